@@ -354,9 +354,31 @@ void FAnimNode_ModifyBodyStateMappedBones::EvaluateComponentPose_AnyThread(FComp
 		{
 			continue;
 		}
+		const double SourceCaptureTime = MappedBoneAnimDataIter.BodyStateSkeleton->SourceCaptureTime;
+		if (SourceCaptureTime > 0 && UBodyStateSkeleton::OnSkeletonEvaluated.IsBound())
+		{
+			UBodyStateSkeleton::OnSkeletonEvaluated.Execute(SourceCaptureTime);
+		}
 		const FBoneContainer& BoneContainer = Output.Pose.GetPose().GetBoneContainer();
 		float BlendWeight = FMath::Clamp<float>(ActualAlpha, 0.f, 1.f);
 
+		// Another mesh with the same device, skeleton and mapping may already have evaluated this pose this frame
+		FBodyStatePoseCacheKey PoseCacheKey;
+		const bool bUsePoseCache = BSAnimInstance->bUseSharedPoseCache && MappedBoneAnimDataIter.CachedBoneList.Num() > 0;
+		if (bUsePoseCache)
+		{
+			PoseCacheKey.BodyStateSkeleton = MappedBoneAnimDataIter.BodyStateSkeleton;
+			PoseCacheKey.SkeletalMesh = BoneContainer.GetSkeletalMeshAsset();
+			BuildPoseCacheKeyData(Output, MappedBoneAnimDataIter, BlendWeight, PoseCacheScratch.KeyData);
+			PoseCacheKey.MappingHash = FCrc::MemCrc32(PoseCacheScratch.KeyData.GetData(), PoseCacheScratch.KeyData.Num());
+
+			if (FBodyStatePoseCache::Get().Find(PoseCacheKey, PoseCacheScratch.KeyData, GFrameCounter, PoseCacheScratch.Transforms))
+			{
+				ApplyCachedPose(Output, PoseCacheScratch, MappedBoneAnimDataIter);
+				continue;
+			}
+		}
+
 		FScopeLock ScopeLock(&MappedBoneAnimDataIter.BodyStateSkeleton->BoneDataLock);
 
 		// cached for elbow position
@@ -429,7 +451,130 @@ void FAnimNode_ModifyBodyStateMappedBones::EvaluateComponentPose_AnyThread(FComp
 			TempTransform.Add(FBoneTransform(ArmOrWrist->MeshBone.GetCompactPoseIndex(BoneContainer), NewBoneTM));
 			Output.Pose.LocalBlendCSBoneTransforms(TempTransform, BlendWeight);
 		}
+
+		if (bUsePoseCache)
+		{
+			StoreCachedPose(Output, PoseCacheKey, MappedBoneAnimDataIter);
+		}
+	}
+}
+
+namespace
+{
+template <typename T>
+void AppendPoseKey(TArray<uint8>& KeyData, const T& Value)
+{
+	KeyData.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+}
+void AppendPoseKeyTransform(TArray<uint8>& KeyData, const FTransform& Transform)
+{
+	// append the components, the vector register layout may carry padding
+	AppendPoseKey(KeyData, Transform.GetTranslation());
+	AppendPoseKey(KeyData, Transform.GetRotation());
+	AppendPoseKey(KeyData, Transform.GetScale3D());
+}
+}	 // namespace
+
+void FAnimNode_ModifyBodyStateMappedBones::BuildPoseCacheKeyData(FComponentSpacePoseContext& Output,
+	const FMappedBoneAnimData& MappedBoneAnimDataIn, const float BlendWeight, TArray<uint8>& OutKeyData)
+{
+	const FBoneContainer& BoneContainer = Output.Pose.GetPose().GetBoneContainer();
+	OutKeyData.Reset();
+
+	// Node and anim instance settings
+	AppendPoseKey(OutKeyData, BlendWeight);
+	AppendPoseKey(OutKeyData, BoneContainer.GetCompactPoseNumBones());
+	AppendPoseKey(OutKeyData, (bool) BSAnimInstance->IsTracking);
+	AppendPoseKey(OutKeyData, BSAnimInstance->ScaleModelToTrackingData);
+	AppendPoseKey(OutKeyData, BSAnimInstance->IgnoreWristTranslation);
+	AppendPoseKey(OutKeyData, BSAnimInstance->GuessElbowPosition);
+	AppendPoseKey(OutKeyData, BSAnimInstance->ModelScaleOffset);
+	AppendPoseKey(OutKeyData, BSAnimInstance->ThumbTipScaleOffset);
+	AppendPoseKey(OutKeyData, BSAnimInstance->IndexTipScaleOffset);
+	AppendPoseKey(OutKeyData, BSAnimInstance->MiddleTipScaleOffset);
+	AppendPoseKey(OutKeyData, BSAnimInstance->RingTipScaleOffset);
+	AppendPoseKey(OutKeyData, BSAnimInstance->PinkyTipScaleOffset);
+	AppendPoseKey(OutKeyData, GetComponentTransformScaleOnly().GetScale3D());
+
+	// the wrist auto correction reads the node's own mapping
+	AppendPoseKey(OutKeyData, MappedBoneAnimData.AutoCorrectRotation);
+	AppendPoseKeyTransform(OutKeyData, MappedBoneAnimData.OffsetTransform);
+
+	// Mapping
+	AppendPoseKey(OutKeyData, MappedBoneAnimDataIn.bShouldDeformMesh);
+	AppendPoseKey(OutKeyData, MappedBoneAnimDataIn.PreBaseRotation);
+	AppendPoseKeyTransform(OutKeyData, MappedBoneAnimDataIn.OffsetTransform);
+	AppendPoseKey(OutKeyData, MappedBoneAnimDataIn.HandModelLength);
+	AppendPoseKey(OutKeyData, MappedBoneAnimDataIn.OriginalScale);
+	AppendPoseKey(OutKeyData, MappedBoneAnimDataIn.AutoCorrectRotation);
+	OutKeyData.Append(reinterpret_cast<const uint8*>(MappedBoneAnimDataIn.FingerTipLengths.GetData()),
+		MappedBoneAnimDataIn.FingerTipLengths.Num() * sizeof(float));
+
+	// Bone links and the incoming pose of each mapped bone, meshes with different animation upstream must not share
+	AppendPoseKey(OutKeyData, MappedBoneAnimDataIn.CachedBoneList.Num());
+	for (const FCachedBoneLink& CachedBone : MappedBoneAnimDataIn.CachedBoneList)
+	{
+		AppendPoseKey(OutKeyData, CachedBone.MeshBone.BoneName);
+		AppendPoseKey(OutKeyData, CachedBone.MeshBone.BoneIndex);
+		AppendPoseKey(OutKeyData, CachedBone.BSBone);
+		if (CachedBone.MeshBone.BoneIndex == -1)
+		{
+			continue;
+		}
+		const FCompactPoseBoneIndex CompactPoseIndex = CachedBone.MeshBone.GetCompactPoseIndex(BoneContainer);
+		if (CompactPoseIndex.IsValid())
+		{
+			AppendPoseKeyTransform(OutKeyData, Output.Pose.GetComponentSpaceTransform(CompactPoseIndex));
+		}
+	}
+}
+
+void FAnimNode_ModifyBodyStateMappedBones::ApplyCachedPose(
+	FComponentSpacePoseContext& Output, const FBodyStateCachedPose& Pose, const FMappedBoneAnimData& MappedBoneAnimDataIn)
+{
+	const FBoneContainer& BoneContainer = Output.Pose.GetPose().GetBoneContainer();
+	const TArray<FCachedBoneLink>& CachedBoneList = MappedBoneAnimDataIn.CachedBoneList;
+
+	// the key data matched, so the stored transforms line up with this node's bone links, resolved here against this
+	// evaluation's bone container as the uncached path does
+	PoseCacheBoneTransforms.Reset();
+	for (int32 i = 0; i < CachedBoneList.Num() && i < Pose.Transforms.Num(); i++)
+	{
+		if (CachedBoneList[i].MeshBone.BoneIndex == -1)
+		{
+			continue;
+		}
+		const FCompactPoseBoneIndex CompactPoseIndex = CachedBoneList[i].MeshBone.GetCompactPoseIndex(BoneContainer);
+		if (CompactPoseIndex.IsValid())
+		{
+			PoseCacheBoneTransforms.Add(FBoneTransform(CompactPoseIndex, Pose.Transforms[i]));
+		}
+	}
+
+	// The stored transforms are final (already blended), parents must be set before children
+	PoseCacheBoneTransforms.Sort(FCompareBoneTransformIndex());
+	Output.Pose.LocalBlendCSBoneTransforms(PoseCacheBoneTransforms, 1.f);
+}
+
+void FAnimNode_ModifyBodyStateMappedBones::StoreCachedPose(
+	FComponentSpacePoseContext& Output, const FBodyStatePoseCacheKey& Key, const FMappedBoneAnimData& MappedBoneAnimDataIn)
+{
+	const FBoneContainer& BoneContainer = Output.Pose.GetPose().GetBoneContainer();
+
+	// KeyData was built for the lookup
+	PoseCacheScratch.FrameEpoch = GFrameCounter;
+	PoseCacheScratch.Transforms.Reset();
+
+	for (const FCachedBoneLink& CachedBone : MappedBoneAnimDataIn.CachedBoneList)
+	{
+		const FCompactPoseBoneIndex CompactPoseIndex = CachedBone.MeshBone.BoneIndex != -1
+														   ? CachedBone.MeshBone.GetCompactPoseIndex(BoneContainer)
+														   : FCompactPoseBoneIndex(INDEX_NONE);
+		// one per bone link, unresolved links keep their slot so indices line up in ApplyCachedPose
+		PoseCacheScratch.Transforms.Add(
+			CompactPoseIndex.IsValid() ? Output.Pose.GetComponentSpaceTransform(CompactPoseIndex) : FTransform::Identity);
 	}
+	FBodyStatePoseCache::Get().Store(Key, PoseCacheScratch);
 }
 bool FAnimNode_ModifyBodyStateMappedBones::IsValidToEvaluate(const USkeleton* Skeleton, const FBoneContainer& RequiredBones)
 {
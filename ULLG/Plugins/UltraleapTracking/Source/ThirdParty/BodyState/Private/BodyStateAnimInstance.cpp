@@ -52,12 +52,19 @@ UBodyStateAnimInstance::UBodyStateAnimInstance(const FObjectInitializer& ObjectI
 	// Defaults
 	DefaultBodyStateIndex = 0;
 	bIncludeMetaCarpels = true;
+	bUseSharedPoseCache = false;
 
 	AutoMapTarget = EBodyStateAutoRigType::HAND_LEFT;
 
 	ModelScaleOffset = ThumbTipScaleOffset = IndexTipScaleOffset = MiddleTipScaleOffset = RingTipScaleOffset = PinkyTipScaleOffset =
 		1.0;
 
+	MirroredBoundsMode = EBSMirroredBoundsMode::BS_MIRRORED_BOUNDS_TRACKED_JOINTS;
+	MirroredBoundsPadding = 5.0f;
+	MirroredBoundsUpdateThreshold = 1.0f;
+	MirroredJointBounds.Init();
+	bWarnedDegenerateMirroredBounds = false;
+
 	UBodyStateBPLibrary::AddDeviceChangeListener(this);
 }
 UBodyStateAnimInstance::~UBodyStateAnimInstance()
@@ -997,8 +1004,18 @@ void UBodyStateAnimInstance::HandleLeftRightFlip(FMappedBoneAnimData& ForMap)
 		Component->SetRelativeScale3D(FVector(1, 1, -1));
 		// Unreal doesn't deal with mirrored scale when in comes to updating the mesh bounds
 		// this means that at 1 bounds scale, the skeletel mesh gets occluded as the bounds are not following the skeleton
-		// Until this is fixed in the engine, we have to force the bounds to be huge to always render.
-		Component->SetBoundsScale(10);
+		if (MirroredBoundsMode == EBSMirroredBoundsMode::BS_MIRRORED_BOUNDS_SCALE)
+		{
+			// force the bounds to be huge to always render, this defeats frustum, occlusion and shadow culling
+			Component->SetBoundsScale(10);
+		}
+		else
+		{
+			// bounds are refitted to the mapped joints from NativeUpdateAnimation
+			MirroredBoundsBoneIndices.Empty();
+			MirroredJointBounds.Init();
+			UpdateMirroredBounds();
+		}
 	}
 	else
 	{
@@ -1006,6 +1023,95 @@ void UBodyStateAnimInstance::HandleLeftRightFlip(FMappedBoneAnimData& ForMap)
 		Component->SetBoundsScale(1);
 	}
 }
+void UBodyStateAnimInstance::UpdateMirroredBounds()
+{
+	USkeletalMeshComponent* Component = GetSkelMeshComponent();
+
+	if (!Component || MirroredBoundsMode != EBSMirroredBoundsMode::BS_MIRRORED_BOUNDS_TRACKED_JOINTS)
+	{
+		return;
+	}
+
+	if (MirroredBoundsBoneIndices.Num() == 0)
+	{
+		for (const FMappedBoneAnimData& Map : MappedBoneList)
+		{
+			if (!Map.FlipModelLeftRight)
+			{
+				continue;
+			}
+			for (const auto& Pair : Map.BoneMap)
+			{
+				const int32 BoneIndex = Component->GetBoneIndex(Pair.Value.MeshBone.BoneName);
+				if (BoneIndex != INDEX_NONE)
+				{
+					MirroredBoundsBoneIndices.AddUnique(BoneIndex);
+				}
+			}
+		}
+		if (MirroredBoundsBoneIndices.Num() == 0)
+		{
+			return;
+		}
+	}
+
+	// last evaluated pose, one frame behind the tracking data which the padding covers
+	const TArray<FTransform>& ComponentSpaceTransforms = Component->GetComponentSpaceTransforms();
+	const FTransform& ComponentToWorld = Component->GetComponentTransform();
+
+	FBox JointBounds(ForceInit);
+	for (const int32 BoneIndex : MirroredBoundsBoneIndices)
+	{
+		if (ComponentSpaceTransforms.IsValidIndex(BoneIndex))
+		{
+			JointBounds += ComponentToWorld.TransformPosition(ComponentSpaceTransforms[BoneIndex].GetLocation());
+		}
+	}
+	if (!JointBounds.IsValid)
+	{
+		return;
+	}
+
+	// Only refit once the joints have moved past the threshold, or the component moved the bounds off the joints
+	const FBox PaddedJoints = JointBounds.ExpandBy(MirroredBoundsPadding);
+	if (MirroredJointBounds.IsValid && Component->Bounds.GetBox().IsInside(PaddedJoints) &&
+		MirroredJointBounds.Min.Equals(JointBounds.Min, MirroredBoundsUpdateThreshold) &&
+		MirroredJointBounds.Max.Equals(JointBounds.Max, MirroredBoundsUpdateThreshold))
+	{
+		return;
+	}
+	MirroredJointBounds = JointBounds;
+
+	// Bounds scale grows the skinned bounds around their centre, find the smallest scale that encloses the joints.
+	// The threshold is added so the joints can move that far before the next refit without leaving the bounds.
+	const FBox Target = JointBounds.ExpandBy(MirroredBoundsPadding + MirroredBoundsUpdateThreshold);
+	const float CurrentScale = FMath::Max(Component->BoundsScale, KINDA_SMALL_NUMBER);
+	const FVector UnscaledExtent = Component->Bounds.BoxExtent / CurrentScale;
+	const float UnscaledRadius = Component->Bounds.SphereRadius / CurrentScale;
+	const FVector Centre = Component->Bounds.Origin;
+
+	if (UnscaledExtent.GetMin() < KINDA_SMALL_NUMBER || UnscaledRadius < KINDA_SMALL_NUMBER)
+	{
+		// degenerate mesh bounds, nothing to scale from. Keep the last fitted scale and try again next update
+		if (!bWarnedDegenerateMirroredBounds)
+		{
+			UE_LOG(BodyStateLog, Warning, TEXT("%s has degenerate mesh bounds, mirrored bounds keep a bounds scale of %.2f."),
+				*Component->GetPathName(), Component->BoundsScale);
+			bWarnedDegenerateMirroredBounds = true;
+		}
+		MirroredJointBounds.Init();
+		return;
+	}
+
+	const FVector FarExtent = (Target.Max - Centre).GetAbs().ComponentMax((Target.Min - Centre).GetAbs());
+	float RequiredScale = (FarExtent / UnscaledExtent).GetMax();
+	RequiredScale = FMath::Max(RequiredScale, FarExtent.Size() / UnscaledRadius);
+
+	if (!FMath::IsNearlyEqual(RequiredScale, Component->BoundsScale, 0.01f))
+	{
+		Component->SetBoundsScale(RequiredScale);
+	}
+}
 UBodyStateSkeleton* UBodyStateAnimInstance::GetCurrentSkeleton()
 {
 	UBodyStateSkeleton* Skeleton = nullptr;
@@ -1101,6 +1207,15 @@ void UBodyStateAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
 		BodyStateSkeleton->bTrackingActive = !bFreezeTracking;
 		IsTracking = CalcIsTracking();
 	}
+
+	for (const FMappedBoneAnimData& Map : MappedBoneList)
+	{
+		if (Map.FlipModelLeftRight)
+		{
+			UpdateMirroredBounds();
+			break;
+		}
+	}
 }
 // static
 const FName& UBodyStateAnimInstance::GetMeshBoneNameFromCachedBoneLink(const FCachedBoneLink& CachedBoneLink)
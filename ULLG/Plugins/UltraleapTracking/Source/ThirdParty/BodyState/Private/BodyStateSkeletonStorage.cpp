@@ -58,6 +58,11 @@ int32 FBodyStateSkeletonStorage::AddDevice(const FBodyStateDevice& InDevice)
 	Device.Skeleton->TrackingTags = Device.Config.TrackingTags;
 	Device.Skeleton->AddToRoot();
 
+	// Arms are lazily created UObjects, create them here on the game thread so
+	// parallel UpdateInput tasks never allocate them
+	Device.Skeleton->LeftArm();
+	Device.Skeleton->RightArm();
+
 	Devices.Add(Device.InputCallbackDelegate, Device);
 	DeviceKeyMap.Add(Device.DeviceId, Device.InputCallbackDelegate);
 
@@ -148,9 +153,6 @@ UBodyStateSkeleton* FBodyStateSkeletonStorage::MergedSkeleton()
 
 void FBodyStateSkeletonStorage::UpdateMergeSkeletonData()
 {
-	double Now = FApp::GetCurrentTime();
-	DeltaTime = (Now - LastFrameTime);
-
 	// Basic merge of skeleton data
 	MergedSkeleton();
 
@@ -159,9 +161,26 @@ void FBodyStateSkeletonStorage::UpdateMergeSkeletonData()
 		return;
 	}
 
+	MergeDeviceSkeletons();
+
+	// Dispatch estimator function lambdas which give merge skeleton and expect further updated values
+	CallMergingFunctions();
+}
+
+void FBodyStateSkeletonStorage::MergeDeviceSkeletons()
+{
+	double Now = FApp::GetCurrentTime();
+	DeltaTime = (Now - LastFrameTime);
+
+	if (!PrivateMergedSkeleton || !PrivateMergedSkeleton->bTrackingActive)
+	{
+		return;
+	}
+
 	// Reset our confidence
 	PrivateMergedSkeleton->ClearConfidence();
 	PrivateMergedSkeleton->TrackingTags.Empty();
+	PrivateMergedSkeleton->SourceCaptureTime = 0;
 
 	// Merges all skeleton data
 	{
@@ -173,14 +192,16 @@ void FBodyStateSkeletonStorage::UpdateMergeSkeletonData()
 		}
 	}
 
-	// Dispatch estimator function lambdas which give merge skeleton and expect further updated values
-	CallMergingFunctions();
-
 	LastFrameTime = Now;
 }
 
 void FBodyStateSkeletonStorage::CallMergingFunctions()
 {
+	if (!PrivateMergedSkeleton || !PrivateMergedSkeleton->bTrackingActive)
+	{
+		return;
+	}
+
 	// Call all merging functions on our private merged skeleton
 	for (auto& Pair : MergingFunctions)
 	{
@@ -58,6 +58,8 @@ public:
 	UBodyStateSkeleton* MergedSkeleton();
 
 	void UpdateMergeSkeletonData();
+	/** Merge step of UpdateMergeSkeletonData without the merging functions */
+	void MergeDeviceSkeletons();
 	void CallMergingFunctions();
 
 	// Merging functions add/remove
@@ -20,12 +20,20 @@
 
 #include "FBodyStateInputDevice.h"
 
+#include "Async/TaskGraphInterfaces.h"
 #include "BodyStateBoneComponent.h"
 #include "BodyStateDevice.h"
 #include "BodyStateHMDSnapshot.h"
 #include "BodyStateInputInterface.h"
 #include "BodyStateSkeletonStorage.h"
 #include "Framework/Application/SlateApplication.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+
+static TAutoConsoleVariable<int32> CVarBodyStateParallelInputDispatch(TEXT("bs.ParallelInputDispatch"), 1,
+	TEXT("1 to update thread safe BodyState devices as parallel tasks joined before the merge, 0 to update all devices ")
+	TEXT("sequentially on the game thread."),
+	ECVF_Default);
 
 // UE v4.6 IM event wrappers
 bool FBodyStateInputDevice::EmitKeyUpEventForKey(FKey Key, int32 User, bool Repeat)
@@ -119,15 +127,58 @@ void FBodyStateInputDevice::SendControllerEvents()
 /************************************************************************/
 void FBodyStateInputDevice::DispatchInput()
 {
-	// TODO expand this
+	const bool bParallel = CVarBodyStateParallelInputDispatch.GetValueOnGameThread() != 0 &&
+						   FApp::ShouldUseThreadingForPerformance();
+
+	if (!bParallel)
+	{
+		// Fetch input from all attached devices
+		SkeletonStorage->CallFunctionOnDevices(
+			[this](const FBodyStateDevice& Device) { Device.InputCallbackDelegate->UpdateInput(Device.DeviceId, Device.Skeleton); });
+		return;
+	}
 
-	// Fetch input from all attached devices
+	// Each device only writes its own skeleton, fan out one task per thread safe device and
+	// update the rest (e.g. HMD) on the game thread while the tasks run
+	InputTasks.Reset();
+	SkeletonStorage->CallFunctionOnDevices(
+		[this](const FBodyStateDevice& Device)
+		{
+			if (Device.InputCallbackDelegate->SupportsParallelUpdateInput())
+			{
+				IBodyStateInputRawInterface* InputCallbackDelegate = Device.InputCallbackDelegate;
+				const int32 DeviceId = Device.DeviceId;
+				UBodyStateSkeleton* Skeleton = Device.Skeleton;
+
+				InputTasks.Add(FFunctionGraphTask::CreateAndDispatchWhenReady(
+					[InputCallbackDelegate, DeviceId, Skeleton]() { InputCallbackDelegate->UpdateInput(DeviceId, Skeleton); },
+					TStatId(), nullptr, ENamedThreads::AnyHiPriThreadHiPriTask));
+			}
+		});
 	SkeletonStorage->CallFunctionOnDevices(
-		[this](const FBodyStateDevice& Device) { Device.InputCallbackDelegate->UpdateInput(Device.DeviceId, Device.Skeleton); });
+		[this](const FBodyStateDevice& Device)
+		{
+			if (!Device.InputCallbackDelegate->SupportsParallelUpdateInput())
+			{
+				Device.InputCallbackDelegate->UpdateInput(Device.DeviceId, Device.Skeleton);
+			}
+		});
 }
 
 void FBodyStateInputDevice::DispatchEstimators()
 {
+	if (InputTasks.Num() > 0)
+	{
+		// Join the device tasks, then merge here, the merge has nothing to run alongside and the merging functions
+		// may call into blueprints and so must run on the game thread
+		FTaskGraphInterface::Get().WaitUntilTasksComplete(InputTasks, ENamedThreads::GameThread_Local);
+		InputTasks.Reset();
+
+		SkeletonStorage->MergeDeviceSkeletons();
+		SkeletonStorage->CallMergingFunctions();
+		return;
+	}
+
 	// Copy results to merged skeleton and obtain estimator data if any
 	SkeletonStorage->UpdateMergeSkeletonData();
 }
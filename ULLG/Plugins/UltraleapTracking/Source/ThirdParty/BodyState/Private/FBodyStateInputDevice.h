@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "Async/TaskGraphInterfaces.h"
 #include "BodyStateDevice.h"
 #include "CoreMinimal.h"
 #include "IInputDevice.h"
@@ -77,6 +78,9 @@ private:
 
 	TArray<UBodyStateBoneComponent*> BoneSceneListeners;
 
+	// Outstanding per device UpdateInput tasks, joined in DispatchEstimators
+	FGraphEventArray InputTasks;
+
 	// Private utility methods
 	bool EmitKeyUpEventForKey(FKey Key, int32 User, bool Repeat);
 	bool EmitKeyDownEventForKey(FKey Key, int32 User, bool Repeat);
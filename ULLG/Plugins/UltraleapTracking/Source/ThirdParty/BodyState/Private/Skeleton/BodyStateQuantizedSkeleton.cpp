@@ -0,0 +1,167 @@
+/*************************************************************************************************************************************
+ *The MIT License(MIT)
+ *
+ *Copyright(c) 2016 Jan Kaniewski(Getnamo)
+ *Modified work Copyright(C) 2019 - 2021 Ultraleap, Inc.
+ *
+ *Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+ *files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify,
+ *merge, publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is
+ *furnished to do so, subject to the following conditions :
+ *
+ *The above copyright notice and this permission notice shall be included in all copies or
+ *substantial portions of the Software.
+ *
+ *THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ *FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************************************/
+
+#include "Skeleton/BodyStateQuantizedSkeleton.h"
+
+#include "BodyStateUtility.h"
+#include "Engine/NetSerialization.h"
+
+namespace
+{
+// Largest possible value of the three smallest components of a unit quaternion
+const float SmallestThreeRange = 0.70710678f;
+const uint32 RotationComponentMax = (1u << FQuantizedBone::RotationComponentBits) - 1;
+
+uint32 QuantizeComponent(float Value)
+{
+	const float Normalized = (FMath::Clamp(Value, -SmallestThreeRange, SmallestThreeRange) + SmallestThreeRange) /
+							 (2.f * SmallestThreeRange);
+	return (uint32) FMath::RoundToInt(Normalized * RotationComponentMax);
+}
+
+float DequantizeComponent(uint32 Value)
+{
+	return ((float) Value / RotationComponentMax) * (2.f * SmallestThreeRange) - SmallestThreeRange;
+}
+}	 // namespace
+
+uint32 FQuantizedBone::PackRotation(const FQuat& Rotation)
+{
+	FQuat Normalized = Rotation.GetNormalized();
+	const float Components[4] = {(float) Normalized.X, (float) Normalized.Y, (float) Normalized.Z, (float) Normalized.W};
+
+	int32 LargestIndex = 0;
+	for (int32 i = 1; i < 4; i++)
+	{
+		if (FMath::Abs(Components[i]) > FMath::Abs(Components[LargestIndex]))
+		{
+			LargestIndex = i;
+		}
+	}
+
+	// q and -q are the same rotation, flip so the dropped component is always positive
+	const float Sign = Components[LargestIndex] < 0.f ? -1.f : 1.f;
+
+	uint32 Packed = (uint32) LargestIndex;
+	for (int32 i = 0; i < 4; i++)
+	{
+		if (i != LargestIndex)
+		{
+			Packed = (Packed << RotationComponentBits) | QuantizeComponent(Components[i] * Sign);
+		}
+	}
+	return Packed;
+}
+
+FQuat FQuantizedBone::UnpackRotation(uint32 Packed)
+{
+	const int32 LargestIndex = (Packed >> (RotationComponentBits * 3)) & 0x3;
+
+	float Components[4];
+	float SumSquares = 0.f;
+	int32 Shift = RotationComponentBits * 2;
+	for (int32 i = 0; i < 4; i++)
+	{
+		if (i != LargestIndex)
+		{
+			Components[i] = DequantizeComponent((Packed >> Shift) & RotationComponentMax);
+			SumSquares += Components[i] * Components[i];
+			Shift -= RotationComponentBits;
+		}
+	}
+	Components[LargestIndex] = FMath::Sqrt(FMath::Max(0.f, 1.f - SumSquares));
+
+	FQuat Result(Components[0], Components[1], Components[2], Components[3]);
+	Result.Normalize();
+	return Result;
+}
+
+void FQuantizedBone::SetFromTransform(const FTransform& Transform, const FVector& RootPosition)
+{
+	PackedRotation = PackRotation(Transform.GetRotation());
+
+	const FVector Relative = (Transform.GetTranslation() - RootPosition) * PositionScale;
+	for (int32 i = 0; i < 3; i++)
+	{
+		PackedPosition[i] = (int16) FMath::Clamp(FMath::RoundToInt(Relative[i]), (int32) MIN_int16, (int32) MAX_int16);
+	}
+}
+
+FTransform FQuantizedBone::ToTransform(const FVector& RootPosition) const
+{
+	const FVector Relative(PackedPosition[0], PackedPosition[1], PackedPosition[2]);
+	return FTransform(UnpackRotation(PackedRotation), RootPosition + Relative / PositionScale);
+}
+
+bool FQuantizedSkeletonData::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	Ar << Sequence;
+
+	uint8 bKeyframeBit = bIsKeyframe ? 1 : 0;
+	Ar.SerializeBits(&bKeyframeBit, 1);
+	bIsKeyframe = bKeyframeBit != 0;
+
+	if (bIsKeyframe)
+	{
+		BaselineSequence = Sequence;
+		bOutSuccess &= SerializePackedVector<100, 30>(RootPosition, Ar);
+	}
+	else
+	{
+		Ar << BaselineSequence;
+	}
+
+	Ar << TrackedMask[0];
+	Ar << TrackedMask[1];
+
+	const uint32 MaxBones = (uint32) EBodyStateBasicBoneType::BONES_COUNT;
+	uint32 NumBones = Bones.Num();
+	Ar.SerializeInt(NumBones, MaxBones + 1);
+
+	if (Ar.IsLoading())
+	{
+		if (NumBones > MaxBones)
+		{
+			bOutSuccess = false;
+			return true;
+		}
+		Bones.SetNumUninitialized(NumBones);
+	}
+
+	for (FQuantizedBone& Bone : Bones)
+	{
+		uint32 BoneIndex = Bone.BoneIndex;
+		Ar.SerializeInt(BoneIndex, MaxBones);
+		Bone.BoneIndex = (uint8) BoneIndex;
+
+		Ar.SerializeBits(&Bone.PackedRotation, FQuantizedBone::RotationComponentBits * 3 + 2);
+		Ar << Bone.PackedPosition[0];
+		Ar << Bone.PackedPosition[1];
+		Ar << Bone.PackedPosition[2];
+	}
+
+	if (Ar.IsError())
+	{
+		bOutSuccess = false;
+	}
+	return true;
+}
@@ -22,10 +22,21 @@
 
 #include "BodyStateUtility.h"
 
+FOnBodyStateSkeletonEvaluated UBodyStateSkeleton::OnSkeletonEvaluated;
+
 UBodyStateSkeleton::UBodyStateSkeleton(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
 	// Todo: build
 
+	NetUpdateRate = 30.f;
+	NetKeyframeInterval = 10;
+	NetPositionTolerance = 0.05f;
+	NetRotationTolerance = 0.25f;
+	NetSendSequence = 0;
+	NetUpdatesSinceKeyframe = 0;
+	NetLastSendTime = 0.0;
+	SourceCaptureTime = 0.0;
+
 	// add a bone for each possible bone in the skeleton
 	for (int i = 0; i < (int32) EBodyStateBasicBoneType::BONES_COUNT; i++)
 	{
@@ -411,6 +422,76 @@ FNamedSkeletonData UBodyStateSkeleton::GetMinimalNamedSkeletonData()
 	return NamedSkeleton;
 }
 
+FQuantizedSkeletonData UBodyStateSkeleton::GetQuantizedSkeletonData()
+{
+	FQuantizedSkeletonData QuantizedSkeleton;
+
+	const bool bKeyframe = !NetSendBaseline.bValid || NetKeyframeInterval <= 1 || NetUpdatesSinceKeyframe >= NetKeyframeInterval;
+
+	QuantizedSkeleton.Sequence = NetSendSequence++;
+	QuantizedSkeleton.bIsKeyframe = bKeyframe;
+
+	if (bKeyframe)
+	{
+		NetSendBaseline.Reset();
+		NetSendBaseline.Sequence = QuantizedSkeleton.Sequence;
+		NetSendBaseline.RootPosition = RootBone()->Position();
+		NetUpdatesSinceKeyframe = 0;
+	}
+	NetUpdatesSinceKeyframe++;
+
+	QuantizedSkeleton.BaselineSequence = NetSendBaseline.Sequence;
+	QuantizedSkeleton.RootPosition = NetSendBaseline.RootPosition;
+
+	const float PositionTolerance = NetPositionTolerance * FQuantizedBone::PositionScale;
+	const float RotationTolerance = FMath::DegreesToRadians(NetRotationTolerance);
+
+	FScopeLock ScopeLock(&BoneDataLock);
+	for (int32 i = 0; i < Bones.Num(); i++)
+	{
+		if (!Bones[i]->IsTracked())
+		{
+			continue;
+		}
+		FQuantizedSkeletonData::SetBoneTracked(QuantizedSkeleton.TrackedMask, i);
+
+		FQuantizedBone QuantizedBone;
+		QuantizedBone.BoneIndex = (uint8) i;
+		QuantizedBone.SetFromTransform(Bones[i]->BoneData.Transform, QuantizedSkeleton.RootPosition);
+
+		if (bKeyframe)
+		{
+			FQuantizedSkeletonData::SetBoneTracked(NetSendBaseline.TrackedMask, i);
+			NetSendBaseline.Bones[i] = QuantizedBone;
+			QuantizedSkeleton.Bones.Add(QuantizedBone);
+			continue;
+		}
+
+		// Delta, only send bones that are new or moved away from the keyframe
+		bool bChanged = !FQuantizedSkeletonData::IsBoneTracked(NetSendBaseline.TrackedMask, i);
+		if (!bChanged)
+		{
+			const FQuantizedBone& Baseline = NetSendBaseline.Bones[i];
+			for (int32 Axis = 0; Axis < 3 && !bChanged; Axis++)
+			{
+				bChanged = FMath::Abs(QuantizedBone.PackedPosition[Axis] - Baseline.PackedPosition[Axis]) > PositionTolerance;
+			}
+			if (!bChanged && QuantizedBone.PackedRotation != Baseline.PackedRotation)
+			{
+				bChanged = FQuantizedBone::UnpackRotation(QuantizedBone.PackedRotation)
+							   .AngularDistance(FQuantizedBone::UnpackRotation(Baseline.PackedRotation)) > RotationTolerance;
+			}
+		}
+		if (bChanged)
+		{
+			QuantizedSkeleton.Bones.Add(QuantizedBone);
+		}
+	}
+	NetSendBaseline.bValid = true;
+
+	return QuantizedSkeleton;
+}
+
 void UBodyStateSkeleton::ResetToDefaultSkeleton()
 {
 	for (int i = 0; i < Bones.Num(); i++)
@@ -471,6 +552,60 @@ void UBodyStateSkeleton::SetFromNamedSkeletonData(const FNamedSkeletonData& Name
 	}
 }
 
+void UBodyStateSkeleton::SetFromQuantizedSkeletonData(const FQuantizedSkeletonData& QuantizedSkeletonData)
+{
+	const int32 BoneCount = (int32) EBodyStateBasicBoneType::BONES_COUNT;
+
+	if (QuantizedSkeletonData.bIsKeyframe)
+	{
+		NetReceiveBaseline.Reset();
+		NetReceiveBaseline.Sequence = QuantizedSkeletonData.Sequence;
+		NetReceiveBaseline.RootPosition = QuantizedSkeletonData.RootPosition;
+		for (const FQuantizedBone& QuantizedBone : QuantizedSkeletonData.Bones)
+		{
+			if (QuantizedBone.BoneIndex < BoneCount)
+			{
+				NetReceiveBaseline.Bones[QuantizedBone.BoneIndex] = QuantizedBone;
+				FQuantizedSkeletonData::SetBoneTracked(NetReceiveBaseline.TrackedMask, QuantizedBone.BoneIndex);
+			}
+		}
+		NetReceiveBaseline.bValid = true;
+	}
+	else if (!NetReceiveBaseline.bValid || NetReceiveBaseline.Sequence != QuantizedSkeletonData.BaselineSequence)
+	{
+		// Keyframe for this delta was lost, wait for the next one
+		return;
+	}
+
+	// Bones not in the packet are unchanged from the keyframe
+	const FQuantizedBone* BoneSources[BoneCount];
+	for (int32 i = 0; i < BoneCount; i++)
+	{
+		BoneSources[i] =
+			FQuantizedSkeletonData::IsBoneTracked(NetReceiveBaseline.TrackedMask, i) ? &NetReceiveBaseline.Bones[i] : nullptr;
+	}
+	for (const FQuantizedBone& QuantizedBone : QuantizedSkeletonData.Bones)
+	{
+		if (QuantizedBone.BoneIndex < BoneCount)
+		{
+			BoneSources[QuantizedBone.BoneIndex] = &QuantizedBone;
+		}
+	}
+
+	FScopeLock ScopeLock(&BoneDataLock);
+	ResetToDefaultSkeleton();
+	ClearConfidence();
+
+	for (int32 i = 0; i < BoneCount && i < Bones.Num(); i++)
+	{
+		if (BoneSources[i] && FQuantizedSkeletonData::IsBoneTracked(QuantizedSkeletonData.TrackedMask, i))
+		{
+			Bones[i]->BoneData.SetFromTransform(BoneSources[i]->ToTransform(NetReceiveBaseline.RootPosition));
+			Bones[i]->Meta.Confidence = 1.f;
+		}
+	}
+}
+
 // Not fully deep copy atm, but usable
 void UBodyStateSkeleton::SetFromOtherSkeleton(UBodyStateSkeleton* Other)
 {
@@ -488,6 +623,7 @@ void UBodyStateSkeleton::SetFromOtherSkeleton(UBodyStateSkeleton* Other)
 		Bone->BoneData = OtherBone->BoneData;
 		Bone->Meta = OtherBone->Meta;
 	}
+	SourceCaptureTime = Other->SourceCaptureTime;
 }
 
 void UBodyStateSkeleton::MergeFromOtherSkeleton(UBodyStateSkeleton* Other)
@@ -500,6 +636,9 @@ void UBodyStateSkeleton::MergeFromOtherSkeleton(UBodyStateSkeleton* Other)
 	
 	if (Other->Name != "HMD")
 	{
+		// the merged skeleton is as fresh as its newest source
+		SourceCaptureTime = FMath::Max(SourceCaptureTime, Other->SourceCaptureTime);
+
 		for (int i = 0; i < Bones.Num(); i++)
 		{
 			UBodyStateBone* OtherBone = Other->Bones[i];
@@ -583,6 +722,36 @@ void UBodyStateSkeleton::Multi_UpdateBodyState_Implementation(const FNamedSkelet
 	SetFromNamedSkeletonData(InBodyStateSkeleton);
 	Name = TEXT("Network");
 }
+bool UBodyStateSkeleton::ServerUpdateQuantizedBodyState_Validate(FQuantizedSkeletonData BodyState)
+{
+	return BodyState.Bones.Num() <= (int32) EBodyStateBasicBoneType::BONES_COUNT;
+}
+
+void UBodyStateSkeleton::ServerUpdateQuantizedBodyState_Implementation(const FQuantizedSkeletonData InBodyStateSkeleton)
+{
+	// Multi cast to everybody
+	Multi_UpdateQuantizedBodyState(InBodyStateSkeleton);
+}
+
+void UBodyStateSkeleton::Multi_UpdateQuantizedBodyState_Implementation(const FQuantizedSkeletonData InBodyStateSkeleton)
+{
+	SetFromQuantizedSkeletonData(InBodyStateSkeleton);
+	Name = TEXT("Network");
+}
+
+bool UBodyStateSkeleton::ReplicateQuantizedBodyState()
+{
+	const double Now = FPlatformTime::Seconds();
+	if (NetUpdateRate > 0.f && (Now - NetLastSendTime) < (1.0 / NetUpdateRate))
+	{
+		return false;
+	}
+	NetLastSendTime = Now;
+
+	ServerUpdateQuantizedBodyState(GetQuantizedSkeletonData());
+	return true;
+}
+
 void UBodyStateSkeleton::ReleaseRefs()
 {
 	if (PrivateLeftArm && PrivateLeftArm->IsValidLowLevel())
@@ -0,0 +1,233 @@
+/*************************************************************************************************************************************
+ *The MIT License(MIT)
+ *
+ *Copyright(c) 2016 Jan Kaniewski(Getnamo)
+ *Modified work Copyright(C) 2019 - 2021 Ultraleap, Inc.
+ *
+ *Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+ *files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify,
+ *merge, publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is
+ *furnished to do so, subject to the following conditions :
+ *
+ *The above copyright notice and this permission notice shall be included in all copies or
+ *substantial portions of the Software.
+ *
+ *THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ *FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************************************/
+
+#include "BodyStateAnimInstance.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+const TCHAR* MirroredBoundsTestMesh = TEXT("/UltraleapTracking/Mesh/LowPoly_Rigged_Hand_Left.LowPoly_Rigged_Hand_Left");
+const TCHAR* MirroredBoundsTestAnimClass = TEXT("/UltraleapTracking/BodyState/BSLowPolyLeftAnimBP.BSLowPolyLeftAnimBP_C");
+constexpr int32 NumSweepFrames = 240;
+// In front of the camera, about where tracked hands are
+constexpr float HandDistance = 60.f;
+// Around each joint for the skinned surface
+constexpr float JointRadius = 3.f;
+
+struct FBoundsStats
+{
+	// A joint in view while the bounds aren't, the mesh and its shadow are culled while visible
+	int32 PopFrames = 0;
+	// The bounds in view while no joint is, the mesh and its shadow are drawn for nothing
+	int32 WastedFrames = 0;
+	// A joint outside the bounds box
+	int32 EscapedFrames = 0;
+	double RadiusSum = 0.0;
+};
+
+// The same flipped hand in each mode, swept sideways across the view of the map's player camera
+struct FMirroredBoundsComparison
+{
+	UWorld* World = nullptr;
+	USkeletalMeshComponent* Meshes[2] = {};
+	FBoundsStats Stats[2];
+	FVector CameraLocation = FVector::ZeroVector;
+	FRotator CameraRotation = FRotator::ZeroRotator;
+	float HalfFov = PI / 4.f;
+	int32 Frame = 0;
+
+	bool SphereInView(const FVector& Centre, const float Radius) const
+	{
+		const FVector ToCentre = Centre - CameraLocation;
+		const float Distance = ToCentre.Size();
+		if (Distance <= Radius)
+		{
+			return true;
+		}
+		// a cone around the view direction, wider than the frustum's corners only at the horizontal edges
+		const float Cosine = FVector::DotProduct(ToCentre / Distance, CameraRotation.Vector());
+		const float Angle = FMath::Acos(FMath::Clamp(Cosine, -1.f, 1.f));
+		return Angle - FMath::Asin(Radius / Distance) < HalfFov;
+	}
+
+	void Measure(const int32 ModeIndex)
+	{
+		const USkeletalMeshComponent* Mesh = Meshes[ModeIndex];
+		FBoundsStats& ModeStats = Stats[ModeIndex];
+		const FTransform& ComponentToWorld = Mesh->GetComponentTransform();
+		const FBox BoundsBox = Mesh->Bounds.GetBox();
+
+		bool bJointInView = false;
+		bool bJointEscaped = false;
+		for (const FTransform& Bone : Mesh->GetComponentSpaceTransforms())
+		{
+			const FVector Joint = ComponentToWorld.TransformPosition(Bone.GetLocation());
+			bJointInView |= SphereInView(Joint, JointRadius);
+			bJointEscaped |= !BoundsBox.IsInsideOrOn(Joint);
+		}
+		const bool bBoundsInView = SphereInView(Mesh->Bounds.Origin, Mesh->Bounds.SphereRadius);
+
+		ModeStats.PopFrames += bJointInView && !bBoundsInView ? 1 : 0;
+		ModeStats.WastedFrames += bBoundsInView && !bJointInView ? 1 : 0;
+		ModeStats.EscapedFrames += bJointEscaped ? 1 : 0;
+		ModeStats.RadiusSum += Mesh->Bounds.SphereRadius;
+	}
+
+	// From well outside the left edge of the view to well outside the right, bobbing up and down
+	FVector SweepLocation(const int32 SweepFrame) const
+	{
+		const float Alpha = (float) SweepFrame / (NumSweepFrames - 1);
+		const float HalfWidth = HandDistance * FMath::Tan(HalfFov);
+		const FRotationMatrix View(CameraRotation);
+		return CameraLocation + View.GetScaledAxis(EAxis::X) * HandDistance +
+			   View.GetScaledAxis(EAxis::Y) * FMath::Lerp(-2.f * HalfWidth, 2.f * HalfWidth, Alpha) +
+			   View.GetScaledAxis(EAxis::Z) * 10.f * FMath::Sin(Alpha * 4.f * PI);
+	}
+};
+}	 // namespace
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FBodyStateMirroredBoundsMapTest, "BodyState.MirroredBounds.MapComparison",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+void FBodyStateMirroredBoundsMapTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	OutBeautifiedNames.Add(TEXT("TestLevel"));
+	OutTestCommands.Add(TEXT("/Game/Maps/TestLevel"));
+	OutBeautifiedNames.Add(TEXT("TestCapsuleHands"));
+	OutTestCommands.Add(TEXT("/UltraleapTracking/DirectRigging/CapsuleHands/TestCapsuleHands"));
+}
+
+bool FBodyStateMirroredBoundsMapTest::RunTest(const FString& Parameters)
+{
+	if (!AutomationOpenMap(Parameters))
+	{
+		AddError(FString::Printf(TEXT("Couldn't open %s."), *Parameters));
+		return false;
+	}
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitLatentCommand(1.f));
+
+	TSharedRef<FMirroredBoundsComparison> Comparison = MakeShared<FMirroredBoundsComparison>();
+	const TCHAR* ModeNames[2] = {TEXT("tracked joints"), TEXT("bounds scale 10")};
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand(
+		[this, Comparison, ModeNames, Parameters]()
+		{
+			if (!Comparison->World)
+			{
+				// loaded once the map is, which collects garbage
+				USkeletalMesh* SkeletalMesh = LoadObject<USkeletalMesh>(nullptr, MirroredBoundsTestMesh);
+				UClass* AnimClass = LoadObject<UClass>(nullptr, MirroredBoundsTestAnimClass);
+				Comparison->World = AutomationCommon::GetAnyGameWorld();
+				if (!SkeletalMesh || !AnimClass || !Comparison->World)
+				{
+					AddError(FString::Printf(TEXT("Couldn't load the low poly hand and BodyState anim blueprint into %s."), *Parameters));
+					return true;
+				}
+				if (APlayerController* PlayerController = GEngine->GetFirstLocalPlayerController(Comparison->World))
+				{
+					if (PlayerController->PlayerCameraManager)
+					{
+						Comparison->CameraLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+						Comparison->CameraRotation = PlayerController->PlayerCameraManager->GetCameraRotation();
+						Comparison->HalfFov = FMath::DegreesToRadians(PlayerController->PlayerCameraManager->GetFOVAngle() * .5f);
+					}
+				}
+
+				const EBSMirroredBoundsMode Modes[2] = {
+					EBSMirroredBoundsMode::BS_MIRRORED_BOUNDS_TRACKED_JOINTS, EBSMirroredBoundsMode::BS_MIRRORED_BOUNDS_SCALE};
+				for (int32 ModeIndex = 0; ModeIndex < 2; ModeIndex++)
+				{
+					USkeletalMeshComponent* Mesh = NewObject<USkeletalMeshComponent>(Comparison->World);
+					Mesh->SetSkeletalMesh(SkeletalMesh);
+					Mesh->SetAnimInstanceClass(AnimClass);
+					Mesh->SetWorldLocation(Comparison->SweepLocation(0));
+					Mesh->RegisterComponentWithWorld(Comparison->World);
+					// no actor owns it
+					Mesh->AddToRoot();
+					Comparison->Meshes[ModeIndex] = Mesh;
+
+					UBodyStateAnimInstance* AnimInstance = Cast<UBodyStateAnimInstance>(Mesh->GetAnimInstance());
+					if (!AnimInstance || AnimInstance->MappedBoneList.Num() == 0)
+					{
+						AddError(TEXT("The BodyState anim blueprint has no bone map to mirror."));
+						continue;
+					}
+					// initialising again applies the flip with the mode, as a flipped asset would on load
+					AnimInstance->MappedBoneList[0].FlipModelLeftRight = true;
+					AnimInstance->MirroredBoundsMode = Modes[ModeIndex];
+					Mesh->InitAnim(true);
+				}
+				return false;
+			}
+
+			// the bounds and pose of the last tick at the location set before it
+			if (Comparison->Frame > 0)
+			{
+				for (int32 ModeIndex = 0; ModeIndex < 2; ModeIndex++)
+				{
+					Comparison->Measure(ModeIndex);
+				}
+			}
+			if (Comparison->Frame < NumSweepFrames)
+			{
+				for (USkeletalMeshComponent* Mesh : Comparison->Meshes)
+				{
+					Mesh->SetWorldLocation(Comparison->SweepLocation(Comparison->Frame));
+				}
+				Comparison->Frame++;
+				return false;
+			}
+
+			const FBoundsStats& Tracked = Comparison->Stats[0];
+			const FBoundsStats& Scaled = Comparison->Stats[1];
+			for (int32 ModeIndex = 0; ModeIndex < 2; ModeIndex++)
+			{
+				const FBoundsStats& ModeStats = Comparison->Stats[ModeIndex];
+				AddInfo(FString::Printf(TEXT("%s, %s: %d frames culled while visible, %d frames drawn while out of view, ")
+										TEXT("%d frames with joints outside the bounds, mean bounds radius %.1fcm"),
+					*Parameters, ModeNames[ModeIndex], ModeStats.PopFrames, ModeStats.WastedFrames, ModeStats.EscapedFrames,
+					ModeStats.RadiusSum / NumSweepFrames));
+			}
+			TestEqual(TEXT("Tracked joint bounds are never culled while the hand is in view"), Tracked.PopFrames, 0);
+			TestEqual(TEXT("Tracked joint bounds always enclose the joints"), Tracked.EscapedFrames, 0);
+			TestTrue(TEXT("Tracked joint bounds are tighter than the scaled bounds"), Tracked.RadiusSum < Scaled.RadiusSum);
+			TestTrue(TEXT("Tracked joint bounds are drawn out of view no more often than the scaled bounds"),
+				Tracked.WastedFrames <= Scaled.WastedFrames);
+
+			for (USkeletalMeshComponent* Mesh : Comparison->Meshes)
+			{
+				Mesh->RemoveFromRoot();
+				Mesh->DestroyComponent();
+			}
+			return true;
+		}));
+	return true;
+}
+
+#endif
@@ -0,0 +1,235 @@
+/*************************************************************************************************************************************
+ *The MIT License(MIT)
+ *
+ *Copyright(c) 2016 Jan Kaniewski(Getnamo)
+ *Modified work Copyright(C) 2019 - 2021 Ultraleap, Inc.
+ *
+ *Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+ *files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify,
+ *merge, publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is
+ *furnished to do so, subject to the following conditions :
+ *
+ *The above copyright notice and this permission notice shall be included in all copies or
+ *substantial portions of the Software.
+ *
+ *THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ *FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************************************/
+
+#include "BodyStateAnimInstance.h"
+#include "BodyStatePoseCache.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/World.h"
+#include "Misc/AutomationTest.h"
+#include "Skeleton/BodyStateSkeleton.h"
+#include "Tests/AutomationCommon.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+const TCHAR* PoseCacheTestMesh = TEXT("/UltraleapTracking/Mesh/LowPoly_Rigged_Hand_Left.LowPoly_Rigged_Hand_Left");
+const TCHAR* PoseCacheTestAnimClass = TEXT("/UltraleapTracking/BodyState/BSLowPolyLeftAnimBP.BSLowPolyLeftAnimBP_C");
+constexpr int32 NumAvatars = 32;
+constexpr int32 NumBenchmarkFrames = 60;
+
+struct FPoseCacheBenchmark
+{
+	UWorld* World = nullptr;
+	UBodyStateSkeleton* Skeleton = nullptr;
+	TArray<USkeletalMeshComponent*> Meshes;
+	int32 Frame = 0;
+	uint64 UncachedCycles = 0;
+	uint64 CachedCycles = 0;
+	float MaxError = 0.f;
+	float MaxAngleError = 0.f;
+	int64 StartHits = 0;
+	int64 StartMisses = 0;
+	int64 StartCollisions = 0;
+
+	void SetUseCache(const bool bUseCache)
+	{
+		for (USkeletalMeshComponent* Mesh : Meshes)
+		{
+			if (UBodyStateAnimInstance* AnimInstance = Cast<UBodyStateAnimInstance>(Mesh->GetAnimInstance()))
+			{
+				AnimInstance->bUseSharedPoseCache = bUseCache;
+			}
+		}
+	}
+	// evaluated on the game thread without a tick function so the timing covers every mesh
+	uint64 Evaluate(const float DeltaTime)
+	{
+		const uint64 Start = FPlatformTime::Cycles64();
+		for (USkeletalMeshComponent* Mesh : Meshes)
+		{
+			if (DeltaTime > 0.f)
+			{
+				Mesh->TickAnimation(DeltaTime, false);
+			}
+			Mesh->RefreshBoneTransforms();
+		}
+		return FPlatformTime::Cycles64() - Start;
+	}
+};
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBodyStatePoseCacheLookupTest, "BodyState.PoseCache.Lookup",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBodyStatePoseCacheLookupTest::RunTest(const FString& Parameters)
+{
+	FBodyStatePoseCache& PoseCache = FBodyStatePoseCache::Get();
+	// a key no mesh evaluates
+	FBodyStatePoseCacheKey Key;
+	Key.BodyStateSkeleton = NewObject<UBodyStateSkeleton>();
+	FBodyStateCachedPose Pose;
+	Pose.FrameEpoch = GFrameCounter;
+	Pose.KeyData = {1, 2, 3, 4};
+	Key.MappingHash = FCrc::MemCrc32(Pose.KeyData.GetData(), Pose.KeyData.Num());
+	Pose.Transforms = {FTransform(FQuat(FVector::UpVector, .5f), FVector(1.f, 2.f, 3.f)), FTransform(FVector(0.f, 4.f, 0.f))};
+
+	const int64 StartHits = PoseCache.GetHitCount();
+	const int64 StartCollisions = PoseCache.GetCollisionCount();
+	TArray<FTransform> Found;
+	TestFalse(TEXT("Nothing is found before the pose is stored"), PoseCache.Find(Key, Pose.KeyData, Pose.FrameEpoch, Found));
+	PoseCache.Store(Key, Pose);
+
+	// the same update repeated, every lookup copies the stored pose
+	for (int32 Lookup = 0; Lookup < 3; Lookup++)
+	{
+		Found.Reset();
+		TestTrue(TEXT("The stored pose is found for the same key and frame"), PoseCache.Find(Key, Pose.KeyData, Pose.FrameEpoch, Found));
+		TestEqual(TEXT("The found pose has every stored bone"), Found.Num(), Pose.Transforms.Num());
+		for (int32 BoneIndex = 0; BoneIndex < Found.Num() && BoneIndex < Pose.Transforms.Num(); BoneIndex++)
+		{
+			TestTrue(TEXT("The found pose equals the stored pose"), Found[BoneIndex].Equals(Pose.Transforms[BoneIndex], 0.f));
+		}
+	}
+	TestEqual(TEXT("Every repeated lookup is a hit"), PoseCache.GetHitCount() - StartHits, (int64) 3);
+
+	const TArray<uint8> OtherKeyData = {1, 2, 3, 5};
+	TestFalse(TEXT("A pose with other key data and the same hash isn't found"),
+		PoseCache.Find(Key, OtherKeyData, Pose.FrameEpoch, Found));
+	TestEqual(TEXT("The mismatch is counted as a collision"), PoseCache.GetCollisionCount() - StartCollisions, (int64) 1);
+	TestFalse(TEXT("A pose stored last frame isn't found this frame"), PoseCache.Find(Key, Pose.KeyData, Pose.FrameEpoch + 1, Found));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBodyStatePoseCacheBenchmark, "BodyState.PoseCache.AvatarBenchmark",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FBodyStatePoseCacheBenchmark::RunTest(const FString& Parameters)
+{
+	USkeletalMesh* SkeletalMesh = LoadObject<USkeletalMesh>(nullptr, PoseCacheTestMesh);
+	UClass* AnimClass = LoadObject<UClass>(nullptr, PoseCacheTestAnimClass);
+	if (!SkeletalMesh || !AnimClass)
+	{
+		AddError(TEXT("Couldn't load the low poly hand mesh and BodyState anim blueprint."));
+		return false;
+	}
+
+	TSharedRef<FPoseCacheBenchmark> Benchmark = MakeShared<FPoseCacheBenchmark>();
+	Benchmark->World = UWorld::CreateWorld(EWorldType::Game, false);
+	Benchmark->World->AddToRoot();
+	GEngine->CreateNewWorldContext(EWorldType::Game).SetCurrentWorld(Benchmark->World);
+
+	// a tracked skeleton of its own, so the test doesn't depend on a connected device, updated identically every frame
+	Benchmark->Skeleton = NewObject<UBodyStateSkeleton>();
+	Benchmark->Skeleton->AddToRoot();
+	for (UBodyStateBone* Bone : Benchmark->Skeleton->Bones)
+	{
+		Bone->Meta.Confidence = 1.f;
+	}
+
+	// the same mesh, anim blueprint and BodyState skeleton, as duplicated or spectator hands
+	for (int32 AvatarIndex = 0; AvatarIndex < NumAvatars; AvatarIndex++)
+	{
+		USkeletalMeshComponent* Mesh = NewObject<USkeletalMeshComponent>(Benchmark->World);
+		Mesh->SetSkeletalMesh(SkeletalMesh);
+		Mesh->SetAnimInstanceClass(AnimClass);
+		Mesh->RegisterComponentWithWorld(Benchmark->World);
+		Benchmark->Meshes.Add(Mesh);
+
+		UBodyStateAnimInstance* AnimInstance = Cast<UBodyStateAnimInstance>(Mesh->GetAnimInstance());
+		if (!AnimInstance)
+		{
+			// the latent command still runs to tear the world down
+			AddError(TEXT("The BodyState anim blueprint didn't create a BodyState anim instance."));
+			continue;
+		}
+		if (AnimInstance->MappedBoneList.Num() == 0)
+		{
+			AddError(TEXT("The BodyState anim blueprint has no bone map, the pose cache has nothing to share."));
+			continue;
+		}
+		AnimInstance->BodyStateSkeleton = Benchmark->Skeleton;
+		AnimInstance->SetAnimSkeleton(Benchmark->Skeleton);
+	}
+
+	const FBodyStatePoseCache& PoseCache = FBodyStatePoseCache::Get();
+	Benchmark->StartHits = PoseCache.GetHitCount();
+	Benchmark->StartMisses = PoseCache.GetMissCount();
+	Benchmark->StartCollisions = PoseCache.GetCollisionCount();
+
+	// one measurement per engine frame, the cache is keyed on GFrameCounter
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand(
+		[this, Benchmark]()
+		{
+			if (Benchmark->Frame++ < NumBenchmarkFrames)
+			{
+				Benchmark->SetUseCache(false);
+				Benchmark->UncachedCycles += Benchmark->Evaluate(1.f / 60.f);
+				const TArray<FTransform> Reference = Benchmark->Meshes[0]->GetComponentSpaceTransforms();
+
+				// same input pose, every mesh but the first copies the pose the first one stores
+				Benchmark->SetUseCache(true);
+				Benchmark->CachedCycles += Benchmark->Evaluate(0.f);
+				for (USkeletalMeshComponent* Mesh : Benchmark->Meshes)
+				{
+					const TArray<FTransform>& Transforms = Mesh->GetComponentSpaceTransforms();
+					for (int32 BoneIndex = 0; BoneIndex < Transforms.Num() && BoneIndex < Reference.Num(); BoneIndex++)
+					{
+						Benchmark->MaxError = FMath::Max(Benchmark->MaxError,
+							(float) FVector::Distance(Transforms[BoneIndex].GetTranslation(), Reference[BoneIndex].GetTranslation()));
+						Benchmark->MaxAngleError = FMath::Max(Benchmark->MaxAngleError,
+							FMath::RadiansToDegrees((float) Transforms[BoneIndex].GetRotation().AngularDistance(
+								Reference[BoneIndex].GetRotation())));
+					}
+				}
+				return false;
+			}
+
+			const FBodyStatePoseCache& PoseCache = FBodyStatePoseCache::Get();
+			const int64 Hits = PoseCache.GetHitCount() - Benchmark->StartHits;
+			AddInfo(FString::Printf(TEXT("%d avatars: uncached %.3fms/frame, cached %.3fms/frame, %lld hits, %lld misses, ")
+									TEXT("%lld collisions, max difference %.4fcm %.4f degrees"),
+				NumAvatars, FPlatformTime::ToMilliseconds64(Benchmark->UncachedCycles) / NumBenchmarkFrames,
+				FPlatformTime::ToMilliseconds64(Benchmark->CachedCycles) / NumBenchmarkFrames, Hits,
+				PoseCache.GetMissCount() - Benchmark->StartMisses, PoseCache.GetCollisionCount() - Benchmark->StartCollisions,
+				Benchmark->MaxError, Benchmark->MaxAngleError));
+			// the first mesh evaluates and stores each frame, every other mesh copies its pose
+			TestTrue(TEXT("Meshes after the first hit the pose cache every frame"),
+				Hits >= (int64) (NumAvatars - 1) * NumBenchmarkFrames);
+			TestTrue(TEXT("Cached bone positions match the recomputed pose"), Benchmark->MaxError < .01f);
+			TestTrue(TEXT("Cached bone rotations match the recomputed pose"), Benchmark->MaxAngleError < .01f);
+
+			for (USkeletalMeshComponent* Mesh : Benchmark->Meshes)
+			{
+				Mesh->UnregisterComponent();
+			}
+			GEngine->DestroyWorldContext(Benchmark->World);
+			Benchmark->World->DestroyWorld(false);
+			Benchmark->World->RemoveFromRoot();
+			Benchmark->Skeleton->RemoveFromRoot();
+			return true;
+		}));
+	return true;
+}
+
+#endif
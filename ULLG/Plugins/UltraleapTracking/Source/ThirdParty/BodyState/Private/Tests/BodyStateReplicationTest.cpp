@@ -0,0 +1,264 @@
+/*************************************************************************************************************************************
+ *The MIT License(MIT)
+ *
+ *Copyright(c) 2016 Jan Kaniewski(Getnamo)
+ *Modified work Copyright(C) 2019 - 2021 Ultraleap, Inc.
+ *
+ *Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+ *files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify,
+ *merge, publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is
+ *furnished to do so, subject to the following conditions :
+ *
+ *The above copyright notice and this permission notice shall be included in all copies or
+ *substantial portions of the Software.
+ *
+ *THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ *FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************************************/
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+#include "Skeleton/BodyStateSkeleton.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+// Ten seconds of tracking at the device frame rate
+constexpr float DeviceFrameRate = 90.f;
+constexpr int32 NumRecordedFrames = 900;
+
+// Root and both arms tracked, as a hand tracking device fills them in
+bool IsSyntheticBone(const int32 BoneIndex)
+{
+	return BoneIndex == (int32) EBodyStateBasicBoneType::BONE_ROOT ||
+		   (BoneIndex >= (int32) EBodyStateBasicBoneType::BONE_CLAVICLE_L &&
+			   BoneIndex <= (int32) EBodyStateBasicBoneType::BONE_UPPERARM_TWIST_1_R);
+}
+
+// Hands swaying and fingers curling at Time seconds, Motion 0 holds them still
+void SetSyntheticPose(UBodyStateSkeleton* Skeleton, const float Time, const float Motion)
+{
+	const float MotionTime = Time * Motion;
+	const FVector Sway(
+		5.f * FMath::Sin(MotionTime), 3.f * FMath::Sin(.7f * MotionTime), 2.f * FMath::Cos(1.3f * MotionTime));
+	for (int32 BoneIndex = 0; BoneIndex < Skeleton->Bones.Num(); BoneIndex++)
+	{
+		UBodyStateBone* Bone = Skeleton->Bones[BoneIndex];
+		if (!IsSyntheticBone(BoneIndex))
+		{
+			Bone->Meta.Confidence = 0.f;
+			continue;
+		}
+		const FVector Position =
+			BoneIndex == 0 ? FVector::ZeroVector
+						   : FVector(20.f + BoneIndex * .7f, 10.f * FMath::Sin(BoneIndex), 5.f * FMath::Cos(BoneIndex)) + Sway;
+		const FRotator Rotation(
+			30.f * FMath::Sin(MotionTime + BoneIndex * .3f), 20.f * FMath::Cos(.5f * MotionTime + BoneIndex), 0.f);
+		Bone->BoneData.SetFromTransform(FTransform(Rotation.Quaternion(), Position));
+		Bone->Meta.Confidence = 1.f;
+	}
+}
+
+// Every bone of one device frame, as the tracking device left the skeleton
+struct FRecordedPose
+{
+	TArray<FTransform> Transforms;
+	TArray<float> Confidences;
+};
+typedef TArray<FRecordedPose> FPoseRecording;
+
+FPoseRecording Record(const float Motion)
+{
+	UBodyStateSkeleton* Skeleton = NewObject<UBodyStateSkeleton>();
+	FPoseRecording Recording;
+	for (int32 FrameIndex = 0; FrameIndex < NumRecordedFrames; FrameIndex++)
+	{
+		SetSyntheticPose(Skeleton, FrameIndex / DeviceFrameRate, Motion);
+		FRecordedPose& Pose = Recording.AddDefaulted_GetRef();
+		for (const UBodyStateBone* Bone : Skeleton->Bones)
+		{
+			Pose.Transforms.Add(Bone->BoneData.Transform);
+			Pose.Confidences.Add(Bone->Meta.Confidence);
+		}
+	}
+	return Recording;
+}
+
+void SetRecordedPose(UBodyStateSkeleton* Skeleton, const FRecordedPose& Pose)
+{
+	for (int32 BoneIndex = 0; BoneIndex < Skeleton->Bones.Num(); BoneIndex++)
+	{
+		UBodyStateBone* Bone = Skeleton->Bones[BoneIndex];
+		Bone->BoneData.SetFromTransform(Pose.Transforms[BoneIndex]);
+		Bone->Meta.Confidence = Pose.Confidences[BoneIndex];
+	}
+}
+
+struct FReplicationResult
+{
+	int64 Bytes = 0;
+	int32 NumUpdates = 0;
+	float NetUpdateRate = 0.f;
+	uint64 EncodeCycles = 0;
+	uint64 DecodeCycles = 0;
+	float MaxPositionError = 0.f;
+	float MaxRotationErrorDegrees = 0.f;
+
+	double BytesPerSecond() const
+	{
+		return Bytes * DeviceFrameRate / NumRecordedFrames;
+	}
+
+	void Report(FAutomationTestBase& Test, const TCHAR* Name) const
+	{
+		const int32 Updates = FMath::Max(NumUpdates, 1);
+		Test.AddInfo(FString::Printf(TEXT("%s: %.0f bytes/s at %.0f updates/s, %.1f bytes/update, encode %.2fus, decode %.2fus, ")
+										 TEXT("max error %.3fcm %.2fdeg"),
+			Name, BytesPerSecond(), NetUpdateRate, (double) Bytes / Updates,
+			FPlatformTime::ToMilliseconds64(EncodeCycles) * 1000.0 / Updates,
+			FPlatformTime::ToMilliseconds64(DecodeCycles) * 1000.0 / Updates, MaxPositionError, MaxRotationErrorDegrees));
+	}
+};
+
+void MeasureError(UBodyStateSkeleton* Sent, UBodyStateSkeleton* Received, FReplicationResult& Result)
+{
+	for (int32 BoneIndex = 0; BoneIndex < Sent->Bones.Num(); BoneIndex++)
+	{
+		if (!IsSyntheticBone(BoneIndex))
+		{
+			continue;
+		}
+		const FTransform& SentTransform = Sent->Bones[BoneIndex]->BoneData.Transform;
+		const FTransform& ReceivedTransform = Received->Bones[BoneIndex]->BoneData.Transform;
+		Result.MaxPositionError = FMath::Max(Result.MaxPositionError,
+			(float) FVector::Distance(SentTransform.GetTranslation(), ReceivedTransform.GetTranslation()));
+		Result.MaxRotationErrorDegrees = FMath::Max(Result.MaxRotationErrorDegrees,
+			(float) FMath::RadiansToDegrees(SentTransform.GetRotation().AngularDistance(ReceivedTransform.GetRotation())));
+	}
+}
+
+// Replays the recording at the device frame rate and sends at the sender's NetUpdateRate, as ReplicateQuantizedBodyState does
+FReplicationResult Replay(const FPoseRecording& Recording, const bool bQuantized)
+{
+	UBodyStateSkeleton* Sender = NewObject<UBodyStateSkeleton>();
+	UBodyStateSkeleton* Receiver = NewObject<UBodyStateSkeleton>();
+	FReplicationResult Result;
+	Result.NetUpdateRate = Sender->NetUpdateRate;
+
+	double NextSendTime = 0.0;
+	for (int32 FrameIndex = 0; FrameIndex < Recording.Num(); FrameIndex++)
+	{
+		SetRecordedPose(Sender, Recording[FrameIndex]);
+		const double Time = FrameIndex / (double) DeviceFrameRate;
+		if (Time + KINDA_SMALL_NUMBER < NextSendTime)
+		{
+			continue;
+		}
+		NextSendTime += 1.0 / Sender->NetUpdateRate;
+		Result.NumUpdates++;
+
+		bool bSuccess = true;
+		FBitWriter Writer(0, true);
+		uint64 Start = FPlatformTime::Cycles64();
+		FNamedSkeletonData SentFull;
+		FQuantizedSkeletonData SentQuantized;
+		if (bQuantized)
+		{
+			SentQuantized = Sender->GetQuantizedSkeletonData();
+			SentQuantized.NetSerialize(Writer, nullptr, bSuccess);
+		}
+		else
+		{
+			SentFull = Sender->GetMinimalNamedSkeletonData();
+			FNamedSkeletonData::StaticStruct()->SerializeBin(Writer, &SentFull);
+		}
+		Result.EncodeCycles += FPlatformTime::Cycles64() - Start;
+		Result.Bytes += Writer.GetNumBytes();
+
+		Start = FPlatformTime::Cycles64();
+		FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+		if (bQuantized)
+		{
+			FQuantizedSkeletonData Received;
+			Received.NetSerialize(Reader, nullptr, bSuccess);
+			Receiver->SetFromQuantizedSkeletonData(Received);
+		}
+		else
+		{
+			FNamedSkeletonData Received;
+			FNamedSkeletonData::StaticStruct()->SerializeBin(Reader, &Received);
+			Receiver->SetFromNamedSkeletonData(Received);
+		}
+		Result.DecodeCycles += FPlatformTime::Cycles64() - Start;
+
+		MeasureError(Sender, Receiver, Result);
+	}
+	return Result;
+}
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBodyStateQuantizedReplicationBenchmark, "BodyState.Replication.QuantizedBenchmark",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FBodyStateQuantizedReplicationBenchmark::RunTest(const FString& Parameters)
+{
+	const TCHAR* MotionNames[] = {TEXT("moving"), TEXT("still")};
+	const float Motions[] = {1.f, 0.f};
+	for (int32 MotionIndex = 0; MotionIndex < 2; MotionIndex++)
+	{
+		const FPoseRecording Recording = Record(Motions[MotionIndex]);
+		const FReplicationResult Full = Replay(Recording, false);
+		const FReplicationResult Quantized = Replay(Recording, true);
+		Full.Report(*this, *FString::Printf(TEXT("Full %s"), MotionNames[MotionIndex]));
+		Quantized.Report(*this, *FString::Printf(TEXT("Quantized %s"), MotionNames[MotionIndex]));
+
+		TestEqual(TEXT("Updates are sent at NetUpdateRate"), Quantized.NumUpdates,
+			FMath::CeilToInt(NumRecordedFrames / DeviceFrameRate * Quantized.NetUpdateRate));
+		TestTrue(TEXT("Quantized updates take less bandwidth than full ones"), Quantized.BytesPerSecond() < Full.BytesPerSecond());
+		// the delta tolerances (0.05cm, 0.25deg) on top of the quantisation steps
+		TestTrue(TEXT("Quantized position error within tolerance"), Quantized.MaxPositionError < .1f);
+		TestTrue(TEXT("Quantized rotation error within tolerance"), Quantized.MaxRotationErrorDegrees < .5f);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBodyStateQuantizedDeltaTest, "BodyState.Replication.QuantizedDelta",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FBodyStateQuantizedDeltaTest::RunTest(const FString& Parameters)
+{
+	UBodyStateSkeleton* Sender = NewObject<UBodyStateSkeleton>();
+	UBodyStateSkeleton* Receiver = NewObject<UBodyStateSkeleton>();
+	Sender->NetKeyframeInterval = 4;
+
+	SetSyntheticPose(Sender, 0.f, 0.f);
+	const FQuantizedSkeletonData Keyframe = Sender->GetQuantizedSkeletonData();
+	TestTrue(TEXT("First update is a keyframe"), Keyframe.bIsKeyframe);
+
+	// a still hand sends no bones until the next keyframe
+	const FQuantizedSkeletonData Delta = Sender->GetQuantizedSkeletonData();
+	TestFalse(TEXT("Second update is a delta"), Delta.bIsKeyframe);
+	TestEqual(TEXT("Still delta carries no bones"), Delta.Bones.Num(), 0);
+
+	const UBodyStateBone* ReceivedWrist = Receiver->Bones[(int32) EBodyStateBasicBoneType::BONE_HAND_WRIST_L];
+
+	// the keyframe was lost, the delta is dropped
+	Receiver->SetFromQuantizedSkeletonData(Delta);
+	TestEqual(TEXT("Delta without its keyframe is dropped"), ReceivedWrist->Meta.Confidence, 0.f);
+
+	Receiver->SetFromQuantizedSkeletonData(Keyframe);
+	Receiver->SetFromQuantizedSkeletonData(Delta);
+	TestEqual(TEXT("Delta applies on its keyframe"), ReceivedWrist->Meta.Confidence, 1.f);
+
+	Sender->GetQuantizedSkeletonData();
+	Sender->GetQuantizedSkeletonData();
+	TestTrue(TEXT("Keyframe every NetKeyframeInterval updates"), Sender->GetQuantizedSkeletonData().bIsKeyframe);
+	return true;
+}
+
+#endif
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "BodyStateAnimInstance.h"
+#include "BodyStatePoseCache.h"
 #include "CoreMinimal.h"
 #include "Runtime/AnimGraphRuntime/Public/BoneControllers/AnimNode_SkeletalControlBase.h"
 #include "Skeleton/BodyStateSkeleton.h"
@@ -79,5 +80,16 @@ private:
 
 	FTransform GetComponentTransformScaleOnly();
 	float CalculateLeapHandLength(const FMappedBoneAnimData& MappedBoneAnimData);
-	
+
+	// Shared pose cache, see UBodyStateAnimInstance::bUseSharedPoseCache
+	void BuildPoseCacheKeyData(FComponentSpacePoseContext& Output, const FMappedBoneAnimData& MappedBoneAnimData,
+		const float BlendWeight, TArray<uint8>& OutKeyData);
+	void ApplyCachedPose(
+		FComponentSpacePoseContext& Output, const FBodyStateCachedPose& Pose, const FMappedBoneAnimData& MappedBoneAnimData);
+	void StoreCachedPose(
+		FComponentSpacePoseContext& Output, const FBodyStatePoseCacheKey& Key, const FMappedBoneAnimData& MappedBoneAnimData);
+
+	// reused between evaluations so cache hits don't allocate
+	FBodyStateCachedPose PoseCacheScratch;
+	TArray<FBoneTransform> PoseCacheBoneTransforms;
 };
\ No newline at end of file
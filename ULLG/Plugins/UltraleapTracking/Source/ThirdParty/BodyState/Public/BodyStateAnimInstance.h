@@ -34,6 +34,15 @@ enum EBSMultiDeviceMode
 	BS_MULTI_DEVICE_COMBINED
 };
 
+UENUM(BlueprintType)
+enum EBSMirroredBoundsMode
+{
+	/** Fit the bounds to the mapped joints each time they move past the update threshold */
+	BS_MIRRORED_BOUNDS_TRACKED_JOINTS = 0,
+	/** Legacy behaviour, scale the bounds by 10 so the mirrored mesh is never culled */
+	BS_MIRRORED_BOUNDS_SCALE
+};
+
 USTRUCT(BlueprintType)
 struct BODYSTATE_API FBodyStateIndexedBone
 {
@@ -280,6 +289,11 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "BS Anim Instance")
 	int32 DefaultBodyStateIndex;
 
+	/** Share evaluated hand poses with other meshes using the same device, skeleton and bone mapping (e.g. duplicated
+	 * or spectator hands). The first mesh evaluated each frame computes the pose and the others copy it */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "BS Anim Instance")
+	bool bUseSharedPoseCache;
+
 	/** Skeleton driving our data */
 	UPROPERTY(BlueprintReadWrite, Category = "Bone Anim Struct")
 	class UBodyStateSkeleton* BodyStateSkeleton;
@@ -390,6 +404,23 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = "BS Anim Instance - Multi device")
 	void SetActiveDeviceSerial(const FString& DeviceID);
+
+	/** How to keep the bounds correct when a map uses FlipModelLeftRight (the mirrored scale breaks the skinned bounds) */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "BS Anim Instance - Mirrored Bounds")
+	TEnumAsByte<EBSMirroredBoundsMode> MirroredBoundsMode;
+
+	/** Padding in cm added around the mapped joints, covers the skinned surface and one frame of latency */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "BS Anim Instance - Mirrored Bounds",
+		meta = (UIMin = "0.0", ClampMin = "0.0",
+			EditCondition = "MirroredBoundsMode == EBSMirroredBoundsMode::BS_MIRRORED_BOUNDS_TRACKED_JOINTS"))
+	float MirroredBoundsPadding;
+
+	/** The joints must move this far in cm outside the last fitted box before the bounds are refitted */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "BS Anim Instance - Mirrored Bounds",
+		meta = (UIMin = "0.0", ClampMin = "0.0",
+			EditCondition = "MirroredBoundsMode == EBSMirroredBoundsMode::BS_MIRRORED_BOUNDS_TRACKED_JOINTS"))
+	float MirroredBoundsUpdateThreshold;
+
 	// IBodyStateDeviceChangeListener
 	virtual void OnDeviceAdded(const FString& DeviceSerial, const uint32 DeviceID) override;
 	virtual void OnDeviceRemoved(const uint32 DeviceID) override;
@@ -436,6 +467,9 @@ protected:
 
 	void HandleLeftRightFlip(FMappedBoneAnimData& ForMap);
 
+	// fit the component bounds to the mapped joints of flipped maps, game thread only
+	void UpdateMirroredBounds();
+
 	static void CreateEmptyBoneMap(
 		TMap<EBodyStateBasicBoneType, FBodyStateIndexedBone>& AutoBoneMap, const EBodyStateAutoRigType HandType);
 
@@ -446,6 +480,13 @@ private:
 	bool GetNamesAndTransforms(TArray<FTransform>& ComponentSpaceTransforms, TArray<FName>& Names, TArray<FNodeItem>& NodeItems) const;
 	void UpdateDeviceList();
 
+	// Mesh bone indices of all flipped maps, rebuilt when the mapping changes
+	TArray<int32> MirroredBoundsBoneIndices;
+	// World space joint box the current bounds scale was fitted to
+	FBox MirroredJointBounds;
+	// Degenerate mesh bounds are only logged once
+	bool bWarnedDegenerateMirroredBounds;
+
 public:
 #if WITH_EDITOR
 	/**
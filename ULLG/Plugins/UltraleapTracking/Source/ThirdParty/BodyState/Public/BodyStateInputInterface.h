@@ -31,13 +31,21 @@ class BODYSTATE_API IBodyStateInputRawInterface
 public:
 	virtual void UpdateInput(int32 DeviceID, class UBodyStateSkeleton* Skeleton) = 0;
 	virtual void OnDeviceDetach() = 0;
+
+	// Return true if UpdateInput only touches the passed skeleton and device owned data, so it may run on a worker
+	// thread in parallel with other devices. Devices that query engine state (e.g. XR system) must stay on the game thread
+	virtual bool SupportsParallelUpdateInput()
+	{
+		return false;
+	}
 };
 UENUM(BlueprintType)
 enum EBSDeviceCombinerClass
 {
 	BS_DEVICE_COMBINER_UNKNOWN,
 	BS_DEVICE_COMBINER_CONFIDENCE,
-	BS_DEVICE_COMBINER_ANGULAR
+	BS_DEVICE_COMBINER_ANGULAR,
+	BS_DEVICE_COMBINER_KALMAN
 	// add your custom classes here and add them to the class factory
 };
 class BODYSTATE_API IBodyStateDeviceManagerRawInterface
@@ -0,0 +1,110 @@
+/*************************************************************************************************************************************
+ *The MIT License(MIT)
+ *
+ *Copyright(c) 2016 Jan Kaniewski(Getnamo)
+ *Modified work Copyright(C) 2019 - 2021 Ultraleap, Inc.
+ *
+ *Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+ *files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify,
+ *merge, publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is
+ *furnished to do so, subject to the following conditions :
+ *
+ *The above copyright notice and this permission notice shall be included in all copies or
+ *substantial portions of the Software.
+ *
+ *THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ *FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Misc/ScopeRWLock.h"
+
+class UBodyStateSkeleton;
+class USkeletalMesh;
+
+/** Identifies an evaluated hand pose, evaluators with equal keys in the same frame produce identical bone transforms */
+struct BODYSTATE_API FBodyStatePoseCacheKey
+{
+	const UBodyStateSkeleton* BodyStateSkeleton = nullptr;
+	/** Meshes sharing a USkeleton can order their bones differently, so poses are only shared between the same mesh */
+	const USkeletalMesh* SkeletalMesh = nullptr;
+
+	/** Hash of the key data, the full data is compared on lookup */
+	uint32 MappingHash = 0;
+
+	bool operator==(const FBodyStatePoseCacheKey& Other) const
+	{
+		return BodyStateSkeleton == Other.BodyStateSkeleton && SkeletalMesh == Other.SkeletalMesh &&
+			   MappingHash == Other.MappingHash;
+	}
+
+	friend uint32 GetTypeHash(const FBodyStatePoseCacheKey& Key)
+	{
+		return HashCombine(HashCombine(PointerHash(Key.BodyStateSkeleton), PointerHash(Key.SkeletalMesh)), Key.MappingHash);
+	}
+};
+
+/** Component space transforms of the mapped bones after evaluation */
+struct BODYSTATE_API FBodyStateCachedPose
+{
+	uint64 FrameEpoch = 0;
+	/** The bone mapping, anim instance settings and input pose of the mapped bones that MappingHash was made from */
+	TArray<uint8> KeyData;
+	/** One per entry of the mapping's CachedBoneList, in order */
+	TArray<FTransform> Transforms;
+
+	void CopyFrom(const FBodyStateCachedPose& Other)
+	{
+		// Reset + Append keeps the existing allocations
+		FrameEpoch = Other.FrameEpoch;
+		KeyData.Reset();
+		KeyData.Append(Other.KeyData);
+		Transforms.Reset();
+		Transforms.Append(Other.Transforms);
+	}
+};
+
+/**
+ * Process wide cache of evaluated mapped bone poses so that meshes sharing a device, skeleton and mapping only evaluate
+ * once per frame. The first evaluator of a frame stores its result and later evaluators copy it. Safe to use from
+ * parallel animation evaluation.
+ */
+class BODYSTATE_API FBodyStatePoseCache
+{
+public:
+	static FBodyStatePoseCache& Get();
+
+	/** Copies the transforms stored this frame for Key and KeyData into OutTransforms, returns false if there aren't any */
+	bool Find(const FBodyStatePoseCacheKey& Key, const TArray<uint8>& KeyData, uint64 FrameEpoch, TArray<FTransform>& OutTransforms);
+
+	/** Stores the pose evaluated for Key this frame, Pose.FrameEpoch must be set */
+	void Store(const FBodyStatePoseCacheKey& Key, const FBodyStateCachedPose& Pose);
+
+	int64 GetHitCount() const
+	{
+		return HitCount.GetValue();
+	}
+	int64 GetMissCount() const
+	{
+		return MissCount.GetValue();
+	}
+	/** Lookups whose hash matched a pose stored from different key data, counted as misses too */
+	int64 GetCollisionCount() const
+	{
+		return CollisionCount.GetValue();
+	}
+
+private:
+	FRWLock Lock;
+	TMap<FBodyStatePoseCacheKey, FBodyStateCachedPose> Poses;
+	uint64 LastPrunedEpoch = 0;
+
+	FThreadSafeCounter64 HitCount;
+	FThreadSafeCounter64 MissCount;
+	FThreadSafeCounter64 CollisionCount;
+};
@@ -0,0 +1,123 @@
+/*************************************************************************************************************************************
+ *The MIT License(MIT)
+ *
+ *Copyright(c) 2016 Jan Kaniewski(Getnamo)
+ *Modified work Copyright(C) 2019 - 2021 Ultraleap, Inc.
+ *
+ *Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+ *files(the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify,
+ *merge, publish, distribute, sublicense, and / or sell copies of the Software, and to permit persons to whom the Software is
+ *furnished to do so, subject to the following conditions :
+ *
+ *The above copyright notice and this permission notice shall be included in all copies or
+ *substantial portions of the Software.
+ *
+ *THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ *MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ *FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************************************/
+
+#pragma once
+
+#include "BodyStateEnums.h"
+#include "CoreMinimal.h"
+#include "UObject/CoreNet.h"
+
+#include "BodyStateQuantizedSkeleton.generated.h"
+
+/** A single bone packed for the network, rotation in smallest-three form and position relative to the skeleton root */
+struct BODYSTATE_API FQuantizedBone
+{
+	/** Bones are identified by their EBodyStateBasicBoneType index rather than by name */
+	uint8 BoneIndex = 0;
+
+	/** 2 bits largest component index followed by 3 x 10 bit components */
+	uint32 PackedRotation = 0;
+
+	/** Position relative to the root in 1/PositionScale cm steps */
+	int16 PackedPosition[3] = {0, 0, 0};
+
+	// Quantisation
+	static constexpr int32 RotationComponentBits = 10;
+	static constexpr float PositionScale = 64.f;	// 1/64 cm, +-512cm range around the root
+
+	static uint32 PackRotation(const FQuat& Rotation);
+	static FQuat UnpackRotation(uint32 Packed);
+
+	void SetFromTransform(const FTransform& Transform, const FVector& RootPosition);
+	FTransform ToTransform(const FVector& RootPosition) const;
+};
+
+/** Per connection direction state, the last keyframe sent or received */
+struct BODYSTATE_API FQuantizedSkeletonBaseline
+{
+	/** Sequence of the keyframe the bones belong to */
+	uint16 Sequence = 0;
+
+	/** Set once a keyframe has been sent/received */
+	bool bValid = false;
+
+	/** Root position the keyframe bones were quantised against */
+	FVector RootPosition = FVector::ZeroVector;
+
+	/** Indexed by bone type, only bones flagged in TrackedMask are meaningful */
+	FQuantizedBone Bones[(int32) EBodyStateBasicBoneType::BONES_COUNT];
+
+	uint64 TrackedMask[2] = {0, 0};
+
+	void Reset()
+	{
+		bValid = false;
+		TrackedMask[0] = TrackedMask[1] = 0;
+	}
+};
+
+/**
+ * Compact network form of a UBodyStateSkeleton. Keyframes carry every tracked bone, deltas carry only bones which
+ * changed against the keyframe referenced by BaselineSequence. A receiver without that keyframe drops the delta and
+ * waits for the next keyframe, so this works over unreliable RPCs.
+ */
+USTRUCT()
+struct BODYSTATE_API FQuantizedSkeletonData
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Sequence of this packet */
+	uint16 Sequence = 0;
+
+	/** Keyframe this packet is relative to, equal to Sequence for keyframes */
+	uint16 BaselineSequence = 0;
+
+	bool bIsKeyframe = true;
+
+	/** Root bone position, all bone positions are quantised relative to this. Only sent with keyframes, deltas use
+	 * the keyframe root */
+	FVector RootPosition = FVector::ZeroVector;
+
+	/** Which bones are tracked in this packet (bit per EBodyStateBasicBoneType) */
+	uint64 TrackedMask[2] = {0, 0};
+
+	/** Changed bones (all tracked bones for a keyframe) */
+	TArray<FQuantizedBone> Bones;
+
+	static bool IsBoneTracked(const uint64 Mask[2], int32 BoneIndex)
+	{
+		return (Mask[BoneIndex >> 6] & (1ull << (BoneIndex & 63))) != 0;
+	}
+	static void SetBoneTracked(uint64 Mask[2], int32 BoneIndex)
+	{
+		Mask[BoneIndex >> 6] |= (1ull << (BoneIndex & 63));
+	}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template <>
+struct TStructOpsTypeTraits<FQuantizedSkeletonData> : public TStructOpsTypeTraitsBase2<FQuantizedSkeletonData>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
@@ -23,6 +23,7 @@
 #include "BodyStateEnums.h"
 #include "Skeleton/BodyStateArm.h"
 #include "Skeleton/BodyStateBone.h"
+#include "Skeleton/BodyStateQuantizedSkeleton.h"
 #include "UObject/CoreNet.h"
 
 #include "BodyStateSkeleton.generated.h"
@@ -82,6 +83,9 @@ struct BODYSTATE_API FNamedSkeletonData
 	TArray<FNamedBoneMeta> UniqueMetas;
 };
 
+/** Called with a skeleton's SourceCaptureTime when a pose is evaluated from it, from the anim thread */
+DECLARE_DELEGATE_OneParam(FOnBodyStateSkeletonEvaluated, double);
+
 /** Body Skeleton data, all bones are expected in component space*/
 UCLASS(BlueprintType)
 class BODYSTATE_API UBodyStateSkeleton : public UObject
@@ -168,6 +172,12 @@ class BODYSTATE_API UBodyStateSkeleton : public UObject
 	UFUNCTION(BlueprintCallable, Category = "BodyState Skeleton Setting")
 	void SetFromNamedSkeletonData(const FNamedSkeletonData& NamedSkeletonData);	   // key replication setter
 
+	/** Quantised replication getter, returns a keyframe or a delta against the last sent keyframe */
+	FQuantizedSkeletonData GetQuantizedSkeletonData();
+
+	/** Quantised replication setter, deltas without a matching received keyframe are dropped */
+	void SetFromQuantizedSkeletonData(const FQuantizedSkeletonData& QuantizedSkeletonData);
+
 	UFUNCTION(BlueprintCallable, Category = "BodyState Skeleton Setting")
 	void SetFromOtherSkeleton(UBodyStateSkeleton* Other);
 
@@ -190,8 +200,40 @@ class BODYSTATE_API UBodyStateSkeleton : public UObject
 	UFUNCTION(NetMulticast, Unreliable)
 	void Multi_UpdateBodyState(const FNamedSkeletonData InBodyStateSkeleton);
 
+	UFUNCTION(Unreliable, Server, WithValidation)
+	void ServerUpdateQuantizedBodyState(const FQuantizedSkeletonData InBodyStateSkeleton);
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void Multi_UpdateQuantizedBodyState(const FQuantizedSkeletonData InBodyStateSkeleton);
+
+	/** Sends the quantised skeleton to the server if the rate limit allows it. Returns true if an update was sent */
+	UFUNCTION(BlueprintCallable, Category = "BodyState Skeleton Setting")
+	bool ReplicateQuantizedBodyState();
+
+	/** Maximum quantised updates per second sent by ReplicateQuantizedBodyState, 0 for unlimited */
+	UPROPERTY(BlueprintReadWrite, Category = "BodyState Skeleton Replication")
+	float NetUpdateRate;
+
+	/** A full keyframe is sent every N quantised updates, the rest are deltas against it */
+	UPROPERTY(BlueprintReadWrite, Category = "BodyState Skeleton Replication")
+	int32 NetKeyframeInterval;
+
+	/** Bones that moved less than this (cm) from the keyframe are left out of deltas */
+	UPROPERTY(BlueprintReadWrite, Category = "BodyState Skeleton Replication")
+	float NetPositionTolerance;
+
+	/** Bones that rotated less than this (degrees) from the keyframe are left out of deltas */
+	UPROPERTY(BlueprintReadWrite, Category = "BodyState Skeleton Replication")
+	float NetRotationTolerance;
+
 	FCriticalSection BoneDataLock;
 
+	/** FPlatformTime::Seconds the bone data was captured at, set by devices tracing latency. 0 if unknown */
+	double SourceCaptureTime;
+
+	/** Bound by a device to measure capture to pose latency, skeletons without a SourceCaptureTime aren't reported */
+	static FOnBodyStateSkeletonEvaluated OnSkeletonEvaluated;
+
 	void ReleaseRefs();
 
 protected:
@@ -204,6 +246,13 @@ private:
 	UPROPERTY()
 	UBodyStateArm* PrivateLeftArm;
 
+	// Quantised replication state
+	FQuantizedSkeletonBaseline NetSendBaseline;
+	FQuantizedSkeletonBaseline NetReceiveBaseline;
+	uint16 NetSendSequence;
+	int32 NetUpdatesSinceKeyframe;
+	double NetLastSendTime;
+
 	UPROPERTY()
 	UBodyStateArm* PrivateRightArm;
 };
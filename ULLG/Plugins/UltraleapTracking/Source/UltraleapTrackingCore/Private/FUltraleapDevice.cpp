@@ -14,6 +14,7 @@
 #include "IXRTrackingSystem.h"
 #include "LeapAsync.h"
 #include "LeapComponent.h"
+#include "LeapLatencyTracer.h"
 #include "LeapUtility.h"
 #include "Skeleton/BodyStateSkeleton.h"
 #include "UltraleapTrackingData.h"
@@ -22,6 +23,19 @@
 DECLARE_STATS_GROUP(TEXT("UltraleapMultiTracking"), STATGROUP_UltraleapMultiTracking, STATCAT_Advanced);
 DECLARE_CYCLE_STAT(TEXT("Multi Leap Game Input and Events"), STAT_MultiLeapInputTick, STATGROUP_UltraleapMultiTracking);
 DECLARE_CYCLE_STAT(TEXT("Multi Leap BodyState Tick"), STAT_MultiLeapBodyStateTick, STATGROUP_UltraleapMultiTracking);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Idle Devices"), STAT_MultiLeapIdleDevices, STATGROUP_UltraleapMultiTracking);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Idle Time Saved (ms)"), STAT_MultiLeapIdleTimeSaved, STATGROUP_UltraleapMultiTracking);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Unchanged Frames"), STAT_MultiLeapUnchangedFrames, STATGROUP_UltraleapMultiTracking);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Skipped Gesture Checks"), STAT_MultiLeapSkippedGestureChecks, STATGROUP_UltraleapMultiTracking);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Skipped BodyState Updates"), STAT_MultiLeapSkippedBodyStateUpdates, STATGROUP_UltraleapMultiTracking);
+
+namespace
+{
+// How quickly the active tick cost estimates follow changes in load
+const float IdleCostSmoothing = 0.05f;
+// Policies turned off while idle if bIdleLowPowerPolicies is set
+const uint32 IdleLowPowerPolicies = eLeapPolicyFlag_Images | eLeapPolicyFlag_MapPoints;
+}	 // namespace
 
 #pragma region Utility
 bool FUltraleapDevice::bUseNewTrackingModeAPI = true;
@@ -168,6 +182,8 @@ void FUltraleapDevice::OnImageCallback(UTexture2D* LeftCapturedTexture, UTexture
 
 void FUltraleapDevice::OnPolicy(const uint32_t CurrentPolicies)
 {
+	CurrentPolicyFlags = CurrentPolicies;
+
 	TArray<TEnumAsByte<ELeapPolicyFlag>> Flags;
 	ELeapMode UpdatedMode = Options.Mode;
 	if (CurrentPolicies & eLeapPolicyFlag_BackgroundFrames)
@@ -254,8 +270,9 @@ void FUltraleapDevice::OnLog(const eLeapLogSeverity Severity, const int64_t Time
 
 FUltraleapDevice::FUltraleapDevice(
 	IHandTrackingWrapper* LeapDeviceWrapper, ITrackingDeviceWrapper* TrackingDeviceWrapperIn, const bool StartInOpenXRMode)
-	: 
-	Leap(LeapDeviceWrapper), TrackingDeviceWrapper(TrackingDeviceWrapperIn)
+	: CurrentFrame(MakeShared<FLeapFrameData, ESPMode::ThreadSafe>())
+	, LatestFrameSnapshot(CurrentFrame)
+	, Leap(LeapDeviceWrapper), TrackingDeviceWrapper(TrackingDeviceWrapperIn)
 {
 	// Link callbacks
 
@@ -327,12 +344,7 @@ void FUltraleapDevice::Init()
 	}
 	BodyStateDeviceId = UBodyStateBPLibrary::AttachDeviceNative(Config, this);
 
-#if WITH_EDITOR
-	// LiveLink startup
-	LiveLink = MakeShareable(new FLeapLiveLinkProducer());
-	LiveLink->Startup(Leap->GetDeviceSerial());
-	LiveLink->SyncSubjectToSkeleton(IBodyState::Get().SkeletonForDevice(BodyStateDeviceId));
-#endif
+	// LiveLink startup happens in SetOptions as it depends on the LiveLink options
 
 	// Image support
 	LeapImageHandler = MakeShareable(new FLeapImage);
@@ -352,14 +364,12 @@ void FUltraleapDevice::Init()
 }
 FUltraleapDevice::~FUltraleapDevice()
 {
-#if WITH_EDITOR
 	if (LiveLink != nullptr)
 	{
 		// LiveLink cleanup
 		LiveLink->ShutDown();
 		LiveLink = nullptr;
 	}
-#endif
 
 	ShutdownLeap();
 }
@@ -375,16 +385,54 @@ void FUltraleapDevice::Tick(float DeltaTime)
 // Main loop event emitter
 void FUltraleapDevice::SendControllerEvents()
 {
+	const uint32 StartCycles = FPlatformTime::Cycles();
 	CaptureAndEvaluateInput();
+	UpdateIdleTimeSaved(StartCycles);
 }
+// Blueprint facing, the one place a reader gets its own copy
 void FUltraleapDevice::GetLatestFrameData(FLeapFrameData& OutData,const bool ApplyDeviceOriginIn /* = false */)
 {
-	OutData = CurrentFrame;
+	OutData = *GetLatestFrameSnapshot(ApplyDeviceOriginIn);
+}
+FLeapFrameSnapshot FUltraleapDevice::GetLatestFrameSnapshot(const bool ApplyDeviceOriginIn /* = false */)
+{
+	FScopeLock Lock(&SnapshotLock);
+	if (!ApplyDeviceOriginIn || DeviceOrigin.Equals(FTransform::Identity, 0.f))
+	{
+		return LatestFrameSnapshot;
+	}
 
-	if (ApplyDeviceOriginIn)
+	// the origin can be moved between frames, e.g. by multi device alignment
+	if (!OriginFrameSnapshot.IsValid() || OriginFrameSnapshotVersion != LatestFrameSnapshotVersion ||
+		!OriginFrameSnapshotOrigin.Equals(DeviceOrigin, 0.f))
 	{
-		ApplyDeviceOrigin(OutData);
+		TSharedRef<FLeapFrameData, ESPMode::ThreadSafe> OriginFrame =
+			MakeShared<FLeapFrameData, ESPMode::ThreadSafe>(*LatestFrameSnapshot);
+		ApplyDeviceOrigin(*OriginFrame);
+
+		OriginFrameSnapshot = OriginFrame;
+		OriginFrameSnapshotVersion = LatestFrameSnapshotVersion;
+		OriginFrameSnapshotOrigin = DeviceOrigin;
 	}
+	return OriginFrameSnapshot.ToSharedRef();
+}
+// CurrentFrame is handed to the readers as is, the next parse goes into another frame
+void FUltraleapDevice::PublishFrameSnapshot()
+{
+	FScopeLock Lock(&SnapshotLock);
+	LatestFrameSnapshot = CurrentFrame;
+	LatestFrameSnapshotVersion = FrameVersion;
+}
+void FUltraleapDevice::BeginFrameParse()
+{
+	CurrentFrame = ParseFrames.Acquire();
+	// only set by the HMD time warp, not left over from whatever frame this was before
+	CurrentFrame->FinalRotationAdjustment = FRotator::ZeroRotator;
+}
+bool FUltraleapDevice::ParseTransformsFrame() const
+{
+	// the HMD and screen top rotations, and the pinch and grab PostLeapHandUpdate fills in for OpenXR
+	return NeedsPerTickTransform() || Options.Mode == LEAP_MODE_SCREENTOP || Options.bUseOpenXRAsSource;
 }
 void FUltraleapDevice::ApplyDeviceOrigin(FLeapFrameData& OutData)
 {
@@ -412,6 +460,36 @@ void FUltraleapDevice::CaptureAndEvaluateInput()
 	{
 		return;
 	}
+	// the raw frame is enough to tell if anyone is there
+	if (UpdateIdleState(Frame->nHands > 0))
+	{
+		return;
+	}
+
+	const EFrameChange Change = GetFrameChange(Frame);
+	if (Change == EFrameChange::None)
+	{
+		// CurrentFrame and the late update samples still hold this frame, only its age has changed
+		if (!Options.bUseOpenXRAsSource)
+		{
+			LateUpdateSamples[0].TimeOffset = LateUpdateSamples[1].TimeOffset = Frame->info.timestamp - Leap->GetNow();
+		}
+		ParseEvents(Change);
+		return;
+	}
+
+	if (FLeapLatencyTracer::IsEnabled())
+	{
+		FrameCaptureTime = FLeapLatencyTracer::GetCaptureTime(Frame->info.timestamp, Leap->GetNow());
+		FLeapLatencyTracer::Get().Record(ELeapLatencyStage::Consume, FrameCaptureTime);
+	}
+
+	BeginFrameParse();
+
+	// late updates need the LeapC frames, so not with OpenXR
+	LateUpdateSamples[0].bValid = LateUpdateSamples[1].bValid = false;
+	int64 LateUpdateTimeOffset = 0;
+
 	if (!Options.bUseOpenXRAsSource)
 	{
 		TimeWarpTimeStamp = Frame->info.timestamp;
@@ -422,49 +500,191 @@ void FUltraleapDevice::CaptureAndEvaluateInput()
 		HandInterpolationTimeOffset = Options.HandInterpFactor * FrameTimeInMicros;
 		FingerInterpolationTimeOffset = Options.FingerInterpFactor * FrameTimeInMicros;
 
-		// interpolation not supported in OpenXR
-		if (Options.bUseInterpolation)
+		// interpolation not supported in OpenXR, falls back to the latest frame if LeapC can't interpolate
+		LEAP_TRACKING_EVENT* FingerFrame =
+			Options.bUseInterpolation ? Leap->GetInterpolatedFrameAtTime(LeapTimeNow + FingerInterpolationTimeOffset) : nullptr;
+		if (FingerFrame)
 		{
-			// Let's interpolate the frame using leap function
-
 			// Get the future interpolated finger frame
-			Frame = Leap->GetInterpolatedFrameAtTime(LeapTimeNow + FingerInterpolationTimeOffset);
-
-			if (!Frame)
-			{
-				return;
-			}
-			CurrentFrame.SetFromLeapFrame(Frame, Options.HMDPositionOffset, Options.HMDRotationOffset.Quaternion());
+			CurrentFrame->SetFromLeapFrame(FingerFrame, Options.HMDPositionOffset, Options.HMDRotationOffset.Quaternion());
+			LateUpdateTimeOffset = FingerInterpolationTimeOffset;
 
 			// Get the future interpolated hand frame, farther than fingers to provide
 			// lower latency
-			Frame = Leap->GetInterpolatedFrameAtTime(LeapTimeNow + HandInterpolationTimeOffset);
-			if (!Frame)
+			LEAP_TRACKING_EVENT* HandFrame = Leap->GetInterpolatedFrameAtTime(LeapTimeNow + HandInterpolationTimeOffset);
+			if (HandFrame)
 			{
-				return;
+				CurrentFrame->SetInterpolationPartialFromLeapFrame(
+					HandFrame, Options.HMDPositionOffset, Options.HMDRotationOffset.Quaternion());
+				LateUpdateTimeOffset = HandInterpolationTimeOffset;
 			}
-			CurrentFrame.SetInterpolationPartialFromLeapFrame(Frame,Options.HMDPositionOffset, Options.HMDRotationOffset.Quaternion());
 
 			// Track our extrapolation time in stats
-			Stats.FrameExtrapolationInMS = (CurrentFrame.TimeStamp - TimeWarpTimeStamp) / 1000.f;
+			Stats.FrameExtrapolationInMS = (CurrentFrame->TimeStamp - TimeWarpTimeStamp) / 1000.f;
 		}
 		else
 		{
-			CurrentFrame.SetFromLeapFrame(Frame, Options.HMDPositionOffset, Options.HMDRotationOffset.Quaternion());
+			CurrentFrame->SetFromLeapFrame(Frame, Options.HMDPositionOffset, Options.HMDRotationOffset.Quaternion());
 			Stats.FrameExtrapolationInMS = 0;
+			LateUpdateTimeOffset = Frame->info.timestamp - LeapTimeNow;
 		}
+		BeginLateUpdateSamples(LateUpdateTimeOffset);
 	}
 	else
 	{
-		CurrentFrame.SetFromLeapFrame(Frame, Options.HMDPositionOffset, Options.HMDRotationOffset.Quaternion());
+		CurrentFrame->SetFromLeapFrame(Frame, Options.HMDPositionOffset, Options.HMDRotationOffset.Quaternion());
 		Stats.FrameExtrapolationInMS = 0;
 	}
 
-	ParseEvents();
+	ParseEvents(Change);
+
+	EndLateUpdateSamples();
+}
+void FUltraleapDevice::InvalidateCurrentFrame()
+{
+	LastFrameId = -1;
+	LastFrameTimeStamp = 0;
+	// readers keyed on the version (BodyState, origin snapshots) refresh even before the next tick
+	++FrameVersion;
+}
+FUltraleapDevice::EFrameChange FUltraleapDevice::GetFrameChange(const LEAP_TRACKING_EVENT* Frame)
+{
+	const bool bSameFrame = Frame->tracking_frame_id == LastFrameId && Frame->info.timestamp == LastFrameTimeStamp;
+	LastFrameId = Frame->tracking_frame_id;
+	LastFrameTimeStamp = Frame->info.timestamp;
+
+	// interpolated frames are new every tick
+	if (!bSameFrame || !Options.bSkipUnchangedFrames || (Options.bUseInterpolation && !Options.bUseOpenXRAsSource))
+	{
+		return EFrameChange::NewFrame;
+	}
+	return NeedsPerTickTransform() ? EFrameChange::Transform : EFrameChange::None;
+}
+bool FUltraleapDevice::NeedsPerTickTransform() const
+{
+	// the HMD transform in ParseEvents
+	return Options.Mode == LEAP_MODE_VR && Options.bTransformOriginToHMD && !Options.bUseOpenXRAsSource;
+}
+bool FUltraleapDevice::UpdateIdleState(const bool bHandsPresent)
+{
+	if (bHandsPresent || !Options.bEnableIdleMode)
+	{
+		TimeWithoutHands = 0;
+		if (bIsIdle)
+		{
+			ExitIdle();
+		}
+		return false;
+	}
+	TimeWithoutHands += DeltaTimeFromTick;
+	if (!bIsIdle && TimeWithoutHands >= Options.IdleTimeout)
+	{
+		EnterIdle();
+	}
+	return bIsIdle;
+}
+void FUltraleapDevice::EnterIdle()
+{
+	bIsIdle = true;
+	Stats.bIsIdle = true;
+
+	IdlePolicyFlags = Options.bIdleLowPowerPolicies ? CurrentPolicyFlags & IdleLowPowerPolicies : 0;
+	if (IdlePolicyFlags & eLeapPolicyFlag_Images)
+	{
+		SetLeapPolicy(LEAP_POLICY_IMAGES, false);
+	}
+	if (IdlePolicyFlags & eLeapPolicyFlag_MapPoints)
+	{
+		SetLeapPolicy(LEAP_POLICY_MAP_POINTS, false);
+	}
+	UE_LOG(UltraleapTrackingLog, Log, TEXT("%s idle after %.1fs without hands."), *Config.DeviceName, TimeWithoutHands);
 }
+void FUltraleapDevice::ExitIdle()
+{
+	bIsIdle = false;
+	Stats.bIsIdle = false;
+
+	if (IdlePolicyFlags & eLeapPolicyFlag_Images)
+	{
+		SetLeapPolicy(LEAP_POLICY_IMAGES, true);
+	}
+	if (IdlePolicyFlags & eLeapPolicyFlag_MapPoints)
+	{
+		SetLeapPolicy(LEAP_POLICY_MAP_POINTS, true);
+	}
+	IdlePolicyFlags = 0;
+	UE_LOG(UltraleapTrackingLog, Log, TEXT("%s woke from idle."), *Config.DeviceName);
+}
+void FUltraleapDevice::UpdateIdleTimeSaved(const uint32 StartCycles)
+{
+	const float TickMS = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+	if (!bIsIdle)
+	{
+		ActiveTickCostMS = FMath::Lerp(ActiveTickCostMS, TickMS, IdleCostSmoothing);
+		return;
+	}
+	const float SavedMS = FMath::Max(ActiveTickCostMS - TickMS, 0.f);
+	Stats.IdleTimeSavedInMS += SavedMS;
 
-void FUltraleapDevice::ParseEvents()
+	INC_DWORD_STAT(STAT_MultiLeapIdleDevices);
+	INC_FLOAT_STAT_BY(STAT_MultiLeapIdleTimeSaved, SavedMS);
+}
+// Before ParseEvents, the hands are still as converted from LeapC
+void FUltraleapDevice::BeginLateUpdateSamples(const int64 TimeOffset)
+{
+	for (const FLeapHandData& Hand : CurrentFrame->Hands)
+	{
+		FLeapLateUpdateSample& Sample = LateUpdateSamples[Hand.HandType == EHandType::LEAP_HAND_LEFT ? 0 : 1];
+		Sample.TimeStamp = CurrentFrame->TimeStamp;
+		Sample.TimeOffset = TimeOffset;
+		Sample.RawPalm = FTransform(Hand.Palm.Orientation, Hand.Palm.Position);
+		Sample.HMDPositionOffset = Options.HMDPositionOffset;
+		Sample.HMDRotationOffset = Options.HMDRotationOffset.Quaternion();
+		Sample.bValid = true;
+	}
+}
+// After ParseEvents, the hands are as the rest of the engine sees them
+void FUltraleapDevice::EndLateUpdateSamples()
+{
+	for (const FLeapHandData& Hand : CurrentFrame->Hands)
+	{
+		FLeapLateUpdateSample& Sample = LateUpdateSamples[Hand.HandType == EHandType::LEAP_HAND_LEFT ? 0 : 1];
+		Sample.FramePalm = FTransform(Hand.Palm.Orientation, Hand.Palm.Position);
+	}
+}
+bool FUltraleapDevice::GetLateUpdateSample(const EHandType HandType, FLeapLateUpdateSample& OutSample)
 {
+	const FLeapLateUpdateSample& Sample = LateUpdateSamples[HandType == EHandType::LEAP_HAND_LEFT ? 0 : 1];
+	if (!Sample.bValid)
+	{
+		return false;
+	}
+	OutSample = Sample;
+	return true;
+}
+
+void FUltraleapDevice::ParseEvents(const EFrameChange Change)
+{
+	if (Change == EFrameChange::None)
+	{
+		// CurrentFrame is already parsed, at most re-send it
+		INC_DWORD_STAT(STAT_MultiLeapUnchangedFrames);
+		INC_DWORD_STAT(STAT_MultiLeapSkippedGestureChecks);
+		if (Options.bBroadcastUnchangedFrames)
+		{
+			if (IsInGameThread())
+			{
+				UpdateEventSubscriptions();
+			}
+			else
+			{
+				EventSubscriptions = ~ELeapEventSubscription::None;
+			}
+			BroadcastComponentEvents();
+		}
+		return;
+	}
+
 	// Are we in HMD mode? add our HMD snapshot
 	// Note with Open XR, the data is already transformed for the HMD/player camera
 	if (Options.Mode == LEAP_MODE_VR && Options.bTransformOriginToHMD && !Options.bUseOpenXRAsSource)
@@ -498,12 +718,12 @@ void FUltraleapDevice::ParseEvents()
 			FinalHMDTranslation += WarpTranslation;
 
 			FinalHMDRotation = FLeapUtility::CombineRotators(WarpRotation, FinalHMDRotation);
-			CurrentFrame.FinalRotationAdjustment = FinalHMDRotation;
+			CurrentFrame->FinalRotationAdjustment = FinalHMDRotation;
 		}
 
 		// Rotate our frame by time warp difference
-		CurrentFrame.RotateFrame(FinalHMDRotation);
-		CurrentFrame.TranslateFrame(FinalHMDTranslation);
+		CurrentFrame->RotateFrame(FinalHMDRotation);
+		CurrentFrame->TranslateFrame(FinalHMDTranslation);
 
 		// store device origin for combiner
 		// Ideally this should include the HMD offset
@@ -512,390 +732,302 @@ void FUltraleapDevice::ParseEvents()
 	else if (Options.Mode == LEAP_MODE_SCREENTOP)
 	{
 		FRotator ScreentopToDesktop(-90, 0, 180);
-		CurrentFrame.RotateFrame(ScreentopToDesktop.GetInverse());
+		CurrentFrame->RotateFrame(ScreentopToDesktop.GetInverse());
 	}
-	if (LastLeapTime == 0)
-		LastLeapTime = Leap->GetNow();
-	
 	// apply any tracking system specific changes to the hand
 	// e.g. Pinch and Grasp simulation for OpenXR
-	Leap->PostLeapHandUpdate(CurrentFrame);
+	Leap->PostLeapHandUpdate(*CurrentFrame);
+	++FrameVersion;
 
-	CheckHandVisibility();
-	CheckGrabGesture();
-	CheckPinchGesture();
+	// off the game thread the bound delegates can't be read, queue everything and filter once on the game thread
+	if (IsInGameThread())
+	{
+		UpdateEventSubscriptions();
+	}
+	else
+	{
+		EventSubscriptions = ~ELeapEventSubscription::None;
+	}
+	// the same tracking frame can't change visibility or gestures, the timeouts catch up on the next frame
+	if (Change == EFrameChange::NewFrame)
+	{
+		UpdateHandStates();
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_MultiLeapSkippedGestureChecks);
+	}
 
-	// Emit tracking data if it is being captured
-	CallFunctionOnComponents(
-		[this](ULeapComponent* Component)
-		{
-			// Scale input?
-			// FinalFrameData.ScaleByWorldScale(Component->GetWorld()->GetWorldSettings()->WorldToMeters
-			// / 100.f);
-			Component->OnLeapTrackingData.Broadcast(CurrentFrame);
-		});
+	// the copy every reader and the broadcast share
+	PublishFrameSnapshot();
 
-	// It's now the past data
-	PastFrame = CurrentFrame;
-	LastLeapTime = Leap->GetNow();
-}
+	// Emit the queued events and the tracking data if it is being captured
+	// Scale input?
+	// FinalFrameData.ScaleByWorldScale(Component->GetWorld()->GetWorldSettings()->WorldToMeters / 100.f);
+	BroadcastComponentEvents();
 
-void FUltraleapDevice::CheckHandVisibility()
-{
-	if (UseTimeBasedVisibilityCheck)
+	if (Change == EFrameChange::NewFrame)
 	{
-		// Update visible hand list, must happen first
-		if (IsLeftVisible)
-		{
-			TimeSinceLastLeftVisible = TimeSinceLastLeftVisible + (Leap->GetNow() - LastLeapTime);
-		}
-		if (IsRightVisible)
-		{
-			TimeSinceLastRightVisible = TimeSinceLastRightVisible + (Leap->GetNow() - LastLeapTime);
-		}
-		for (auto& Hand : CurrentFrame.Hands)
-		{
-			if (Hand.HandType == EHandType::LEAP_HAND_LEFT)
-			{
-				if (CurrentFrame.LeftHandVisible)
-				{
-					TimeSinceLastLeftVisible = 0;
-					LastLeftHand = Hand;
-					if (!IsLeftVisible)
-					{
-						IsLeftVisible = true;
-						const bool LeftVisible = true;
-						CallFunctionOnComponents([this, LeftVisible](ULeapComponent* Component)
-							{ Component->OnLeftHandVisibilityChanged.Broadcast(LeftVisible); });
-						CallFunctionOnComponents(
-							[Hand](ULeapComponent* Component) { Component->OnHandBeginTracking.Broadcast(Hand); });
-					}
-				}
-			}
-			else if (Hand.HandType == EHandType::LEAP_HAND_RIGHT)
-			{
-				if (CurrentFrame.RightHandVisible)
-				{
-					TimeSinceLastRightVisible = 0;
-					LastRightHand = Hand;
-					if (!IsRightVisible)
-					{
-						IsRightVisible = true;
-						const bool RightVisible = true;
-						CallFunctionOnComponents([this, RightVisible](ULeapComponent* Component)
-							{ Component->OnRightHandVisibilityChanged.Broadcast(RightVisible); });
-						CallFunctionOnComponents(
-							[Hand](ULeapComponent* Component) { Component->OnHandBeginTracking.Broadcast(Hand); });
-					}
-				}
-			}
-		}
+		UpdateLastSeenHands();
 
-		// Check if hands should no longer be visible
-		if (IsLeftVisible && TimeSinceLastLeftVisible > VisibilityTimeout)
-		{
-			IsLeftVisible = false;
-			const FLeapHandData EndHand = LastLeftHand;
-			CallFunctionOnComponents([EndHand](ULeapComponent* Component) { Component->OnHandEndTracking.Broadcast(EndHand); });
-			const bool LeftVisible = false;
-			CallFunctionOnComponents(
-				[this, LeftVisible](ULeapComponent* Component) { Component->OnLeftHandVisibilityChanged.Broadcast(LeftVisible); });
-		}
-		if (IsRightVisible && TimeSinceLastRightVisible > VisibilityTimeout)
+		if (FLeapLatencyTracer::IsEnabled() && FrameCaptureTime > 0)
 		{
-			IsRightVisible = false;
-			const FLeapHandData EndHand = LastRightHand;
-			CallFunctionOnComponents([EndHand](ULeapComponent* Component) { Component->OnHandEndTracking.Broadcast(EndHand); });
-			const bool RightVisible = false;
-			CallFunctionOnComponents([this, RightVisible](ULeapComponent* Component)
-				{ Component->OnRightHandVisibilityChanged.Broadcast(RightVisible); });
+			FLeapLatencyTracer::Get().Record(ELeapLatencyStage::Parse, FrameCaptureTime);
 		}
 	}
-	else
+}
+
+void FUltraleapDevice::UpdateHandStates()
+{
+	HandTransitions.Reset();
+	HandStates.Update(*CurrentFrame, Leap->GetNow(), HandTransitions);
+
+	for (const FLeapHandStateMachine::FTransition& Transition : HandTransitions)
 	{
-		// Use old, frame based checking
-		// Compare past to present visible hands to determine hand enums.
-		//== change can happen when chirality is incorrect and changes
-		// Hand end tracking must be called first before we call begin tracking
-		// Add each hand to visible hands
-		// CurrentFrame.Hands;
-		TArray<int32> VisibleHands;
-		for (auto& Hand : CurrentFrame.Hands)
-		{
-			VisibleHands.Add(Hand.Id);
-		}
-		if (VisibleHands.Num() <= PastVisibleHands.Num())
-		{
-			for (auto HandId : PastVisibleHands)
-			{
-				// Not visible anymore? lost hand
-				if (!VisibleHands.Contains(HandId))
-				{
-					const FLeapHandData Hand = PastFrame.HandForId(HandId);
-					CallFunctionOnComponents([Hand](ULeapComponent* Component) { Component->OnHandEndTracking.Broadcast(Hand); });
-				}
-			}
-		}
+		const bool bLeft = Transition.HandType == EHandType::LEAP_HAND_LEFT;
+		// hands that have left the frame are found where they were last seen
+		const EComponentEventHand HandSource =
+			Transition.HandIndex == INDEX_NONE ? EComponentEventHand::LastSeen : EComponentEventHand::CurrentFrame;
+		const int32 HandIndex = Transition.HandIndex == INDEX_NONE ? (int32) Transition.HandType : Transition.HandIndex;
 
-		// Check for hand visibility changes
-		if (PastFrame.LeftHandVisible != CurrentFrame.LeftHandVisible)
-		{
-			const bool LeftVisible = CurrentFrame.LeftHandVisible;
-			CallFunctionOnComponents(
-				[this, LeftVisible](ULeapComponent* Component) { Component->OnLeftHandVisibilityChanged.Broadcast(LeftVisible); });
-		}
-		if (PastFrame.RightHandVisible != CurrentFrame.RightHandVisible)
+		switch (Transition.Type)
 		{
-			const bool RightVisible = CurrentFrame.RightHandVisible;
-			CallFunctionOnComponents([this, RightVisible](ULeapComponent* Component)
-				{ Component->OnRightHandVisibilityChanged.Broadcast(RightVisible); });
+			case ELeapHandTransition::Visible:
+			case ELeapHandTransition::Hidden:
+				QueueVisibilityEvent(bLeft ? ELeapEventSubscription::LeftHandVisibilityChanged
+										   : ELeapEventSubscription::RightHandVisibilityChanged,
+					Transition.Type == ELeapHandTransition::Visible);
+				break;
+			case ELeapHandTransition::BeginTracking:
+				QueueHandEvent(ELeapEventSubscription::HandBeginTracking, HandSource, HandIndex);
+				break;
+			case ELeapHandTransition::EndTracking:
+				QueueHandEvent(ELeapEventSubscription::HandEndTracking, HandSource, HandIndex);
+				break;
+			case ELeapHandTransition::Pinch:
+				EmitKeyDownEventForKey(bLeft ? EKeysLeap::LeapPinchL : EKeysLeap::LeapPinchR);
+				QueueHandEvent(ELeapEventSubscription::HandPinched, HandSource, HandIndex);
+				break;
+			case ELeapHandTransition::Unpinch:
+				EmitKeyUpEventForKey(bLeft ? EKeysLeap::LeapPinchL : EKeysLeap::LeapPinchR);
+				QueueHandEvent(ELeapEventSubscription::HandUnpinched, HandSource, HandIndex);
+				break;
+			case ELeapHandTransition::Grab:
+				EmitKeyDownEventForKey(bLeft ? EKeysLeap::LeapGrabL : EKeysLeap::LeapGrabR);
+				QueueHandEvent(ELeapEventSubscription::HandGrabbed, HandSource, HandIndex);
+				break;
+			case ELeapHandTransition::Release:
+				EmitKeyUpEventForKey(bLeft ? EKeysLeap::LeapGrabL : EKeysLeap::LeapGrabR);
+				QueueHandEvent(ELeapEventSubscription::HandReleased, HandSource, HandIndex);
+				break;
 		}
-
-		for (auto& Hand : CurrentFrame.Hands)
+	}
+}
+// After the broadcast, the events queued this frame still refer to where the hands were before it
+void FUltraleapDevice::UpdateLastSeenHands()
+{
+	const bool bHandVisible[FLeapHandStateMachine::NumSlots] = {
+		LatestFrameSnapshot->LeftHandVisible, LatestFrameSnapshot->RightHandVisible};
+	for (int32 HandIndex = 0; HandIndex < LatestFrameSnapshot->Hands.Num(); HandIndex++)
+	{
+		const int32 Slot = LatestFrameSnapshot->Hands[HandIndex].HandType;
+		if (Slot >= 0 && Slot < FLeapHandStateMachine::NumSlots && bHandVisible[Slot])
 		{
-			FLeapHandData PastHand;
-
-			// Hand list is tiny, typically 1-3, just enum until you find the matching
-			// one
-			for (auto& EnumPastHand : PastFrame.Hands)
-			{
-				if (Hand.Id == EnumPastHand.Id)
-				{
-					// Same id? same hand
-					PastHand = EnumPastHand;
-				}
-			}
-
-			if (!PastVisibleHands.Contains(Hand.Id))	// or if the hand changed type?
-			{
-				// New hand
-				CallFunctionOnComponents([Hand](ULeapComponent* Component) { Component->OnHandBeginTracking.Broadcast(Hand); });
-			}
+			LastHandFrames[Slot] = LatestFrameSnapshot;
+			LastHandIndices[Slot] = HandIndex;
 		}
-		PastVisibleHands = VisibleHands;
 	}
 }
+void FUltraleapDevice::UpdateEventSubscriptions()
+{
+	EventDelegateSubscriptions.Reset();
+	EventSubscriptions = ELeapEventSubscription::None;
+	for (const ULeapComponent* EventDelegate : EventDelegates)
+	{
+		const ELeapEventSubscription Subscriptions = EventDelegate->GetEventSubscriptions();
+		EventDelegateSubscriptions.Add(Subscriptions);
+		EventSubscriptions |= Subscriptions;
+	}
+}
+// static
+ELeapEventSubscription FUltraleapDevice::GetHandSubscription(const FLeapHandData& Hand)
+{
+	return Hand.HandType == EHandType::LEAP_HAND_LEFT ? ELeapEventSubscription::LeftHand : ELeapEventSubscription::RightHand;
+}
+void FUltraleapDevice::QueueHandEvent(const ELeapEventSubscription Type, const EComponentEventHand HandSource, const int32 HandIndex)
+{
+	FComponentEvent Event;
+	Event.Type = Type;
+	Event.HandSource = HandSource;
+	Event.HandIndex = (int8) HandIndex;
 
-void FUltraleapDevice::CheckPinchGesture()
+	if (!EnumHasAnyFlags(EventSubscriptions, Type) ||
+		!EnumHasAnyFlags(EventSubscriptions, GetHandSubscription(GetComponentEventHand(Event))))
+	{
+		return;
+	}
+	ComponentEvents.Add(Event);
+}
+void FUltraleapDevice::QueueVisibilityEvent(const ELeapEventSubscription Type, const bool bVisible)
 {
-	if (UseTimeBasedGestureCheck)
+	if (!EnumHasAnyFlags(EventSubscriptions, Type))
 	{
-		if (IsLeftPinching)
-		{
-			TimeSinceLastLeftPinch = TimeSinceLastLeftPinch + (Leap->GetNow() - LastLeapTime);
-		}
-		if (IsRightPinching)
-		{
-			TimeSinceLastRightPinch = TimeSinceLastRightPinch + (Leap->GetNow() - LastLeapTime);
-		}
-		for (auto& Hand : CurrentFrame.Hands)
+		return;
+	}
+	FComponentEvent& Event = ComponentEvents.AddDefaulted_GetRef();
+	Event.Type = Type;
+	Event.bVisible = bVisible;
+}
+const FLeapHandData& FUltraleapDevice::GetComponentEventHand(const FComponentEvent& Event) const
+{
+	static const FLeapHandData NoHand;
+
+	switch (Event.HandSource)
+	{
+		case EComponentEventHand::CurrentFrame:
+			return CurrentFrame->Hands.IsValidIndex(Event.HandIndex) ? CurrentFrame->Hands[Event.HandIndex] : NoHand;
+		case EComponentEventHand::LastSeen:
 		{
-			const FLeapHandData& FinalHandData = Hand;
-			if (Hand.HandType == EHandType::LEAP_HAND_LEFT)
+			if (Event.HandIndex < 0 || Event.HandIndex >= FLeapHandStateMachine::NumSlots)
 			{
-				if ((!IsLeftGrabbing && (!IsLeftPinching && (Hand.PinchStrength > StartPinchThreshold))) ||
-					(IsLeftPinching && (Hand.PinchStrength > EndPinchThreshold)))
-				{
-					TimeSinceLastLeftPinch = 0;
-					if (!IsLeftPinching)
-					{
-						IsLeftPinching = true;
-						EmitKeyDownEventForKey(EKeysLeap::LeapPinchL);
-						CallFunctionOnComponents(
-							[FinalHandData](ULeapComponent* Component) { Component->OnHandPinched.Broadcast(FinalHandData); });
-					}
-				}
-				else if (IsLeftPinching && (TimeSinceLastLeftPinch > PinchTimeout))
-				{
-					IsLeftPinching = false;
-					EmitKeyUpEventForKey(EKeysLeap::LeapPinchL);
-					CallFunctionOnComponents(
-						[FinalHandData](ULeapComponent* Component) { Component->OnHandUnpinched.Broadcast(FinalHandData); });
-				}
-			}
-			else if (Hand.HandType == EHandType::LEAP_HAND_RIGHT)
-			{
-				if ((!IsRightGrabbing && (!IsRightPinching && (Hand.PinchStrength > StartPinchThreshold))) ||
-					(IsRightPinching && (Hand.PinchStrength > EndPinchThreshold)))
-				{
-					TimeSinceLastRightPinch = 0;
-					if (!IsRightPinching)
-					{
-						IsRightPinching = true;
-						EmitKeyDownEventForKey(EKeysLeap::LeapPinchR);
-						CallFunctionOnComponents(
-							[FinalHandData](ULeapComponent* Component) { Component->OnHandPinched.Broadcast(FinalHandData); });
-					}
-				}
-				else if (IsRightPinching && (TimeSinceLastRightPinch > PinchTimeout))
-				{
-					IsRightPinching = false;
-					EmitKeyUpEventForKey(EKeysLeap::LeapPinchR);
-					CallFunctionOnComponents(
-						[FinalHandData](ULeapComponent* Component) { Component->OnHandUnpinched.Broadcast(FinalHandData); });
-				}
+				return NoHand;
 			}
+			const TSharedPtr<const FLeapFrameData, ESPMode::ThreadSafe>& Frame = LastHandFrames[Event.HandIndex];
+			const int32 HandIndex = LastHandIndices[Event.HandIndex];
+			return Frame.IsValid() && Frame->Hands.IsValidIndex(HandIndex) ? Frame->Hands[HandIndex] : NoHand;
 		}
+		default:
+			return NoHand;
 	}
-	else
+}
+// static
+void FUltraleapDevice::BroadcastComponentEvent(ULeapComponent* Component, const FComponentEvent& Event, const FLeapHandData& Hand)
+{
+	switch (Event.Type)
 	{
-		for (auto& Hand : CurrentFrame.Hands)
-		{
-			FLeapHandData PastHand;
-
-			// Hand list is tiny, typically 1-3, just enum until you find the matching
-			// one
-			for (auto& EnumPastHand : PastFrame.Hands)
-			{
-				if (Hand.Id == EnumPastHand.Id)
-				{
-					// Same id? same hand
-					PastHand = EnumPastHand;
-				}
-			}
+		case ELeapEventSubscription::HandBeginTracking:
+			Component->OnHandBeginTracking.Broadcast(Hand);
+			break;
+		case ELeapEventSubscription::HandEndTracking:
+			Component->OnHandEndTracking.Broadcast(Hand);
+			break;
+		case ELeapEventSubscription::LeftHandVisibilityChanged:
+			Component->OnLeftHandVisibilityChanged.Broadcast(Event.bVisible);
+			break;
+		case ELeapEventSubscription::RightHandVisibilityChanged:
+			Component->OnRightHandVisibilityChanged.Broadcast(Event.bVisible);
+			break;
+		case ELeapEventSubscription::HandPinched:
+			Component->OnHandPinched.Broadcast(Hand);
+			break;
+		case ELeapEventSubscription::HandUnpinched:
+			Component->OnHandUnpinched.Broadcast(Hand);
+			break;
+		case ELeapEventSubscription::HandGrabbed:
+			Component->OnHandGrabbed.Broadcast(Hand);
+			break;
+		case ELeapEventSubscription::HandReleased:
+			Component->OnHandReleased.Broadcast(Hand);
+			break;
+		default:
+			break;
+	}
+}
+// Game thread only. Components only get the events they have handlers bound for, and hand events only for the hands
+// they asked for
+void FUltraleapDevice::BroadcastComponentEvents(const TArrayView<const FComponentEvent> Events,
+	const TArrayView<const FLeapHandData* const> Hands, const FLeapFrameData& Frame)
+{
+	// handlers can remove components, so bounds check against both lists
+	for (int32 EventIndex = 0; EventIndex < Events.Num(); EventIndex++)
+	{
+		const FComponentEvent& Event = Events[EventIndex];
+		const FLeapHandData& Hand = *Hands[EventIndex];
+		const ELeapEventSubscription HandSubscription =
+			Event.HandSource == EComponentEventHand::None ? ELeapEventSubscription::None : GetHandSubscription(Hand);
 
-			const FLeapHandData& FinalHandData = Hand;
-			// Pinch
-			if (Hand.PinchStrength > StartPinchThreshold && PastHand.PinchStrength <= StartPinchThreshold)
-			{
-				if (Hand.HandType == EHandType::LEAP_HAND_LEFT)
-				{
-					EmitKeyDownEventForKey(EKeysLeap::LeapPinchL);
-				}
-				else if (Hand.HandType == EHandType::LEAP_HAND_RIGHT)
-				{
-					EmitKeyDownEventForKey(EKeysLeap::LeapPinchR);
-				}
-				CallFunctionOnComponents(
-					[FinalHandData](ULeapComponent* Component) { Component->OnHandPinched.Broadcast(FinalHandData); });
-			}
-			// Unpinch (TODO: Adjust values)
-			else if (Hand.PinchStrength <= EndPinchThreshold && PastHand.PinchStrength > EndPinchThreshold)
+		for (int32 i = 0; i < EventDelegates.Num() && i < EventDelegateSubscriptions.Num(); i++)
+		{
+			const ELeapEventSubscription Subscriptions = EventDelegateSubscriptions[i];
+			if (EnumHasAnyFlags(Subscriptions, Event.Type) &&
+				(HandSubscription == ELeapEventSubscription::None || EnumHasAnyFlags(Subscriptions, HandSubscription)))
 			{
-				if (Hand.HandType == EHandType::LEAP_HAND_LEFT)
-				{
-					EmitKeyUpEventForKey(EKeysLeap::LeapPinchL);
-				}
-				else if (Hand.HandType == EHandType::LEAP_HAND_RIGHT)
-				{
-					EmitKeyUpEventForKey(EKeysLeap::LeapPinchR);
-				}
-				CallFunctionOnComponents(
-					[FinalHandData](ULeapComponent* Component) { Component->OnHandUnpinched.Broadcast(FinalHandData); });
+				BroadcastComponentEvent(EventDelegates[i], Event, Hand);
 			}
 		}
 	}
-}
 
-void FUltraleapDevice::CheckGrabGesture()
-{
-	if (UseTimeBasedGestureCheck)
+	const ELeapEventSubscription AnyTrackingData = ELeapEventSubscription::TrackingData |
+												   ELeapEventSubscription::LeftHandTrackingData |
+												   ELeapEventSubscription::RightHandTrackingData;
+	if (!EnumHasAnyFlags(EventSubscriptions, AnyTrackingData))
+	{
+		return;
+	}
+	const FLeapHandData* LeftHand =
+		Frame.Hands.FindByPredicate([](const FLeapHandData& Hand) { return Hand.HandType == EHandType::LEAP_HAND_LEFT; });
+	const FLeapHandData* RightHand =
+		Frame.Hands.FindByPredicate([](const FLeapHandData& Hand) { return Hand.HandType == EHandType::LEAP_HAND_RIGHT; });
+
+	for (int32 i = 0; i < EventDelegates.Num() && i < EventDelegateSubscriptions.Num(); i++)
 	{
-		if (IsLeftGrabbing)
+		const ELeapEventSubscription Subscriptions = EventDelegateSubscriptions[i];
+		if (EnumHasAnyFlags(Subscriptions, ELeapEventSubscription::TrackingData))
 		{
-			TimeSinceLastLeftGrab = TimeSinceLastLeftGrab + (Leap->GetNow() - LastLeapTime);
+			EventDelegates[i]->OnLeapTrackingData.Broadcast(Frame);
 		}
-		if (IsRightGrabbing)
+		if (LeftHand && EnumHasAnyFlags(Subscriptions, ELeapEventSubscription::LeftHandTrackingData))
 		{
-			TimeSinceLastRightGrab = TimeSinceLastRightGrab + (Leap->GetNow() - LastLeapTime);
+			EventDelegates[i]->OnLeftHandTrackingData.Broadcast(*LeftHand);
 		}
-		for (auto& Hand : CurrentFrame.Hands)
+		if (RightHand && EnumHasAnyFlags(Subscriptions, ELeapEventSubscription::RightHandTrackingData))
 		{
-			const FLeapHandData& FinalHandData = Hand;
-			if (Hand.HandType == EHandType::LEAP_HAND_LEFT)
-			{
-				if ((!IsLeftGrabbing && (Hand.GrabStrength > StartGrabThreshold)) ||
-					(IsLeftGrabbing && (Hand.GrabStrength > EndGrabThreshold)))
-				{
-					TimeSinceLastLeftGrab = 0;
-					if (!IsLeftGrabbing)
-					{
-						IsLeftGrabbing = true;
-						EmitKeyDownEventForKey(EKeysLeap::LeapGrabL);
-						CallFunctionOnComponents(
-							[FinalHandData](ULeapComponent* Component) { Component->OnHandGrabbed.Broadcast(FinalHandData); });
-					}
-				}
-				else if (IsLeftGrabbing && (TimeSinceLastLeftGrab > GrabTimeout))
-				{
-					IsLeftGrabbing = false;
-					EmitKeyUpEventForKey(EKeysLeap::LeapGrabL);
-					CallFunctionOnComponents(
-						[FinalHandData](ULeapComponent* Component) { Component->OnHandReleased.Broadcast(FinalHandData); });
-				}
-			}
-			else if (Hand.HandType == EHandType::LEAP_HAND_RIGHT)
-			{
-				if ((!IsRightGrabbing && (Hand.GrabStrength > StartGrabThreshold)) ||
-					(IsRightGrabbing && (Hand.GrabStrength > EndGrabThreshold)))
-				{
-					TimeSinceLastRightGrab = 0;
-					if (!IsRightGrabbing)
-					{
-						IsRightGrabbing = true;
-						EmitKeyDownEventForKey(EKeysLeap::LeapGrabR);
-						CallFunctionOnComponents(
-							[FinalHandData](ULeapComponent* Component) { Component->OnHandGrabbed.Broadcast(FinalHandData); });
-					}
-				}
-				else if (IsRightGrabbing && (TimeSinceLastRightGrab > GrabTimeout))
-				{
-					IsRightGrabbing = false;
-					EmitKeyUpEventForKey(EKeysLeap::LeapGrabR);
-					CallFunctionOnComponents(
-						[FinalHandData](ULeapComponent* Component) { Component->OnHandReleased.Broadcast(FinalHandData); });
-				}
-			}
+			EventDelegates[i]->OnRightHandTrackingData.Broadcast(*RightHand);
+		}
+	}
+}
+// Broadcasts the events queued while parsing the current frame, then the frame itself. Must run before the last seen
+// hands move on to the current frame as the queued events refer to hands in both
+void FUltraleapDevice::BroadcastComponentEvents()
+{
+	if (EventDelegates.Num() <= 0)
+	{
+		ComponentEvents.Reset();
+		return;
+	}
+
+	if (IsInGameThread())
+	{
+		TArray<const FLeapHandData*, TInlineAllocator<16>> Hands;
+		for (const FComponentEvent& Event : ComponentEvents)
+		{
+			Hands.Add(&GetComponentEventHand(Event));
 		}
+		BroadcastComponentEvents(ComponentEvents, Hands, *CurrentFrame);
 	}
 	else
 	{
-		for (auto& Hand : CurrentFrame.Hands)
+		// the frames will have moved on by the time the game thread runs this, so the hands are copied.
+		// Still one game thread task per frame rather than one per event
+		TArray<FComponentEvent> Events(ComponentEvents);
+		TArray<FLeapHandData> EventHands;
+		EventHands.Reserve(ComponentEvents.Num());
+		for (const FComponentEvent& Event : ComponentEvents)
 		{
-			FLeapHandData PastHand;
-
-			// Hand list is tiny, typically 1-3, just enum until you find the matching
-			// one
-			for (auto& EnumPastHand : PastFrame.Hands)
-			{
-				if (Hand.Id == EnumPastHand.Id)
-				{
-					// Same id? same hand
-					PastHand = EnumPastHand;
-				}
-			}
-
-			const FLeapHandData& FinalHandData = Hand;
-
-			if (Hand.GrabStrength > StartGrabThreshold && PastHand.GrabStrength <= StartGrabThreshold)
-			{
-				if (Hand.HandType == EHandType::LEAP_HAND_LEFT)
-				{
-					EmitKeyDownEventForKey(EKeysLeap::LeapGrabL);
-				}
-				else if (Hand.HandType == EHandType::LEAP_HAND_RIGHT)
-				{
-					EmitKeyDownEventForKey(EKeysLeap::LeapGrabR);
-				}
-				CallFunctionOnComponents(
-					[FinalHandData](ULeapComponent* Component) { Component->OnHandGrabbed.Broadcast(FinalHandData); });
-			}
-			// Release
-			else if (Hand.GrabStrength <= EndGrabThreshold && PastHand.GrabStrength > EndGrabThreshold)
-			{
-				if (Hand.HandType == EHandType::LEAP_HAND_LEFT)
-				{
-					EmitKeyUpEventForKey(EKeysLeap::LeapGrabL);
-				}
-				else if (Hand.HandType == EHandType::LEAP_HAND_RIGHT)
+			EventHands.Add(GetComponentEventHand(Event));
+		}
+		FLeapAsync::RunShortLambdaOnGameThread(
+			[this, Events = MoveTemp(Events), EventHands = MoveTemp(EventHands), Frame = GetLatestFrameSnapshot()] {
+				TArray<const FLeapHandData*, TInlineAllocator<16>> Hands;
+				for (const FLeapHandData& Hand : EventHands)
 				{
-					EmitKeyUpEventForKey(EKeysLeap::LeapGrabR);
+					Hands.Add(&Hand);
 				}
-				CallFunctionOnComponents(
-					[FinalHandData](ULeapComponent* Component) { Component->OnHandReleased.Broadcast(FinalHandData); });
-			}
-		}
+				UpdateEventSubscriptions();
+				BroadcastComponentEvents(Events, Hands, *Frame);
+			});
 	}
+	ComponentEvents.Reset();
 }
 // Device specific events such as tracking mode change will be passed through here
 // in addition to global events such as add remove device.
@@ -955,8 +1087,8 @@ void FUltraleapDevice::ShutdownLeap()
 
 void FUltraleapDevice::AreHandsVisible(bool& LeftHandIsVisible, bool& RightHandIsVisible)
 {
-	LeftHandIsVisible = CurrentFrame.LeftHandVisible;
-	RightHandIsVisible = CurrentFrame.RightHandVisible;
+	LeftHandIsVisible = CurrentFrame->LeftHandVisible;
+	RightHandIsVisible = CurrentFrame->RightHandVisible;
 }
 
 void FUltraleapDevice::SetSwizzles(
@@ -1003,16 +1135,15 @@ void FUltraleapDevice::SetTrackingMode(ELeapMode Flag)
 			Leap->SetTrackingMode(eLeapTrackingMode_ScreenTop);
 			break;
 	}
+	// CurrentFrame was transformed for the old mode
+	InvalidateCurrentFrame();
 }
 #pragma endregion Leap Input Device
 
 #pragma region BodyState
 
-void FUltraleapDevice::UpdateInput(int32 DeviceID, class UBodyStateSkeleton* Skeleton)
+void FUltraleapDevice::SetSkeletonFromCurrentFrame(UBodyStateSkeleton* Skeleton)
 {
-	SCOPE_CYCLE_COUNTER(STAT_MultiLeapBodyStateTick);
-	// UE_LOG(UltraleapTrackingLog, Log, TEXT("Update requested for %d"),
-	// DeviceID);
 	bool bLeftIsTracking = false;
 	bool bRightIsTracking = false;
 
@@ -1020,7 +1151,7 @@ void FUltraleapDevice::UpdateInput(int32 DeviceID, class UBodyStateSkeleton* Ske
 		FScopeLock ScopeLock(&Skeleton->BoneDataLock);
 
 		// Update our skeleton with new data
-		for (auto LeapHand : CurrentFrame.Hands)
+		for (auto LeapHand : CurrentFrame->Hands)
 		{
 			if (LeapHand.HandType == EHandType::LEAP_HAND_LEFT)
 			{
@@ -1053,16 +1184,11 @@ void FUltraleapDevice::UpdateInput(int32 DeviceID, class UBodyStateSkeleton* Ske
 		}
 	}
 
-	// if the number or type of bones that are tracked changed
-	bool bTrackedBonesChanged = false;
-
 	UBodyStateArm* Arm = Skeleton->LeftArm();
 
 	// Did left hand tracking state change? propagate it
 	if (bLeftIsTracking != Arm->LowerArm->IsTracked())
 	{
-		bTrackedBonesChanged = true;
-
 		if (bLeftIsTracking)
 		{
 			Arm->LowerArm->Meta.TrackingType = Config.DeviceName;
@@ -1083,8 +1209,6 @@ void FUltraleapDevice::UpdateInput(int32 DeviceID, class UBodyStateSkeleton* Ske
 	// Did right hand tracking state change? propagate it
 	if (bRightIsTracking != Arm->LowerArm->IsTracked())
 	{
-		bTrackedBonesChanged = true;
-
 		if (bRightIsTracking)
 		{
 			Arm->LowerArm->Meta.TrackingType = Config.DeviceName;
@@ -1100,18 +1224,50 @@ void FUltraleapDevice::UpdateInput(int32 DeviceID, class UBodyStateSkeleton* Ske
 		}
 	}
 
-// Livelink is an editor only thing
-#if WITH_EDITOR
-	// LiveLink logic
-	if (LiveLink->HasConnection())
+	// carried to the anim node so pose evaluation can be traced, 0 leaves it untraced
+	Skeleton->SourceCaptureTime = FLeapLatencyTracer::IsEnabled() ? FrameCaptureTime : 0;
+}
+void FUltraleapDevice::UpdateInput(int32 DeviceID, class UBodyStateSkeleton* Skeleton)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MultiLeapBodyStateTick);
+	// UE_LOG(UltraleapTrackingLog, Log, TEXT("Update requested for %d"),
+	// DeviceID);
+
+	// the hands have been gone long enough for the skeleton to already be untracked
+	if (bIsIdle)
+	{
+		BodyStateIdleTimeSavedMS += ActiveBodyStateCostMS;
+		INC_FLOAT_STAT_BY(STAT_MultiLeapIdleTimeSaved, ActiveBodyStateCostMS);
+		return;
+	}
+	const uint32 StartCycles = FPlatformTime::Cycles();
+
+	// the skeleton already holds CurrentFrame unless it has been rebuilt since, or it is a different skeleton
+	if (Options.bSkipUnchangedFrames && BodyStateFrameVersion == FrameVersion && BodyStateSkeleton.Get() == Skeleton)
+	{
+		INC_DWORD_STAT(STAT_MultiLeapSkippedBodyStateUpdates);
+	}
+	else
 	{
-		if (bTrackedBonesChanged)
+		BodyStateFrameVersion = FrameVersion;
+		BodyStateSkeleton = Skeleton;
+		SetSkeletonFromCurrentFrame(Skeleton);
+
+		if (FLeapLatencyTracer::IsEnabled() && FrameCaptureTime > 0)
 		{
-			LiveLink->SyncSubjectToSkeleton(Skeleton);
+			FLeapLatencyTracer::Get().Record(ELeapLatencyStage::BodyState, FrameCaptureTime);
 		}
+	}
+
+	// LiveLink logic, only pay for the frame when something is listening and the rate limit allows it
+	if (LiveLink.IsValid() && LiveLink->HasConnection() && LiveLink->ShouldPublish())
+	{
+		// cheap when the tracked bones haven't changed, and catches changes made on unpublished updates
+		LiveLink->SyncSubjectToSkeleton(Skeleton);
 		LiveLink->UpdateFromBodyState(Skeleton);
 	}
-#endif
+	ActiveBodyStateCostMS = FMath::Lerp(
+		ActiveBodyStateCostMS, FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles), IdleCostSmoothing);
 }
 void FUltraleapDevice::SetBSFingerFromLeapDigit(UBodyStateFinger* Finger, const FLeapDigitData& LeapDigit)
 {
@@ -1429,14 +1585,48 @@ void FUltraleapDevice::SetOptions(const FLeapOptions& InOptions)
 		Options.HMDRotationOffset = FRotator::ZeroRotator;
 	}
 
-	UseTimeBasedGestureCheck = !Options.bUseFrameBasedGestureDetection;
-
-	StartGrabThreshold = Options.StartGrabThreshold;
-	EndGrabThreshold = Options.EndGrabThreshold;
-	StartPinchThreshold = Options.StartPinchThreshold;
-	EndPinchThreshold = Options.EndPinchThreshold;
-	GrabTimeout = Options.GrabTimeout;
-	PinchTimeout = Options.PinchTimeout;
+	// frame based detection is the hysteresis alone, time based also holds gestures through short dropouts
+	const bool bTimeBasedGestures = !Options.bUseFrameBasedGestureDetection;
+	FLeapHandStateSettings HandStateSettings;
+	HandStateSettings.StartGrabThreshold = Options.StartGrabThreshold;
+	HandStateSettings.EndGrabThreshold = Options.EndGrabThreshold;
+	HandStateSettings.StartPinchThreshold = Options.StartPinchThreshold;
+	HandStateSettings.EndPinchThreshold = Options.EndPinchThreshold;
+	HandStateSettings.GrabDebounce = (int64) Options.GrabDebounce;
+	HandStateSettings.PinchDebounce = (int64) Options.PinchDebounce;
+	HandStateSettings.GrabTimeout = bTimeBasedGestures ? (int64) Options.GrabTimeout : 0;
+	HandStateSettings.PinchTimeout = bTimeBasedGestures ? (int64) Options.PinchTimeout : 0;
+	HandStateSettings.VisibilityTimeout = (int64) Options.VisibilityTimeout;
+	HandStateSettings.bBlockPinchWhileGrabbing = bTimeBasedGestures;
+	HandStates.SetSettings(HandStateSettings);
+
+	// offsets, interpolation and the like change how the same LeapC frame is parsed
+	InvalidateCurrentFrame();
+
+	UpdateLiveLinkProducer();
+}
+void FUltraleapDevice::UpdateLiveLinkProducer()
+{
+#if WITH_EDITOR
+	const bool bWantLiveLink = true;
+#else
+	const bool bWantLiveLink = Options.bEnableLiveLinkInPackagedBuilds;
+#endif
+	// Switching transport needs a new producer
+	if (LiveLink.IsValid() && (!bWantLiveLink || LiveLink->IsLoopback() != Options.bUseLiveLinkLoopback))
+	{
+		LiveLink->ShutDown();
+		LiveLink = nullptr;
+	}
+	if (bWantLiveLink && !LiveLink.IsValid())
+	{
+		LiveLink = MakeShareable(new FLeapLiveLinkProducer());
+		LiveLink->Startup(Config.DeviceSerial, Options.bUseLiveLinkLoopback);
+	}
+	if (LiveLink.IsValid())
+	{
+		LiveLink->SetPublishRate(Options.LiveLinkPublishRate, Options.LiveLinkDecimation);
+	}
 }
 FLeapOptions FUltraleapDevice::GetOptions()
 {
@@ -1445,7 +1635,9 @@ FLeapOptions FUltraleapDevice::GetOptions()
 
 FLeapStats FUltraleapDevice::GetStats()
 {
-	return Stats;
+	FLeapStats Ret = Stats;
+	Ret.IdleTimeSavedInMS += BodyStateIdleTimeSavedMS;
+	return Ret;
 }
 void FUltraleapDevice::OnDeviceDetach()
 {
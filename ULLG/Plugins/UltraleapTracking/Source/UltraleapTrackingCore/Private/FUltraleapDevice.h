@@ -15,6 +15,8 @@
 #include "IXRTrackingSystem.h"
 #include "LeapC.h"
 #include "LeapComponent.h"
+#include "LeapFramePool.h"
+#include "LeapHandStateMachine.h"
 #include "LeapImage.h"
 #include "LeapLiveLink.h"
 #include "LeapUtility.h"
@@ -34,9 +36,19 @@ public:
 
 	
 
+	// How much of CurrentFrame changed since the last tick, the stages after it skip what hasn't
+	enum class EFrameChange : uint8
+	{
+		// CurrentFrame is as it was last tick
+		None,
+		// The same tracking frame rebuilt for a new HMD pose
+		Transform,
+		NewFrame
+	};
+
 	/** Main input capture and event parsing 'tick' */
 	void CaptureAndEvaluateInput();
-	void ParseEvents();
+	void ParseEvents(const EFrameChange Change = EFrameChange::NewFrame);
 
 	// IHandTrackingDevice implementation
 	virtual void AddEventDelegate(const ULeapComponent* EventDelegate) override;
@@ -46,6 +58,7 @@ public:
 	/** Poll for controller state and send events if needed */
 	virtual void SendControllerEvents() override;
 	virtual void GetLatestFrameData(FLeapFrameData& OutData,const bool ApplyDeviceOrigin = false) override;
+	virtual FLeapFrameSnapshot GetLatestFrameSnapshot(const bool ApplyDeviceOrigin = false) override;
 	FLeapOptions GetOptions() override;
 	FLeapStats GetStats() override;
 	virtual ELeapDeviceType GetDeviceType()
@@ -59,7 +72,12 @@ public:
 	virtual void SetDeviceOrigin(const FTransform& UESpaceDeviceOriginIn) override
 	{
 		// at device level, we're in LeapSpace
-		DeviceOrigin = ConvertUEDeviceOriginToBSTransform(UESpaceDeviceOriginIn, true);
+		const FTransform NewDeviceOrigin = ConvertUEDeviceOriginToBSTransform(UESpaceDeviceOriginIn, true);
+		if (!NewDeviceOrigin.Equals(DeviceOrigin, 0.f))
+		{
+			DeviceOrigin = NewDeviceOrigin;
+			InvalidateCurrentFrame();
+		}
 	}
 	virtual void UpdateJointOcclusions(class AJointOcclusionActor* Actor) override
 	{
@@ -76,6 +94,7 @@ public:
 	{
 		return BodyStateDeviceId;
 	}
+	virtual bool GetLateUpdateSample(const EHandType HandType, FLeapLateUpdateSample& OutSample) override;
 	// end of IHandTrackingDevice implementation
 
 	void ShutdownLeap();
@@ -88,43 +107,45 @@ public:
 	// BodyState
 	virtual void UpdateInput(int32 DeviceID, class UBodyStateSkeleton* Skeleton) override;
 	virtual void OnDeviceDetach();
+	// UpdateInput only reads CurrentFrame and writes its own skeleton
+	virtual bool SupportsParallelUpdateInput() override
+	{
+		return true;
+	}
 
 	FCriticalSection LeapSection;
 
 	static FTransform ConvertUEDeviceOriginToBSTransform(const FTransform& TransformUE, const bool Direction);
 	
 protected:
-	FLeapFrameData CurrentFrame;
+	// The frame being parsed, then published as the latest snapshot as is. Never written once published, BeginFrameParse
+	// points it at a frame no reader holds before it is rebuilt
+	FLeapFramePool::FFrameRef CurrentFrame;
+	FLeapFramePool ParseFrames;
+	void BeginFrameParse();
+	// True if ParseEvents transforms CurrentFrame in place, a frame parsed more than once has to start from a copy
+	bool ParseTransformsFrame() const;
 	float DeltaTimeFromTick;
 
+	// Idle mode (FLeapOptions::bEnableIdleMode), call once per input tick with whether any hand is in view. Returns
+	// true while idle, the caller should skip the rest of the tick
+	bool UpdateIdleState(const bool bHandsPresent);
+	// Call at the end of an input tick started at StartCycles, tracks what the idle ticks save
+	void UpdateIdleTimeSaved(const uint32 StartCycles);
+
+	// True if CurrentFrame changes every tick with the HMD pose, even without a new tracking frame
+	bool NeedsPerTickTransform() const;
+
+	// FPlatformTime::Seconds the tracking data in CurrentFrame was captured at, only kept with leap.LatencyTrace on
+	double FrameCaptureTime = 0;
+
 private:
-	bool UseTimeBasedVisibilityCheck = false;
-	bool UseTimeBasedGestureCheck = false;
-	// Time Based Variables
-	// Pinch And Grab Thresholds
-	float StartGrabThreshold = .8f;
-	float EndGrabThreshold = .5f;
-	float StartPinchThreshold = .8f;
-	float EndPinchThreshold = .5f;
-	double TimeSinceLastLeftPinch = 0;
-	double TimeSinceLastRightPinch = 0;
-	double TimeSinceLastLeftGrab = 0;
-	double TimeSinceLastRightGrab = 0;
-	double PinchTimeout = 100000;	 //.1 Second
-	double GrabTimeout = 100000;	 //.1 Second
-	bool IsLeftPinching = false;
-	bool IsRightPinching = false;
-	bool IsLeftGrabbing = false;
-	bool IsRightGrabbing = false;
-	// Visibility Tracking and Thresholds
-	bool IsLeftVisible = false;
-	bool IsRightVisible = false;
-	int64_t TimeSinceLastLeftVisible = 10000;
-	int64_t TimeSinceLastRightVisible = 10000;
-	int64_t VisibilityTimeout = 1000000;	// 1 Second
-	int64_t LastLeapTime = 0;
-	FLeapHandData LastLeftHand;
-	FLeapHandData LastRightHand;
+	// Visibility, pinch and grab with hysteresis, configured from the gesture options
+	FLeapHandStateMachine HandStates;
+	FLeapHandStateMachine::FTransitions HandTransitions;
+	// The published frame each hand was last seen in and its index there, for events about hands that have left
+	TSharedPtr<const FLeapFrameData, ESPMode::ThreadSafe> LastHandFrames[FLeapHandStateMachine::NumSlots];
+	int32 LastHandIndices[FLeapHandStateMachine::NumSlots] = {INDEX_NONE, INDEX_NONE};
 	FTransform DeviceOrigin;
 
 	// Private UProperties
@@ -138,16 +159,81 @@ private:
 	bool EmitAnalogInputEventForKey(FKey Key, float Value, int32 User, bool Repeat);
 	bool HandClosed(float Strength);
 	bool HandPinched(float Strength);
-	void CheckHandVisibility();
-	void CheckPinchGesture();
-	void CheckGrabGesture();
+	// Runs the hand state machine over CurrentFrame and queues its transitions as events
+	void UpdateHandStates();
+	void UpdateLastSeenHands();
+
+	// Component events found while parsing a frame are queued and broadcast together once the frame is parsed
+	// Where the hand an event refers to is kept until the queue is broadcast
+	enum class EComponentEventHand : uint8
+	{
+		None,
+		CurrentFrame,
+		// The last frame the hand was in, HandIndex is the EHandType
+		LastSeen
+	};
+	struct FComponentEvent
+	{
+		// A single event flag
+		ELeapEventSubscription Type = ELeapEventSubscription::None;
+		EComponentEventHand HandSource = EComponentEventHand::None;
+		// Index into the source frame's hands
+		int8 HandIndex = INDEX_NONE;
+		bool bVisible = false;
+	};
+	// A frame raises at most a handful of events, inline so the queue never allocates
+	TArray<FComponentEvent, TInlineAllocator<16>> ComponentEvents;
+
+	// What each of EventDelegates has handlers bound for and the union of them, refreshed every frame on the game thread
+	TArray<ELeapEventSubscription, TInlineAllocator<8>> EventDelegateSubscriptions;
+	ELeapEventSubscription EventSubscriptions = ELeapEventSubscription::None;
+	void UpdateEventSubscriptions();
+	static ELeapEventSubscription GetHandSubscription(const FLeapHandData& Hand);
+
+	void QueueHandEvent(const ELeapEventSubscription Type, const EComponentEventHand HandSource, const int32 HandIndex = INDEX_NONE);
+	void QueueVisibilityEvent(const ELeapEventSubscription Type, const bool bVisible);
+	const FLeapHandData& GetComponentEventHand(const FComponentEvent& Event) const;
+	static void BroadcastComponentEvent(ULeapComponent* Component, const FComponentEvent& Event, const FLeapHandData& Hand);
+	void BroadcastComponentEvents(const TArrayView<const FComponentEvent> Events, const TArrayView<const FLeapHandData* const> Hands,
+		const FLeapFrameData& Frame);
+	void BroadcastComponentEvents();
 
 	int64 GetInterpolatedNow();
 
+	// Late update samples of the current frame's hands, left then right
+	FLeapLateUpdateSample LateUpdateSamples[2];
+	void BeginLateUpdateSamples(const int64 TimeOffset);
+	void EndLateUpdateSamples();
+
 	// Internal states
 	FLeapOptions Options;
 	FLeapStats Stats;
 
+	// Idle mode state
+	bool bIsIdle = false;
+	float TimeWithoutHands = 0;
+	// Smoothed cost in ms of an active input tick and BodyState update, what an idle one saves
+	float ActiveTickCostMS = 0;
+	float ActiveBodyStateCostMS = 0;
+	// BodyState updates can run on worker tasks, kept apart from Stats until GetStats
+	float BodyStateIdleTimeSavedMS = 0;
+	// Last policies reported by the service and the ones turned off for idle mode
+	uint32 CurrentPolicyFlags = 0;
+	uint32 IdlePolicyFlags = 0;
+	void EnterIdle();
+	void ExitIdle();
+
+	// Unchanged frame detection, the LeapC frame CurrentFrame was last built from
+	int64 LastFrameId = -1;
+	int64 LastFrameTimeStamp = 0;
+	// Bumped whenever CurrentFrame is rebuilt, and the version BodyStateSkeleton was last set from
+	uint32 FrameVersion = 0;
+	uint32 BodyStateFrameVersion = 0;
+	TWeakObjectPtr<class UBodyStateSkeleton> BodyStateSkeleton;
+	EFrameChange GetFrameChange(const LEAP_TRACKING_EVENT* Frame);
+	// Options, tracking mode or origin changed, the next tick rebuilds CurrentFrame even if the LeapC frame hasn't
+	void InvalidateCurrentFrame();
+
 	// Interpolation time offsets
 	int64 HandInterpolationTimeOffset;		// in microseconds
 	int64 FingerInterpolationTimeOffset;	// in microseconds
@@ -166,10 +252,16 @@ private:
 	int64 FrameTimeInMicros;
 
 	// Game thread Data
-	
-	FLeapFrameData PastFrame;
 
-	TArray<int32> PastVisibleHands;
+	// CurrentFrame as last parsed, published once per parse and shared by all readers. The origin transformed copy is
+	// made on first request for each published frame
+	FLeapFrameSnapshot LatestFrameSnapshot;
+	uint32 LatestFrameSnapshotVersion = 0;
+	TSharedPtr<const FLeapFrameData, ESPMode::ThreadSafe> OriginFrameSnapshot;
+	uint32 OriginFrameSnapshotVersion = 0;
+	FTransform OriginFrameSnapshotOrigin;
+	FCriticalSection SnapshotLock;
+	void PublishFrameSnapshot();
 
 	// Time warp support
 	BSHMDSnapshotHandler SnapshotHandler;
@@ -197,10 +289,12 @@ private:
 	int32 BodyStateDeviceId;
 	FBodyStateDeviceConfig Config;
 	ELeapDeviceType DeviceType = ELeapDeviceType::LEAP_DEVICE_TYPE_UNKNOWN;
-#if WITH_EDITOR
 	// LiveLink
 	TSharedPtr<FLeapLiveLinkProducer> LiveLink;
-#endif
+	// Create, recreate or remove the producer to match the options
+	void UpdateLiveLinkProducer();
+
+	void SetSkeletonFromCurrentFrame(class UBodyStateSkeleton* Skeleton);
 
 	// Convenience Converters - Todo: wrap into separate class?
 	void SetBSFingerFromLeapDigit(class UBodyStateFinger* Finger, const FLeapDigitData& LeapDigit);
@@ -117,19 +117,27 @@ void FUltraleapTrackingInputDevice::OnDeviceFound(const LEAP_DEVICE_INFO* Props)
 	CallFunctionOnComponents(
 		[&](ULeapComponent* Component) { Component->OnLeapDeviceAttached.Broadcast(FString(Props->serial)); });
 }
-// comes from service message loop
+// the LeapC wrapper calls this on the game thread, other wrappers may not
 void FUltraleapTrackingInputDevice::OnDeviceLost(const char* Serial)
 {
 	const FString SerialString = FString(ANSI_TO_TCHAR(Serial));
 
-	FLeapAsync::RunShortLambdaOnGameThread([&, SerialString] {
+	auto HandleDeviceLost = [this, SerialString] {
 		UE_LOG(UltraleapTrackingLog, Warning, TEXT("OnDeviceLost %s."), *SerialString);
 
 		AttachedDevices.Remove(SerialString);
 
 		CallFunctionOnComponents(
 			[SerialString](ULeapComponent* Component) { Component->OnLeapDeviceDetached.Broadcast(SerialString); });
-	});
+	};
+	if (IsInGameThread())
+	{
+		HandleDeviceLost();
+	}
+	else
+	{
+		FLeapAsync::RunShortLambdaOnGameThread(HandleDeviceLost);
+	}
 }
 
 void FUltraleapTrackingInputDevice::OnDeviceFailure(const eLeapDeviceStatus FailureCode, const LEAP_DEVICE FailedDevice)
@@ -287,19 +295,7 @@ void FUltraleapTrackingInputDevice::ShutdownLeap()
 }
 IHandTrackingDevice* FUltraleapTrackingInputDevice::GetDeviceBySerial(const FString& DeviceSerial)
 {
-	if (!Connector)
-	{
-		return nullptr;
-	}
-
-	TArray<FString> DeviceList;
-
-	// leave list empty if no device serial (backwards compatibilty fallback to default device)
-	if (!DeviceSerial.IsEmpty())
-	{
-		DeviceList.Add(DeviceSerial);
-	}
-	auto DeviceWrapper = Connector->GetDevice(DeviceList, ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_UNKNOWN, IsInOpenXRMode);
+	auto DeviceWrapper = GetDeviceWrapperBySerial(DeviceSerial);
 	if (DeviceWrapper)
 	{
 		auto InternalDevice = DeviceWrapper->GetDevice();
@@ -316,14 +312,8 @@ IHandTrackingWrapper* FUltraleapTrackingInputDevice::GetDeviceWrapperBySerial(co
 	{
 		return nullptr;
 	}
-	TArray<FString> DeviceList;
-	// leave list empty if no device serial (backwards compatibilty fallback to default device)
-	if (!DeviceSerial.IsEmpty())
-	{
-		DeviceList.Add(DeviceSerial);
-	}
-
-	return Connector->GetDevice(DeviceList, ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_UNKNOWN, IsInOpenXRMode);
+	// empty serial falls back to the default device for backwards compatibility
+	return Connector->GetDeviceBySerial(DeviceSerial, IsInOpenXRMode);
 }
 // get default device for backwards compatibility
 IHandTrackingWrapper* FUltraleapTrackingInputDevice::GetFallbackDeviceWrapper()
@@ -332,9 +322,8 @@ IHandTrackingWrapper* FUltraleapTrackingInputDevice::GetFallbackDeviceWrapper()
 	{
 		return nullptr;
 	}
-	// empty device list means 'give me the default'
-	TArray<FString> DeviceList;
-	return Connector->GetDevice(DeviceList, ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_UNKNOWN, IsInOpenXRMode);
+	// empty serial means 'give me the default'
+	return Connector->GetDeviceBySerial(FString(), IsInOpenXRMode);
 }
 void FUltraleapTrackingInputDevice::AreHandsVisible(
 		bool& LeftHandIsVisible, bool& RightHandIsVisible, const FString& DeviceSerial)
@@ -475,6 +464,9 @@ int32 FUltraleapTrackingInputDevice::RequestCombinedDevice(
 		case EBSDeviceCombinerClass::BS_DEVICE_COMBINER_ANGULAR:
 			LeapCombinerClass = ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_ANGULAR;
 			break;
+		case EBSDeviceCombinerClass::BS_DEVICE_COMBINER_KALMAN:
+			LeapCombinerClass = ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_KALMAN;
+			break;
 	}
 	auto DeviceWrapper = Connector->GetDevice(DeviceSerials, LeapCombinerClass, IsInOpenXRMode);
 	if (DeviceWrapper)
@@ -13,7 +13,9 @@
 #include "FUltraleapTrackingInputDevice.h"
 #include "IInputDeviceModule.h"
 #include "Interfaces/IPluginManager.h"
+#include "LeapLatencyTracer.h"
 #include "Modules/ModuleManager.h"
+#include "Skeleton/BodyStateSkeleton.h"
 
 #define LOCTEXT_NAMESPACE "LeapPlugin"
 
@@ -52,6 +54,14 @@ void FUltraleapTrackingPlugin::StartupModule()
 	const FPluginDescriptor& PluginDescriptor = Plugin->GetDescriptor();
 	UE_LOG(UltraleapTrackingLog, Log, TEXT("Leap Plugin started v%s"), *PluginDescriptor.VersionName);
 
+	// last latency stage, BodyState can't see the tracer so reports pose evaluation through the skeleton
+	UBodyStateSkeleton::OnSkeletonEvaluated.BindLambda([](const double SourceCaptureTime) {
+		if (FLeapLatencyTracer::IsEnabled())
+		{
+			FLeapLatencyTracer::Get().Record(ELeapLatencyStage::AnimEvaluate, SourceCaptureTime);
+		}
+	});
+
 	// early initialising works around device/input startup after begin play
 	TSharedPtr<FGenericApplicationMessageHandler> DummyMessageHandler(new FGenericApplicationMessageHandler());
 	CreateInputDevice(DummyMessageHandler.ToSharedRef());
@@ -61,6 +71,8 @@ void FUltraleapTrackingPlugin::ShutdownModule()
 {
 	UE_LOG(UltraleapTrackingLog, Log, TEXT("Leap Plugin shutdown."));
 
+	UBodyStateSkeleton::OnSkeletonEvaluated.Unbind();
+
 	if (LeapDLLHandle)
 	{
 		FPlatformProcess::FreeDllHandle(LeapDLLHandle);
@@ -24,6 +24,8 @@ ULeapComponent::ULeapComponent(const FObjectInitializer& init) :
 	bAutoActivate = true;
 	IsConnectedToInputEvents = false;
 	bAddHmdOrigin = false;
+	bReceiveLeftHandEvents = true;
+	bReceiveRightHandEvents = true;
 	ILeapConnector* Connector = IUltraleapTrackingPlugin::Get().GetConnector();
 	if (Connector)
 	{
@@ -44,6 +46,32 @@ void ULeapComponent::SetShouldAddHmdOrigin(bool& bShouldAdd)
 	// this needs to propagate to all other components with same id
 }
 
+ELeapEventSubscription ULeapComponent::GetEventSubscriptions() const
+{
+	ELeapEventSubscription Subscriptions = ELeapEventSubscription::None;
+	auto Subscribe = [&Subscriptions](const bool bBound, const ELeapEventSubscription Event)
+	{
+		if (bBound)
+		{
+			Subscriptions |= Event;
+		}
+	};
+	Subscribe(OnLeapTrackingData.IsBound(), ELeapEventSubscription::TrackingData);
+	Subscribe(OnLeftHandTrackingData.IsBound(), ELeapEventSubscription::LeftHandTrackingData);
+	Subscribe(OnRightHandTrackingData.IsBound(), ELeapEventSubscription::RightHandTrackingData);
+	Subscribe(OnHandBeginTracking.IsBound(), ELeapEventSubscription::HandBeginTracking);
+	Subscribe(OnHandEndTracking.IsBound(), ELeapEventSubscription::HandEndTracking);
+	Subscribe(OnLeftHandVisibilityChanged.IsBound(), ELeapEventSubscription::LeftHandVisibilityChanged);
+	Subscribe(OnRightHandVisibilityChanged.IsBound(), ELeapEventSubscription::RightHandVisibilityChanged);
+	Subscribe(OnHandPinched.IsBound(), ELeapEventSubscription::HandPinched);
+	Subscribe(OnHandUnpinched.IsBound(), ELeapEventSubscription::HandUnpinched);
+	Subscribe(OnHandGrabbed.IsBound(), ELeapEventSubscription::HandGrabbed);
+	Subscribe(OnHandReleased.IsBound(), ELeapEventSubscription::HandReleased);
+	Subscribe(bReceiveLeftHandEvents, ELeapEventSubscription::LeftHand);
+	Subscribe(bReceiveRightHandEvents, ELeapEventSubscription::RightHand);
+
+	return Subscriptions;
+}
 void ULeapComponent::AreHandsVisible(bool& LeftIsVisible, bool& RightIsVisible)
 {
 	if (CurrentHandTrackingDevice)
@@ -68,6 +96,18 @@ void ULeapComponent::GetLatestFrameData(FLeapFrameData& OutData, const bool Appl
 		}
 	}
 }
+TSharedPtr<const FLeapFrameData, ESPMode::ThreadSafe> ULeapComponent::GetLatestFrameSnapshot(const bool ApplyDeviceOrigin)
+{
+	if (CurrentHandTrackingDevice)
+	{
+		IHandTrackingDevice* Device = CurrentHandTrackingDevice->GetDevice();
+		if (Device)
+		{
+			return Device->GetLatestFrameSnapshot(ApplyDeviceOrigin);
+		}
+	}
+	return nullptr;
+}
 void ULeapComponent::ConnectToInputEvents()
 {
 	RefreshDeviceList();
@@ -409,22 +449,17 @@ bool ULeapComponent::GetLeapOptions(FLeapOptions& Options)
 
 void ULeapComponent::GetHandSize(float& OutHandSize)
 {
-	FLeapFrameData LeapFrameData;
-	GetLatestFrameData(LeapFrameData);
-	TArray<FLeapHandData> Hands = LeapFrameData.Hands;
-	FLeapHandData HandToScale;
-	if (!Hands.Num())
+	TSharedPtr<const FLeapFrameData, ESPMode::ThreadSafe> LeapFrameData = GetLatestFrameSnapshot();
+	if (!LeapFrameData.IsValid() || !LeapFrameData->Hands.Num())
 	{
 		return;
 	}
-	if (LeapFrameData.LeftHandVisible || LeapFrameData.RightHandVisible)
-	{
-		HandToScale = Hands[0];
-	}
+	static const FLeapHandData NoHand;
+	const FLeapHandData& HandToScale =
+		LeapFrameData->LeftHandVisible || LeapFrameData->RightHandVisible ? LeapFrameData->Hands[0] : NoHand;
 
 	float Length = 0.0;
-	FLeapDigitData MiddleFinger = HandToScale.Middle;
-	TArray<FLeapBoneData> Bones = MiddleFinger.Bones;
+	const TArray<FLeapBoneData>& Bones = HandToScale.Middle.Bones;
 
 	// starting from the palm cause there's no wrist position in the frame
 	bool AddedPalmToFirstBone = false;
@@ -0,0 +1,220 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+
+#include "LeapDeviceRegistry.h"
+
+#include "IUltraleapTrackingPlugin.h"
+#include "Misc/ScopeRWLock.h"
+
+int32 FLeapDeviceRegistry::AddDevice(IHandTrackingWrapper* Device)
+{
+	FDeviceSlot Slot;
+	Slot.Device = Device;
+	Slot.Serial = Device->GetDeviceSerial();
+	Slot.DeviceID = Device->GetDeviceID();
+
+	const int32 SlotIndex = Slots.Add(Slot);
+	DeviceToSlot.Add(Device, SlotIndex);
+	SerialToSlot.Add(Slot.Serial, SlotIndex);
+	DeviceIDToSlot.Add(Slot.DeviceID, SlotIndex);
+
+	RebuildLists();
+	return SlotIndex;
+}
+int32 FLeapDeviceRegistry::AddCombinedDevice(IHandTrackingWrapper* Device, const TArray<FString>& DeviceSerials,
+	const ELeapDeviceCombinerClass DeviceCombinerClass, const TArray<FString>& MissingSerials)
+{
+	FDeviceSlot Slot;
+	Slot.Device = Device;
+	Slot.DeviceID = Device->GetDeviceID();
+	Slot.bCombined = true;
+	Slot.CombinedHash = HashCombinedKey(DeviceSerials, DeviceCombinerClass);
+	Slot.CombinerClass = DeviceCombinerClass;
+	Slot.CombinedSerials = DeviceSerials;
+	Slot.MissingSerials = MissingSerials;
+
+	const int32 SlotIndex = Slots.Add(MoveTemp(Slot));
+	DeviceToSlot.Add(Device, SlotIndex);
+	CombinedHashToSlot.Add(Slots[SlotIndex].CombinedHash, SlotIndex);
+
+	RebuildLists();
+	return SlotIndex;
+}
+bool FLeapDeviceRegistry::RemoveDevice(IHandTrackingWrapper* Device)
+{
+	int32 SlotIndex = INDEX_NONE;
+	if (!DeviceToSlot.RemoveAndCopyValue(Device, SlotIndex))
+	{
+		return false;
+	}
+	const FDeviceSlot& Slot = Slots[SlotIndex];
+	if (Slot.bCombined)
+	{
+		CombinedHashToSlot.RemoveSingle(Slot.CombinedHash, SlotIndex);
+	}
+	else
+	{
+		// only drop the lookups if they still point at this slot
+		const int32* SerialSlot = SerialToSlot.Find(Slot.Serial);
+		if (SerialSlot && *SerialSlot == SlotIndex)
+		{
+			SerialToSlot.Remove(Slot.Serial);
+		}
+		const int32* DeviceIDSlot = DeviceIDToSlot.Find(Slot.DeviceID);
+		if (DeviceIDSlot && *DeviceIDSlot == SlotIndex)
+		{
+			DeviceIDToSlot.Remove(Slot.DeviceID);
+		}
+	}
+	Slots.RemoveAt(SlotIndex);
+
+	RebuildLists();
+	return true;
+}
+void FLeapDeviceRegistry::Reset()
+{
+	Slots.Empty();
+	DeviceToSlot.Empty();
+	SerialToSlot.Empty();
+	DeviceIDToSlot.Empty();
+	CombinedHashToSlot.Empty();
+
+	RebuildLists();
+}
+IHandTrackingWrapper* FLeapDeviceRegistry::FindDeviceBySerial(const FString& DeviceSerial) const
+{
+	const int32* SlotIndex = SerialToSlot.Find(DeviceSerial);
+	return SlotIndex ? Slots[*SlotIndex].Device : nullptr;
+}
+IHandTrackingWrapper* FLeapDeviceRegistry::FindDeviceByID(const uint32 DeviceID) const
+{
+	const int32* SlotIndex = DeviceIDToSlot.Find(DeviceID);
+	return SlotIndex ? Slots[*SlotIndex].Device : nullptr;
+}
+IHandTrackingWrapper* FLeapDeviceRegistry::FindCombinedDevice(
+	const TArray<FString>& DeviceSerials, const ELeapDeviceCombinerClass DeviceCombinerClass) const
+{
+	for (auto It = CombinedHashToSlot.CreateConstKeyIterator(HashCombinedKey(DeviceSerials, DeviceCombinerClass)); It; ++It)
+	{
+		const FDeviceSlot& Slot = Slots[It.Value()];
+		if (MatchesCombinedKey(Slot, DeviceSerials, DeviceCombinerClass))
+		{
+			return Slot.Device;
+		}
+	}
+	return nullptr;
+}
+void FLeapDeviceRegistry::FindCombinedDevicesMissing(const FString& DeviceSerial, TArray<IHandTrackingWrapper*>& OutDevices) const
+{
+	for (IHandTrackingWrapper* CombinedDevice : CombinedDevices)
+	{
+		const FDeviceSlot& Slot = Slots[DeviceToSlot.FindChecked(CombinedDevice)];
+		if (Slot.MissingSerials.Contains(DeviceSerial))
+		{
+			OutDevices.Add(CombinedDevice);
+		}
+	}
+}
+int32 FLeapDeviceRegistry::GetSlotIndex(IHandTrackingWrapper* Device) const
+{
+	const int32* SlotIndex = DeviceToSlot.Find(Device);
+	return SlotIndex ? *SlotIndex : INDEX_NONE;
+}
+IHandTrackingWrapper* FLeapDeviceRegistry::GetDeviceInSlot(const int32 SlotIndex) const
+{
+	return Slots.IsValidIndex(SlotIndex) ? Slots[SlotIndex].Device : nullptr;
+}
+void FLeapDeviceRegistry::RebuildLists()
+{
+	Devices.Reset();
+	CombinedDevices.Reset();
+
+	// slots are reused after removal, so order by slot index isn't add order. Keep the previous relative order and
+	// append new devices at the end
+	TArray<IHandTrackingWrapper*> PreviousOrder = MoveTemp(TickList);
+	for (IHandTrackingWrapper* Device : PreviousOrder)
+	{
+		if (const int32* SlotIndex = DeviceToSlot.Find(Device))
+		{
+			(Slots[*SlotIndex].bCombined ? CombinedDevices : Devices).Add(Device);
+		}
+	}
+	for (const FDeviceSlot& Slot : Slots)
+	{
+		TArray<IHandTrackingWrapper*>& List = Slot.bCombined ? CombinedDevices : Devices;
+		List.AddUnique(Slot.Device);
+	}
+	TickList.Reset(Devices.Num() + CombinedDevices.Num());
+	TickList.Append(Devices);
+	TickList.Append(CombinedDevices);
+
+	Version++;
+}
+uint32 FLeapDeviceRegistry::HashCombinedKey(
+	const TArray<FString>& DeviceSerials, const ELeapDeviceCombinerClass DeviceCombinerClass)
+{
+	// summed so the order the serials were requested in doesn't matter
+	uint32 SerialsHash = DeviceSerials.Num();
+	for (const FString& DeviceSerial : DeviceSerials)
+	{
+		SerialsHash += GetTypeHash(DeviceSerial);
+	}
+	return HashCombine(GetTypeHash((int32) DeviceCombinerClass), SerialsHash);
+}
+bool FLeapDeviceRegistry::MatchesCombinedKey(
+	const FDeviceSlot& Slot, const TArray<FString>& DeviceSerials, const ELeapDeviceCombinerClass DeviceCombinerClass)
+{
+	if (Slot.CombinerClass != DeviceCombinerClass || Slot.CombinedSerials.Num() != DeviceSerials.Num())
+	{
+		return false;
+	}
+	for (const FString& DeviceSerial : DeviceSerials)
+	{
+		if (!Slot.CombinedSerials.Contains(DeviceSerial))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+void FLeapDeviceRegistry::SetDeviceHandle(const uint32 DeviceID, const LEAP_DEVICE DeviceHandle)
+{
+	FWriteScopeLock Lock(DeviceConnectionsLock);
+	DeviceConnections.FindOrAdd(DeviceID).DeviceHandle = DeviceHandle;
+}
+LEAP_DEVICE FLeapDeviceRegistry::GetDeviceHandle(const uint32 DeviceID) const
+{
+	FReadScopeLock Lock(DeviceConnectionsLock);
+	const FDeviceConnection* Connection = DeviceConnections.Find(DeviceID);
+	return Connection ? Connection->DeviceHandle : nullptr;
+}
+void FLeapDeviceRegistry::SetCallbackDelegate(const uint32 DeviceID, LeapWrapperCallbackInterface* CallbackDelegate)
+{
+	FWriteScopeLock Lock(DeviceConnectionsLock);
+	DeviceConnections.FindOrAdd(DeviceID).CallbackDelegate = CallbackDelegate;
+}
+LeapWrapperCallbackInterface* FLeapDeviceRegistry::GetCallbackDelegate(const uint32 DeviceID) const
+{
+	FReadScopeLock Lock(DeviceConnectionsLock);
+	const FDeviceConnection* Connection = DeviceConnections.Find(DeviceID);
+	return Connection ? Connection->CallbackDelegate : nullptr;
+}
+void FLeapDeviceRegistry::RemoveDeviceID(const uint32 DeviceID)
+{
+	FWriteScopeLock Lock(DeviceConnectionsLock);
+	DeviceConnections.Remove(DeviceID);
+}
+void FLeapDeviceRegistry::ClearCallbackDelegates()
+{
+	FWriteScopeLock Lock(DeviceConnectionsLock);
+	for (auto& Pair : DeviceConnections)
+	{
+		Pair.Value.CallbackDelegate = nullptr;
+	}
+}
@@ -8,6 +8,7 @@
 
 #include "LeapDeviceWrapper.h"
 #include "LeapAsync.h"
+#include "LeapLatencyTracer.h"
 #include "LeapUtility.h"
 #include "Runtime/Core/Public/Misc/Timespan.h"
 
@@ -138,50 +139,60 @@ LEAP_TRACKING_EVENT* FLeapDeviceWrapper::GetFrame()
 	return currentFrame;
 }
 
+// Returns nullptr on failure rather than the last interpolated frame, devices that go bad are cleaned up by their
+// device lost events
 LEAP_TRACKING_EVENT* FLeapDeviceWrapper::GetInterpolatedFrameAtTime(int64 TimeStamp)
 {
 	uint64_t FrameSize = 0;
 	eLeapRS Result = LeapGetFrameSizeEx(ConnectionHandle, DeviceHandle, TimeStamp, &FrameSize);
 	
-	if (Result != eLeapRS_Success)
+	if (Result != eLeapRS_Success || FrameSize == 0)
 	{
-		UE_LOG(UltraleapTrackingLog, Log, TEXT("LeapGetFrameSizeEx failed in  FLeapDeviceWrapper::GetInterpolatedFrameAtTime"));
-		// if the device goes bad (currently due to system sleep wake and replug)
-		// clean it up
-		if (Connector)
-		{
-			Connector->CleanupBadDevice(this);
-			Connector = nullptr;
-			return nullptr;
-		}
+		UE_LOG(UltraleapTrackingLog, Verbose, TEXT("LeapGetFrameSizeEx failed in  FLeapDeviceWrapper::GetInterpolatedFrameAtTime"));
+		return nullptr;
 	}
-	// Check validity of frame size
-	if (FrameSize > 0)
+	// Different frame?
+	if (FrameSize != InterpolatedFrameSize)
 	{
-		// Different frame?
-		if (FrameSize != InterpolatedFrameSize)
+		// If we already have an allocated frame, free it
+		if (InterpolatedFrame)
 		{
-			// If we already have an allocated frame, free it
-			if (InterpolatedFrame)
-			{
-				free(InterpolatedFrame);
-			}
-			InterpolatedFrame = (LEAP_TRACKING_EVENT*) malloc(FrameSize);
+			free(InterpolatedFrame);
 		}
-		InterpolatedFrameSize = FrameSize;
+		InterpolatedFrame = (LEAP_TRACKING_EVENT*) malloc(FrameSize);
+	}
+	InterpolatedFrameSize = FrameSize;
 
-		// Grab the new frame
-		Result = LeapInterpolateFrameEx(ConnectionHandle, DeviceHandle, TimeStamp, InterpolatedFrame, InterpolatedFrameSize);
+	// Grab the new frame
+	Result = LeapInterpolateFrameEx(ConnectionHandle, DeviceHandle, TimeStamp, InterpolatedFrame, InterpolatedFrameSize);
 
-		if (Result != eLeapRS_Success)
-		{
-			UE_LOG(UltraleapTrackingLog, Log,
-				TEXT("LeapInterpolateFrameEx failed in  FLeapDeviceWrapper::GetInterpolatedFrameAtTime"));
-		}
+	if (Result != eLeapRS_Success)
+	{
+		UE_LOG(UltraleapTrackingLog, Verbose,
+			TEXT("LeapInterpolateFrameEx failed in  FLeapDeviceWrapper::GetInterpolatedFrameAtTime"));
+		return nullptr;
 	}
 	return InterpolatedFrame;
 }
 
+// As GetInterpolatedFrameAtTime but into the caller's buffer, so safe off the game thread
+LEAP_TRACKING_EVENT* FLeapDeviceWrapper::InterpolateFrameAtTime(int64 TimeStamp, TArray<uint8>& FrameBuffer)
+{
+	uint64_t FrameSize = 0;
+	if (!ConnectionHandle || !DeviceHandle ||
+		LeapGetFrameSizeEx(ConnectionHandle, DeviceHandle, TimeStamp, &FrameSize) != eLeapRS_Success || FrameSize == 0)
+	{
+		return nullptr;
+	}
+	FrameBuffer.SetNumUninitialized(FrameSize, false);
+	LEAP_TRACKING_EVENT* Frame = (LEAP_TRACKING_EVENT*) FrameBuffer.GetData();
+	if (LeapInterpolateFrameEx(ConnectionHandle, DeviceHandle, TimeStamp, Frame, FrameSize) != eLeapRS_Success)
+	{
+		return nullptr;
+	}
+	return Frame;
+}
+
 LEAP_DEVICE_INFO* FLeapDeviceWrapper::GetDeviceProperties()
 {
 	LEAP_DEVICE_INFO* currentDevice;
@@ -257,6 +268,12 @@ void FLeapDeviceWrapper::SetFrame(const LEAP_TRACKING_EVENT* Frame)
 	*LatestFrame = *Frame;
 
 	DataLock->Unlock();
+
+	if (FLeapLatencyTracer::IsEnabled())
+	{
+		FLeapLatencyTracer::Get().Record(
+			ELeapLatencyStage::Publish, FLeapLatencyTracer::GetCaptureTime(Frame->info.timestamp, LeapGetNow()));
+	}
 }
 
 
@@ -49,6 +49,7 @@ public:
 
 	/** Uses leap method to get an interpolated frame at a given leap timestamp in microseconds given by e.g. LeapGetNow()*/
 	virtual LEAP_TRACKING_EVENT* GetInterpolatedFrameAtTime(int64 TimeStamp) override;
+	virtual LEAP_TRACKING_EVENT* InterpolateFrameAtTime(int64 TimeStamp, TArray<uint8>& FrameBuffer) override;
 
 	virtual LEAP_DEVICE_INFO* GetDeviceProperties() override;	 // Used in polling example
 
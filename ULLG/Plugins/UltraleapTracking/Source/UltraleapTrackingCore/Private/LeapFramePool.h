@@ -0,0 +1,46 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UltraleapTrackingData.h"
+
+/**
+ * Frames to build into and then publish as FLeapFrameSnapshot without a copy. A published frame is never written again,
+ * the pool hands it out for the next build once every reader has let go of it, keeping its hand arrays allocated. Not
+ * thread safe, one thread builds frames
+ */
+class FLeapFramePool
+{
+public:
+	typedef TSharedRef<FLeapFrameData, ESPMode::ThreadSafe> FFrameRef;
+
+	// A frame nobody else holds, as it was last built
+	FFrameRef Acquire()
+	{
+		for (const FFrameRef& Frame : Frames)
+		{
+			if (Frame.IsUnique())
+			{
+				return Frame;
+			}
+		}
+		// readers holding on to the oldest frame keep it alive on their own
+		if (Frames.Num() == MaxFrames)
+		{
+			Frames.RemoveAt(0);
+		}
+		return Frames.Add_GetRef(MakeShared<FLeapFrameData, ESPMode::ThreadSafe>());
+	}
+
+private:
+	// The frame being built, the published one and a couple held by slow readers
+	static constexpr int32 MaxFrames = 4;
+	TArray<FFrameRef, TInlineAllocator<MaxFrames>> Frames;
+};
@@ -0,0 +1,120 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "LeapHandStateMachine.h"
+
+void FLeapHandStateMachine::Update(const FLeapFrameData& Frame, const int64 Now, FTransitions& OutTransitions)
+{
+	// find each slot's hand, the frame has at most one of each
+	int32 HandIndices[NumSlots] = {INDEX_NONE, INDEX_NONE};
+	const bool bHandVisible[NumSlots] = {Frame.LeftHandVisible, Frame.RightHandVisible};
+	for (int32 HandIndex = 0; HandIndex < Frame.Hands.Num(); HandIndex++)
+	{
+		const int32 Slot = Frame.Hands[HandIndex].HandType;
+		if (Slot >= 0 && Slot < NumSlots && bHandVisible[Slot] && HandIndices[Slot] == INDEX_NONE)
+		{
+			HandIndices[Slot] = HandIndex;
+		}
+	}
+
+	for (int32 SlotIndex = 0; SlotIndex < NumSlots; SlotIndex++)
+	{
+		FHandSlot& Slot = Slots[SlotIndex];
+		const EHandType HandType = (EHandType) SlotIndex;
+		const int32 HandIndex = HandIndices[SlotIndex];
+
+		if (HandIndex == INDEX_NONE)
+		{
+			if (Slot.bVisible && Now - Slot.LastSeen >= Settings.VisibilityTimeout)
+			{
+				EndHand(Slot, HandType, OutTransitions);
+				Slot.bVisible = false;
+				OutTransitions.Add({ELeapHandTransition::Hidden, HandType, INDEX_NONE});
+			}
+			// gestures hold while the hand is briefly gone
+			continue;
+		}
+
+		const FLeapHandData& Hand = Frame.Hands[HandIndex];
+		if (!Slot.bVisible)
+		{
+			Slot.bVisible = true;
+			Slot.HandId = Hand.Id;
+			OutTransitions.Add({ELeapHandTransition::Visible, HandType, HandIndex});
+			OutTransitions.Add({ELeapHandTransition::BeginTracking, HandType, HandIndex});
+		}
+		else if (Slot.HandId != Hand.Id)
+		{
+			// the service swapped in a new hand, or chirality flipped
+			EndHand(Slot, HandType, OutTransitions);
+			Slot.HandId = Hand.Id;
+			OutTransitions.Add({ELeapHandTransition::BeginTracking, HandType, HandIndex});
+		}
+		Slot.LastSeen = Now;
+
+		// the grab is updated first so a hand closing in one frame grabs rather than pinches
+		if (UpdateGesture(Slot.Grab, Hand.GrabStrength, Settings.StartGrabThreshold, Settings.EndGrabThreshold,
+				Settings.GrabDebounce, Settings.GrabTimeout, Now, true))
+		{
+			OutTransitions.Add({Slot.Grab.bActive ? ELeapHandTransition::Grab : ELeapHandTransition::Release, HandType, HandIndex});
+		}
+		const bool bCanPinch = !Settings.bBlockPinchWhileGrabbing || !Slot.Grab.bActive;
+		if (UpdateGesture(Slot.Pinch, Hand.PinchStrength, Settings.StartPinchThreshold, Settings.EndPinchThreshold,
+				Settings.PinchDebounce, Settings.PinchTimeout, Now, bCanPinch))
+		{
+			OutTransitions.Add({Slot.Pinch.bActive ? ELeapHandTransition::Pinch : ELeapHandTransition::Unpinch, HandType, HandIndex});
+		}
+	}
+}
+
+void FLeapHandStateMachine::Reset()
+{
+	for (FHandSlot& Slot : Slots)
+	{
+		Slot = FHandSlot();
+	}
+}
+
+bool FLeapHandStateMachine::UpdateGesture(FGestureState& Gesture, const float Strength, const float StartThreshold,
+	const float EndThreshold, const int64 Debounce, const int64 Timeout, const int64 Now, const bool bCanStart)
+{
+	// strength between the thresholds keeps the current state
+	const bool bWantsChange = Gesture.bActive ? Strength <= EndThreshold : (bCanStart && Strength > StartThreshold);
+	if (!bWantsChange)
+	{
+		Gesture.PendingSince = -1;
+		return false;
+	}
+	if (Gesture.PendingSince < 0)
+	{
+		Gesture.PendingSince = Now;
+	}
+	if (Now - Gesture.PendingSince < (Gesture.bActive ? Timeout : Debounce))
+	{
+		return false;
+	}
+	Gesture.bActive = !Gesture.bActive;
+	Gesture.PendingSince = -1;
+	return true;
+}
+
+void FLeapHandStateMachine::EndHand(FHandSlot& Slot, const EHandType HandType, FTransitions& OutTransitions)
+{
+	// releases first so nothing is left held by a hand that is gone
+	if (Slot.Pinch.bActive)
+	{
+		OutTransitions.Add({ELeapHandTransition::Unpinch, HandType, INDEX_NONE});
+	}
+	if (Slot.Grab.bActive)
+	{
+		OutTransitions.Add({ELeapHandTransition::Release, HandType, INDEX_NONE});
+	}
+	Slot.Pinch = FGestureState();
+	Slot.Grab = FGestureState();
+	OutTransitions.Add({ELeapHandTransition::EndTracking, HandType, INDEX_NONE});
+}
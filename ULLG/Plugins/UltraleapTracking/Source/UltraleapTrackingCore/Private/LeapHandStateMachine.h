@@ -0,0 +1,118 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UltraleapTrackingData.h"
+
+// Hand state changes, a hand leaving sends its releases before EndTracking and Hidden
+enum class ELeapHandTransition : uint8
+{
+	Visible,
+	Hidden,
+	BeginTracking,
+	EndTracking,
+	Pinch,
+	Unpinch,
+	Grab,
+	Release
+};
+
+struct FLeapHandStateSettings
+{
+	// Hysteresis, a gesture starts above its start threshold and ends at or below its end threshold
+	float StartPinchThreshold = .8f;
+	float EndPinchThreshold = .5f;
+	float StartGrabThreshold = .8f;
+	float EndGrabThreshold = .5f;
+	// How long (microseconds) the strength has to stay above the start threshold before the gesture starts
+	int64 PinchDebounce = 0;
+	int64 GrabDebounce = 0;
+	// How long (microseconds) the strength has to stay at or below the end threshold before the gesture ends
+	int64 PinchTimeout = 0;
+	int64 GrabTimeout = 0;
+	// How long (microseconds) a hand stays visible after it leaves the frame
+	int64 VisibilityTimeout = 0;
+	// A grabbing hand can't start a pinch
+	bool bBlockPinchWhileGrabbing = false;
+};
+
+/**
+ * Visibility, pinch and grab state of the left and right hand, updated for both hands in one pass over a frame. State
+ * is kept in fixed per hand slots and transitions are returned in a fixed size array, so updates don't allocate.
+ */
+class FLeapHandStateMachine
+{
+public:
+	static constexpr int32 NumSlots = 2;
+	// A hand that is replaced sends Unpinch, Release, EndTracking and the new one BeginTracking, Pinch, Grab
+	static constexpr int32 MaxTransitionsPerSlot = 6;
+
+	struct FTransition
+	{
+		ELeapHandTransition Type;
+		EHandType HandType;
+		// Index of the hand in the updated frame, INDEX_NONE if it has left the frame
+		int32 HandIndex;
+	};
+	typedef TArray<FTransition, TFixedAllocator<NumSlots * MaxTransitionsPerSlot>> FTransitions;
+
+	void SetSettings(const FLeapHandStateSettings& InSettings)
+	{
+		Settings = InSettings;
+	}
+	const FLeapHandStateSettings& GetSettings() const
+	{
+		return Settings;
+	}
+
+	// Now is in microseconds, e.g. LeapGetNow(). Appends the transitions to OutTransitions
+	void Update(const FLeapFrameData& Frame, const int64 Now, FTransitions& OutTransitions);
+
+	// Forgets every hand without sending transitions
+	void Reset();
+
+	bool IsVisible(const EHandType HandType) const
+	{
+		return Slots[HandType].bVisible;
+	}
+	bool IsPinching(const EHandType HandType) const
+	{
+		return Slots[HandType].Pinch.bActive;
+	}
+	bool IsGrabbing(const EHandType HandType) const
+	{
+		return Slots[HandType].Grab.bActive;
+	}
+
+private:
+	struct FGestureState
+	{
+		bool bActive = false;
+		// When the strength first crossed the threshold that would change bActive, -1 if it hasn't
+		int64 PendingSince = -1;
+	};
+	struct FHandSlot
+	{
+		int32 HandId = -1;
+		bool bVisible = false;
+		int64 LastSeen = 0;
+		FGestureState Pinch;
+		FGestureState Grab;
+	};
+	FHandSlot Slots[NumSlots];
+	FLeapHandStateSettings Settings;
+
+	// Returns true if bActive changed
+	static bool UpdateGesture(FGestureState& Gesture, const float Strength, const float StartThreshold, const float EndThreshold,
+		const int64 Debounce, const int64 Timeout, const int64 Now, const bool bCanStart);
+
+	// Ends the slot's gestures and tracking
+	static void EndHand(FHandSlot& Slot, const EHandType HandType, FTransitions& OutTransitions);
+};
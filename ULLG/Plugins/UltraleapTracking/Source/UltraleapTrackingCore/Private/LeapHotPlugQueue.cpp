@@ -0,0 +1,63 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "LeapHotPlugQueue.h"
+
+FLeapHotPlugQueue::FLeapHotPlugQueue() : Queue(Capacity)
+{
+}
+
+bool FLeapHotPlugQueue::Push(const FEvent& Event)
+{
+	return Queue.Enqueue(Event);
+}
+
+void FLeapHotPlugQueue::Gather()
+{
+	check(IsInGameThread());
+
+	FEvent Event;
+	// events stay queued while the pending list is full, they're gathered once adds free it up
+	while (Pending.Num() < (int32) Capacity && Queue.Dequeue(Event))
+	{
+		if (!Event.bFound)
+		{
+			// a device that comes and goes before it was added is never created
+			const int32 FoundIndex = Pending.FindLastByPredicate(
+				[&Event](const FEvent& PendingEvent) { return PendingEvent.DeviceID == Event.DeviceID; });
+			if (FoundIndex != INDEX_NONE && Pending[FoundIndex].bFound)
+			{
+				Pending.RemoveAt(FoundIndex);
+				continue;
+			}
+		}
+		Pending.Add(Event);
+	}
+}
+
+bool FLeapHotPlugQueue::Pop(FEvent& OutEvent, int32& InOutFoundBudget)
+{
+	check(IsInGameThread());
+
+	if (Pending.Num() == 0)
+	{
+		return false;
+	}
+	// adds are rate limited, later events wait behind them so a device's events stay in order
+	if (Pending[0].bFound)
+	{
+		if (InOutFoundBudget <= 0)
+		{
+			return false;
+		}
+		InOutFoundBudget--;
+	}
+	OutEvent = Pending[0];
+	Pending.RemoveAt(0);
+	return true;
+}
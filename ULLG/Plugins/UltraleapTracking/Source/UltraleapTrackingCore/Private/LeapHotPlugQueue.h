@@ -0,0 +1,63 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "Containers/CircularQueue.h"
+#include "CoreMinimal.h"
+#include "LeapC.h"
+
+/**
+ * Device found and lost events from the poll thread to the game thread. Events are fixed size, serial included, and go
+ * through a preallocated single producer single consumer queue, so plugging devices in and out doesn't allocate or queue
+ * task graph work. The game thread gathers them into a fixed pending list once a tick, where a device lost before it was
+ * added cancels out, and pops them in order.
+ */
+class FLeapHotPlugQueue
+{
+public:
+	// Queued plus pending events, found and lost, well above any real rig
+	static constexpr uint32 Capacity = 64;
+	static constexpr int32 MaxSerialLength = 64;
+
+	struct FEvent
+	{
+		bool bFound = false;
+		uint32 DeviceID = 0;
+		LEAP_DEVICE DeviceHandle = nullptr;
+		// serial is left null, GetDeviceInfo() points it at Serial
+		LEAP_DEVICE_INFO DeviceInfo = {sizeof(LEAP_DEVICE_INFO)};
+		char Serial[MaxSerialLength] = {};
+
+		LEAP_DEVICE_INFO GetDeviceInfo()
+		{
+			LEAP_DEVICE_INFO Info = DeviceInfo;
+			Info.serial = Serial;
+			return Info;
+		}
+	};
+
+	FLeapHotPlugQueue();
+
+	// Poll thread. Returns false if the queue is full
+	bool Push(const FEvent& Event);
+
+	// Game thread. Moves queued events to the pending list, call once before popping
+	void Gather();
+	// Game thread. Pops the oldest pending event, a found device only while FoundBudget is above 0 and taking one from it
+	bool Pop(FEvent& OutEvent, int32& InOutFoundBudget);
+
+	int32 NumPending() const
+	{
+		return Pending.Num();
+	}
+
+private:
+	TCircularQueue<FEvent> Queue;
+	TArray<FEvent, TFixedAllocator<Capacity>> Pending;
+};
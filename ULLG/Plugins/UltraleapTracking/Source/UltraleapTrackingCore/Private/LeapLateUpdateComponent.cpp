@@ -0,0 +1,224 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+
+#include "LeapLateUpdateComponent.h"
+
+#include "Engine/Engine.h"
+#include "LeapLatencyTracer.h"
+#include "SceneView.h"
+
+DECLARE_STATS_GROUP(TEXT("UltraleapLateUpdate"), STATGROUP_UltraleapLateUpdate, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Leap Late Update"), STAT_LeapLateUpdate, STATGROUP_UltraleapLateUpdate);
+// How much further along in tracking time the late update resamples the hand than the game thread sampled it, prediction
+// included. The latency left is the LateUpdate stage of STATGROUP_UltraleapLatency
+DECLARE_FLOAT_COUNTER_STAT(
+	TEXT("Late Update Resample Advance (ms)"), STAT_LeapLateUpdateResampleAdvance, STATGROUP_UltraleapLateUpdate);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Late Update Correction (cm)"), STAT_LeapLateUpdateCorrection, STATGROUP_UltraleapLateUpdate);
+
+ULeapLateUpdateComponent::ULeapLateUpdateComponent(const FObjectInitializer& init) : USceneComponent(init)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	bAutoActivate = true;
+
+	Hand = EHandType::LEAP_HAND_LEFT;
+	bLateUpdate = true;
+	AdditionalPredictionMS = 0;
+}
+void ULeapLateUpdateComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	if (GEngine && !ViewExtension.IsValid())
+	{
+		ViewExtension = FSceneViewExtensions::NewExtension<FViewExtension>(this);
+	}
+	ILeapConnector* Connector = IUltraleapTrackingPlugin::Get().GetConnector();
+	if (Connector)
+	{
+		Connector->AddLeapConnectorCallback(this);
+	}
+	UpdateDevice();
+}
+void ULeapLateUpdateComponent::OnUnregister()
+{
+	ILeapConnector* Connector = IUltraleapTrackingPlugin::Get().GetConnector();
+	if (Connector)
+	{
+		Connector->RemoveLeapConnnectorCallback(this);
+	}
+	if (ViewExtension.IsValid())
+	{
+		// the render thread may still hold the extension, make sure it stops using us
+		FScopeLock DeviceLock(&ViewExtension->DeviceInUseSect);
+		FScopeLock Lock(&ViewExtension->CritSect);
+		ViewExtension->Component = nullptr;
+		ViewExtension->Device = nullptr;
+	}
+	ViewExtension.Reset();
+	CurrentDevice = nullptr;
+
+	Super::OnUnregister();
+}
+void ULeapLateUpdateComponent::UpdateDevice()
+{
+	CurrentDevice = nullptr;
+	ILeapConnector* Connector = IUltraleapTrackingPlugin::Get().GetConnector();
+	if (Connector)
+	{
+		TArray<FString> DeviceSerials;
+		if (!DeviceSerial.IsEmpty())
+		{
+			DeviceSerials.Add(DeviceSerial);
+		}
+		CurrentDevice = Connector->GetDevice(DeviceSerials, ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_UNKNOWN, false);
+	}
+}
+void ULeapLateUpdateComponent::OnDeviceAdded(IHandTrackingWrapper* DeviceWrapper)
+{
+	if (!CurrentDevice)
+	{
+		UpdateDevice();
+	}
+}
+void ULeapLateUpdateComponent::OnDeviceRemoved(IHandTrackingWrapper* DeviceWrapper)
+{
+	if (CurrentDevice != DeviceWrapper)
+	{
+		return;
+	}
+	if (ViewExtension.IsValid())
+	{
+		// waits for a late update still sampling the device, it is deleted after this returns
+		FScopeLock DeviceLock(&ViewExtension->DeviceInUseSect);
+		FScopeLock Lock(&ViewExtension->CritSect);
+		ViewExtension->Device = nullptr;
+	}
+	CurrentDevice = nullptr;
+}
+void ULeapLateUpdateComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!ViewExtension.IsValid())
+	{
+		return;
+	}
+	// the devices have parsed this frame's input by now
+	FLeapLateUpdateSample Sample;
+	IHandTrackingDevice* Device = CurrentDevice ? CurrentDevice->GetDevice() : nullptr;
+	const bool bHaveSample = bLateUpdate && Device && Device->GetLateUpdateSample(Hand, Sample);
+
+	FScopeLock Lock(&ViewExtension->CritSect);
+	ViewExtension->Device = bHaveSample ? CurrentDevice : nullptr;
+	ViewExtension->Sample = Sample;
+	ViewExtension->HandType = Hand;
+	ViewExtension->AdditionalPrediction = (int64) (AdditionalPredictionMS * 1000.f);
+}
+
+ULeapLateUpdateComponent::FViewExtension::FViewExtension(const FAutoRegister& AutoRegister, ULeapLateUpdateComponent* InComponent)
+	: FSceneViewExtensionBase(AutoRegister), Component(InComponent)
+{
+}
+bool ULeapLateUpdateComponent::FViewExtension::IsActiveThisFrame_Internal(const FSceneViewExtensionContext& Context) const
+{
+	FScopeLock Lock(&CritSect);
+	return Component && Component->bLateUpdate;
+}
+// Game thread, after everything has ticked
+void ULeapLateUpdateComponent::FViewExtension::BeginRenderViewFamily(FSceneViewFamily& InViewFamily)
+{
+	FScopeLock Lock(&CritSect);
+	if (!Component)
+	{
+		return;
+	}
+	RelativeTransform = Component->GetRelativeTransform();
+	ComponentToWorld = Component->GetComponentTransform();
+	ParentToWorld = Component->CalcNewComponentToWorld(FTransform());
+
+	LateUpdate.Setup(ParentToWorld, Component, Device == nullptr || !Sample.bValid);
+}
+void ULeapLateUpdateComponent::FViewExtension::PreRenderViewFamily_RenderThread(
+	FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LeapLateUpdate);
+
+	// keeps the device alive while it is sampled, only contended when the device is going away
+	FScopeLock DeviceLock(&DeviceInUseSect);
+
+	// copied so the game thread isn't held up while LeapC interpolates
+	IHandTrackingWrapper* SampleDevice = nullptr;
+	FLeapLateUpdateSample GameThreadSample;
+	EHandType SampleHandType = EHandType::LEAP_HAND_LEFT;
+	int64 SamplePrediction = 0;
+	FTransform OldRelativeTransform;
+	FTransform SampleComponentToWorld;
+	FTransform SampleParentToWorld;
+	{
+		FScopeLock Lock(&CritSect);
+		if (!Component || !Device || !Sample.bValid)
+		{
+			return;
+		}
+		SampleDevice = Device;
+		GameThreadSample = Sample;
+		SampleHandType = HandType;
+		SamplePrediction = AdditionalPrediction;
+		OldRelativeTransform = RelativeTransform;
+		SampleComponentToWorld = ComponentToWorld;
+		SampleParentToWorld = ParentToWorld;
+	}
+
+	// same distance from now as the game thread sample, now is just later
+	const int64 Now = SampleDevice->GetNow();
+	const int64 SampleTime = Now + GameThreadSample.TimeOffset + SamplePrediction;
+	const LEAP_TRACKING_EVENT* Frame = SampleDevice->InterpolateFrameAtTime(SampleTime, FrameBuffer);
+	if (!Frame)
+	{
+		return;
+	}
+	const LEAP_HAND* LeapHand = nullptr;
+	for (uint32 i = 0; i < Frame->nHands; i++)
+	{
+		if ((EHandType) Frame->pHands[i].type == SampleHandType)
+		{
+			LeapHand = &Frame->pHands[i];
+			break;
+		}
+	}
+	if (!LeapHand)
+	{
+		return;
+	}
+	FLeapPalmData Palm;
+	Palm.SetFromLeapPalm(
+		(_LEAP_PALM*) &LeapHand->palm, GameThreadSample.HMDPositionOffset, GameThreadSample.HMDRotationOffset);
+	const FTransform RawPalm(Palm.Orientation, Palm.Position);
+
+	// the game thread's raw to frame transform (tracking mode, HMD) applied to the new raw palm gives the palm's
+	// movement in frame space, which is this component's space
+	const FTransform Delta =
+		GameThreadSample.FramePalm.Inverse() * RawPalm * GameThreadSample.RawPalm.Inverse() * GameThreadSample.FramePalm;
+	const FTransform NewRelativeTransform = (Delta * SampleComponentToWorld).GetRelativeTransform(SampleParentToWorld);
+
+	SET_FLOAT_STAT(STAT_LeapLateUpdateResampleAdvance, (SampleTime - GameThreadSample.TimeStamp) / 1000.f);
+	SET_FLOAT_STAT(STAT_LeapLateUpdateCorrection, Delta.GetTranslation().Size());
+	if (FLeapLatencyTracer::IsEnabled())
+	{
+		FLeapLatencyTracer::Get().Record(
+			ELeapLatencyStage::LateUpdate, FLeapLatencyTracer::GetCaptureTime(Frame->info.timestamp, Now));
+	}
+
+	LateUpdate.Apply_RenderThread(InViewFamily.Scene, OldRelativeTransform, NewRelativeTransform);
+}
+void ULeapLateUpdateComponent::FViewExtension::PostRenderViewFamily_RenderThread(
+	FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily)
+{
+	LateUpdate.PostRender_RenderThread();
+}
@@ -0,0 +1,275 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "LeapLatencyTracer.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "LeapUtility.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include "Trace/Trace.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Arrival Latency (ms)"), STAT_LeapLatencyArrival, STATGROUP_UltraleapLatency);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Publish Latency (ms)"), STAT_LeapLatencyPublish, STATGROUP_UltraleapLatency);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Consume Latency (ms)"), STAT_LeapLatencyConsume, STATGROUP_UltraleapLatency);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Parse Latency (ms)"), STAT_LeapLatencyParse, STATGROUP_UltraleapLatency);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Combine Latency (ms)"), STAT_LeapLatencyCombine, STATGROUP_UltraleapLatency);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("BodyState Latency (ms)"), STAT_LeapLatencyBodyState, STATGROUP_UltraleapLatency);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Anim Evaluate Latency (ms)"), STAT_LeapLatencyAnimEvaluate, STATGROUP_UltraleapLatency);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Late Update Latency (ms)"), STAT_LeapLatencyLateUpdate, STATGROUP_UltraleapLatency);
+
+UE_TRACE_CHANNEL(UltraleapLatencyChannel);
+
+TRACE_DECLARE_FLOAT_COUNTER(LeapLatencyArrival, TEXT("Ultraleap/Latency/Arrival (ms)"));
+TRACE_DECLARE_FLOAT_COUNTER(LeapLatencyPublish, TEXT("Ultraleap/Latency/Publish (ms)"));
+TRACE_DECLARE_FLOAT_COUNTER(LeapLatencyConsume, TEXT("Ultraleap/Latency/Consume (ms)"));
+TRACE_DECLARE_FLOAT_COUNTER(LeapLatencyParse, TEXT("Ultraleap/Latency/Parse (ms)"));
+TRACE_DECLARE_FLOAT_COUNTER(LeapLatencyCombine, TEXT("Ultraleap/Latency/Combine (ms)"));
+TRACE_DECLARE_FLOAT_COUNTER(LeapLatencyBodyState, TEXT("Ultraleap/Latency/BodyState (ms)"));
+TRACE_DECLARE_FLOAT_COUNTER(LeapLatencyAnimEvaluate, TEXT("Ultraleap/Latency/AnimEvaluate (ms)"));
+TRACE_DECLARE_FLOAT_COUNTER(LeapLatencyLateUpdate, TEXT("Ultraleap/Latency/LateUpdate (ms)"));
+
+int32 FLeapLatencyTracer::Enabled = 0;
+
+static FAutoConsoleVariableRef CVarUltraleapLatencyTrace(TEXT("leap.LatencyTrace"), FLeapLatencyTracer::Enabled,
+	TEXT("Record how long after capture tracking frames reach each stage of the pipeline.\n")
+	TEXT("0: off (default), 1: on"));
+
+static FAutoConsoleCommand CmdUltraleapDumpLatency(TEXT("leap.DumpLatency"),
+	TEXT("Writes the tracking latency histograms to a csv in the profiling directory. Optional file name argument"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+		const FString FileName =
+			Args.Num() > 0 ? Args[0] : FString::Printf(TEXT("Latency-%s.csv"), *FDateTime::Now().ToString());
+		FLeapLatencyTracer::Get().DumpToFile(FPaths::ProfilingDir() / TEXT("UltraleapLatency") / FileName);
+	}));
+
+static FAutoConsoleCommand CmdUltraleapResetLatency(TEXT("leap.ResetLatency"), TEXT("Clears the tracking latency histograms"),
+	FConsoleCommandDelegate::CreateLambda([]() { FLeapLatencyTracer::Get().Reset(); }));
+
+namespace
+{
+const TCHAR* GetStageName(const ELeapLatencyStage Stage)
+{
+	switch (Stage)
+	{
+		case ELeapLatencyStage::Arrival:
+			return TEXT("Arrival");
+		case ELeapLatencyStage::Publish:
+			return TEXT("Publish");
+		case ELeapLatencyStage::Consume:
+			return TEXT("Consume");
+		case ELeapLatencyStage::Parse:
+			return TEXT("Parse");
+		case ELeapLatencyStage::Combine:
+			return TEXT("Combine");
+		case ELeapLatencyStage::BodyState:
+			return TEXT("BodyState");
+		case ELeapLatencyStage::AnimEvaluate:
+			return TEXT("AnimEvaluate");
+		case ELeapLatencyStage::LateUpdate:
+			return TEXT("LateUpdate");
+	}
+	return TEXT("Unknown");
+}
+}	 // namespace
+
+FLeapLatencyTracer& FLeapLatencyTracer::Get()
+{
+	static FLeapLatencyTracer Tracer;
+	return Tracer;
+}
+double FLeapLatencyTracer::GetCaptureTime(const int64 LeapTimeStamp, const int64 LeapNow)
+{
+	return FPlatformTime::Seconds() - (LeapNow - LeapTimeStamp) / 1000000.0;
+}
+int32 FLeapLatencyTracer::GetBucketIndex(const uint64 Micros)
+{
+	const uint64 Clamped = FMath::Min<uint64>(Micros, (1ull << MaxValueBits) - 1);
+	if (Clamped < SubBucketCount)
+	{
+		return (int32) Clamped;
+	}
+	// the top SubBucketBits + 1 bits pick the bucket, the highest of them is implied by the power of two
+	const int32 Shift = (int32) FMath::FloorLog2_64(Clamped) - SubBucketBits;
+	return SubBucketCount * (Shift + 1) + (int32) (Clamped >> Shift) - SubBucketCount;
+}
+uint64 FLeapLatencyTracer::GetBucketLowerBound(const int32 BucketIndex)
+{
+	if (BucketIndex < SubBucketCount)
+	{
+		return BucketIndex;
+	}
+	const int32 Shift = BucketIndex / SubBucketCount - 1;
+	const uint64 SubBucket = BucketIndex % SubBucketCount + SubBucketCount;
+	return SubBucket << Shift;
+}
+void FLeapLatencyTracer::Record(const ELeapLatencyStage Stage, const double CaptureTime)
+{
+	const double LatencySeconds = FMath::Max(FPlatformTime::Seconds() - CaptureTime, 0.0);
+	const int64 Micros = (int64) (LatencySeconds * 1000000.0);
+
+	FHistogram& Histogram = Histograms[(int32) Stage];
+	FPlatformAtomics::InterlockedIncrement(&Histogram.Buckets[GetBucketIndex(Micros)]);
+	FPlatformAtomics::InterlockedIncrement(&Histogram.Count);
+	FPlatformAtomics::InterlockedAdd(&Histogram.SumMicros, Micros);
+
+	int64 Max = FPlatformAtomics::AtomicRead(&Histogram.MaxMicros);
+	while (Micros > Max)
+	{
+		const int64 Previous = FPlatformAtomics::InterlockedCompareExchange(&Histogram.MaxMicros, Micros, Max);
+		if (Previous == Max)
+		{
+			break;
+		}
+		Max = Previous;
+	}
+
+	RecordStats(Stage, (float) (LatencySeconds * 1000.0));
+}
+void FLeapLatencyTracer::RecordStats(const ELeapLatencyStage Stage, const float LatencyMS)
+{
+	const bool bTrace = UE_TRACE_CHANNELEXPR_IS_ENABLED(UltraleapLatencyChannel);
+	switch (Stage)
+	{
+		case ELeapLatencyStage::Arrival:
+			SET_FLOAT_STAT(STAT_LeapLatencyArrival, LatencyMS);
+			if (bTrace)
+			{
+				TRACE_COUNTER_SET(LeapLatencyArrival, LatencyMS);
+			}
+			break;
+		case ELeapLatencyStage::Publish:
+			SET_FLOAT_STAT(STAT_LeapLatencyPublish, LatencyMS);
+			if (bTrace)
+			{
+				TRACE_COUNTER_SET(LeapLatencyPublish, LatencyMS);
+			}
+			break;
+		case ELeapLatencyStage::Consume:
+			SET_FLOAT_STAT(STAT_LeapLatencyConsume, LatencyMS);
+			if (bTrace)
+			{
+				TRACE_COUNTER_SET(LeapLatencyConsume, LatencyMS);
+			}
+			break;
+		case ELeapLatencyStage::Parse:
+			SET_FLOAT_STAT(STAT_LeapLatencyParse, LatencyMS);
+			if (bTrace)
+			{
+				TRACE_COUNTER_SET(LeapLatencyParse, LatencyMS);
+			}
+			break;
+		case ELeapLatencyStage::Combine:
+			SET_FLOAT_STAT(STAT_LeapLatencyCombine, LatencyMS);
+			if (bTrace)
+			{
+				TRACE_COUNTER_SET(LeapLatencyCombine, LatencyMS);
+			}
+			break;
+		case ELeapLatencyStage::BodyState:
+			SET_FLOAT_STAT(STAT_LeapLatencyBodyState, LatencyMS);
+			if (bTrace)
+			{
+				TRACE_COUNTER_SET(LeapLatencyBodyState, LatencyMS);
+			}
+			break;
+		case ELeapLatencyStage::AnimEvaluate:
+			SET_FLOAT_STAT(STAT_LeapLatencyAnimEvaluate, LatencyMS);
+			if (bTrace)
+			{
+				TRACE_COUNTER_SET(LeapLatencyAnimEvaluate, LatencyMS);
+			}
+			break;
+		case ELeapLatencyStage::LateUpdate:
+			SET_FLOAT_STAT(STAT_LeapLatencyLateUpdate, LatencyMS);
+			if (bTrace)
+			{
+				TRACE_COUNTER_SET(LeapLatencyLateUpdate, LatencyMS);
+			}
+			break;
+		default:
+			break;
+	}
+}
+float FLeapLatencyTracer::GetPercentileMS(const ELeapLatencyStage Stage, const float Percentile) const
+{
+	const FHistogram& Histogram = Histograms[(int32) Stage];
+	const int64 Count = FPlatformAtomics::AtomicRead(&Histogram.Count);
+	if (Count == 0)
+	{
+		return 0;
+	}
+	const int64 Target = FMath::Max<int64>(1, (int64) FMath::CeilToDouble(Count * FMath::Clamp(Percentile, 0.f, 100.f) / 100.0));
+
+	int64 Seen = 0;
+	for (int32 BucketIndex = 0; BucketIndex < NumBuckets; BucketIndex++)
+	{
+		Seen += FPlatformAtomics::AtomicRead(&Histogram.Buckets[BucketIndex]);
+		if (Seen >= Target)
+		{
+			// report the top of the bucket so percentiles never under state
+			return (GetBucketLowerBound(BucketIndex + 1) - 1) / 1000.f;
+		}
+	}
+	return FPlatformAtomics::AtomicRead(&Histogram.MaxMicros) / 1000.f;
+}
+void FLeapLatencyTracer::Reset()
+{
+	// records racing with the reset may leave a count or two behind, fine for a profiling tool
+	for (FHistogram& Histogram : Histograms)
+	{
+		for (int32 BucketIndex = 0; BucketIndex < NumBuckets; BucketIndex++)
+		{
+			FPlatformAtomics::InterlockedExchange(&Histogram.Buckets[BucketIndex], 0);
+		}
+		FPlatformAtomics::InterlockedExchange(&Histogram.Count, 0);
+		FPlatformAtomics::InterlockedExchange(&Histogram.SumMicros, 0);
+		FPlatformAtomics::InterlockedExchange(&Histogram.MaxMicros, 0);
+	}
+}
+bool FLeapLatencyTracer::DumpToFile(const FString& FileName) const
+{
+	FString Csv = TEXT("Stage,Frames,MeanMS,P50MS,P90MS,P99MS,P999MS,MaxMS\n");
+	for (int32 StageIndex = 0; StageIndex < (int32) ELeapLatencyStage::Count; StageIndex++)
+	{
+		const ELeapLatencyStage Stage = (ELeapLatencyStage) StageIndex;
+		const FHistogram& Histogram = Histograms[StageIndex];
+		const int64 Count = FPlatformAtomics::AtomicRead(&Histogram.Count);
+		const double MeanMS = Count > 0 ? FPlatformAtomics::AtomicRead(&Histogram.SumMicros) / (Count * 1000.0) : 0.0;
+
+		Csv += FString::Printf(TEXT("%s,%lld,%f,%f,%f,%f,%f,%f\n"), GetStageName(Stage), Count, MeanMS,
+			GetPercentileMS(Stage, 50.f), GetPercentileMS(Stage, 90.f), GetPercentileMS(Stage, 99.f),
+			GetPercentileMS(Stage, 99.9f), FPlatformAtomics::AtomicRead(&Histogram.MaxMicros) / 1000.0);
+	}
+
+	Csv += TEXT("\nStage,BucketFromMS,BucketToMS,Frames\n");
+	for (int32 StageIndex = 0; StageIndex < (int32) ELeapLatencyStage::Count; StageIndex++)
+	{
+		const FHistogram& Histogram = Histograms[StageIndex];
+		for (int32 BucketIndex = 0; BucketIndex < NumBuckets; BucketIndex++)
+		{
+			const int64 BucketCount = FPlatformAtomics::AtomicRead(&Histogram.Buckets[BucketIndex]);
+			if (BucketCount > 0)
+			{
+				Csv += FString::Printf(TEXT("%s,%f,%f,%lld\n"), GetStageName((ELeapLatencyStage) StageIndex),
+					GetBucketLowerBound(BucketIndex) / 1000.0, GetBucketLowerBound(BucketIndex + 1) / 1000.0, BucketCount);
+			}
+		}
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *FileName))
+	{
+		UE_LOG(UltraleapTrackingLog, Warning, TEXT("Failed to write tracking latency to %s"), *FileName);
+		return false;
+	}
+	UE_LOG(UltraleapTrackingLog, Log, TEXT("Wrote tracking latency histograms to %s"), *FileName);
+	return true;
+}
@@ -0,0 +1,91 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("UltraleapLatency"), STATGROUP_UltraleapLatency, STATCAT_Advanced);
+
+// Points in the pipeline a tracking frame's latency is measured at, in pipeline order
+enum class ELeapLatencyStage : uint8
+{
+	// Returned by LeapPollConnection on the poll thread
+	Arrival,
+	// Stored by the device wrapper for the game thread
+	Publish,
+	// Picked up by the device's input tick
+	Consume,
+	// ParseEvents finished with it
+	Parse,
+	// Combined device frame finished combining
+	Combine,
+	// BodyState skeleton set from it
+	BodyState,
+	// Pose evaluated from the skeleton on the anim thread
+	AnimEvaluate,
+	// Hand resampled for the late update on the render thread, going by the resampled pose's own timestamp
+	LateUpdate,
+	Count
+};
+
+/**
+ * End to end tracking latency, enabled with leap.LatencyTrace 1. Each stage records how long after the hardware captured
+ * a frame, going by its LeapC timestamp, the frame reached that stage. Stages record lock free from any thread into HDR
+ * style log linear histograms (16 sub buckets per power of two, 1us to 16s). Records also feed STATGROUP_UltraleapLatency
+ * and, with the UltraleapLatency and Counters trace channels on, Insights counters. leap.DumpLatency writes the
+ * histograms and percentiles to a csv, leap.ResetLatency clears them.
+ */
+class FLeapLatencyTracer
+{
+public:
+	static FLeapLatencyTracer& Get();
+
+	// Check before working out capture times, recording is skipped when disabled
+	static bool IsEnabled()
+	{
+		return Enabled != 0;
+	}
+	// Backs leap.LatencyTrace
+	static int32 Enabled;
+
+	// When a frame was captured in FPlatformTime::Seconds, from its LeapC timestamp and LeapGetNow()
+	static double GetCaptureTime(const int64 LeapTimeStamp, const int64 LeapNow);
+
+	void Record(const ELeapLatencyStage Stage, const double CaptureTime);
+
+	// Latency in ms that Percentile (0-100) of the stage's frames were at or under
+	float GetPercentileMS(const ELeapLatencyStage Stage, const float Percentile) const;
+
+	void Reset();
+	bool DumpToFile(const FString& FileName) const;
+
+private:
+	static constexpr int32 SubBucketBits = 4;
+	static constexpr int32 SubBucketCount = 1 << SubBucketBits;
+	// Latencies are clamped under 2^MaxValueBits microseconds
+	static constexpr int32 MaxValueBits = 24;
+	static constexpr int32 NumBuckets = SubBucketCount * (MaxValueBits - SubBucketBits + 1);
+
+	struct FHistogram
+	{
+		volatile int64 Buckets[NumBuckets] = {};
+		volatile int64 Count = 0;
+		volatile int64 SumMicros = 0;
+		volatile int64 MaxMicros = 0;
+	};
+	FHistogram Histograms[(int32) ELeapLatencyStage::Count];
+
+	FLeapLatencyTracer() = default;
+
+	static int32 GetBucketIndex(const uint64 Micros);
+	static uint64 GetBucketLowerBound(const int32 BucketIndex);
+
+	void RecordStats(const ELeapLatencyStage Stage, const float LatencyMS);
+};
@@ -10,101 +10,278 @@
 
 #include "Animation/AnimInstance.h"
 #include "CoreMinimal.h"
+#include "Features/IModularFeatures.h"
 #include "LeapBlueprintFunctionLibrary.h"
+#include "LeapUtility.h"
 #include "LiveLinkProvider.h"
 #include "Misc/App.h"
 #include "Roles/LiveLinkAnimationRole.h"
 #include "Roles/LiveLinkAnimationTypes.h"
 
+#define LOCTEXT_NAMESPACE "LeapLiveLink"
+
+FLeapLiveLinkLoopbackSource::FLeapLiveLinkLoopbackSource(const FString& DeviceSerial) : Client(nullptr)
+{
+	SourceType = FText::FromString(TEXT("Ultraleap Tracking Loopback: ") + DeviceSerial);
+}
+
+void FLeapLiveLinkLoopbackSource::ReceiveClient(ILiveLinkClient* InClient, FGuid InSourceGuid)
+{
+	FScopeLock Lock(&ClientLock);
+	Client = InClient;
+	SourceGuid = InSourceGuid;
+}
+
+bool FLeapLiveLinkLoopbackSource::IsSourceStillValid() const
+{
+	return HasClient();
+}
+
+bool FLeapLiveLinkLoopbackSource::RequestSourceShutdown()
+{
+	FScopeLock Lock(&ClientLock);
+	Client = nullptr;
+	return true;
+}
+
+FText FLeapLiveLinkLoopbackSource::GetSourceType() const
+{
+	return SourceType;
+}
+
+FText FLeapLiveLinkLoopbackSource::GetSourceMachineName() const
+{
+	return FText::FromString(FPlatformProcess::ComputerName());
+}
+
+FText FLeapLiveLinkLoopbackSource::GetSourceStatus() const
+{
+	return HasClient() ? LOCTEXT("LoopbackActive", "Active") : LOCTEXT("LoopbackShutdown", "Shut down");
+}
+
+void FLeapLiveLinkLoopbackSource::PushStaticData(const FName& SubjectName, FLiveLinkStaticDataStruct&& StaticData)
+{
+	FScopeLock Lock(&ClientLock);
+	if (Client)
+	{
+		Client->PushSubjectStaticData_AnyThread(
+			FLiveLinkSubjectKey(SourceGuid, SubjectName), ULiveLinkAnimationRole::StaticClass(), MoveTemp(StaticData));
+	}
+}
+
+void FLeapLiveLinkLoopbackSource::PushFrameData(const FName& SubjectName, FLiveLinkFrameDataStruct&& FrameData)
+{
+	FScopeLock Lock(&ClientLock);
+	if (Client)
+	{
+		Client->PushSubjectFrameData_AnyThread(FLiveLinkSubjectKey(SourceGuid, SubjectName), MoveTemp(FrameData));
+	}
+}
+
+bool FLeapLiveLinkLoopbackSource::HasClient() const
+{
+	FScopeLock Lock(&ClientLock);
+	return Client != nullptr;
+}
+
 FLeapLiveLinkProducer::FLeapLiveLinkProducer()
+	: bStaticDataSent(false)
+	, MinPublishInterval(0)
+	, LastPublishTime(0)
+	, Decimation(1)
+	, UpdatesSincePublish(0)
+	, PublishedFrameCount(0)
+	, SkippedFrameCount(0)
+	, StaticDataUpdateCount(0)
 {
 }
 
-void FLeapLiveLinkProducer::Startup(const FString& DeviceSerial)
+void FLeapLiveLinkProducer::Startup(const FString& DeviceSerial, const bool bUseLoopback)
 {
+	SubjectName = TEXT("Ultraleap Tracking");
+
+	if (bUseLoopback)
+	{
+		IModularFeatures& ModularFeatures = IModularFeatures::Get();
+		if (ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+		{
+			ILiveLinkClient& Client = ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName);
+			LoopbackSource = MakeShared<FLeapLiveLinkLoopbackSource>(DeviceSerial);
+			Client.AddSource(LoopbackSource);
+			return;
+		}
+		UE_LOG(UltraleapTrackingLog, Warning,
+			TEXT("Leap Live Link loopback requested but no Live Link client is loaded, falling back to the message bus."));
+	}
+
 	LiveLinkProvider = ILiveLinkProvider::CreateLiveLinkProvider(TEXT("Ultraleap Tracking Live Link: ") + DeviceSerial);
 
 	TFunction<void()> StatusChangeLambda = [this] {
 		if (LiveLinkProvider->HasConnection())
 		{
-			UE_LOG(LogTemp, Log, TEXT("Leap Live Link Source Connected. "));
+			UE_LOG(UltraleapTrackingLog, Log, TEXT("Leap Live Link Source Connected. "));
 		}
 		else
 		{
-			UE_LOG(LogTemp, Log, TEXT("Leap Live Link Source Disconnected."));
+			UE_LOG(UltraleapTrackingLog, Log, TEXT("Leap Live Link Source Disconnected."));
 		}
 	};
 	ConnectionStatusChangedHandle = LiveLinkProvider->RegisterConnStatusChangedHandle(
 		FLiveLinkProviderConnectionStatusChanged::FDelegate::CreateLambda(StatusChangeLambda));
-
-	SubjectName = TEXT("Ultraleap Tracking");
 }
 
 void FLeapLiveLinkProducer::ShutDown()
 {
-	LiveLinkProvider->UnregisterConnStatusChangedHandle(ConnectionStatusChangedHandle);
+	if (LiveLinkProvider.IsValid())
+	{
+		LiveLinkProvider->UnregisterConnStatusChangedHandle(ConnectionStatusChangedHandle);
+		LiveLinkProvider = nullptr;
+	}
+	if (LoopbackSource.IsValid())
+	{
+		IModularFeatures& ModularFeatures = IModularFeatures::Get();
+		if (LoopbackSource->HasClient() && ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+		{
+			ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName)
+				.RemoveSource(LoopbackSource->GetSourceGuid());
+		}
+		LoopbackSource = nullptr;
+	}
+	bStaticDataSent = false;
+}
+
+void FLeapLiveLinkProducer::SetPublishRate(const float InPublishRate, const int32 InDecimation)
+{
+	MinPublishInterval = InPublishRate > 0.f ? 1.0 / InPublishRate : 0.0;
+	Decimation = FMath::Max(1, InDecimation);
+}
+
+bool FLeapLiveLinkProducer::ShouldPublish()
+{
+	UpdatesSincePublish++;
+	if (UpdatesSincePublish < Decimation)
+	{
+		SkippedFrameCount++;
+		return false;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (MinPublishInterval > 0.0 && (Now - LastPublishTime) < MinPublishInterval)
+	{
+		SkippedFrameCount++;
+		return false;
+	}
+	UpdatesSincePublish = 0;
+	LastPublishTime = Now;
+	return true;
 }
 
 void FLeapLiveLinkProducer::SyncSubjectToSkeleton(const UBodyStateSkeleton* Skeleton)
 {
 	const TArray<UBodyStateBone*>& Bones = Skeleton->Bones;
 
+	// The static data only changes when hands start or stop tracking, so compare the tracked set before rebuilding it
+	bool bTrackedBonesChanged = !bStaticDataSent || TrackedBoneMask.Num() != Bones.Num();
+	for (int32 i = 0; !bTrackedBonesChanged && i < Bones.Num(); i++)
+	{
+		bTrackedBonesChanged = TrackedBoneMask[i] != Bones[i]->IsTracked();
+	}
+	if (!bTrackedBonesChanged)
+	{
+		return;
+	}
+
 	// Create Data structures for LiveLink
 	FLiveLinkStaticDataStruct StaticData(FLiveLinkSkeletonStaticData::StaticStruct());
 	FLiveLinkSkeletonStaticData& AnimationData = *StaticData.Cast<FLiveLinkSkeletonStaticData>();
 
-	TrackedBones.Reset();
+	TrackedBoneMask.Init(false, Bones.Num());
+	TrackedBoneIndices.Reset();
+	TrackedParentIndices.Reset();
 
-	TArray<FName> ParentsNames;
-	for (int i = 0; i < Bones.Num(); i++)
+	for (int32 i = 0; i < Bones.Num(); i++)
 	{
 		if (Bones[i]->IsTracked())
 		{
+			TrackedBoneMask[i] = true;
+			TrackedBoneIndices.Add(i);
+			TrackedParentIndices.Add(Bones[i]->Parent ? Bones.IndexOfByKey(Bones[i]->Parent) : INDEX_NONE);
 			AnimationData.BoneNames.Add(FName(*Bones[i]->Name));
-			ParentsNames.Add(FName(*Bones[i]->Parent->Name));
-			TrackedBones.Add(Bones[i]);
 		}
 	}
 
-	// Add bone parents
-	for (int j = 0; j < ParentsNames.Num(); j++)
+	// Add bone parents, as indices into the published bones
+	AnimationData.BoneParents.Reserve(TrackedParentIndices.Num());
+	for (const int32 ParentIndex : TrackedParentIndices)
 	{
-		AnimationData.BoneParents.Add(AnimationData.BoneNames.IndexOfByKey(ParentsNames[j]));
+		AnimationData.BoneParents.Add(ParentIndex != INDEX_NONE ? TrackedBoneIndices.IndexOfByKey(ParentIndex) : INDEX_NONE);
 	}
 
-	LiveLinkProvider->UpdateSubjectStaticData(SubjectName, ULiveLinkAnimationRole::StaticClass(), MoveTemp(StaticData));
+	if (LoopbackSource.IsValid())
+	{
+		LoopbackSource->PushStaticData(SubjectName, MoveTemp(StaticData));
+	}
+	else
+	{
+		LiveLinkProvider->UpdateSubjectStaticData(SubjectName, ULiveLinkAnimationRole::StaticClass(), MoveTemp(StaticData));
+	}
+	bStaticDataSent = true;
+	StaticDataUpdateCount++;
 }
 
 void FLeapLiveLinkProducer::UpdateFromBodyState(const UBodyStateSkeleton* Skeleton)
 {
+	const TArray<UBodyStateBone*>& Bones = Skeleton->Bones;
+
+	// The frame is moved into LiveLink so can't be reused, size it exactly once rather than growing it per bone
 	FLiveLinkFrameDataStruct FrameData(FLiveLinkAnimationFrameData::StaticStruct());
 	FLiveLinkAnimationFrameData* AnimationFrameData = FrameData.Cast<FLiveLinkAnimationFrameData>();
+	AnimationFrameData->Transforms.SetNumUninitialized(TrackedBoneIndices.Num());
 
-	const TArray<UBodyStateBone*>& Bones = Skeleton->Bones;
-
-	for (int i = 0; i < Bones.Num(); i++)
+	for (int32 i = 0; i < TrackedBoneIndices.Num(); i++)
 	{
-		if (Bones[i]->IsTracked())
+		const int32 BoneIndex = TrackedBoneIndices[i];
+		const int32 ParentIndex = TrackedParentIndices[i];
+		if (!Bones.IsValidIndex(BoneIndex))
 		{
-			FTransform BoneTransform = Bones[i]->Transform();
-			FTransform ParentTransform;
+			AnimationFrameData->Transforms[i] = FTransform::Identity;
+			continue;
+		}
 
-			// The live link node outputs in local space (this means each bone transform must be relative to its parent)
-			// so convert from component space here
-			ConvertComponentTransformToLocalTransform(BoneTransform, Bones[i]->Parent->Transform());
-			AnimationFrameData->Transforms.Add(BoneTransform);
+		FTransform BoneTransform = Bones[BoneIndex]->Transform();
+
+		// The live link node outputs in local space (this means each bone transform must be relative to its parent)
+		// so convert from component space here
+		if (Bones.IsValidIndex(ParentIndex))
+		{
+			ConvertComponentTransformToLocalTransform(BoneTransform, Bones[ParentIndex]->Transform());
 		}
+		AnimationFrameData->Transforms[i] = BoneTransform;
 	}
 
-	LiveLinkProvider->UpdateSubjectFrameData(SubjectName, MoveTemp(FrameData));
+	if (LoopbackSource.IsValid())
+	{
+		LoopbackSource->PushFrameData(SubjectName, MoveTemp(FrameData));
+	}
+	else
+	{
+		LiveLinkProvider->UpdateSubjectFrameData(SubjectName, MoveTemp(FrameData));
+	}
+	PublishedFrameCount++;
 }
 
 bool FLeapLiveLinkProducer::HasConnection()
 {
-	return LiveLinkProvider->HasConnection();
+	if (LoopbackSource.IsValid())
+	{
+		return LoopbackSource->HasClient();
+	}
+	return LiveLinkProvider.IsValid() && LiveLinkProvider->HasConnection();
 }
 void FLeapLiveLinkProducer::ConvertComponentTransformToLocalTransform(FTransform& BoneTransform, const FTransform& ParentTransform)
 {
 	BoneTransform.SetToRelativeTransform(ParentTransform);
 	BoneTransform.NormalizeRotation();
-}
\ No newline at end of file
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -9,18 +9,60 @@
 #pragma once
 
 #include "ILiveLinkClient.h"
+#include "ILiveLinkSource.h"
 #include "LiveLinkProvider.h"
 #include "LiveLinkTypes.h"
 #include "Skeleton/BodyStateSkeleton.h"
 
+// In process LiveLink source, the producer pushes straight into the local LiveLink client without the message bus.
+// Useful in packaged builds that consume their own tracking and for measuring publish to consume latency.
+class FLeapLiveLinkLoopbackSource : public ILiveLinkSource
+{
+public:
+	FLeapLiveLinkLoopbackSource(const FString& DeviceSerial);
+
+	// ILiveLinkSource
+	virtual void ReceiveClient(ILiveLinkClient* InClient, FGuid InSourceGuid) override;
+	virtual bool IsSourceStillValid() const override;
+	virtual bool RequestSourceShutdown() override;
+	virtual FText GetSourceType() const override;
+	virtual FText GetSourceMachineName() const override;
+	virtual FText GetSourceStatus() const override;
+
+	// Can be called from any thread
+	void PushStaticData(const FName& SubjectName, FLiveLinkStaticDataStruct&& StaticData);
+	void PushFrameData(const FName& SubjectName, FLiveLinkFrameDataStruct&& FrameData);
+	bool HasClient() const;
+
+	const FGuid& GetSourceGuid() const
+	{
+		return SourceGuid;
+	}
+
+private:
+	// Client is cleared on shutdown from the game thread while the tracking update may be pushing
+	mutable FCriticalSection ClientLock;
+	ILiveLinkClient* Client;
+	FGuid SourceGuid;
+	FText SourceType;
+};
+
 class FLeapLiveLinkProducer
 {
 public:
 	FLeapLiveLinkProducer();
-	void Startup(const FString& DeviceSerial);
+
+	// bUseLoopback publishes to the in process LiveLink client instead of over the message bus
+	void Startup(const FString& DeviceSerial, const bool bUseLoopback = false);
 	void ShutDown();
 
-	// Linkup initial information of the skeleton
+	// Publish at most PublishRate times a second (0 for no limit) and only every Decimation'th tracking update
+	void SetPublishRate(const float InPublishRate, const int32 InDecimation);
+
+	// Call once per tracking update, returns whether this update should be published
+	bool ShouldPublish();
+
+	// Linkup initial information of the skeleton, only rebuilds the static data when the tracked bones changed
 	void SyncSubjectToSkeleton(const UBodyStateSkeleton* Skeleton);
 
 	// Update transforms from bodystate skeleton data
@@ -29,11 +71,46 @@ public:
 	// Whether it's connected as a live link source, use this to determine if we should pay the live link data cost
 	bool HasConnection();
 
+	bool IsLoopback() const
+	{
+		return LoopbackSource.IsValid();
+	}
+
+	// Counters for profiling
+	uint64 GetPublishedFrameCount() const
+	{
+		return PublishedFrameCount;
+	}
+	uint64 GetSkippedFrameCount() const
+	{
+		return SkippedFrameCount;
+	}
+	uint64 GetStaticDataUpdateCount() const
+	{
+		return StaticDataUpdateCount;
+	}
+
 protected:
 	FDelegateHandle ConnectionStatusChangedHandle;
 	TSharedPtr<ILiveLinkProvider> LiveLinkProvider;
+	TSharedPtr<FLeapLiveLinkLoopbackSource> LoopbackSource;
 	FName SubjectName;
-	TArray<UBodyStateBone*> TrackedBones;
+
+	// Indices into UBodyStateSkeleton::Bones of the published bones and their parents, cached by SyncSubjectToSkeleton
+	TArray<int32> TrackedBoneIndices;
+	TArray<int32> TrackedParentIndices;
+	TBitArray<> TrackedBoneMask;
+	bool bStaticDataSent;
+
+	// Rate control
+	double MinPublishInterval;
+	double LastPublishTime;
+	int32 Decimation;
+	int32 UpdatesSincePublish;
+
+	uint64 PublishedFrameCount;
+	uint64 SkippedFrameCount;
+	uint64 StaticDataUpdateCount;
 
 	static void ConvertComponentTransformToLocalTransform(FTransform& BoneTransform, const FTransform& ParentTransform);
-};
\ No newline at end of file
+};
@@ -0,0 +1,187 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "LeapPollThread.h"
+
+#include "HAL/Event.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformAffinity.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/RunnableThread.h"
+#include "LeapUtility.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("UltraleapPollThread"), STATGROUP_UltraleapPollThread, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Leap Poll Connection"), STAT_LeapPollConnection, STATGROUP_UltraleapPollThread);
+DECLARE_CYCLE_STAT(TEXT("Leap Poll Handlers"), STAT_LeapPollHandlers, STATGROUP_UltraleapPollThread);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Poll Events per Second"), STAT_LeapPollEventsPerSecond, STATGROUP_UltraleapPollThread);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Poll Wait (ms/s)"), STAT_LeapPollWaitMS, STATGROUP_UltraleapPollThread);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Poll Handlers (ms/s)"), STAT_LeapPollHandlerMS, STATGROUP_UltraleapPollThread);
+
+static int32 GLeapPollThreadPriority = 0;
+static FAutoConsoleVariableRef CVarLeapPollThreadPriority(TEXT("leap.PollThreadPriority"), GLeapPollThreadPriority,
+	TEXT("Priority of the LeapC poll thread, applied on (re)connect.\n")
+	TEXT("-1: below normal, 0: normal (default), 1: above normal, 2: highest, 3: time critical"));
+
+// a string so masks can cover all 64 cores
+static FString GLeapPollThreadAffinity = TEXT("0");
+static FAutoConsoleVariableRef CVarLeapPollThreadAffinity(TEXT("leap.PollThreadAffinity"), GLeapPollThreadAffinity,
+	TEXT("Core affinity bit mask of the LeapC poll thread, decimal or 0x hex, applied on (re)connect. 0: no affinity (default)"));
+
+static int32 GLeapPollTimeoutMS = 20;
+static FAutoConsoleVariableRef CVarLeapPollTimeoutMS(TEXT("leap.PollTimeoutMS"), GLeapPollTimeoutMS,
+	TEXT("LeapPollConnection timeout in milliseconds. Events return immediately, this bounds how long shutdown and ")
+	TEXT("reconnect wait for the poll thread. Default 20"));
+
+namespace
+{
+// Back off between polls while the service isn't connected
+constexpr uint32 DisconnectedWaitMS = 100;
+
+EThreadPriority GetPollThreadPriority()
+{
+	switch (GLeapPollThreadPriority)
+	{
+		case -1:
+			return TPri_BelowNormal;
+		case 1:
+			return TPri_AboveNormal;
+		case 2:
+			return TPri_Highest;
+		case 3:
+			return TPri_TimeCritical;
+		default:
+			return TPri_Normal;
+	}
+}
+uint64 GetPollThreadAffinity()
+{
+	const uint64 Mask = FCString::Strtoui64(*GLeapPollThreadAffinity, nullptr, 0);
+	return Mask != 0 ? Mask : FPlatformAffinity::GetNoAffinityMask();
+}
+}	 // namespace
+
+TUniquePtr<FLeapPollThread> FLeapPollThread::Create(
+	const TCHAR* ThreadName, LEAP_CONNECTION Connection, FMessageHandler InHandler, FIsConnected InIsConnected)
+{
+	TUniquePtr<FLeapPollThread> PollThread(new FLeapPollThread(Connection, MoveTemp(InHandler), MoveTemp(InIsConnected)));
+
+	PollThread->Thread =
+		FRunnableThread::Create(PollThread.Get(), ThreadName, 0, GetPollThreadPriority(), GetPollThreadAffinity());
+	if (!PollThread->Thread)
+	{
+		UE_LOG(UltraleapTrackingLog, Error, TEXT("Failed to create %s."), ThreadName);
+		return nullptr;
+	}
+	return PollThread;
+}
+
+FLeapPollThread::FLeapPollThread(LEAP_CONNECTION InConnection, FMessageHandler InHandler, FIsConnected InIsConnected)
+	: Connection(InConnection)
+	, Handler(MoveTemp(InHandler))
+	, IsConnected(MoveTemp(InIsConnected))
+	, WakeEvent(FPlatformProcess::GetSynchEventFromPool())
+	, bStopping(false)
+{
+}
+
+FLeapPollThread::~FLeapPollThread()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	WakeEvent = nullptr;
+}
+
+uint32 FLeapPollThread::Run()
+{
+	UE_LOG(UltraleapTrackingLog, Log, TEXT("ServiceMessageLoop started."));
+
+	LEAP_CONNECTION_MESSAGE Msg;
+	StatsWindowStart = FPlatformTime::Seconds();
+
+	while (!bStopping)
+	{
+		eLeapRS Result;
+		{
+			SCOPE_CYCLE_COUNTER(STAT_LeapPollConnection);
+			const uint32 PollStart = FPlatformTime::Cycles();
+			Result = LeapPollConnection(Connection, (uint32) FMath::Max(GLeapPollTimeoutMS, 0), &Msg);
+			PollCycles += FPlatformTime::Cycles() - PollStart;
+		}
+
+		// Polling may have taken some time, re-check exit condition
+		if (bStopping)
+		{
+			break;
+		}
+
+		if (Result == eLeapRS_Success)
+		{
+			SCOPE_CYCLE_COUNTER(STAT_LeapPollHandlers);
+			const uint32 HandlerStart = FPlatformTime::Cycles();
+			Handler(Msg);
+			HandlerCycles += FPlatformTime::Cycles() - HandlerStart;
+			++EventCount;
+		}
+		else if (!IsConnected())
+		{
+			WakeEvent->Wait(DisconnectedWaitMS);
+		}
+
+		const double Now = FPlatformTime::Seconds();
+		if (Now - StatsWindowStart >= 1.0)
+		{
+			UpdateStats(Now);
+		}
+	}
+
+	UE_LOG(UltraleapTrackingLog, Log, TEXT("ServiceMessageLoop stopped."));
+	return 0;
+}
+
+void FLeapPollThread::Stop()
+{
+	bStopping = true;
+	WakeEvent->Trigger();
+}
+
+void FLeapPollThread::UpdateStats(const double Now)
+{
+	const float WindowSeconds = (float) (Now - StatsWindowStart);
+
+	FLeapPollThreadStats WindowStats;
+	WindowStats.EventsPerSecond = EventCount / WindowSeconds;
+	WindowStats.PollMSPerSecond = FPlatformTime::ToMilliseconds64(PollCycles) / WindowSeconds;
+	WindowStats.HandlerMSPerSecond = FPlatformTime::ToMilliseconds64(HandlerCycles) / WindowSeconds;
+
+	SET_FLOAT_STAT(STAT_LeapPollEventsPerSecond, WindowStats.EventsPerSecond);
+	SET_FLOAT_STAT(STAT_LeapPollWaitMS, WindowStats.PollMSPerSecond);
+	SET_FLOAT_STAT(STAT_LeapPollHandlerMS, WindowStats.HandlerMSPerSecond);
+
+	{
+		FScopeLock Lock(&StatsLock);
+		Stats = WindowStats;
+	}
+
+	EventCount = 0;
+	PollCycles = 0;
+	HandlerCycles = 0;
+	StatsWindowStart = Now;
+}
+
+FLeapPollThreadStats FLeapPollThread::GetStats() const
+{
+	FScopeLock Lock(&StatsLock);
+	return Stats;
+}
@@ -0,0 +1,76 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "LeapC.h"
+
+class FRunnableThread;
+class FEvent;
+
+struct FLeapPollThreadStats
+{
+	float EventsPerSecond = 0;
+	// Milliseconds per second spent waiting in LeapPollConnection
+	float PollMSPerSecond = 0;
+	// Milliseconds per second spent in the message handlers
+	float HandlerMSPerSecond = 0;
+};
+
+/**
+ * Named thread servicing a LeapC connection. Priority and core affinity come from leap.PollThreadPriority and
+ * leap.PollThreadAffinity when the thread is created, the poll timeout from leap.PollTimeoutMS on every poll.
+ * Stop() wakes the thread, shutdown waits at most one poll timeout.
+ */
+class FLeapPollThread : public FRunnable
+{
+public:
+	typedef TFunction<void(const LEAP_CONNECTION_MESSAGE& Message)> FMessageHandler;
+	typedef TFunction<bool()> FIsConnected;
+
+	/** Returns nullptr if the platform can't create the thread */
+	static TUniquePtr<FLeapPollThread> Create(
+		const TCHAR* ThreadName, LEAP_CONNECTION Connection, FMessageHandler InHandler, FIsConnected InIsConnected);
+
+	/** Stops and waits for the thread */
+	virtual ~FLeapPollThread();
+
+	// FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End of FRunnable
+
+	/** Stats over the last full second, safe to call from any thread */
+	FLeapPollThreadStats GetStats() const;
+
+private:
+	FLeapPollThread(LEAP_CONNECTION InConnection, FMessageHandler InHandler, FIsConnected InIsConnected);
+
+	void UpdateStats(const double Now);
+
+	LEAP_CONNECTION Connection;
+	FMessageHandler Handler;
+	FIsConnected IsConnected;
+
+	FRunnableThread* Thread = nullptr;
+	// Triggered by Stop() to cut the disconnected back off short
+	FEvent* WakeEvent = nullptr;
+	FThreadSafeBool bStopping;
+
+	// Accumulated on the poll thread, published once a second
+	uint32 EventCount = 0;
+	uint64 PollCycles = 0;
+	uint64 HandlerCycles = 0;
+	double StatsWindowStart = 0;
+
+	mutable FCriticalSection StatsLock;
+	FLeapPollThreadStats Stats;
+};
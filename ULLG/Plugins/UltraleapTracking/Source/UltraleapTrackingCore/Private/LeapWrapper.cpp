@@ -9,14 +9,24 @@
 #include "LeapWrapper.h"
 #include "LeapDeviceWrapper.h"
 #include "LeapAsync.h"
+#include "LeapHotPlugQueue.h"
+#include "LeapLatencyTracer.h"
+#include "LeapPollThread.h"
 #include "LeapUtility.h"
 #include "Multileap/DeviceCombiner.h"
 #include "Runtime/Core/Public/Misc/Timespan.h"
+#include "HAL/IConsoleManager.h"
+
+static int32 GLeapHotPlugAddsPerTick = 1;
+static FAutoConsoleVariableRef CVarLeapHotPlugAddsPerTick(TEXT("leap.HotPlugAddsPerTick"), GLeapHotPlugAddsPerTick,
+	TEXT("Devices added per game thread tick when several are plugged in at once, later ones wait for the next tick. ")
+	TEXT("Removals aren't limited. Default 1"));
 
 #pragma region LeapC Wrapper
 
 FLeapWrapper::FLeapWrapper()
 	: bIsRunning(false)
+	, HotPlugQueue(new FLeapHotPlugQueue())
 	, DataLock(new FCriticalSection())
 	, InterpolatedFrame(nullptr)
 	, InterpolatedFrameSize(0)
@@ -26,38 +36,37 @@ FLeapWrapper::FLeapWrapper()
 
 FLeapWrapper::~FLeapWrapper()
 {
-	for (auto CombinedDevice : CombinedDevices)
+	// stop the poll thread before the devices its handlers use are deleted
+	if (PollThread)
+	{
+		CloseConnection();
+	}
+	for (auto CombinedDevice : DeviceRegistry.GetCombinedDevices())
 	{
 		delete CombinedDevice;
 	}
-	CombinedDevices.Empty();
-	for (auto Device : Devices)
+	for (auto Device : DeviceRegistry.GetDevices())
 	{
 		delete Device;
 	}
-	Devices.Empty();
+	DeviceRegistry.Reset();
 	bIsRunning = false;
 	// map device to callback delegate
-	MapDeviceToCallback.Empty();
+	DeviceRegistry.ClearCallbackDelegates();
 
 	ConnectionHandle = nullptr;
-
-	if (bIsConnected)
-	{
-		CloseConnection();
-	}
 }
 // to be deprecated
 void FLeapWrapper::SetCallbackDelegate(LeapWrapperCallbackInterface* InCallbackDelegate)
 {
 	// fallback behaviour for non multidevice
-	MapDeviceToCallback.Add(0, InCallbackDelegate);
+	DeviceRegistry.SetCallbackDelegate(0, InCallbackDelegate);
 	ConnectorCallbackDelegate = InCallbackDelegate;
 }
 // per device event handling
 void FLeapWrapper::SetCallbackDelegate(const uint32_t DeviceID, LeapWrapperCallbackInterface* InCallbackDelegate)
 {
-	MapDeviceToCallback.Add(DeviceID, InCallbackDelegate);
+	DeviceRegistry.SetCallbackDelegate(DeviceID, InCallbackDelegate);
 }
 LEAP_CONNECTION* FLeapWrapper::OpenConnection(LeapWrapperCallbackInterface* InCallbackDelegate, bool UseMultiDeviceMode)
 {
@@ -82,14 +91,10 @@ LEAP_CONNECTION* FLeapWrapper::OpenConnection(LeapWrapperCallbackInterface* InCa
 		{
 			bIsRunning = true;
 
-			LEAP_CONNECTION* Handle = &ConnectionHandle;
-			ProducerLambdaFuture = FLeapAsync::RunLambdaOnBackGroundThread([&, Handle] {
-				UE_LOG(UltraleapTrackingLog, Log, TEXT("ServiceMessageLoop started."));
-				ServiceMessageLoop();
-				UE_LOG(UltraleapTrackingLog, Log, TEXT("ServiceMessageLoop stopped."));
-
-				CloseConnectionHandle(Handle);
-			});
+			PollThread = FLeapPollThread::Create(
+				TEXT("UltraleapPollThread"), ConnectionHandle,
+				[this](const LEAP_CONNECTION_MESSAGE& Msg) { ServiceMessage(Msg); },
+				[this]() { return bIsConnected; });
 		}
 	}
 	
@@ -97,16 +102,13 @@ LEAP_CONNECTION* FLeapWrapper::OpenConnection(LeapWrapperCallbackInterface* InCa
 }
 LeapWrapperCallbackInterface* FLeapWrapper::GetCallbackDelegateFromDeviceID(const uint32_t DeviceID)
 {
-	if(MapDeviceToCallback.Contains(DeviceID))
-	{
-		return *MapDeviceToCallback.Find(DeviceID);
-	}
-	return nullptr;
+	return DeviceRegistry.GetCallbackDelegate(DeviceID);
 }
 
 void FLeapWrapper::CloseConnection()
 {
-	if (!bIsConnected)
+	// the poll thread runs from OpenConnection even before the service connects
+	if (!PollThread)
 	{
 		// Not connected, already done
 		UE_LOG(UltraleapTrackingLog, Log, TEXT("Attempt at closing an already closed connection."));
@@ -114,16 +116,19 @@ void FLeapWrapper::CloseConnection()
 	}
 	bIsConnected = false;
 	bIsRunning = false;
-	
 
-	// Wait for thread to exit - Blocking call, but it should be very quick.
-	FTimespan ExitWaitTimeSpan = FTimespan::FromSeconds(3);
+	// Wakes the poll thread and waits for it - Blocking call, bounded by leap.PollTimeoutMS
+	PollThread->Stop();
+	const FLeapPollThreadStats PollStats = PollThread->GetStats();
+	PollThread.Reset();
+
+	UE_LOG(UltraleapTrackingLog, Log, TEXT("Poll thread stopped, last second: %.1f events, %.2fms in handlers."),
+		PollStats.EventsPerSecond, PollStats.HandlerMSPerSecond);
 
-	ProducerLambdaFuture.WaitFor(ExitWaitTimeSpan);
-	ProducerLambdaFuture.Reset();
+	CloseConnectionHandle(&ConnectionHandle);
 
 	// Nullify the callback delegate. Any outstanding task graphs will not run if the delegate is nullified.
-	MapDeviceToCallback.Empty();
+	DeviceRegistry.ClearCallbackDelegates();
 
 	UE_LOG(UltraleapTrackingLog, Log, TEXT("Connection successfully closed."));
 }
@@ -138,12 +143,7 @@ void FLeapWrapper::SetTrackingMode(eLeapTrackingMode TrackingMode)
 }
 LEAP_DEVICE FLeapWrapper::GetDeviceHandleFromDeviceID(const uint32_t DeviceID)
 {
-	LEAP_DEVICE DeviceHandle = nullptr;
-	if (MapDeviceIDToDevice.Contains(DeviceID))
-	{
-		DeviceHandle = MapDeviceIDToDevice[DeviceID];
-	}
-	return DeviceHandle;
+	return DeviceRegistry.GetDeviceHandle(DeviceID);
 }
 void FLeapWrapper::SetTrackingModeEx(eLeapTrackingMode TrackingMode, const uint32_t DeviceID /* = 0*/)
 {
@@ -244,6 +244,21 @@ LEAP_TRACKING_EVENT* FLeapWrapper::GetInterpolatedFrameAtTime(int64 TimeStamp)
 
 	return InterpolatedFrame;
 }
+LEAP_TRACKING_EVENT* FLeapWrapper::InterpolateFrameAtTime(int64 TimeStamp, TArray<uint8>& FrameBuffer)
+{
+	uint64_t FrameSize = 0;
+	if (!ConnectionHandle || LeapGetFrameSize(ConnectionHandle, TimeStamp, &FrameSize) != eLeapRS_Success || FrameSize == 0)
+	{
+		return nullptr;
+	}
+	FrameBuffer.SetNumUninitialized(FrameSize, false);
+	LEAP_TRACKING_EVENT* Frame = (LEAP_TRACKING_EVENT*) FrameBuffer.GetData();
+	if (LeapInterpolateFrame(ConnectionHandle, TimeStamp, Frame, FrameSize) != eLeapRS_Success)
+	{
+		return nullptr;
+	}
+	return Frame;
+}
 LEAP_TRACKING_EVENT* FLeapWrapper::GetInterpolatedFrameAtTimeEx(int64 TimeStamp, const uint32_t DeviceID)
 {
 	if (!DeviceID)
@@ -377,7 +392,7 @@ void FLeapWrapper::SetFrame(const LEAP_TRACKING_EVENT* Frame)
 	DataLock->Unlock();
 }
 
-/** Called by ServiceMessageLoop() when a connection event is returned by LeapPollConnection(). */
+/** Called by ServiceMessage() when a connection event is returned by LeapPollConnection(). */
 void FLeapWrapper::HandleConnectionEvent(const LEAP_CONNECTION_EVENT* ConnectionEvent)
 {
 	bIsConnected = true;
@@ -387,7 +402,7 @@ void FLeapWrapper::HandleConnectionEvent(const LEAP_CONNECTION_EVENT* Connection
 	}
 }
 
-/** Called by ServiceMessageLoop() when a connection lost event is returned by LeapPollConnection(). */
+/** Called by ServiceMessage() when a connection lost event is returned by LeapPollConnection(). */
 void FLeapWrapper::HandleConnectionLostEvent(const LEAP_CONNECTION_LOST_EVENT* ConnectionLostEvent)
 {
 	bIsConnected = false;
@@ -400,103 +415,108 @@ void FLeapWrapper::HandleConnectionLostEvent(const LEAP_CONNECTION_LOST_EVENT* C
 }
 
 /**
- * Called by ServiceMessageLoop() when a device event is returned by LeapPollConnection()
+ * Called by ServiceMessage() when a device event is returned by LeapPollConnection()
  */
 void FLeapWrapper::HandleDeviceEvent(const LEAP_DEVICE_EVENT* DeviceEvent)
 {
-	LEAP_DEVICE DeviceHandle = nullptr;
+	// filled in on the stack, the serial goes in the event's own buffer so nothing is allocated on the poll thread
+	FLeapHotPlugQueue::FEvent HotPlugEvent;
+	HotPlugEvent.bFound = true;
+	HotPlugEvent.DeviceID = DeviceEvent->device.id;
+
 	// Open device using LEAP_DEVICE_REF from event struct.
-	eLeapRS Result = LeapOpenDevice(DeviceEvent->device, &DeviceHandle);
+	eLeapRS Result = LeapOpenDevice(DeviceEvent->device, &HotPlugEvent.DeviceHandle);
 	if (Result != eLeapRS_Success)
 	{
 		UE_LOG(UltraleapTrackingLog, Warning, TEXT("Could not open device %s.\n"), ResultString(Result));
 		return;
 	}
-	
-	// Create a struct to hold the device properties, we have to provide a buffer for the serial string
-	LEAP_DEVICE_INFO DeviceProperties = {sizeof(DeviceProperties)};
-	// Start with a length of 1 (pretending we don't know a priori what the length is).
-	// Currently device serial numbers are all the same length, but that could change in the future
-	DeviceProperties.serial_length = 64;
-	DeviceProperties.serial = (char*) malloc(DeviceProperties.serial_length);
-	// This will fail since the serial buffer is only 1 character long
-	// But deviceProperties is updated to contain the required buffer length
-	Result = LeapGetDeviceInfo(DeviceHandle, &DeviceProperties);
-	if (Result == eLeapRS_InsufficientBuffer)
-	{
-		// try again with correct buffer size
-		free(DeviceProperties.serial);
-		DeviceProperties.serial = (char*) malloc(DeviceProperties.serial_length);
-		Result = LeapGetDeviceInfo(DeviceHandle, &DeviceProperties);
-		if (Result != eLeapRS_Success)
-		{
-			printf("Failed to get device info %s.\n", ResultString(Result));
-			free(DeviceProperties.serial);
-			return;
-		}
-	}
-	AddDevice(DeviceEvent->device.id, DeviceProperties, DeviceHandle);
-	
-	if (ConnectorCallbackDelegate)
+
+	LEAP_DEVICE_INFO DeviceProperties = HotPlugEvent.GetDeviceInfo();
+	DeviceProperties.serial_length = FLeapHotPlugQueue::MaxSerialLength;
+	Result = LeapGetDeviceInfo(HotPlugEvent.DeviceHandle, &DeviceProperties);
+	if (Result != eLeapRS_Success)
 	{
-		TaskRefDeviceFound = FLeapAsync::RunShortLambdaOnGameThread([DeviceEvent, DeviceProperties, this] {
-				if (ConnectorCallbackDelegate)
-			{
-				ConnectorCallbackDelegate->OnDeviceFound(&DeviceProperties);
-				free(DeviceProperties.serial);
-			}
-		});
+		// device serial numbers are all well under the buffer size, a longer one reports eLeapRS_InsufficientBuffer
+		UE_LOG(UltraleapTrackingLog, Warning, TEXT("Failed to get device info %s."), ResultString(Result));
 	}
 	else
 	{
-		free(DeviceProperties.serial);
+		HotPlugEvent.DeviceInfo = DeviceProperties;
+		HotPlugEvent.DeviceInfo.serial = nullptr;
+		if (!HotPlugQueue->Push(HotPlugEvent))
+		{
+			UE_LOG(UltraleapTrackingLog, Error, TEXT("Device hot plug queue full, device %d not added."), HotPlugEvent.DeviceID);
+		}
 	}
 
-	LeapCloseDevice(DeviceHandle);
+	LeapCloseDevice(HotPlugEvent.DeviceHandle);
 }
 
-/** Called by ServiceMessageLoop() when a device lost event is returned by LeapPollConnection(). */
+/** Called by ServiceMessage() when a device lost event is returned by LeapPollConnection(). */
 void FLeapWrapper::HandleDeviceLostEvent(const LEAP_DEVICE_EVENT* DeviceEvent)
 {
-	if (ConnectorCallbackDelegate)
+	FLeapHotPlugQueue::FEvent HotPlugEvent;
+	HotPlugEvent.DeviceID = DeviceEvent->device.id;
+	if (!HotPlugQueue->Push(HotPlugEvent))
+	{
+		UE_LOG(UltraleapTrackingLog, Error, TEXT("Device hot plug queue full, device %d not removed."), HotPlugEvent.DeviceID);
+	}
+}
+// game thread, safe point before the devices tick
+void FLeapWrapper::ProcessHotPlugEvents()
+{
+	HotPlugQueue->Gather();
+
+	int32 AddBudget = FMath::Max(GLeapHotPlugAddsPerTick, 1);
+	FLeapHotPlugQueue::FEvent HotPlugEvent;
+	while (HotPlugQueue->Pop(HotPlugEvent, AddBudget))
 	{
-		TaskRefDeviceLost = FLeapAsync::RunShortLambdaOnGameThread([DeviceEvent, this] {
-				if (ConnectorCallbackDelegate)
+		if (HotPlugEvent.bFound)
+		{
+			const LEAP_DEVICE_INFO DeviceProperties = HotPlugEvent.GetDeviceInfo();
+			AddDevice(HotPlugEvent.DeviceID, DeviceProperties, HotPlugEvent.DeviceHandle);
+			if (ConnectorCallbackDelegate)
 			{
-					FString DeviceSerial;
-					for (auto LeapDeviceWrapper : Devices)
-					{
-						if (LeapDeviceWrapper->GetDeviceID() == DeviceEvent->device.id)
-						{
-							DeviceSerial = LeapDeviceWrapper->GetDeviceSerial();
-							break;
-						}
-					}
-					ConnectorCallbackDelegate->OnDeviceLost(TCHAR_TO_ANSI(*DeviceSerial));
+				ConnectorCallbackDelegate->OnDeviceFound(&DeviceProperties);
 			}
-		});
+		}
+		else
+		{
+			if (ConnectorCallbackDelegate)
+			{
+				FString DeviceSerial;
+				if (IHandTrackingWrapper* LeapDeviceWrapper = DeviceRegistry.FindDeviceByID(HotPlugEvent.DeviceID))
+				{
+					DeviceSerial = LeapDeviceWrapper->GetDeviceSerial();
+				}
+				ConnectorCallbackDelegate->OnDeviceLost(TCHAR_TO_ANSI(*DeviceSerial));
+			}
+			//TODO: Why does the old code close the device handle once opened?
+			RemoveDeviceDirect(HotPlugEvent.DeviceID);
+		}
 	}
-	//TODO: Why does the old code close the device handle once opened?
-	RemoveDevice(DeviceEvent->device.id);
 }
 void FLeapWrapper::AddDevice(const uint32_t DeviceID, const LEAP_DEVICE_INFO& DeviceInfo, const LEAP_DEVICE DeviceHandle)
 {
-	AsyncTask(ENamedThreads::GameThread,
-		[this,DeviceInfo, DeviceID, DeviceHandle]()
-		{
-			IHandTrackingWrapper* Device = new FLeapDeviceWrapper(DeviceID, DeviceInfo, DeviceHandle, ConnectionHandle, this);
-		
-			Devices.Add(Device);
-			auto Result = LeapSubscribeEvents(ConnectionHandle, DeviceHandle);
-			MapDeviceIDToDevice.Add(DeviceID, DeviceHandle);
-
-			NotifyDeviceAdded(Device);
-			UE_LOG(
-				UltraleapTrackingLog, Log, TEXT("Add Device %s %d."), *(Device->GetDeviceSerial().Right(4)), Device->GetDeviceID());
-		
-			UE_LOG(UltraleapTrackingLog, Log, TEXT("Device Count %d."), Devices.Num());
-		
-		});
+	check(IsInGameThread());
+
+	// a device found again without being lost keeps its wrapper
+	if (DeviceRegistry.FindDeviceByID(DeviceID))
+	{
+		return;
+	}
+	IHandTrackingWrapper* Device = new FLeapDeviceWrapper(DeviceID, DeviceInfo, DeviceHandle, ConnectionHandle, this);
+
+	DeviceRegistry.AddDevice(Device);
+	auto Result = LeapSubscribeEvents(ConnectionHandle, DeviceHandle);
+	DeviceRegistry.SetDeviceHandle(DeviceID, DeviceHandle);
+
+	CleanupCombinedDevicesMissingDevice(Device);
+	NotifyDeviceAdded(Device);
+	UE_LOG(UltraleapTrackingLog, Log, TEXT("Add Device %s %d."), *(Device->GetDeviceSerial().Right(4)), Device->GetDeviceID());
+
+	UE_LOG(UltraleapTrackingLog, Log, TEXT("Device Count %d."), DeviceRegistry.GetDevices().Num());
 }
 void FLeapWrapper::RemoveDevice(const uint32_t DeviceID)
 {
@@ -511,27 +531,23 @@ void FLeapWrapper::RemoveDevice(const uint32_t DeviceID)
 }
 void FLeapWrapper::RemoveDeviceDirect(const uint32_t DeviceID)
 {
-	MapDeviceToCallback.Remove(DeviceID);
-	MapDeviceIDToDevice.Remove(DeviceID);
+	DeviceRegistry.RemoveDeviceID(DeviceID);
 
-	for (auto LeapDeviceWrapper : Devices)
+	IHandTrackingWrapper* LeapDeviceWrapper = DeviceRegistry.FindDeviceByID(DeviceID);
+	if (LeapDeviceWrapper)
 	{
-		if (LeapDeviceWrapper->GetDeviceID() == DeviceID)
-		{
-			UE_LOG(UltraleapTrackingLog, Log, TEXT("Remove Device %s %d."), *(LeapDeviceWrapper->GetDeviceSerial().Right(4)),
-				LeapDeviceWrapper->GetDeviceID());
-
-			Devices.Remove(LeapDeviceWrapper);
-			CleanupCombinedDevicesReferencingDevice(LeapDeviceWrapper);
-			NotifyDeviceRemoved(LeapDeviceWrapper);
-			DevicesToCleanup.Remove(LeapDeviceWrapper);
-			delete LeapDeviceWrapper;
-			break;
-		}
+		UE_LOG(UltraleapTrackingLog, Log, TEXT("Remove Device %s %d."), *(LeapDeviceWrapper->GetDeviceSerial().Right(4)),
+			LeapDeviceWrapper->GetDeviceID());
+
+		DeviceRegistry.RemoveDevice(LeapDeviceWrapper);
+		CleanupCombinedDevicesReferencingDevice(LeapDeviceWrapper);
+		NotifyDeviceRemoved(LeapDeviceWrapper);
+		DevicesToCleanup.Remove(LeapDeviceWrapper);
+		delete LeapDeviceWrapper;
 	}
-	UE_LOG(UltraleapTrackingLog, Log, TEXT("Device Count %d."), Devices.Num());
+	UE_LOG(UltraleapTrackingLog, Log, TEXT("Device Count %d."), DeviceRegistry.GetDevices().Num());
 }
-/** Called by ServiceMessageLoop() when a device failure event is returned by LeapPollConnection(). */
+/** Called by ServiceMessage() when a device failure event is returned by LeapPollConnection(). */
 void FLeapWrapper::HandleDeviceFailureEvent(const LEAP_DEVICE_FAILURE_EVENT* DeviceFailureEvent, const uint32_t DeviceID)
 {
 	LeapWrapperCallbackInterface* CallbackDelegate = GetCallbackDelegateFromDeviceID(DeviceID);
@@ -545,9 +561,14 @@ void FLeapWrapper::HandleDeviceFailureEvent(const LEAP_DEVICE_FAILURE_EVENT* Dev
 	}
 }
 
-/** Called by ServiceMessageLoop() when a tracking event is returned by LeapPollConnection(). */
+/** Called by ServiceMessage() when a tracking event is returned by LeapPollConnection(). */
 void FLeapWrapper::HandleTrackingEvent(const LEAP_TRACKING_EVENT* TrackingEvent,const uint32_t DeviceID)
 {
+	if (FLeapLatencyTracer::IsEnabled())
+	{
+		FLeapLatencyTracer::Get().Record(ELeapLatencyStage::Arrival,
+			FLeapLatencyTracer::GetCaptureTime(TrackingEvent->info.timestamp, LeapGetNow()));
+	}
 	auto CallbackDelegate = GetCallbackDelegateFromDeviceID(DeviceID);
 	// Callback delegate is checked twice since the second call happens on the second thread and may be invalidated!
 	if (CallbackDelegate)
@@ -568,7 +589,7 @@ void FLeapWrapper::HandleImageEvent(const LEAP_IMAGE_EVENT* ImageEvent, const ui
 	}
 }
 
-/** Called by ServiceMessageLoop() when a log event is returned by LeapPollConnection(). */
+/** Called by ServiceMessage() when a log event is returned by LeapPollConnection(). */
 void FLeapWrapper::HandleLogEvent(const LEAP_LOG_EVENT* LogEvent, const uint32_t DeviceID)
 {
 	auto CallbackDelegate = GetCallbackDelegateFromDeviceID(DeviceID);
@@ -585,7 +606,7 @@ void FLeapWrapper::HandleLogEvent(const LEAP_LOG_EVENT* LogEvent, const uint32_t
 	}
 }
 
-/** Called by ServiceMessageLoop() when a policy event is returned by LeapPollConnection(). */
+/** Called by ServiceMessage() when a policy event is returned by LeapPollConnection(). */
 void FLeapWrapper::HandlePolicyEvent(const LEAP_POLICY_EVENT* PolicyEvent, const uint32_t DeviceID)
 {
 	auto CallbackDelegate = GetCallbackDelegateFromDeviceID(DeviceID);
@@ -605,7 +626,7 @@ void FLeapWrapper::HandlePolicyEvent(const LEAP_POLICY_EVENT* PolicyEvent, const
 	}
 }
 
-/** Called by ServiceMessageLoop() when a policy event is returned by LeapPollConnection(). */
+/** Called by ServiceMessage() when a policy event is returned by LeapPollConnection(). */
 void FLeapWrapper::HandleTrackingModeEvent(const LEAP_TRACKING_MODE_EVENT* TrackingModeEvent, const uint32_t DeviceID)
 {
 	auto CallbackDelegate = GetCallbackDelegateFromDeviceID(DeviceID);
@@ -625,7 +646,7 @@ void FLeapWrapper::HandleTrackingModeEvent(const LEAP_TRACKING_MODE_EVENT* Track
 	}
 }
 
-/** Called by ServiceMessageLoop() when a config change event is returned by LeapPollConnection(). */
+/** Called by ServiceMessage() when a config change event is returned by LeapPollConnection(). */
 void FLeapWrapper::HandleConfigChangeEvent(const LEAP_CONFIG_CHANGE_EVENT* ConfigChangeEvent, const uint32_t DeviceID)
 {
 	auto CallbackDelegate = GetCallbackDelegateFromDeviceID(DeviceID);
@@ -642,7 +663,7 @@ void FLeapWrapper::HandleConfigChangeEvent(const LEAP_CONFIG_CHANGE_EVENT* Confi
 	}
 }
 
-/** Called by ServiceMessageLoop() when a config response event is returned by LeapPollConnection(). */
+/** Called by ServiceMessage() when a config response event is returned by LeapPollConnection(). */
 void FLeapWrapper::HandleConfigResponseEvent(const LEAP_CONFIG_RESPONSE_EVENT* ConfigResponseEvent, const uint32_t DeviceID)
 {
 	auto CallbackDelegate = GetCallbackDelegateFromDeviceID(DeviceID);
@@ -660,89 +681,58 @@ void FLeapWrapper::HandleConfigResponseEvent(const LEAP_CONFIG_RESPONSE_EVENT* C
 }
 
 /**
- * Services the LeapC message pump by calling LeapPollConnection().
+ * Services one message from the LeapC message pump, called by the poll thread after LeapPollConnection().
  * The average polling time is determined by the framerate of the Leap Motion service.
  */
-void FLeapWrapper::ServiceMessageLoop(void* Unused)
+void FLeapWrapper::ServiceMessage(const LEAP_CONNECTION_MESSAGE& Msg)
 {
-	eLeapRS Result;
-	LEAP_CONNECTION_MESSAGE Msg;
-	LEAP_CONNECTION Handle = ConnectionHandle;	  // copy handle so it doesn't get released from under us on game thread
-
-	unsigned int Timeout = 200;
-	while (bIsRunning)
+	switch (Msg.type)
 	{
-		Result = LeapPollConnection(Handle, Timeout, &Msg);
-
-		// Polling may have taken some time, re-check exit condition
-		if (!bIsRunning)
-		{
+		case eLeapEventType_Connection:
+			HandleConnectionEvent(Msg.connection_event);
 			break;
-		}
-
-		if (Result != eLeapRS_Success)
-		{
-			// UE_LOG(UltraleapTrackingLog, Log, TEXT("LeapC PollConnection unsuccessful result %s.\n"),
-			// UTF8_TO_TCHAR(ResultString(result)));
-			if (!bIsConnected)
-			{
-				FPlatformProcess::Sleep(0.1f);
-				continue;
-			}
-			else
-			{
-				continue;
-			}
-		}
-
-		switch (Msg.type)
-		{
-			case eLeapEventType_Connection:
-				HandleConnectionEvent(Msg.connection_event);
-				break;
-			case eLeapEventType_ConnectionLost:
-				HandleConnectionLostEvent(Msg.connection_lost_event);
-				break;
-			case eLeapEventType_Device:
-				HandleDeviceEvent(Msg.device_event);
-				break;
-			case eLeapEventType_DeviceLost:
-				HandleDeviceLostEvent(Msg.device_event);
-				break;
-			case eLeapEventType_DeviceFailure:
-				HandleDeviceFailureEvent(Msg.device_failure_event, Msg.device_id);
-				break;
-			case eLeapEventType_Tracking:
-				HandleTrackingEvent(Msg.tracking_event, Msg.device_id);
-				break;
-			case eLeapEventType_Image:
-				HandleImageEvent(Msg.image_event, Msg.device_id);
-				break;
-			case eLeapEventType_LogEvent:
-				HandleLogEvent(Msg.log_event, Msg.device_id);
-				break;
-			case eLeapEventType_Policy:
-				HandlePolicyEvent(Msg.policy_event, Msg.device_id);
-				break;
-			case eLeapEventType_TrackingMode:
-				HandleTrackingModeEvent(Msg.tracking_mode_event, Msg.device_id);
-				break;
-			case eLeapEventType_ConfigChange:
-				HandleConfigChangeEvent(Msg.config_change_event, Msg.device_id);
-				break;
-			case eLeapEventType_ConfigResponse:
-				HandleConfigResponseEvent(Msg.config_response_event, Msg.device_id);
-				break;
-			default:
-				// discard unknown message types
-				// UE_LOG(UltraleapTrackingLog, Log, TEXT("Unhandled message type %i."), (int32)Msg.type);
-				break;
-		}	 // switch on msg.type
-	}		 // end while running
+		case eLeapEventType_ConnectionLost:
+			HandleConnectionLostEvent(Msg.connection_lost_event);
+			break;
+		case eLeapEventType_Device:
+			HandleDeviceEvent(Msg.device_event);
+			break;
+		case eLeapEventType_DeviceLost:
+			HandleDeviceLostEvent(Msg.device_event);
+			break;
+		case eLeapEventType_DeviceFailure:
+			HandleDeviceFailureEvent(Msg.device_failure_event, Msg.device_id);
+			break;
+		case eLeapEventType_Tracking:
+			HandleTrackingEvent(Msg.tracking_event, Msg.device_id);
+			break;
+		case eLeapEventType_Image:
+			HandleImageEvent(Msg.image_event, Msg.device_id);
+			break;
+		case eLeapEventType_LogEvent:
+			HandleLogEvent(Msg.log_event, Msg.device_id);
+			break;
+		case eLeapEventType_Policy:
+			HandlePolicyEvent(Msg.policy_event, Msg.device_id);
+			break;
+		case eLeapEventType_TrackingMode:
+			HandleTrackingModeEvent(Msg.tracking_mode_event, Msg.device_id);
+			break;
+		case eLeapEventType_ConfigChange:
+			HandleConfigChangeEvent(Msg.config_change_event, Msg.device_id);
+			break;
+		case eLeapEventType_ConfigResponse:
+			HandleConfigResponseEvent(Msg.config_response_event, Msg.device_id);
+			break;
+		default:
+			// discard unknown message types
+			// UE_LOG(UltraleapTrackingLog, Log, TEXT("Unhandled message type %i."), (int32)Msg.type);
+			break;
+	}	 // switch on msg.type
 }
 void FLeapWrapper::GetDeviceSerials(TArray<FString>& DeviceSerials)
 {
-	for (auto Device : Devices)
+	for (auto Device : DeviceRegistry.GetDevices())
 	{
 		DeviceSerials.Add(Device->GetDeviceSerial());
 	}
@@ -750,15 +740,7 @@ void FLeapWrapper::GetDeviceSerials(TArray<FString>& DeviceSerials)
 IHandTrackingWrapper* FLeapWrapper::FindAggregator(
 	const TArray<FString>& DeviceSerials, const ELeapDeviceCombinerClass DeviceCombinerClass)
 {
-	IHandTrackingWrapper* Ret = nullptr;
-	for (auto Combiner : CombinedDevices)
-	{
-		if (Combiner->MatchDevices(DeviceSerials, DeviceCombinerClass))
-		{
-			return Combiner;
-		}
-	}
-	return Ret;
+	return DeviceRegistry.FindCombinedDevice(DeviceSerials, DeviceCombinerClass);
 }
 IHandTrackingWrapper* FLeapWrapper::CreateAggregator(
 	const TArray<FString>& DeviceSerials, const ELeapDeviceCombinerClass DeviceCombinerClass)
@@ -771,6 +753,7 @@ IHandTrackingWrapper* FLeapWrapper::CreateAggregator(
 		return Ret;
 	}
 	TArray<IHandTrackingWrapper*> DevicesToCombine;
+	TArray<FString> MissingSerials;
 	for (auto DeviceSerial : DeviceSerials)
 	{
 		auto DeviceWrapper = GetSingularDeviceBySerial(DeviceSerial);
@@ -778,12 +761,18 @@ IHandTrackingWrapper* FLeapWrapper::CreateAggregator(
 		{
 			DevicesToCombine.Add(DeviceWrapper);
 		}
+		else
+		{
+			MissingSerials.Add(DeviceSerial);
+		}
 	}
 	Ret = new FDeviceCombiner(ConnectionHandle, this, DevicesToCombine, DeviceCombinerClass);
 	if (Ret)
 	{
 		UE_LOG(UltraleapTrackingLog, Log, TEXT("Created new aggregator"));
-		CombinedDevices.Add(Ret);
+		// keyed by the requested serials so a missing device doesn't create a new aggregator every lookup, it is
+		// rebuilt when the missing device connects
+		DeviceRegistry.AddCombinedDevice(Ret, DeviceSerials, DeviceCombinerClass, MissingSerials);
 		//NotifyDeviceAdded(Ret);
 	}
 	return Ret;
@@ -791,99 +780,100 @@ IHandTrackingWrapper* FLeapWrapper::CreateAggregator(
 // gets a singular device from the real devices
 IHandTrackingWrapper* FLeapWrapper::GetSingularDeviceBySerial(const FString& DeviceSerial)
 {
+	return DeviceRegistry.FindDeviceBySerial(DeviceSerial);
+}
+IHandTrackingWrapper* FLeapWrapper::GetFallbackDevice(const bool AllowOpenXR)
+{
+	const TArray<IHandTrackingWrapper*>& Devices = DeviceRegistry.GetDevices();
+	if (!Devices.Num())
+	{
+		return nullptr;
+	}
+	// fallback device is the first non OpenXR device
+	// as OpenXR devices are created at startup these are the first ones in the list
 	for (auto Device : Devices)
 	{
-		if (Device->GetDeviceSerial() == DeviceSerial)
+		if (Device->GetDeviceType() == IHandTrackingWrapper::DEVICE_TYPE_OPENXR && !AllowOpenXR)
 		{
-			return Device;
+			continue;
 		}
+		else if (AllowOpenXR && Device->GetDeviceType() != IHandTrackingWrapper::DEVICE_TYPE_OPENXR)
+		{
+			continue;
+		}
+		return Device;
 	}
-	return nullptr;
+	// if none found specific to the OpenXR flag, just return the zeroth device
+	return Devices[0];
 }
 // gets a device, finds or creates combined device
 IHandTrackingWrapper* FLeapWrapper::GetDevice(
 	const TArray<FString>& DeviceSerials, const ELeapDeviceCombinerClass DeviceCombinerClass, const bool AllowOpenXR)
 {
-	IHandTrackingWrapper* Ret = nullptr;
-	if (DeviceSerials.Num() == 0 && Devices.Num())
+	if (DeviceSerials.Num() == 0)
 	{
-		// fallback device is the first non OpenXR device
-		// as OpenXR devices are created at startup these are the first ones in the list
-		for (auto Device : Devices)
-		{
-			if (Device->GetDeviceType() == IHandTrackingWrapper::DEVICE_TYPE_OPENXR && !AllowOpenXR)
-			{
-				continue;
-			}
-			else if (AllowOpenXR && Device->GetDeviceType() != IHandTrackingWrapper::DEVICE_TYPE_OPENXR)
-			{
-				continue;
-			}
-			return Device;
-		}
-		// if none found specific to the OpenXR flag, just return the zeroth device
-		return Devices[0];
+		return GetFallbackDevice(AllowOpenXR);
 	}
-
-
 	// singular mode, find the device
 	if (DeviceSerials.Num() == 1)
 	{
-		for (auto Device : Devices)
-		{
-			if (DeviceSerials.Contains(Device->GetDeviceSerial()))
-			{
-				Ret = Device;
-				break;
-			}
-		}
+		return GetSingularDeviceBySerial(DeviceSerials[0]);
 	}
 	// multi mode, create/find aggregator/combiner
-	else if (DeviceSerials.Num() > 1)
+	return CreateAggregator(DeviceSerials, DeviceCombinerClass);
+}
+IHandTrackingWrapper* FLeapWrapper::GetDeviceBySerial(const FString& DeviceSerial, const bool AllowOpenXR)
+{
+	if (DeviceSerial.IsEmpty())
 	{
-		return CreateAggregator(DeviceSerials, DeviceCombinerClass);
+		return GetFallbackDevice(AllowOpenXR);
 	}
-	return Ret;
+	return GetSingularDeviceBySerial(DeviceSerial);
 }
 void FLeapWrapper::TickDevices(const float DeltaTime) 
 {
+	ProcessHotPlugEvents();
+
 	// safe point to cleanup force deleted devices
 	for (auto DeviceToRemove : DevicesToCleanup)
 	{
 		RemoveDevice(DeviceToRemove->GetDeviceID());
 	}
 	DevicesToCleanup.Empty();
-	TArray<IHandTrackingWrapper*> AllDevices;
 
-	// tick real devices first
-	AllDevices.Append(Devices);
-	
-	//UE_LOG(UltraleapTrackingLog, Log, TEXT("Device Count %d"), Devices.Num());
-	
-	AllDevices.Append(CombinedDevices);
-	for (auto Device : AllDevices)
-	{
-		auto InternalDevice = Device->GetDevice();
-		if (InternalDevice)
-		{
-			InternalDevice->Tick(DeltaTime);
-		}
-	}
+	ForEachTickDevice([DeltaTime](IHandTrackingDevice* InternalDevice) { InternalDevice->Tick(DeltaTime); });
 }
 void FLeapWrapper::TickSendControllerEventsOnDevices()
 {
-	TArray<IHandTrackingWrapper*> AllDevices;
-
-	// tick real devices first
-	AllDevices.Append(Devices);
-	AllDevices.Append(CombinedDevices);
+	ForEachTickDevice([](IHandTrackingDevice* InternalDevice) { InternalDevice->SendControllerEvents(); });
+}
+// real devices first, then combined devices
+void FLeapWrapper::ForEachTickDevice(TFunctionRef<void(IHandTrackingDevice*)> Function)
+{
+	const TArray<IHandTrackingWrapper*>& TickList = DeviceRegistry.GetTickList();
+	uint32 RegistryVersion = DeviceRegistry.GetVersion();
+	// so a changed list can be gone over again from the start without ticking a device twice
+	TArray<IHandTrackingWrapper*, TInlineAllocator<16>> Ticked;
 
-	for (auto Device : AllDevices)
+	for (int32 Index = 0; Index < TickList.Num(); Index++)
 	{
+		IHandTrackingWrapper* Device = TickList[Index];
+		if (Ticked.Contains(Device))
+		{
+			continue;
+		}
+		Ticked.Add(Device);
 		auto InternalDevice = Device->GetDevice();
 		if (InternalDevice)
 		{
-			InternalDevice->SendControllerEvents();
+			Function(InternalDevice);
+		}
+		// a delegate added or removed a device (e.g. created an aggregator, or the device removed itself), go over the new
+		// list again, skipping the devices already ticked
+		if (RegistryVersion != DeviceRegistry.GetVersion())
+		{
+			RegistryVersion = DeviceRegistry.GetVersion();
+			Index = INDEX_NONE;
 		}
 	}
 }
@@ -932,20 +922,34 @@ void FLeapWrapper::CleanupCombinedDevicesReferencingDevice(IHandTrackingWrapper*
 {
 	TArray<IHandTrackingWrapper*> CombinedDevicesToCleanup;
 	// make sure any aggregated/combined devices that reference the removed device get cleaned up
-	for (auto CombinedDevice : CombinedDevices)
+	for (auto CombinedDevice : DeviceRegistry.GetCombinedDevices())
 	{
 		if (CombinedDevice->ContainsDevice(Device))
 		{
 			CombinedDevicesToCleanup.Add(CombinedDevice);
 		}
 	}
+	DestroyCombinedDevices(CombinedDevicesToCleanup);
+}
+void FLeapWrapper::CleanupCombinedDevicesMissingDevice(IHandTrackingWrapper* Device)
+{
+	TArray<IHandTrackingWrapper*> CombinedDevicesToCleanup;
+	DeviceRegistry.FindCombinedDevicesMissing(Device->GetDeviceSerial(), CombinedDevicesToCleanup);
 	for (auto CombinedDevice : CombinedDevicesToCleanup)
 	{
-		CombinedDevices.Remove(CombinedDevice);
+		UE_LOG(UltraleapTrackingLog, Log, TEXT("Rebuilding aggregator %s now %s is connected."),
+			*CombinedDevice->GetDeviceSerial(), *(Device->GetDeviceSerial().Right(4)));
+	}
+	DestroyCombinedDevices(CombinedDevicesToCleanup);
+}
+void FLeapWrapper::DestroyCombinedDevices(const TArray<IHandTrackingWrapper*>& CombinedDevices)
+{
+	for (auto CombinedDevice : CombinedDevices)
+	{
+		DeviceRegistry.RemoveDevice(CombinedDevice);
 		NotifyDeviceRemoved(CombinedDevice);
 		delete CombinedDevice;
 	}
-
 }
 void FLeapWrapper::CleanupBadDevice(IHandTrackingWrapper* DeviceWrapper)
 {
@@ -967,8 +971,9 @@ void FLeapWrapper::AddOpenXRDevice(LeapWrapperCallbackInterface* InCallbackDeleg
 	{
 		InCallbackDelegate->OnConnect();
 	}
-	Devices.Add(Device);
+	DeviceRegistry.AddDevice(Device);
 
+	CleanupCombinedDevicesMissingDevice(Device);
 	NotifyDeviceAdded(Device);
 	UE_LOG(
 		UltraleapTrackingLog, Log, TEXT("Add OpenXR Device %s %d."), *(Device->GetDeviceSerial()), Device->GetDeviceID());
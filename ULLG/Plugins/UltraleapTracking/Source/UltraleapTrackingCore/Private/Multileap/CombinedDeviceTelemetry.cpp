@@ -0,0 +1,226 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+
+#include "CombinedDeviceTelemetry.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "LeapUtility.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "UltraleapTrackingData.h"
+
+DEFINE_STAT(STAT_UltraleapCombineFrame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fused Source Hands"), STAT_UltraleapFusedHands, STATGROUP_UltraleapFusion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected Source Hands"), STAT_UltraleapRejectedHands, STATGROUP_UltraleapFusion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hand Swaps"), STAT_UltraleapHandSwaps, STATGROUP_UltraleapFusion);
+
+CSV_DEFINE_CATEGORY(UltraleapFusion, false);
+
+int32 FCombinedDeviceTelemetry::Enabled = 0;
+
+static FAutoConsoleVariableRef CVarUltraleapFusionTelemetry(TEXT("leap.FusionTelemetry"),
+	FCombinedDeviceTelemetry::Enabled,
+	TEXT("Record per source device confidences, fusion weights, hand swaps and combine times from combined devices.\n")
+	TEXT("0: off (default), 1: on"));
+
+static FAutoConsoleCommand CmdUltraleapDumpFusionTelemetry(TEXT("leap.DumpFusionTelemetry"),
+	TEXT("Writes the recorded combined device telemetry to a csv in the profiling directory. Optional file name argument"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+		const FString FileName = Args.Num() > 0 ? Args[0]
+												: FString::Printf(TEXT("FusionTelemetry-%s.csv"), *FDateTime::Now().ToString());
+		FCombinedDeviceTelemetry::Get().DumpToFile(FPaths::ProfilingDir() / TEXT("UltraleapFusion") / FileName);
+	}));
+
+namespace
+{
+const TCHAR* GetEventName(const ECombinedDeviceTelemetryEvent Event)
+{
+	switch (Event)
+	{
+		case ECombinedDeviceTelemetryEvent::Contribution:
+			return TEXT("Contribution");
+		case ECombinedDeviceTelemetryEvent::HandSwap:
+			return TEXT("HandSwap");
+		case ECombinedDeviceTelemetryEvent::CombineTime:
+			return TEXT("CombineTime");
+	}
+	return TEXT("Unknown");
+}
+const TCHAR* GetHandName(const uint8 HandType)
+{
+	return HandType == EHandType::LEAP_HAND_LEFT ? TEXT("Left") : TEXT("Right");
+}
+}	 // namespace
+
+FCombinedDeviceTelemetry& FCombinedDeviceTelemetry::Get()
+{
+	static FCombinedDeviceTelemetry Telemetry;
+	return Telemetry;
+}
+FCombinedDeviceTelemetry::FCombinedDeviceTelemetry()
+{
+	Slots.SetNum(Capacity);
+}
+void FCombinedDeviceTelemetry::AddRecord(const FCombinedDeviceTelemetryRecord& Record)
+{
+	const int64 Index = WriteCount.Increment() - 1;
+	FSlot& Slot = Slots[Index & (Capacity - 1)];
+
+	// readers skip slots whose sequence doesn't match the record they expect either side of the copy
+	FPlatformAtomics::InterlockedExchange(&Slot.Sequence, -1);
+	Slot.Record = Record;
+	Slot.Record.Time = FPlatformTime::Seconds();
+	FPlatformAtomics::InterlockedExchange(&Slot.Sequence, Index);
+
+	if (Record.Event == ECombinedDeviceTelemetryEvent::Contribution)
+	{
+		INC_DWORD_STAT(STAT_UltraleapFusedHands);
+		if (Record.bRejected)
+		{
+			INC_DWORD_STAT(STAT_UltraleapRejectedHands);
+		}
+	}
+	else if (Record.Event == ECombinedDeviceTelemetryEvent::HandSwap)
+	{
+		INC_DWORD_STAT(STAT_UltraleapHandSwaps);
+	}
+	RecordCsvStats(Record);
+}
+void FCombinedDeviceTelemetry::RecordCombineTime(const int32 CombinerID, const float CombineTimeMS)
+{
+	FCombinedDeviceTelemetryRecord Record;
+	Record.CombinerID = CombinerID;
+	Record.Event = ECombinedDeviceTelemetryEvent::CombineTime;
+	Record.CombineTimeMS = CombineTimeMS;
+	AddRecord(Record);
+}
+void FCombinedDeviceTelemetry::RecordCsvStats(const FCombinedDeviceTelemetryRecord& Record)
+{
+#if CSV_PROFILER
+	FCsvProfiler* CsvProfiler = FCsvProfiler::Get();
+	if (!CsvProfiler || !CsvProfiler->IsCapturing())
+	{
+		return;
+	}
+	const uint32 CategoryIndex = CSV_CATEGORY_INDEX(UltraleapFusion);
+	switch (Record.Event)
+	{
+		case ECombinedDeviceTelemetryEvent::Contribution:
+		{
+			const FString Prefix = FString::Printf(
+				TEXT("Combiner%d_Device%d_%s_"), Record.CombinerID, Record.SourceIndex, GetHandName(Record.HandType));
+			FCsvProfiler::RecordCustomStat(FName(*(Prefix + TEXT("Weight"))), CategoryIndex, Record.Weight, ECsvCustomStatOp::Set);
+			FCsvProfiler::RecordCustomStat(
+				FName(*(Prefix + TEXT("Confidence"))), CategoryIndex, Record.Confidence, ECsvCustomStatOp::Set);
+			if (Record.bRejected)
+			{
+				FCsvProfiler::RecordCustomStat(FName(*(Prefix + TEXT("Rejected"))), CategoryIndex, 1, ECsvCustomStatOp::Accumulate);
+			}
+			break;
+		}
+		case ECombinedDeviceTelemetryEvent::HandSwap:
+			FCsvProfiler::RecordCustomStat(
+				FName(*FString::Printf(TEXT("Combiner%d_%s_HandSwaps"), Record.CombinerID, GetHandName(Record.HandType))),
+				CategoryIndex, 1, ECsvCustomStatOp::Accumulate);
+			break;
+		case ECombinedDeviceTelemetryEvent::CombineTime:
+			FCsvProfiler::RecordCustomStat(FName(*FString::Printf(TEXT("Combiner%d_CombineTimeMS"), Record.CombinerID)),
+				CategoryIndex, Record.CombineTimeMS, ECsvCustomStatOp::Set);
+			break;
+	}
+#endif
+}
+void FCombinedDeviceTelemetry::GetRecords(TArray<FCombinedDeviceTelemetryRecord>& OutRecords) const
+{
+	const int64 End = WriteCount.GetValue();
+	const int64 Start = FMath::Max<int64>(0, End - Capacity);
+
+	OutRecords.Reset(End - Start);
+	for (int64 Index = Start; Index < End; Index++)
+	{
+		const FSlot& Slot = Slots[Index & (Capacity - 1)];
+		if (FPlatformAtomics::AtomicRead(&Slot.Sequence) != Index)
+		{
+			continue;
+		}
+		FCombinedDeviceTelemetryRecord Record = Slot.Record;
+		FPlatformMisc::MemoryBarrier();
+		// overwritten while copying
+		if (FPlatformAtomics::AtomicRead(&Slot.Sequence) != Index)
+		{
+			continue;
+		}
+		OutRecords.Add(Record);
+	}
+}
+bool FCombinedDeviceTelemetry::DumpToFile(const FString& FileName) const
+{
+	TArray<FCombinedDeviceTelemetryRecord> Records;
+	GetRecords(Records);
+
+	// per combiner, device and hand totals to compare sensor placements at a glance
+	struct FSourceSummary
+	{
+		int32 Count = 0;
+		int32 Rejected = 0;
+		double WeightSum = 0;
+		double ConfidenceSum = 0;
+	};
+	TMap<FString, FSourceSummary> Summaries;
+	TMap<FString, int32> HandSwaps;
+
+	FString Csv = TEXT("Time,Combiner,Event,Hand,Device,PreviousDevice,Rejected,Weight,Confidence,PalmPosition,PalmRotation,")
+				  TEXT("PalmVelocity,TimeVisible,Joints,CombineTimeMS\n");
+	for (const FCombinedDeviceTelemetryRecord& Record : Records)
+	{
+		const FCombinedDeviceConfidenceTerms& Terms = Record.Terms;
+		Csv += FString::Printf(TEXT("%.6f,%d,%s,%s,%d,%d,%d,%f,%f,%f,%f,%f,%f,%f,%f\n"), Record.Time, Record.CombinerID,
+			GetEventName(Record.Event), GetHandName(Record.HandType), Record.SourceIndex, Record.PreviousSourceIndex,
+			Record.bRejected ? 1 : 0, Record.Weight, Record.Confidence, Terms.PalmPosition, Terms.PalmRotation,
+			Terms.PalmVelocity, Terms.TimeVisible, Terms.Joints, Record.CombineTimeMS);
+
+		if (Record.Event == ECombinedDeviceTelemetryEvent::Contribution)
+		{
+			FSourceSummary& Summary = Summaries.FindOrAdd(FString::Printf(
+				TEXT("%d,%d,%s"), Record.CombinerID, Record.SourceIndex, GetHandName(Record.HandType)));
+			Summary.Count++;
+			Summary.Rejected += Record.bRejected ? 1 : 0;
+			Summary.WeightSum += Record.Weight;
+			Summary.ConfidenceSum += Record.Confidence;
+		}
+		else if (Record.Event == ECombinedDeviceTelemetryEvent::HandSwap)
+		{
+			HandSwaps.FindOrAdd(FString::Printf(TEXT("%d,%s"), Record.CombinerID, GetHandName(Record.HandType)))++;
+		}
+	}
+
+	Csv += TEXT("\nCombiner,Device,Hand,Frames,Rejected,MeanWeight,MeanConfidence\n");
+	for (const auto& Pair : Summaries)
+	{
+		const FSourceSummary& Summary = Pair.Value;
+		Csv += FString::Printf(TEXT("%s,%d,%d,%f,%f\n"), *Pair.Key, Summary.Count, Summary.Rejected,
+			Summary.WeightSum / Summary.Count, Summary.ConfidenceSum / Summary.Count);
+	}
+	Csv += TEXT("\nCombiner,Hand,HandSwaps\n");
+	for (const auto& Pair : HandSwaps)
+	{
+		Csv += FString::Printf(TEXT("%s,%d\n"), *Pair.Key, Pair.Value);
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *FileName))
+	{
+		UE_LOG(UltraleapTrackingLog, Warning, TEXT("Failed to write fusion telemetry to %s"), *FileName);
+		return false;
+	}
+	UE_LOG(UltraleapTrackingLog, Log, TEXT("Wrote %d fusion telemetry records to %s"), Records.Num(), *FileName);
+	return true;
+}
@@ -0,0 +1,101 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("UltraleapFusion"), STATGROUP_UltraleapFusion, STATCAT_Advanced);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Combine Frame"), STAT_UltraleapCombineFrame, STATGROUP_UltraleapFusion, );
+
+enum class ECombinedDeviceTelemetryEvent : uint8
+{
+	// A source hand's confidence terms and the weight it was fused with
+	Contribution,
+	// The most heavily weighted source device for a hand changed
+	HandSwap,
+	// Time taken by one CombineFrame call
+	CombineTime
+};
+
+// Confidence terms for one source hand, before the combiner's factors are applied
+struct FCombinedDeviceConfidenceTerms
+{
+	float PalmPosition = 0;
+	float PalmRotation = 0;
+	float PalmVelocity = 0;
+	float TimeVisible = 1;
+	float Joints = 0;
+};
+
+struct FCombinedDeviceTelemetryRecord
+{
+	double Time = 0;
+	int32 CombinerID = 0;
+	ECombinedDeviceTelemetryEvent Event = ECombinedDeviceTelemetryEvent::Contribution;
+	uint8 HandType = 0;
+	// Source device index in the combiner, the new dominant device for hand swaps
+	int8 SourceIndex = INDEX_NONE;
+	// Previous dominant device for hand swaps
+	int8 PreviousSourceIndex = INDEX_NONE;
+	bool bRejected = false;
+
+	// Normalised fusion weight
+	float Weight = 0;
+	// Overall hand confidence before normalisation
+	float Confidence = 0;
+	FCombinedDeviceConfidenceTerms Terms;
+	float CombineTimeMS = 0;
+};
+
+/**
+ * Fusion telemetry from the device combiners, enabled with leap.FusionTelemetry 1. Combiners can record from any thread
+ * into a fixed size ring, old records are overwritten. Records also feed STATGROUP_UltraleapFusion and, while a CSV
+ * capture is running, the UltraleapFusion CSV category. leap.DumpFusionTelemetry writes the ring to a file.
+ */
+class FCombinedDeviceTelemetry
+{
+public:
+	static FCombinedDeviceTelemetry& Get();
+
+	// Check before building records, everything else is skipped when disabled
+	static bool IsEnabled()
+	{
+		return Enabled != 0;
+	}
+	// Backs leap.FusionTelemetry
+	static int32 Enabled;
+
+	// Source hands with a weight below this count as rejected
+	static constexpr float RejectedWeight = 0.01f;
+
+	void AddRecord(const FCombinedDeviceTelemetryRecord& Record);
+	void RecordCombineTime(const int32 CombinerID, const float CombineTimeMS);
+
+	// Oldest first
+	void GetRecords(TArray<FCombinedDeviceTelemetryRecord>& OutRecords) const;
+	bool DumpToFile(const FString& FileName) const;
+
+private:
+	static constexpr int32 Capacity = 8192;
+	struct FSlot
+	{
+		// Index of the record in the slot, -1 while being written
+		volatile int64 Sequence = -1;
+		FCombinedDeviceTelemetryRecord Record;
+	};
+	TArray<FSlot> Slots;
+	FThreadSafeCounter64 WriteCount;
+
+	FCombinedDeviceTelemetry();
+
+	void RecordCsvStats(const FCombinedDeviceTelemetryRecord& Record);
+};
@@ -12,6 +12,7 @@
 #include "FUltraleapCombinedDevice.h"
 #include "FUltraleapCombinedDeviceAngular.h"
 #include "FUltraleapCombinedDeviceConfidence.h"
+#include "FUltraleapCombinedDeviceKalman.h"
 #include "Runtime/Core/Public/Misc/Timespan.h"
 
 #pragma region Combiner
@@ -50,6 +51,12 @@ FDeviceCombiner::FDeviceCombiner(const LEAP_CONNECTION ConnectionHandleIn, IHand
 				(IHandTrackingWrapper*) this, (ITrackingDeviceWrapper*) this, DevicesToCombineIn);
 			break;
 		}
+		case ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_KALMAN:
+		{
+			Device = MakeShared<FUltraleapCombinedDeviceKalman>(
+				(IHandTrackingWrapper*) this, (ITrackingDeviceWrapper*) this, DevicesToCombineIn);
+			break;
+		}
 		default:
 			Device = MakeShared<FUltraleapCombinedDeviceConfidence>(
 				(IHandTrackingWrapper*) this, (ITrackingDeviceWrapper*) this, DevicesToCombineIn);
@@ -58,6 +65,12 @@ FDeviceCombiner::FDeviceCombiner(const LEAP_CONNECTION ConnectionHandleIn, IHand
 
 FDeviceCombiner::~FDeviceCombiner()
 {
+	// the combine task may still be running against the device
+	if (Device.IsValid())
+	{
+		static_cast<FUltraleapCombinedDevice*>(Device.Get())->WaitForCombine();
+	}
+
 	delete DataLock;
 	DataLock = nullptr;
 	
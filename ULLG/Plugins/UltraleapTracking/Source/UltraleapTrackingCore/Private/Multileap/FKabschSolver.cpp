@@ -139,4 +139,318 @@ void FKabschSolver::TransposeMult(
 			}
 		}
 	}
-}
\ No newline at end of file
+}
+namespace
+{
+// Cyclic Jacobi eigen decomposition of a symmetric 4x4 matrix, eigenvectors are returned in the columns of V
+void JacobiEigen4(double A[4][4], double V[4][4])
+{
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			V[i][j] = i == j ? 1.0 : 0.0;
+		}
+	}
+
+	for (int Sweep = 0; Sweep < 32; Sweep++)
+	{
+		double OffDiagonal = 0.0;
+		double Diagonal = 0.0;
+		for (int p = 0; p < 4; p++)
+		{
+			Diagonal += A[p][p] * A[p][p];
+			for (int q = p + 1; q < 4; q++)
+			{
+				OffDiagonal += A[p][q] * A[p][q];
+			}
+		}
+		if (OffDiagonal <= 1e-24 * FMath::Max(Diagonal, 1e-30))
+		{
+			break;
+		}
+
+		for (int p = 0; p < 4; p++)
+		{
+			for (int q = p + 1; q < 4; q++)
+			{
+				if (FMath::Abs(A[p][q]) < 1e-300)
+				{
+					continue;
+				}
+				// Rotation zeroing A[p][q], applied as A = J^T A J and V = V J
+				const double Theta = (A[q][q] - A[p][p]) / (2.0 * A[p][q]);
+				const double T = (Theta >= 0.0 ? 1.0 : -1.0) / (FMath::Abs(Theta) + FMath::Sqrt(Theta * Theta + 1.0));
+				const double C = 1.0 / FMath::Sqrt(T * T + 1.0);
+				const double S = T * C;
+
+				for (int k = 0; k < 4; k++)
+				{
+					const double Akp = A[k][p];
+					const double Akq = A[k][q];
+					A[k][p] = C * Akp - S * Akq;
+					A[k][q] = S * Akp + C * Akq;
+				}
+				for (int k = 0; k < 4; k++)
+				{
+					const double Apk = A[p][k];
+					const double Aqk = A[q][k];
+					A[p][k] = C * Apk - S * Aqk;
+					A[q][k] = S * Apk + C * Aqk;
+				}
+				for (int k = 0; k < 4; k++)
+				{
+					const double Vkp = V[k][p];
+					const double Vkq = V[k][q];
+					V[k][p] = C * Vkp - S * Vkq;
+					V[k][q] = S * Vkp + C * Vkq;
+				}
+			}
+		}
+	}
+}
+
+// Horn's closed form: the rotation taking centred points a onto b is the eigenvector with the largest eigenvalue of
+// the symmetric 4x4 matrix built from M = sum(w * a * b^T)
+FQuat SolveRotationHorn(const double M[3][3])
+{
+	const double Sxx = M[0][0], Sxy = M[0][1], Sxz = M[0][2];
+	const double Syx = M[1][0], Syy = M[1][1], Syz = M[1][2];
+	const double Szx = M[2][0], Szy = M[2][1], Szz = M[2][2];
+
+	double N[4][4] = {
+		{Sxx + Syy + Szz, Syz - Szy, Szx - Sxz, Sxy - Syx},
+		{Syz - Szy, Sxx - Syy - Szz, Sxy + Syx, Szx + Sxz},
+		{Szx - Sxz, Sxy + Syx, -Sxx + Syy - Szz, Syz + Szy},
+		{Sxy - Syx, Szx + Sxz, Syz + Szy, -Sxx - Syy + Szz}};
+	double V[4][4];
+	JacobiEigen4(N, V);
+
+	int Largest = 0;
+	for (int i = 1; i < 4; i++)
+	{
+		if (N[i][i] > N[Largest][Largest])
+		{
+			Largest = i;
+		}
+	}
+	// eigenvector is (w, x, y, z)
+	FQuat Result(V[1][Largest], V[2][Largest], V[3][Largest], V[0][Largest]);
+	if (Result.SizeSquared() < SMALL_NUMBER)
+	{
+		return FQuat::Identity;
+	}
+	Result.Normalize();
+	return Result;
+}
+}	 // namespace
+
+FTransform FKabschSolver::Solve(const TArray<FVector>& InPoints, const TArray<FVector>& RefPoints, const TArray<float>& Weights,
+	const FKabschSolverOptions& Options)
+{
+	InlierCount = 0;
+	RMSError = 0.0f;
+
+	const int32 NumPoints = InPoints.Num();
+	if (NumPoints == 0 || NumPoints != RefPoints.Num() || (Weights.Num() > 0 && Weights.Num() != NumPoints))
+	{
+		return FTransform::Identity;
+	}
+
+	BaseWeights.SetNumUninitialized(NumPoints);
+	for (int32 i = 0; i < NumPoints; i++)
+	{
+		BaseWeights[i] = Weights.Num() > 0 ? FMath::Max(Weights[i], 0.0f) : 1.0f;
+	}
+	WorkingWeights = BaseWeights;
+
+	const float Threshold = FMath::Max(Options.InlierThreshold, KINDA_SMALL_NUMBER);
+	FTransform Result = SolveWeighted(InPoints, RefPoints, WorkingWeights, Options, Options.bUseClosedForm);
+
+	if (Options.OutlierRejection == EKabschOutlierRejection::IRLS)
+	{
+		for (int32 Iteration = 0; Iteration < Options.IRLSIterations; Iteration++)
+		{
+			// Cauchy weights, a point at the threshold counts half
+			CalculateResiduals(Result, InPoints, RefPoints);
+			for (int32 i = 0; i < NumPoints; i++)
+			{
+				const float Ratio = Residuals[i] / Threshold;
+				WorkingWeights[i] = BaseWeights[i] / (1.0f + Ratio * Ratio);
+			}
+			const FTransform Refined = SolveWeighted(InPoints, RefPoints, WorkingWeights, Options, Options.bUseClosedForm);
+			const bool bConverged = Refined.Equals(Result, 1e-4f);
+			Result = Refined;
+			if (bConverged)
+			{
+				break;
+			}
+		}
+	}
+	else if (Options.OutlierRejection == EKabschOutlierRejection::RANSAC && NumPoints > 3)
+	{
+		FRandomStream Stream(Options.RandomSeed);
+		float BestScore = -1.0f;
+		FTransform BestHypothesis = Result;
+
+		for (int32 Iteration = 0; Iteration < Options.RANSACIterations; Iteration++)
+		{
+			// Minimal set, three distinct weighted points which aren't collinear
+			const int32 A = Stream.RandHelper(NumPoints);
+			const int32 B = Stream.RandHelper(NumPoints);
+			const int32 C = Stream.RandHelper(NumPoints);
+			if (A == B || B == C || A == C || BaseWeights[A] <= 0.0f || BaseWeights[B] <= 0.0f || BaseWeights[C] <= 0.0f)
+			{
+				continue;
+			}
+			const FVector Normal = FVector::CrossProduct(InPoints[B] - InPoints[A], InPoints[C] - InPoints[A]);
+			const float MinArea = Threshold * Threshold;
+			if (Normal.SizeSquared() < MinArea * MinArea)
+			{
+				continue;
+			}
+
+			FMemory::Memzero(WorkingWeights.GetData(), NumPoints * sizeof(float));
+			WorkingWeights[A] = WorkingWeights[B] = WorkingWeights[C] = 1.0f;
+			const FTransform Hypothesis = SolveWeighted(InPoints, RefPoints, WorkingWeights, Options, true);
+
+			CalculateResiduals(Hypothesis, InPoints, RefPoints);
+			float Score = 0.0f;
+			for (int32 i = 0; i < NumPoints; i++)
+			{
+				if (Residuals[i] < Threshold)
+				{
+					Score += BaseWeights[i];
+				}
+			}
+			if (Score > BestScore)
+			{
+				BestScore = Score;
+				BestHypothesis = Hypothesis;
+			}
+		}
+
+		// Refit to the consensus set with the caller's weights
+		if (BestScore > 0.0f)
+		{
+			CalculateResiduals(BestHypothesis, InPoints, RefPoints);
+			for (int32 i = 0; i < NumPoints; i++)
+			{
+				WorkingWeights[i] = Residuals[i] < Threshold ? BaseWeights[i] : 0.0f;
+			}
+			Result = SolveWeighted(InPoints, RefPoints, WorkingWeights, Options, Options.bUseClosedForm);
+		}
+	}
+
+	// Final stats against the caller's weights
+	CalculateResiduals(Result, InPoints, RefPoints);
+	double SquaredError = 0.0;
+	double WeightSum = 0.0;
+	for (int32 i = 0; i < NumPoints; i++)
+	{
+		if (BaseWeights[i] <= 0.0f)
+		{
+			continue;
+		}
+		SquaredError += BaseWeights[i] * Residuals[i] * Residuals[i];
+		WeightSum += BaseWeights[i];
+		if (Residuals[i] < Threshold)
+		{
+			InlierCount++;
+		}
+	}
+	RMSError = WeightSum > 0.0 ? FMath::Sqrt(SquaredError / WeightSum) : 0.0f;
+
+	return Result;
+}
+
+FTransform FKabschSolver::SolveWeighted(const TArray<FVector>& InPoints, const TArray<FVector>& RefPoints,
+	const TArray<float>& Weights, const FKabschSolverOptions& Options, const bool bUseClosedForm)
+{
+	// Weighted centroids
+	double WeightSum = 0.0;
+	int32 NumWeighted = 0;
+	FVector InCentroid = FVector::ZeroVector;
+	FVector RefCentroid = FVector::ZeroVector;
+	for (int32 i = 0; i < InPoints.Num(); i++)
+	{
+		if (Weights[i] <= 0.0f)
+		{
+			continue;
+		}
+		InCentroid += InPoints[i] * Weights[i];
+		RefCentroid += RefPoints[i] * Weights[i];
+		WeightSum += Weights[i];
+		NumWeighted++;
+	}
+	if (WeightSum <= SMALL_NUMBER)
+	{
+		return FTransform::Identity;
+	}
+	InCentroid /= WeightSum;
+	RefCentroid /= WeightSum;
+
+	// Weighted covariance M = sum(w * a * b^T) of the centred points, and the spread for the scale ratio
+	double M[3][3] = {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+	double InScale = 0.0;
+	double RefScale = 0.0;
+	for (int32 i = 0; i < InPoints.Num(); i++)
+	{
+		const float W = Weights[i];
+		if (W <= 0.0f)
+		{
+			continue;
+		}
+		const FVector A = InPoints[i] - InCentroid;
+		const FVector B = RefPoints[i] - RefCentroid;
+		for (int Row = 0; Row < 3; Row++)
+		{
+			for (int Col = 0; Col < 3; Col++)
+			{
+				M[Row][Col] += W * A[Row] * B[Col];
+			}
+		}
+		InScale += W * A.Size();
+		RefScale += W * B.Size();
+	}
+
+	float Scale = 1.0f;
+	if (Options.bSolveScale && NumWeighted > 1 && InScale > SMALL_NUMBER)
+	{
+		Scale = RefScale / InScale;
+	}
+
+	FQuat Rotation = FQuat::Identity;
+	if (NumWeighted > 1)
+	{
+		if (bUseClosedForm)
+		{
+			Rotation = SolveRotationHorn(M);
+		}
+		else
+		{
+			for (int Row = 0; Row < 3; Row++)
+			{
+				DataCovariance[Row] = FVector(M[Row][0], M[Row][1], M[Row][2]);
+			}
+			// warm started from the previous solve
+			ExtractRotation(DataCovariance, OptimalRotation, Options.OptimalRotationIterations);
+			Rotation = OptimalRotation;
+		}
+	}
+	OptimalRotation = Rotation;
+	ScaleRatio = Scale;
+
+	// p' = R * (s * p) + T, with the centroids mapping onto each other
+	Translation = RefCentroid - Rotation.RotateVector(InCentroid * Scale);
+	return FTransform(Rotation, Translation, FVector(Scale));
+}
+
+void FKabschSolver::CalculateResiduals(const FTransform& Transform, const TArray<FVector>& InPoints, const TArray<FVector>& RefPoints)
+{
+	Residuals.SetNumUninitialized(InPoints.Num());
+	for (int32 i = 0; i < InPoints.Num(); i++)
+	{
+		Residuals[i] = FVector::Distance(Transform.TransformPosition(InPoints[i]), RefPoints[i]);
+	}
+}
@@ -27,6 +27,31 @@ public:
 	}
 };
 
+enum class EKabschOutlierRejection : uint8
+{
+	None,
+	// Iteratively reweighted least squares, points are down weighted by their residual each pass
+	IRLS,
+	// Fit to random minimal sets, keep the largest consensus set and refit to it
+	RANSAC
+};
+
+struct FKabschSolverOptions
+{
+	// Closed form quaternion (Horn) rotation, otherwise the iterative ExtractRotation
+	bool bUseClosedForm = true;
+	int32 OptimalRotationIterations = 9;
+	bool bSolveScale = false;
+
+	EKabschOutlierRejection OutlierRejection = EKabschOutlierRejection::None;
+	// Residual distance above which a point is an outlier (RANSAC) or where its IRLS weight has halved
+	float InlierThreshold = 1.0f;
+	int32 IRLSIterations = 8;
+	int32 RANSACIterations = 64;
+	// Fixed seed so the same input always gives the same result
+	int32 RandomSeed = 0;
+};
+
 class FKabschSolver
 {
 public:
@@ -36,11 +61,25 @@ public:
 		const int OptimalRotationIterations = 9,
 		const bool SolveScale = false);
 
+	// Weighted solve for the transform taking InPoints onto RefPoints, Weights may be empty for equal weights
+	FTransform Solve(const TArray<FVector>& InPoints, const TArray<FVector>& RefPoints, const TArray<float>& Weights,
+		const FKabschSolverOptions& Options);
+
 	FVector& GetTranslation()
 	{
 		return Translation;
 	}
 
+	// Results of the last Solve
+	int32 GetInlierCount() const
+	{
+		return InlierCount;
+	}
+	float GetRMSError() const
+	{
+		return RMSError;
+	}
+
 protected:
 		// https://animation.rwth-aachen.de/media/papers/2016-MIG-StableRotation.pdf
 		void ExtractRotation(const TArray<FVector>& A, FQuat& Q, const int OptimalRotationIterations = 9);
@@ -48,9 +87,19 @@ protected:
 private:
 	// Calculate Covariance Matrices --------------------------------------------------
 	void TransposeMult(const TArray<FVector>& Vec1, const TArray<FVector>& Vec2, TArray<FVector>& Covariance);
-	
 
-	
+	FTransform SolveWeighted(const TArray<FVector>& InPoints, const TArray<FVector>& RefPoints, const TArray<float>& Weights,
+		const FKabschSolverOptions& Options, const bool bUseClosedForm);
+	void CalculateResiduals(const FTransform& Transform, const TArray<FVector>& InPoints, const TArray<FVector>& RefPoints);
+
+	// Scratch, kept between solves to avoid reallocating
+	TArray<float> BaseWeights;
+	TArray<float> WorkingWeights;
+	TArray<float> Residuals;
+
+	int32 InlierCount = 0;
+	float RMSError = 0.0f;
+
 	TArray<FVector> DataCovariance;
 	FVector Translation = FVector::ZeroVector;
 	FQuat OptimalRotation = FQuat::Identity;
@@ -8,21 +8,29 @@
 
 #include "FUltraleapCombinedDevice.h"
 
+#include "CombinedDeviceTelemetry.h"
+#include "LeapLatencyTracer.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Skipped Combines"), STAT_UltraleapSkippedCombines, STATGROUP_UltraleapFusion);
+
 int FUltraleapCombinedDevice::HandID = 0;
 
 
 
+
 FUltraleapCombinedDevice::FUltraleapCombinedDevice(IHandTrackingWrapper* LeapDeviceWrapper,
 	ITrackingDeviceWrapper* TrackingDeviceWrapperIn, TArray<IHandTrackingWrapper*> DevicesToCombineIn) : 
 	FUltraleapDevice(LeapDeviceWrapper, TrackingDeviceWrapperIn),
-	DevicesToCombine(DevicesToCombineIn)
+	DevicesToCombine(DevicesToCombineIn),
+	CombinerID(++HandID),
+	LatestCombinedFrame(MakeShared<FLeapFrameData, ESPMode::ThreadSafe>())
 {
-	// static
-	++HandID;
 }
 
 FUltraleapCombinedDevice::~FUltraleapCombinedDevice()
 {
+	// the owner should have already waited, CombineFrame is virtual and the derived combiner is gone by now
+	check(!CombineTask.IsValid() || CombineTask->IsComplete());
 }
 void FUltraleapCombinedDevice::TransformFrame(
 	FLeapFrameData& OutData, const FVector& TranslationOffset, const FRotator& RotationOffset)
@@ -33,70 +41,361 @@ void FUltraleapCombinedDevice::TransformFrame(
 // Main loop event emitter and handler
 void FUltraleapCombinedDevice::SendControllerEvents()
 {
+	const uint32 StartCycles = FPlatformTime::Cycles();
+	// nothing is combined or parsed until a source device sees a hand
+	if (UpdateIdleState(AreSourceHandsPresent()))
+	{
+		UpdateIdleTimeSaved(StartCycles);
+		return;
+	}
+
 	// Create combined frame here and call parse
 	// the parent class will then behave as if it had one device
-	TArray<FLeapFrameData> SourceFrames;
-	FTransform VRDeviceOrigin;
+	const FLeapOptions CombinedOptions = GetOptions();
+
+	if (CombinedOptions.bCombineDevicesAsync)
+	{
+		if (CombineTask.IsValid() && CombineTask->IsComplete())
+		{
+			PickUpCombinedFrame();
+		}
+		// one combine in flight at a time, the combiners keep per frame history
+		if (!CombineTask.IsValid() && HaveSourceDevicesPublished(true))
+		{
+			GatherSourceFrames(CombinedOptions);
+			CombineTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+				[this]() { CombineSourceFrames(); }, TStatId(), nullptr, ENamedThreads::AnyHiPriThreadHiPriTask);
+
+			if (CombinedOptions.bWaitForCombinedFrame)
+			{
+				FTaskGraphInterface::Get().WaitUntilTaskCompletes(CombineTask, ENamedThreads::GameThread_Local);
+				PickUpCombinedFrame();
+			}
+		}
+	}
+	else
+	{
+		// drain a task left over from switching async off
+		WaitForCombine();
+
+		// resampled and HMD transformed source frames change every tick, otherwise only recombine for new source frames
+		const bool bSourcesChangeEveryTick = CombinedOptions.bTimeAlignCombinedDevices || CombineJob.bAnyVR;
+		if (!CombinedOptions.bSkipUnchangedFrames || bSourcesChangeEveryTick || HaveSourceDevicesPublished(false))
+		{
+			GatherSourceFrames(CombinedOptions);
+			CombineSourceFrames();
+			PickUpCombinedFrame();
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_UltraleapSkippedCombines);
+		}
+	}
+
+	EFrameChange Change = EFrameChange::NewFrame;
+	if (CombinedOptions.bSkipUnchangedFrames && !bCombinedFrameChanged)
+	{
+		Change = NeedsPerTickTransform() ? EFrameChange::Transform : EFrameChange::None;
+	}
+	bCombinedFrameChanged = false;
+
+	// ParseEvents transforms CurrentFrame in place, so it is only reset from the combined frame when reparsed. Without
+	// those transforms the combined frame is published as is
+	if (Change != EFrameChange::None)
+	{
+		if (ParseTransformsFrame())
+		{
+			BeginFrameParse();
+			*CurrentFrame = *LatestCombinedFrame;
+		}
+		else
+		{
+			CurrentFrame = LatestCombinedFrame;
+		}
+		FrameCaptureTime = LatestCombinedCaptureTime;
+		if (FLeapLatencyTracer::IsEnabled() && FrameCaptureTime > 0)
+		{
+			FLeapLatencyTracer::Get().Record(ELeapLatencyStage::Consume, FrameCaptureTime);
+		}
+	}
+	ParseEvents(Change);
+
+	UpdateIdleTimeSaved(StartCycles);
+}
+void FUltraleapCombinedDevice::WaitForCombine()
+{
+	if (CombineTask.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(CombineTask);
+		PickUpCombinedFrame();
+	}
+}
+void FUltraleapCombinedDevice::CombineRecordedFrames(
+	const TArray<FLeapFrameData>& SourceFrames, const FLeapOptions& CombinedOptions, FLeapFrameData& OutCombinedFrame)
+{
+	TArray<FLeapFrameSnapshot> Snapshots;
+	for (const FLeapFrameData& SourceFrame : SourceFrames)
+	{
+		Snapshots.Add(MakeShared<FLeapFrameData, ESPMode::ThreadSafe>(SourceFrame));
+	}
+	CombineRecordedFrames(Snapshots, CombinedOptions, OutCombinedFrame);
+}
+void FUltraleapCombinedDevice::CombineRecordedFrames(
+	const TArray<FLeapFrameSnapshot>& SourceFrames, const FLeapOptions& CombinedOptions, FLeapFrameData& OutCombinedFrame)
+{
+	WaitForCombine();
+
+	CombineJob.SourceFrames = SourceFrames;
+	CombineJob.SourceDeviceOrigins.Reset(DevicesToCombine.Num());
+	for (IHandTrackingWrapper* SourceDevice : DevicesToCombine)
+	{
+		IHandTrackingDevice* InternalSourceDevice = SourceDevice->GetDevice();
+		CombineJob.SourceDeviceOrigins.Add(InternalSourceDevice ? InternalSourceDevice->GetDeviceOrigin() : FTransform::Identity);
+	}
+	CombineJob.bAnyVR = false;
+	CombineJob.Options = CombinedOptions;
+	CombineJob.CombinedFrameDelayInMS = 0;
+	CombineJob.CaptureTime = 0;
+	CombineJob.CombinedFrame = CombinedFrames.Acquire();
+
+	CombineSourceFrames();
+	OutCombinedFrame = *CombineJob.CombinedFrame;
+	CombineJob.CombinedFrame = nullptr;
+	OnCombinedFramePickedUp();
+}
+void FUltraleapCombinedDevice::PickUpCombinedFrame()
+{
+	// the task completing is the handoff, nothing else writes the job until the next kick
+	LatestCombinedFrame = CombineJob.CombinedFrame.ToSharedRef();
+	CombineJob.CombinedFrame = nullptr;
+	LatestCombinedCaptureTime = CombineJob.CaptureTime;
+	bCombinedFrameChanged = true;
+	CombineTask = nullptr;
+	OnCombinedFramePickedUp();
+}
+bool FUltraleapCombinedDevice::AreSourceHandsPresent()
+{
+	for (IHandTrackingWrapper* SourceDevice : DevicesToCombine)
+	{
+		const LEAP_TRACKING_EVENT* LatestFrame = SourceDevice->GetFrame();
+		if (LatestFrame && LatestFrame->nHands > 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+bool FUltraleapCombinedDevice::HaveSourceDevicesPublished(const bool bWaitForAllSources)
+{
+	// don't wait forever on a source device that has stopped producing frames
+	static const int32 MaxTicksWaitingForSources = 2;
+
+	KickedSourceFrameIds.SetNum(DevicesToCombine.Num());
+
+	bool bAllPublished = true;
+	bool bAnyPublished = false;
+	for (int32 ProviderIndex = 0; ProviderIndex < DevicesToCombine.Num(); ProviderIndex++)
+	{
+		const LEAP_TRACKING_EVENT* LatestFrame = DevicesToCombine[ProviderIndex]->GetFrame();
+		if (!LatestFrame)
+		{
+			continue;
+		}
+		if (LatestFrame->info.frame_id != KickedSourceFrameIds[ProviderIndex])
+		{
+			bAnyPublished = true;
+		}
+		else
+		{
+			bAllPublished = false;
+		}
+	}
+	if (!bAnyPublished || (bWaitForAllSources && !bAllPublished && ++TicksWaitingForSources < MaxTicksWaitingForSources))
+	{
+		return false;
+	}
+	TicksWaitingForSources = 0;
+
+	for (int32 ProviderIndex = 0; ProviderIndex < DevicesToCombine.Num(); ProviderIndex++)
+	{
+		const LEAP_TRACKING_EVENT* LatestFrame = DevicesToCombine[ProviderIndex]->GetFrame();
+		if (LatestFrame)
+		{
+			KickedSourceFrameIds[ProviderIndex] = LatestFrame->info.frame_id;
+		}
+	}
+	return true;
+}
+// Reads the source devices so must run on the game thread
+void FUltraleapCombinedDevice::GatherSourceFrames(const FLeapOptions& CombinedOptions)
+{
+	CombineJob.SourceFrames.Reset(DevicesToCombine.Num());
+	CombineJob.SourceDeviceOrigins.Reset(DevicesToCombine.Num());
+	CombineJob.bAnyVR = false;
+	CombineJob.Options = CombinedOptions;
+	CombineJob.CaptureTime = 0;
+	CombineJob.CombinedFrame = CombinedFrames.Acquire();
+	SourceFramePools.SetNum(DevicesToCombine.Num());
+
+	if (FLeapLatencyTracer::IsEnabled())
+	{
+		for (IHandTrackingWrapper* SourceDevice : DevicesToCombine)
+		{
+			const LEAP_TRACKING_EVENT* LatestFrame = SourceDevice->GetFrame();
+			if (LatestFrame)
+			{
+				CombineJob.CaptureTime = FMath::Max(CombineJob.CaptureTime,
+					FLeapLatencyTracer::GetCaptureTime(LatestFrame->info.timestamp, SourceDevice->GetNow()));
+			}
+		}
+	}
 
-	bool AreAnyVR = false;
 	for (auto SourceDevice : DevicesToCombine)
 	{
 		auto InternalSourceDevice = SourceDevice->GetDevice();
 		if (InternalSourceDevice)
 		{
-			FLeapFrameData SourceFrame;
-
 			const bool IsVR = InternalSourceDevice->GetOptions().Mode == LEAP_MODE_VR;
 			if (IsVR)
 			{
-				AreAnyVR = true;
-				VRDeviceOrigin = InternalSourceDevice->GetDeviceOrigin();
+				CombineJob.bAnyVR = true;
+				CombineJob.VRDeviceOrigin = InternalSourceDevice->GetDeviceOrigin();
 				break;
 			}
 		}
 	}
+	int64 TargetTimeStamp = 0;
+	if (CombinedOptions.bTimeAlignCombinedDevices)
+	{
+		TargetTimeStamp = UpdateSourceDeviceClocks(CombinedOptions);
+	}
+	else
+	{
+		TimeAlignment.Reset();
+	}
+	CombineJob.CombinedFrameDelayInMS = TimeAlignment.GetDelayInMS();
+
 	// add combiner logic based on DevicesToCombine List. All devices will have ticked before this is called
-	for (auto SourceDevice : DevicesToCombine)
+	for (int32 ProviderIndex = 0; ProviderIndex < DevicesToCombine.Num(); ProviderIndex++)
 	{
-		auto InternalSourceDevice = SourceDevice->GetDevice();
+		auto InternalSourceDevice = DevicesToCombine[ProviderIndex]->GetDevice();
+		CombineJob.SourceDeviceOrigins.Add(InternalSourceDevice ? InternalSourceDevice->GetDeviceOrigin() : FTransform::Identity);
 		if (InternalSourceDevice)
 		{
-			FLeapFrameData SourceFrame;
+			const FLeapOptions SourceOptions = InternalSourceDevice->GetOptions();
 
 			// For VR/XR mounted devices, the frame here is already transformed by the HMD position
 			// so we don't want to re-apply the device origin as this will transform it twice
 			// BUT the device origin is still required for confidence calcs
-			const bool IsVR = InternalSourceDevice->GetOptions().Mode == LEAP_MODE_VR;
-			const bool IsScreenTop = InternalSourceDevice->GetOptions().Mode == LEAP_MODE_SCREENTOP;
+			const bool IsVR = SourceOptions.Mode == LEAP_MODE_VR;
+			const bool IsScreenTop = SourceOptions.Mode == LEAP_MODE_SCREENTOP;
+
+			// only the sources whose frames are resampled or transformed here are copies, the rest are shared as published.
+			// The device shares its origin transformed frame too, copied once per frame and only if its origin isn't identity
+			FLeapFramePool::FFrameRef ResampledFrame = SourceFramePools[ProviderIndex].Acquire();
+			const bool bResampled = CombinedOptions.bTimeAlignCombinedDevices &&
+									ResampleSourceFrame(ProviderIndex, TargetTimeStamp, !IsVR, SourceOptions, *ResampledFrame);
+			FLeapFrameSnapshot SourceFrame =
+				bResampled ? FLeapFrameSnapshot(ResampledFrame) : InternalSourceDevice->GetLatestFrameSnapshot(!IsVR);
 
-			InternalSourceDevice->GetLatestFrameData(SourceFrame, !IsVR);
-			
 			if (IsVR)
 			{
 				// Transform HMD into Desktop rotation
+				FLeapFramePool::FFrameRef DesktopFrame = SourceFramePools[ProviderIndex].Acquire();
+				*DesktopFrame = *SourceFrame;
 				FRotator Rotation(90, 0, 180);
 				FUltraleapCombinedDevice::TransformFrame(
-					SourceFrame,  VRDeviceOrigin.GetLocation(), Rotation.GetInverse());
+					*DesktopFrame, CombineJob.VRDeviceOrigin.GetLocation(), Rotation.GetInverse());
+				SourceFrame = DesktopFrame;
 			}
 			// comment in for debugging desktop devices only in the combined hand -> 
 			//if (IsScreenTop)
 			{
-				SourceFrames.Add(SourceFrame);
+				CombineJob.SourceFrames.Add(SourceFrame);
 			}
 		}
 	}
-	
-	CombineFrame(SourceFrames);
+}
+void FUltraleapCombinedDevice::CombineSourceFrames()
+{
+	SCOPE_CYCLE_COUNTER(STAT_UltraleapCombineFrame);
+	const uint64 StartCycles = FCombinedDeviceTelemetry::IsEnabled() ? FPlatformTime::Cycles64() : 0;
+
+	FLeapFrameData& CombinedFrame = *CombineJob.CombinedFrame;
+	// combiners only set the hands they merge, visibility isn't carried over from an earlier combine into this frame
+	CombinedFrame.LeftHandVisible = false;
+	CombinedFrame.RightHandVisible = false;
+	CombineFrame(CombineJob.SourceFrames, CombinedFrame);
+
+	if (StartCycles)
+	{
+		FCombinedDeviceTelemetry::Get().RecordCombineTime(
+			CombinerID, (float) FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+	}
 
-	if (AreAnyVR)
+	if (CombineJob.bAnyVR)
 	{
 		// from desktop rotation to HMD rotation
 		FRotator Rotation(90, 0, 180);
-		FUltraleapCombinedDevice::TransformFrame(CurrentFrame,  -Rotation.RotateVector(VRDeviceOrigin.GetLocation()), Rotation);
+		FUltraleapCombinedDevice::TransformFrame(CombinedFrame,
+			-Rotation.RotateVector(CombineJob.VRDeviceOrigin.GetLocation()), Rotation);
 	}
-	
 
-	ParseEvents();
+	if (FLeapLatencyTracer::IsEnabled() && CombineJob.CaptureTime > 0)
+	{
+		FLeapLatencyTracer::Get().Record(ELeapLatencyStage::Combine, CombineJob.CaptureTime);
+	}
+}
+int64 FUltraleapCombinedDevice::UpdateSourceDeviceClocks(const FLeapOptions& CombinedOptions)
+{
+	if (DevicesToCombine.Num() == 0)
+	{
+		return 0;
+	}
+	LatestSourceTimeStamps.Reset(DevicesToCombine.Num());
+	for (IHandTrackingWrapper* SourceDevice : DevicesToCombine)
+	{
+		const LEAP_TRACKING_EVENT* LatestFrame = SourceDevice->GetFrame();
+		LatestSourceTimeStamps.Add(LatestFrame ? LatestFrame->info.timestamp : 0);
+	}
+	return TimeAlignment.Update(
+		DevicesToCombine[0]->GetNow(), LatestSourceTimeStamps, CombinedOptions.CombinedDeviceLatencyBudgetMS);
+}
+bool FUltraleapCombinedDevice::ResampleSourceFrame(const int32 ProviderIndex, const int64 TargetTimeStamp,
+	const bool ApplyDeviceOrigin, const FLeapOptions& SourceOptions, FLeapFrameData& OutFrame)
+{
+	// VR devices are already resampled against the HMD pose by their own timewarp, and OpenXR can't interpolate
+	if (SourceOptions.Mode == LEAP_MODE_VR || SourceOptions.bUseOpenXRAsSource ||
+		!TimeAlignment.IsValid(ProviderIndex))
+	{
+		return false;
+	}
+	IHandTrackingWrapper* SourceDevice = DevicesToCombine[ProviderIndex];
+
+	// no side effects on failure, the caller falls back to the latest frame
+	LEAP_TRACKING_EVENT* Frame = SourceDevice->InterpolateFrameAtTime(TargetTimeStamp, ResampleFrameBuffer);
+	if (!Frame)
+	{
+		return false;
+	}
+	OutFrame.SetFromLeapFrame(Frame, SourceOptions.HMDPositionOffset, SourceOptions.HMDRotationOffset.Quaternion());
+
+	if (ApplyDeviceOrigin)
+	{
+		// in BS Space
+		const FTransform& Origin = SourceDevice->GetDevice()->GetDeviceOrigin();
+		OutFrame.RotateFrame(Origin.GetRotation().Rotator());
+		OutFrame.TranslateFrame(Origin.GetLocation());
+	}
+	return true;
+}
+FLeapStats FUltraleapCombinedDevice::GetStats()
+{
+	FLeapStats Ret = FUltraleapDevice::GetStats();
+
+	TimeAlignment.GetLagsInMS(Ret.SourceDeviceLagInMS);
+	Ret.CombinedFrameDelayInMS = TimeAlignment.GetDelayInMS();
+	return Ret;
 }
 FVector ToLocal(const FVector& WorldPoint,const FVector& LocalOrigin,const FQuat& LocalRot)
 {
@@ -250,7 +549,12 @@ void FUltraleapCombinedDevice::CreateLinearJointListInterp(
 	}
 	return;
 }
+// Origins are snapshotted with the source frames so the combine task never reads the live devices
 FTransform FUltraleapCombinedDevice::GetSourceDeviceOrigin(const int ProviderIndex)
 {
+	if (CombineJob.SourceDeviceOrigins.IsValidIndex(ProviderIndex))
+	{
+		return CombineJob.SourceDeviceOrigins[ProviderIndex];
+	}
 	return DevicesToCombine[ProviderIndex]->GetDevice()->GetDeviceOrigin();
 }
\ No newline at end of file
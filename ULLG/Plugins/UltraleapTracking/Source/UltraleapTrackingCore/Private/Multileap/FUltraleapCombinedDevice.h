@@ -7,7 +7,9 @@
  ******************************************************************************/
 
 #pragma once
+#include "Async/TaskGraphInterfaces.h"
 #include "FUltraleapDevice.h"
+#include "SourceDeviceTimeAlignment.h"
 
 class FUltraleapCombinedDevice : public FUltraleapDevice
 {
@@ -19,6 +21,18 @@ public:
 
 	/** Poll for controller state and send events if needed */
 	virtual void SendControllerEvents() override;
+
+	virtual FLeapStats GetStats() override;
+
+	/** Blocks until any in flight combine task has finished, call before destroying the device */
+	void WaitForCombine();
+
+	/** Combines recorded source frames, one per source device in DevicesToCombine order, as a tick would but without
+	 * reading the source devices. Frames replayed through a new combiner give the same combined frames */
+	void CombineRecordedFrames(
+		const TArray<FLeapFrameData>& SourceFrames, const FLeapOptions& CombinedOptions, FLeapFrameData& OutCombinedFrame);
+	void CombineRecordedFrames(
+		const TArray<FLeapFrameSnapshot>& SourceFrames, const FLeapOptions& CombinedOptions, FLeapFrameData& OutCombinedFrame);
 		
 	// Based on VectorHand.NUM_JOINT_POSITIONS
 	static const int NumJointPositions = 25;
@@ -28,7 +42,14 @@ public:
 
 protected:
 	// override this in any custom combiners
-	virtual void CombineFrame(const TArray<FLeapFrameData>& SourceFrames) = 0;
+	// Called on a worker task when combining async, only touch combiner state and the passed in frames. The source frames
+	// are the devices' published snapshots, shared with other readers
+	virtual void CombineFrame(const TArray<FLeapFrameSnapshot>& SourceFrames, FLeapFrameData& CombinedFrame) = 0;
+	// Called on the game thread once a combine has finished and its frame is picked up. Copy out any combiner state the
+	// game thread reads here, CombineFrame may be running on a worker at any other time
+	virtual void OnCombinedFramePickedUp()
+	{
+	}
 
 
 	// the combined devices
@@ -47,9 +68,73 @@ protected:
 
 	
 	static int HandID;
+	// Identifies this combiner in telemetry
+	const int32 CombinerID;
 	
 	FTransform GetSourceDeviceOrigin(const int ProviderIndex);
+
+	// How far in the past (ms) the source devices were resampled to for the frame being combined, 0 if not time aligned
+	float GetCombinedFrameDelayInMS() const
+	{
+		return CombineJob.CombinedFrameDelayInMS;
+	}
+	// Options of this device as of the frame being combined, safe to read from CombineFrame
+	const FLeapOptions& GetCombineOptions() const
+	{
+		return CombineJob.Options;
+	}
 	
 
 private:
+	FSourceDeviceTimeAlignment TimeAlignment;
+	// Scratch for the time alignment and resampled source frames
+	TArray<int64> LatestSourceTimeStamps;
+	TArray<uint8> ResampleFrameBuffer;
+
+	// Everything CombineFrame needs, gathered on the game thread. Owned by the combine task while it is in flight
+	struct FCombineJob
+	{
+		// Shared with the source devices, only resampled or HMD transformed sources are copies
+		TArray<FLeapFrameSnapshot> SourceFrames;
+		TArray<FTransform> SourceDeviceOrigins;
+		FTransform VRDeviceOrigin;
+		bool bAnyVR = false;
+		float CombinedFrameDelayInMS = 0;
+		FLeapOptions Options;
+		// Capture time of the newest source frame, for leap.LatencyTrace
+		double CaptureTime = 0;
+		// From CombinedFrames, not shared until picked up
+		TSharedPtr<FLeapFrameData, ESPMode::ThreadSafe> CombinedFrame;
+	};
+	FCombineJob CombineJob;
+	FGraphEventRef CombineTask;
+	FLeapFramePool CombinedFrames;
+	// Copies of the source frames that are resampled or transformed, one pool per source device
+	TArray<FLeapFramePool> SourceFramePools;
+
+	// Newest completed combined frame. Published as CurrentFrame as is, or copied into CurrentFrame when ParseEvents
+	// transforms CurrentFrame in place
+	FLeapFramePool::FFrameRef LatestCombinedFrame;
+	double LatestCombinedCaptureTime = 0;
+	// A combined frame was picked up since the last parse
+	bool bCombinedFrameChanged = false;
+
+	// Source frame ids the last combine was kicked with, a new combine waits for every source to publish a new frame
+	TArray<int64> KickedSourceFrameIds;
+	int32 TicksWaitingForSources = 0;
+
+	// Any source device has a new frame, and with bWaitForAllSources all of them or a couple of ticks have passed
+	bool HaveSourceDevicesPublished(const bool bWaitForAllSources);
+	// Cheap presence check for idle mode, looks at the newest raw frame of each source device
+	bool AreSourceHandsPresent();
+	void GatherSourceFrames(const FLeapOptions& CombinedOptions);
+	// Runs on the combine task when async
+	void CombineSourceFrames();
+	void PickUpCombinedFrame();
+
+	// Updates the time alignment and returns the timestamp to resample the source devices at
+	int64 UpdateSourceDeviceClocks(const FLeapOptions& CombinedOptions);
+	// Returns false if the device can't be resampled, the caller should use its latest frame instead
+	bool ResampleSourceFrame(const int32 ProviderIndex, const int64 TargetTimeStamp, const bool ApplyDeviceOrigin,
+		const FLeapOptions& SourceOptions, FLeapFrameData& OutFrame);
 };
@@ -7,16 +7,18 @@
  ******************************************************************************/
 
 #include "FUltraleapCombinedDeviceAngular.h"
+
+#include "CombinedDeviceTelemetry.h"
  
-void FUltraleapCombinedDeviceAngular::CombineFrame(const TArray<FLeapFrameData>& SourceFrames)
+void FUltraleapCombinedDeviceAngular::CombineFrame(const TArray<FLeapFrameSnapshot>& SourceFrames, FLeapFrameData& CombinedFrame)
 {
 	if (!SourceFrames.Num())
 	{
 		return;
 	}
 
-	CurrentFrame.Hands.Empty();
-	MergeHands(SourceFrames, CurrentFrame.Hands, CurrentFrame.LeftHandVisible, CurrentFrame.RightHandVisible);
+	CombinedFrame.Hands.Empty();
+	MergeHands(SourceFrames, CombinedFrame.Hands, CombinedFrame.LeftHandVisible, CombinedFrame.RightHandVisible);
 }
 /*
  * Utility function of running average
@@ -32,26 +34,29 @@ float AprxAvg(float Avg, float NewSample)
  * This function returns one set of hands from multiple Leap Providers, weighing their influence using hands' positions relative
  * to devices.
  */
-void FUltraleapCombinedDeviceAngular::MergeHands(const TArray<FLeapFrameData>& SourceFrames, TArray<FLeapHandData>& MergedHands, bool& LeftHandVisible, bool& RightHandVisible)
+void FUltraleapCombinedDeviceAngular::MergeHands(const TArray<FLeapFrameSnapshot>& SourceFrames, TArray<FLeapHandData>& MergedHands, bool& LeftHandVisible, bool& RightHandVisible)
 {
 	// Sort Left and Right hands (some values may be null since never know how many hands are visible, but we clean it up at the
 	// end)
 	TArray<const FLeapHandData*> LeftHands;
 	TArray<const FLeapHandData*> RightHands;
-	
-
+	// source device of each hand, for telemetry
+	TArray<int32, TInlineAllocator<4>> LeftSources;
+	TArray<int32, TInlineAllocator<4>> RightSources;
 
 	for (int i = 0; i < SourceFrames.Num(); i++)
 	{
-		for(auto& TempHand : SourceFrames[i].Hands)
+		for(auto& TempHand : SourceFrames[i]->Hands)
 		{
 			if (TempHand.HandType == LEAP_HAND_LEFT)
 			{
 				LeftHands.Add(&TempHand);
+				LeftSources.Add(i);
 			}
 			else
 			{
 				RightHands.Add(&TempHand);
+				RightSources.Add(i);
 			}
 		}
 	}
@@ -63,6 +68,12 @@ void FUltraleapCombinedDeviceAngular::MergeHands(const TArray<FLeapFrameData>& S
 	const bool LeftValid = AngularInterpolate(LeftHands, Cam1Alpha, LeftAngle, ConfidentLeft);
 	const bool RightValid = AngularInterpolate(RightHands,Cam2Alpha, RightAngle, ConfidentRight);
 
+	if (FCombinedDeviceTelemetry::IsEnabled())
+	{
+		RecordTelemetry(LeftHands, LeftSources, Cam1Alpha);
+		RecordTelemetry(RightHands, RightSources, Cam2Alpha);
+	}
+
 	// clean up and return hand arrays with only valid hands
 	if (LeftValid)
 	{
@@ -100,8 +111,7 @@ bool FUltraleapCombinedDeviceAngular::AngularInterpolate(
 	{
 		IsLeft = Hand->HandType == LEAP_HAND_LEFT;
 
-		if (Hand->Confidence > 0.98f &&
-			Hand->VisibleTime > 0.5f)	// only use hands with high confidence to avoid when hand is barely in view
+		if (IsHandUsable(*Hand))
 		{
 			if (!HandInit)
 			{
@@ -175,4 +185,67 @@ bool FUltraleapCombinedDeviceAngular::AngularInterpolate(
 	}
 	return HandInit;
 }
+// only use hands with high confidence to avoid when hand is barely in view
+bool FUltraleapCombinedDeviceAngular::IsHandUsable(const FLeapHandData& Hand)
+{
+	return Hand.Confidence > 0.98f && Hand.VisibleTime > 0.5f;
+}
+// Mirrors the weights AngularInterpolate used: one usable hand is taken as is, more are interpolated between the first two
+void FUltraleapCombinedDeviceAngular::RecordTelemetry(
+	const TArray<const FLeapHandData*>& HandList, const TArrayView<const int32> Sources, const float Alpha)
+{
+	int32 NumUsable = 0;
+	int32 FirstUsable = INDEX_NONE;
+	for (int32 i = 0; i < HandList.Num(); i++)
+	{
+		if (IsHandUsable(*HandList[i]) && NumUsable++ == 0)
+		{
+			FirstUsable = i;
+		}
+	}
 
+	FCombinedDeviceTelemetry& Telemetry = FCombinedDeviceTelemetry::Get();
+	int32 Dominant = INDEX_NONE;
+	float DominantWeight = 0;
+	for (int32 i = 0; i < HandList.Num(); i++)
+	{
+		FCombinedDeviceTelemetryRecord Record;
+		Record.CombinerID = CombinerID;
+		Record.HandType = HandList[i]->HandType;
+		Record.SourceIndex = (int8) Sources[i];
+		Record.Confidence = HandList[i]->Confidence;
+		if (NumUsable > 1)
+		{
+			Record.Weight = i == 0 ? 1.0f - Alpha : (i == 1 ? Alpha : 0.0f);
+		}
+		else
+		{
+			Record.Weight = i == FirstUsable ? 1.0f : 0.0f;
+		}
+		Record.bRejected = Record.Weight < FCombinedDeviceTelemetry::RejectedWeight;
+		Telemetry.AddRecord(Record);
+
+		if (Record.Weight > DominantWeight)
+		{
+			Dominant = i;
+			DominantWeight = Record.Weight;
+		}
+	}
+	if (Dominant == INDEX_NONE)
+	{
+		return;
+	}
+	int32& PreviousDominant = DominantTelemetrySource[HandList[Dominant]->HandType == LEAP_HAND_LEFT ? 0 : 1];
+	if (PreviousDominant != INDEX_NONE && PreviousDominant != Sources[Dominant])
+	{
+		FCombinedDeviceTelemetryRecord Swap;
+		Swap.CombinerID = CombinerID;
+		Swap.Event = ECombinedDeviceTelemetryEvent::HandSwap;
+		Swap.HandType = HandList[Dominant]->HandType;
+		Swap.SourceIndex = (int8) Sources[Dominant];
+		Swap.PreviousSourceIndex = (int8) PreviousDominant;
+		Swap.Weight = DominantWeight;
+		Telemetry.AddRecord(Swap);
+	}
+	PreviousDominant = Sources[Dominant];
+}
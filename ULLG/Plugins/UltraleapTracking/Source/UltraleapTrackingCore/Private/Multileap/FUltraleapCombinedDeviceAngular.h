@@ -19,7 +19,7 @@ public:
 	}
 	
 protected:
-	virtual void CombineFrame(const TArray<FLeapFrameData>& SourceFrames) override;
+	virtual void CombineFrame(const TArray<FLeapFrameSnapshot>& SourceFrames, FLeapFrameData& CombinedFrame) override;
 
 public:
 	float Cam1Alpha;
@@ -41,7 +41,12 @@ private:
 	FVector MidDevicePointUp;
 
 	void MergeHands(
-		const TArray<FLeapFrameData>& SourceFrames, TArray<FLeapHandData>& Hands, bool& LeftHandVisible, bool& RightHandVisible);
+		const TArray<FLeapFrameSnapshot>& SourceFrames, TArray<FLeapHandData>& Hands, bool& LeftHandVisible, bool& RightHandVisible);
 	static float AngleSigned(const FVector& V1, const FVector& V2, const FVector& N);
 	bool AngularInterpolate(const TArray<const FLeapHandData*>& HandList, float& Alpha, float& Angle, FLeapHandData& Hand);
+	static bool IsHandUsable(const FLeapHandData& Hand);
+
+	// Telemetry, the most heavily weighted source device per hand last combine
+	int32 DominantTelemetrySource[2] = {INDEX_NONE, INDEX_NONE};
+	void RecordTelemetry(const TArray<const FLeapHandData*>& HandList, const TArrayView<const int32> Sources, const float Alpha);
 };
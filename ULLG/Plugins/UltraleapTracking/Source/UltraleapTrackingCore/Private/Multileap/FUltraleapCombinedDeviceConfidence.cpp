@@ -7,14 +7,12 @@
  ******************************************************************************/
 
 #include "FUltraleapCombinedDeviceConfidence.h"
+
+#include "CombinedDeviceTelemetry.h"
 #include "LeapBlueprintFunctionLibrary.h" // for AngleBetweenVectors()
 
 #define PRINT_ONSCREEN_DEBUG (0 && WITH_EDITOR) 
 
-float GetTime()
-{
-	return FPlatformTime::Seconds();
-}
 float SumFloatArray(const TArray<float>& ToSum)
 {
 	float Ret = 0;
@@ -55,29 +53,21 @@ FUltraleapCombinedDeviceConfidence::FUltraleapCombinedDeviceConfidence(IHandTrac
 	TArray<IHandTrackingWrapper*> DevicesToCombineIn)
 	: FUltraleapCombinedDevice(LeapDeviceWrapperIn, TrackingDeviceWrapperIn, DevicesToCombineIn)
 {
-	// Maps need filling with defaults as they don't auto size with the array operator
-	for (auto DeviceWrapper : DevicesToCombine)
-	{
-		LeftHandFirstVisible.Add(DeviceWrapper->GetDevice(), 0);
-		RightHandFirstVisible.Add(DeviceWrapper->GetDevice(), 0);
-
-		LastLeftHandPositions.Add(DeviceWrapper->GetDevice(), FHandPositionHistory());
-		LastRightHandPositions.Add(DeviceWrapper->GetDevice(), FHandPositionHistory());
-
-		JointConfidenceHistoriesLeft.Add(DeviceWrapper->GetDevice(), FJointConfidenceHistory(NumJointPositions));
-		JointConfidenceHistoriesRight.Add(DeviceWrapper->GetDevice(), FJointConfidenceHistory(NumJointPositions));
-
-		HandConfidenceHistoriesLeft.Add(DeviceWrapper->GetDevice(), FHandConfidenceHistory());
-		HandConfidenceHistoriesRight.Add(DeviceWrapper->GetDevice(), FHandConfidenceHistory());
-	}
 	const int NumProviders = DevicesToCombine.Num();
 	const int NumHandsPerProvider = 2;	  // until we evolve more
 	
 	// per hand
+	SourceHandHistories.Reserve(NumProviders * NumHandsPerProvider);
+	for (int i = 0; i < NumProviders * NumHandsPerProvider; i++)
+	{
+		FSourceHandHistory& History = SourceHandHistories.AddDefaulted_GetRef();
+		History.JointConfidences = FJointConfidenceHistory(NumJointPositions);
+	}
 	JointConfidences.AddZeroed(NumProviders * NumHandsPerProvider);
 	ConfidencesJointRot.AddZeroed(NumProviders * NumHandsPerProvider);
 	ConfidencesJointPalmRot.AddZeroed(NumProviders * NumHandsPerProvider);
 	ConfidencesJointOcclusion.AddZeroed(NumProviders * NumHandsPerProvider);
+	PendingConfidencesJointOcclusion.AddZeroed(NumProviders * NumHandsPerProvider);
 
 	for (int i = 0; i < (NumProviders * NumHandsPerProvider); ++i)
 	{
@@ -85,6 +75,7 @@ FUltraleapCombinedDeviceConfidence::FUltraleapCombinedDeviceConfidence(IHandTrac
 		ConfidencesJointRot[i].AddZeroed(NumJointPositions);
 		ConfidencesJointPalmRot[i].AddZeroed(NumJointPositions);
 		ConfidencesJointOcclusion[i].AddZeroed(NumJointPositions);
+		PendingConfidencesJointOcclusion[i].AddZeroed(NumJointPositions);
 	}
 }
 // if a joint occlusion actor is in the scene, this will get called on tick
@@ -93,14 +84,17 @@ FUltraleapCombinedDeviceConfidence::FUltraleapCombinedDeviceConfidence(IHandTrac
 // Note this is called from the joint occlusion actor tick and will fill the 
 // Joint Occlusion confidence arrays which will get picked up separately
 // when this component is ticked (still the same thread = game thread, but different tick timing)
+// The combine may be running on a worker task, so this fills a pending copy the next combine picks up
 void FUltraleapCombinedDeviceConfidence::UpdateJointOcclusions(AJointOcclusionActor* Actor)
 {
-	if (!Actor || JointOcclusionFactor == 0)
+	const FLeapOptions Options = GetOptions();
+	if (!Actor || Options.JointOcclusionFactor == 0 || Options.bUseAnalyticJointOcclusion)
 	{
 		return;
 	}
 	
-	
+	FScopeLock Lock(&JointOcclusionSection);
+
 	int FrameIndex = 0;
 	for (auto Device : DevicesToCombine)
 	{
@@ -110,7 +104,7 @@ void FUltraleapCombinedDeviceConfidence::UpdateJointOcclusions(AJointOcclusionAc
 			// get index in confidence arrays
 			int Idx = FrameIndex * 2 + (Hand);
 			
-			StoreConfidenceJointOcclusion(Actor, ConfidencesJointOcclusion[Idx], SourceDeviceOrigin,(EHandType)Hand,Device);
+			StoreConfidenceJointOcclusion(Actor, PendingConfidencesJointOcclusion[Idx], SourceDeviceOrigin,(EHandType)Hand,Device);
 		}
 		FrameIndex++;
 	}
@@ -119,6 +113,8 @@ void FUltraleapCombinedDeviceConfidence::UpdateJointOcclusions(AJointOcclusionAc
 bool FUltraleapCombinedDeviceConfidence::GetJointOcclusionConfidences(
 	const FString& DeviceSerial, TArray<float>& Left, TArray<float>& Right)
 {
+	FScopeLock Lock(&JointOcclusionSection);
+
 	int FrameIndex = 0;
 	for (auto Device : DevicesToCombine)
 	{
@@ -141,8 +137,8 @@ bool FUltraleapCombinedDeviceConfidence::GetJointOcclusionConfidences(
 					// confidence keys are stored as if we have 5 bones per finger
 					int ConfidenceKey = FingerIndex * 5 + j;
 
-					Left[JointColoursKey] = ConfidencesJointOcclusion[IdxLeft][ConfidenceKey];
-					Right[JointColoursKey] = ConfidencesJointOcclusion[IdxRight][ConfidenceKey];
+					Left[JointColoursKey] = PendingConfidencesJointOcclusion[IdxLeft][ConfidenceKey];
+					Right[JointColoursKey] = PendingConfidencesJointOcclusion[IdxRight][ConfidenceKey];
 				}
 			}
 			
@@ -155,8 +151,13 @@ bool FUltraleapCombinedDeviceConfidence::GetJointOcclusionConfidences(
 }
 void FUltraleapCombinedDeviceConfidence::GetDebugInfo(int32& NumCombinedLeft, int32& NumCombinedRight)
 {
-	NumCombinedLeft = NumLeftHands;
-	NumCombinedRight = NumRightHands;
+	NumCombinedLeft = PickedUpNumLeftHands;
+	NumCombinedRight = PickedUpNumRightHands;
+}
+void FUltraleapCombinedDeviceConfidence::OnCombinedFramePickedUp()
+{
+	PickedUpNumLeftHands = NumLeftHands;
+	PickedUpNumRightHands = NumRightHands;
 }
 FColourMap* GetColourMapForDevice(AJointOcclusionActor* Actor, IHandTrackingWrapper* Device)
 {
@@ -171,12 +172,34 @@ FColourMap* GetColourMapForDevice(AJointOcclusionActor* Actor, IHandTrackingWrap
 	}
 	return nullptr;
 }
-void FUltraleapCombinedDeviceConfidence::CombineFrame(const TArray<FLeapFrameData>& SourceFrames)
+void FUltraleapCombinedDeviceConfidence::CombineFrame(const TArray<FLeapFrameSnapshot>& SourceFrames, FLeapFrameData& CombinedFrame)
 {
-	MergeFrames(SourceFrames, CurrentFrame);
+	const FLeapOptions& Options = GetCombineOptions();
+	JointOcclusionFactor = Options.JointOcclusionFactor;
+	bUseAnalyticJointOcclusion = Options.bUseAnalyticJointOcclusion;
+
+	if (JointOcclusionFactor != 0 && !bUseAnalyticJointOcclusion)
+	{
+		FScopeLock Lock(&JointOcclusionSection);
+		for (int i = 0; i < ConfidencesJointOcclusion.Num(); ++i)
+		{
+			ConfidencesJointOcclusion[i] = PendingConfidencesJointOcclusion[i];
+		}
+	}
+	MergeFrames(SourceFrames, CombinedFrame);
+
+	// publish the estimates so the joint occlusion debug view still works
+	if (JointOcclusionFactor != 0 && bUseAnalyticJointOcclusion)
+	{
+		FScopeLock Lock(&JointOcclusionSection);
+		for (int i = 0; i < ConfidencesJointOcclusion.Num(); ++i)
+		{
+			PendingConfidencesJointOcclusion[i] = ConfidencesJointOcclusion[i];
+		}
+	}
 }
 // direct port from Unity
-void FUltraleapCombinedDeviceConfidence::MergeFrames(const TArray<FLeapFrameData>& SourceFrames, FLeapFrameData& CombinedFrame )
+void FUltraleapCombinedDeviceConfidence::MergeFrames(const TArray<FLeapFrameSnapshot>& SourceFrames, FLeapFrameData& CombinedFrame )
 {	
 	TArray<const FLeapHandData*> LeftHands;
 	TArray<const FLeapHandData*> RightHands;
@@ -187,13 +210,17 @@ void FUltraleapCombinedDeviceConfidence::MergeFrames(const TArray<FLeapFrameData
 	TArray<TArray<float>> LeftJointConfidences;
 	TArray<TArray<float>> RightJointConfidences;
 
+	// only filled when telemetry is on, in the same order as the hand lists
+	const bool bTelemetry = FCombinedDeviceTelemetry::IsEnabled();
+	FTelemetryRecords LeftTelemetry;
+	FTelemetryRecords RightTelemetry;
 
 	// make lists of all left and right hands found in each frame and also make a list of their confidences
 	for (int FrameIdx = 0; FrameIdx < SourceFrames.Num(); FrameIdx++)
 	{
-		const FLeapFrameData& Frame = SourceFrames[FrameIdx];
+		const FLeapFrameData& Frame = *SourceFrames[FrameIdx];
 	
-		AddFrameToTimeVisibleDicts(SourceFrames, FrameIdx);
+		AddFrameToHandHistories(SourceFrames, FrameIdx);
 
 		for (const FLeapHandData& Hand : Frame.Hands)
 		{
@@ -201,9 +228,14 @@ void FUltraleapCombinedDeviceConfidence::MergeFrames(const TArray<FLeapFrameData
 			{
 				LeftHands.Add(&Hand);
 
-				float HandConfidence = CalculateHandConfidence(FrameIdx, Hand);
+				FCombinedDeviceConfidenceTerms Terms;
+				float HandConfidence = CalculateHandConfidence(FrameIdx, Hand, bTelemetry ? &Terms : nullptr);
 				TArray<float> JointConfidencesLocal;
 				CalculateJointConfidence(FrameIdx, Hand, JointConfidencesLocal);
+				if (bTelemetry)
+				{
+					AddTelemetryRecord(LeftTelemetry, FrameIdx, Hand, HandConfidence, Terms, JointConfidencesLocal);
+				}
 
 				LeftHandConfidences.Add(HandConfidence);
 				LeftJointConfidences.Add(JointConfidencesLocal);
@@ -212,9 +244,14 @@ void FUltraleapCombinedDeviceConfidence::MergeFrames(const TArray<FLeapFrameData
 			{
 				RightHands.Add(&Hand);
 
-				float HandConfidence = CalculateHandConfidence(FrameIdx, Hand);
+				FCombinedDeviceConfidenceTerms Terms;
+				float HandConfidence = CalculateHandConfidence(FrameIdx, Hand, bTelemetry ? &Terms : nullptr);
 				TArray<float> JointConfidencesLocal;
 				CalculateJointConfidence(FrameIdx, Hand, JointConfidencesLocal);
+				if (bTelemetry)
+				{
+					AddTelemetryRecord(RightTelemetry, FrameIdx, Hand, HandConfidence, Terms, JointConfidencesLocal);
+				}
 
 				RightHandConfidences.Add(HandConfidence);
 				RightJointConfidences.Add(JointConfidencesLocal);
@@ -255,6 +292,12 @@ void FUltraleapCombinedDeviceConfidence::MergeFrames(const TArray<FLeapFrameData
 		}
 	}
 
+	if (bTelemetry)
+	{
+		SubmitTelemetryRecords(LeftTelemetry, LeftHandConfidences);
+		SubmitTelemetryRecords(RightTelemetry, RightHandConfidences);
+	}
+
 	// normalize joint confidences:
 	for (int JointIdx = 0; JointIdx < NumJointPositions; JointIdx++)
 	{
@@ -339,104 +382,125 @@ void FUltraleapCombinedDeviceConfidence::MergeFrames(const TArray<FLeapFrameData
 	NumLeftHands = LeftHands.Num();
 	NumRightHands = RightHands.Num();
 }
+void FUltraleapCombinedDeviceConfidence::AddTelemetryRecord(FTelemetryRecords& Records, const int FrameIdx,
+	const FLeapHandData& Hand, const float HandConfidence, const FCombinedDeviceConfidenceTerms& Terms,
+	const TArray<float>& HandJointConfidences)
+{
+	FCombinedDeviceTelemetryRecord& Record = Records.AddDefaulted_GetRef();
+	Record.CombinerID = CombinerID;
+	Record.HandType = Hand.HandType;
+	Record.SourceIndex = (int8) FrameIdx;
+	Record.Confidence = HandConfidence;
+	Record.Terms = Terms;
+	Record.Terms.Joints = HandJointConfidences.Num() ? SumFloatArray(HandJointConfidences) / HandJointConfidences.Num() : 0;
+}
+void FUltraleapCombinedDeviceConfidence::SubmitTelemetryRecords(
+	FTelemetryRecords& Records, const TArray<float>& NormalisedHandConfidences)
+{
+	if (!Records.Num())
+	{
+		return;
+	}
+	FCombinedDeviceTelemetry& Telemetry = FCombinedDeviceTelemetry::Get();
 
+	int32 Dominant = 0;
+	for (int32 i = 0; i < Records.Num(); i++)
+	{
+		Records[i].Weight = NormalisedHandConfidences[i];
+		Records[i].bRejected = Records[i].Weight < FCombinedDeviceTelemetry::RejectedWeight;
+		if (Records[i].Weight > Records[Dominant].Weight)
+		{
+			Dominant = i;
+		}
+		Telemetry.AddRecord(Records[i]);
+	}
 
-/// add all hands in the frame given by frames[frameIdx] to the Dictionaries lastLeftHandPositions and lastRightHandPositions,
-/// and update leftHandFirstVisible and rightHandFirstVisible
-void FUltraleapCombinedDeviceConfidence::AddFrameToTimeVisibleDicts(const TArray<FLeapFrameData>& Frames,const int FrameIdx)
+	const uint8 HandType = Records[Dominant].HandType;
+	int32& PreviousDominant = DominantTelemetrySource[HandType == EHandType::LEAP_HAND_LEFT ? 0 : 1];
+	if (PreviousDominant != INDEX_NONE && PreviousDominant != Records[Dominant].SourceIndex)
+	{
+		FCombinedDeviceTelemetryRecord Swap;
+		Swap.CombinerID = CombinerID;
+		Swap.Event = ECombinedDeviceTelemetryEvent::HandSwap;
+		Swap.HandType = HandType;
+		Swap.SourceIndex = Records[Dominant].SourceIndex;
+		Swap.PreviousSourceIndex = (int8) PreviousDominant;
+		Swap.Weight = Records[Dominant].Weight;
+		Telemetry.AddRecord(Swap);
+	}
+	PreviousDominant = Records[Dominant].SourceIndex;
+}
+
+
+/// add all hands in the frame given by frames[frameIdx] to the position histories of that device,
+/// and update when each hand was first visible. Times are tracking timestamps so replays give the same confidences
+void FUltraleapCombinedDeviceConfidence::AddFrameToHandHistories(const TArray<FLeapFrameSnapshot>& Frames, const int FrameIdx)
 {
+	const double FrameTime = Frames[FrameIdx]->TimeStamp / 1000000.0;
 	bool HandsVisible[2] = {false};
-	
-	for(auto Hand : Frames[FrameIdx].Hands)
+
+	for (const FLeapHandData& Hand : Frames[FrameIdx]->Hands)
 	{
-		if (Hand.HandType == EHandType::LEAP_HAND_LEFT)
-		{
-			HandsVisible[0] = true;
-			
-			if (LeftHandFirstVisible[DevicesToCombine[FrameIdx]->GetDevice()] == 0)
-			{
-				LeftHandFirstVisible[DevicesToCombine[FrameIdx]->GetDevice()] = GetTime();
-			}
+		const int HandIdx = Hand.HandType == EHandType::LEAP_HAND_LEFT ? 0 : 1;
+		FSourceHandHistory& History = SourceHandHistories[FrameIdx * 2 + HandIdx];
+		HandsVisible[HandIdx] = true;
 
-			if (!LastLeftHandPositions.Contains(DevicesToCombine[FrameIdx]->GetDevice()))
-			{
-				LastLeftHandPositions.Add(DevicesToCombine[FrameIdx]->GetDevice(), FHandPositionHistory());
-			}
-			
-			
-			LastLeftHandPositions[DevicesToCombine[FrameIdx]->GetDevice()].AddPosition(
-				Hand.Palm.Position, GetTime());
-		}
-		else
+		if (!History.bVisible)
 		{
-			HandsVisible[1] = true;
-			if (RightHandFirstVisible[DevicesToCombine[FrameIdx]->GetDevice()] == 0)
-			{
-				RightHandFirstVisible[DevicesToCombine[FrameIdx]->GetDevice()] = GetTime();
-			}
-
-			if (!LastRightHandPositions.Contains(DevicesToCombine[FrameIdx]->GetDevice()))
-			{
-				LastRightHandPositions.Add(DevicesToCombine[FrameIdx]->GetDevice(), FHandPositionHistory());
-			}
-
-			LastRightHandPositions[DevicesToCombine[FrameIdx]->GetDevice()].AddPosition(Hand.Palm.Position, GetTime());
+			History.bVisible = true;
+			History.FirstVisibleTime = FrameTime;
 		}
+		History.Positions.AddPosition(Hand.Palm.Position, FrameTime);
 	}
 
-	if (!HandsVisible[0])
+	for (int HandIdx = 0; HandIdx < 2; HandIdx++)
 	{
-		LeftHandFirstVisible[DevicesToCombine[FrameIdx]->GetDevice()] =  0;
-	}
-	if (!HandsVisible[1])
-	{
-		RightHandFirstVisible[DevicesToCombine[FrameIdx]->GetDevice()] = 0;
+		FSourceHandHistory& History = SourceHandHistories[FrameIdx * 2 + HandIdx];
+		History.FrameTime = FrameTime;
+		if (!HandsVisible[HandIdx] && History.bVisible)
+		{
+			History.bVisible = false;
+			History.Positions.ClearAllPositions();
+		}
 	}
 }
 /// <summary>
 /// combine different confidence functions to get an overall confidence for the given hand
 /// uses frame_idx to find the corresponding provider that saw this hand
 /// </summary>
-float FUltraleapCombinedDeviceConfidence::CalculateHandConfidence(int FrameIdx,const FLeapHandData& Hand)
+float FUltraleapCombinedDeviceConfidence::CalculateHandConfidence(
+	int FrameIdx, const FLeapHandData& Hand, FCombinedDeviceConfidenceTerms* OutTerms)
 {
-	float Confidence = 0;
+	FCombinedDeviceConfidenceTerms Terms;
 
 	FTransform SourceDeviceOrigin = GetSourceDeviceOrigin(FrameIdx);
 
-	Confidence = PalmPosFactor * ConfidenceRelativeHandPos(DevicesToCombine[FrameIdx]->GetDevice(), SourceDeviceOrigin, Hand.Palm.Position);
-	Confidence += PalmRotFactor * ConfidenceRelativeHandRot(SourceDeviceOrigin, Hand.Palm.Position, Hand.Palm.Normal);
+	Terms.PalmPosition = ConfidenceRelativeHandPos(DevicesToCombine[FrameIdx]->GetDevice(), SourceDeviceOrigin, Hand.Palm.Position);
+	Terms.PalmRotation = ConfidenceRelativeHandRot(SourceDeviceOrigin, Hand.Palm.Position, Hand.Palm.Normal);
 	
-	Confidence += PalmVelocityFactor * ConfidenceRelativeHandVelocity(DevicesToCombine[FrameIdx]->GetDevice(), SourceDeviceOrigin,
-										   Hand.Palm.Position, Hand.HandType == EHandType::LEAP_HAND_LEFT);
+	FSourceHandHistory& History = SourceHandHistories[FrameIdx * 2 + (Hand.HandType == EHandType::LEAP_HAND_LEFT ? 0 : 1)];
+
+	Terms.PalmVelocity = ConfidenceRelativeHandVelocity(History, Hand.Palm.Position);
+
+	float Confidence = PalmPosFactor * Terms.PalmPosition + PalmRotFactor * Terms.PalmRotation +
+					   PalmVelocityFactor * Terms.PalmVelocity;
 
 	// if ignoreRecentNewHands is true, then
 	// the confidence should be 0 when it is the first frame with the hand in it.
 	if (IgnoreRecentNewHands)
 	{
-		Confidence = Confidence * ConfidenceTimeSinceHandFirstVisible(
-									  DevicesToCombine[FrameIdx]->GetDevice(), Hand.HandType == EHandType::LEAP_HAND_LEFT);
-	}
-
-	// average out new hand confidence with that of the last few frames
-	if (Hand.HandType == EHandType::LEAP_HAND_LEFT)
-	{
-		if (!HandConfidenceHistoriesLeft.Contains(DevicesToCombine[FrameIdx]->GetDevice()))
-		{
-			HandConfidenceHistoriesLeft.Add(DevicesToCombine[FrameIdx]->GetDevice(),FHandConfidenceHistory());
-		}
-		HandConfidenceHistoriesLeft[DevicesToCombine[FrameIdx]->GetDevice()].AddConfidence(Confidence);
-		Confidence = HandConfidenceHistoriesLeft[DevicesToCombine[FrameIdx]->GetDevice()].GetAveragedConfidence();
+		Terms.TimeVisible = ConfidenceTimeSinceHandFirstVisible(History);
+		Confidence = Confidence * Terms.TimeVisible;
 	}
-	else
+	if (OutTerms)
 	{
-		if (!HandConfidenceHistoriesRight.Contains(DevicesToCombine[FrameIdx]->GetDevice()))
-		{
-			HandConfidenceHistoriesRight.Add(DevicesToCombine[FrameIdx]->GetDevice(), FHandConfidenceHistory());
-		}
-		HandConfidenceHistoriesRight[DevicesToCombine[FrameIdx]->GetDevice()].AddConfidence(Confidence);
-		Confidence = HandConfidenceHistoriesRight[DevicesToCombine[FrameIdx]->GetDevice()].GetAveragedConfidence();
+		*OutTerms = Terms;
 	}
 
+	// average out new hand confidence with that of the last few frames
+	History.HandConfidences.AddConfidence(Confidence);
+	Confidence = History.HandConfidences.GetAveragedConfidence();
+
 	return Confidence;
 }
 
@@ -555,23 +619,20 @@ float FUltraleapCombinedDeviceConfidence::ConfidenceRelativeHandRot(
 /// returns a high confidence, if the velocity is low, and a low confidence otherwise.
 /// Returns 0, if the hand hasn't been consistently tracked for about the last 10 frames
 /// </summary>
-float FUltraleapCombinedDeviceConfidence::ConfidenceRelativeHandVelocity(
-	IHandTrackingDevice* Provider, const FTransform& SourceDeviceOrigin, const FVector HandPos, const bool IsLeft)
+float FUltraleapCombinedDeviceConfidence::ConfidenceRelativeHandVelocity(const FSourceHandHistory& History, const FVector HandPos)
 {
 	FVector OldPosition;
-	float OldTime;
+	double OldTime;
 
-	bool PositionsRecorded = IsLeft ? LastLeftHandPositions[Provider].GetOldestPosition(OldPosition, OldTime)
-									: LastRightHandPositions[Provider].GetOldestPosition(OldPosition, OldTime);
-
-	// if we haven't recorded any positions yet, or the hand hasn't been present in the last 10 frames (oldest position is older
-	// than 10 * frame time), return 0
-	if (!PositionsRecorded || (GetTime() - OldTime) > DeltaTimeFromTick * 10)
+	// the history is cleared whenever the hand is lost, so the oldest position is at most 10 frames old
+	// if we haven't recorded enough positions yet, return 0
+	if (History.Positions.GetNumPositions() < 2 || !History.Positions.GetOldestPosition(OldPosition, OldTime) ||
+		History.FrameTime <= OldTime)
 	{
 		return 0;
 	}
 
-	float Velocity = FVector::Distance(HandPos, OldPosition) / (GetTime() - OldTime);
+	float Velocity = FVector::Distance(HandPos, OldPosition) / (History.FrameTime - OldTime);
 
 	float Confidence = 0;
 	if (Velocity < 2)
@@ -582,14 +643,14 @@ float FUltraleapCombinedDeviceConfidence::ConfidenceRelativeHandVelocity(
 	return Confidence;
 }
 
-float FUltraleapCombinedDeviceConfidence::ConfidenceTimeSinceHandFirstVisible(IHandTrackingDevice* Provider, const bool IsLeft)
+float FUltraleapCombinedDeviceConfidence::ConfidenceTimeSinceHandFirstVisible(const FSourceHandHistory& History)
 {
-	if ((IsLeft ? LeftHandFirstVisible[Provider] : RightHandFirstVisible[Provider]) == 0)
+	if (!History.bVisible)
 	{
 		return 0;
 	}
 
-	float LengthVisible = GetTime() - (IsLeft ? LeftHandFirstVisible[Provider] : RightHandFirstVisible[Provider]);
+	float LengthVisible = History.FrameTime - History.FirstVisibleTime;
 
 	float Confidence = 1;
 	if (LengthVisible < 1)
@@ -620,6 +681,10 @@ void FUltraleapCombinedDeviceConfidence::CalculateJointConfidence(
 	{
 		ConfidenceRelativeJointRotToPalmRot(ConfidencesJointPalmRot[idx], SourceDeviceOrigin, Hand);
 	}
+	if (JointOcclusionFactor != 0 && bUseAnalyticJointOcclusion)
+	{
+		JointOcclusionEstimator.Estimate(Hand, SourceDeviceOrigin.GetLocation(), ConfidencesJointOcclusion[idx]);
+	}
 
 	for (int FingerIdx = 0; FingerIdx < 5; FingerIdx++)
 	{
@@ -643,24 +708,9 @@ void FUltraleapCombinedDeviceConfidence::CalculateJointConfidence(
 	}
 
 	// average out new joint confidence with that of the last few frames
-	if (Hand.HandType == EHandType::LEAP_HAND_LEFT)
-	{
-		if (!JointConfidenceHistoriesLeft.Contains(DevicesToCombine[FrameIdx]->GetDevice()))
-		{
-			JointConfidenceHistoriesLeft.Add(DevicesToCombine[FrameIdx]->GetDevice(), FJointConfidenceHistory(NumJointPositions));
-		}
-		JointConfidenceHistoriesLeft[DevicesToCombine[FrameIdx]->GetDevice()].AddConfidences(JointConfidences[idx]);
-		JointConfidences[idx] = JointConfidenceHistoriesLeft[DevicesToCombine[FrameIdx]->GetDevice()].GetAveragedConfidences();
-	}
-	else
-	{
-		if (!JointConfidenceHistoriesRight.Contains(DevicesToCombine[FrameIdx]->GetDevice()))
-		{
-			JointConfidenceHistoriesRight.Add(DevicesToCombine[FrameIdx]->GetDevice(), FJointConfidenceHistory(NumJointPositions));
-		}
-		JointConfidenceHistoriesRight[DevicesToCombine[FrameIdx]->GetDevice()].AddConfidences(JointConfidences[idx]);
-		JointConfidences[idx] = JointConfidenceHistoriesRight[DevicesToCombine[FrameIdx]->GetDevice()].GetAveragedConfidences();
-	}
+	FJointConfidenceHistory& History = SourceHandHistories[idx].JointConfidences;
+	History.AddConfidences(JointConfidences[idx]);
+	History.GetAveragedConfidences(JointConfidences[idx]);
 
 	RetConfidences = JointConfidences[idx];
 }
@@ -817,12 +867,6 @@ void FUltraleapCombinedDeviceConfidence::ConfidenceRelativeJointRotToPalmRot(
 
 	return;
 }
-float DistanceBetweenColors(const FLinearColor& Color1,const FLinearColor& Color2)
-{
-	FLinearColor ColorDifference = Color1 - Color2;
-	FVector DiffVector(ColorDifference.R, ColorDifference.G, ColorDifference.B);
-	return DiffVector.Size();
-}
 /// <summary>
 /// return an array of joint confidences that is determined by joint occlusion.
 /// It uses a capsule hand rendered on a camera sitting at the deviceOrigin.
@@ -862,34 +906,7 @@ void FUltraleapCombinedDeviceConfidence::StoreConfidenceJointOcclusion(AJointOcc
 			
 
 			OptimalPixelsCount[ConfidenceKey] = (int) (12);
-			FLinearColor TestColour;
-			if (HandType == LEAP_HAND_LEFT)
-			{
-				TestColour = JointOcclusionActor->SphereColoursLeft[JointColoursKey];	
-			}
-			else
-			{
-				TestColour = JointOcclusionActor->SphereColoursRight[JointColoursKey];
-			}
-			const int32* NumPixelsOfColour = ColourMap->ColourCountMap.Find(TestColour);
-			PixelsSeenCount[ConfidenceKey] = 0;
-		
-			if (NumPixelsOfColour)
-			{
-				PixelsSeenCount[ConfidenceKey] = *NumPixelsOfColour;
-			}
-			else
-			{
-				for (auto& KeyPair : ColourMap->ColourCountMap)
-				{
-					const float Distance = DistanceBetweenColors(TestColour, KeyPair.Key);
-					if (Distance < 0.01)
-					{
-						PixelsSeenCount[ConfidenceKey] = KeyPair.Value;
-						break;
-					}
-				}
-			}
+			PixelsSeenCount[ConfidenceKey] = ColourMap->GetJointPixelCount(HandType, JointColoursKey);
 		}
 	}
 
@@ -7,68 +7,67 @@
  ******************************************************************************/
 
 #pragma once
+#include "CombinedDeviceTelemetry.h"
 #include "FUltraleapCombinedDevice.h"
 #include "JointOcclusionActor.h"
+#include "JointOcclusionEstimator.h"
 
+// Fixed size ring of recent palm positions, timed by tracking timestamp
 class FHandPositionHistory
 {
 public:
 	FHandPositionHistory()
 	{
-		Positions.AddZeroed(NumItems);
-		Times.AddZeroed(NumItems);
-		Index = 0;
+		ClearAllPositions();
 	}
 
 	void ClearAllPositions()
 	{
-		Positions.Empty();
-		Positions.AddZeroed(NumItems);
+		Index = 0;
+		Count = 0;
 	}
 
-	void AddPosition(const FVector& Position, const float Time)
+	void AddPosition(const FVector& Position, const double Time)
 	{
+		// a device that hasn't produced a new frame since the last combine adds nothing
+		if (Count > 0 && Times[(Index - 1 + NumItems) % NumItems] == Time)
+		{
+			return;
+		}
 		Positions[Index] = Position;
 		Times[Index] = Time;
 		Index = (Index + 1) % NumItems;
+		Count = FMath::Min(Count + 1, NumItems);
 	}
 
-	bool GetPastPosition(const int PastIndex, FVector& Position, float& Time)
+	bool GetPastPosition(const int PastIndex, FVector& Position, double& Time) const
 	{
-		Position = Positions[(Index - 1 - PastIndex + NumItems) % NumItems];
-		Time = Times[(Index - 1 - PastIndex + NumItems) % NumItems];
-
-		if (Position == FVector::ZeroVector)
+		if (PastIndex >= Count)
 		{
 			return false;
 		}
-		else
-		{
-			return true;
-		}
+		Position = Positions[(Index - 1 - PastIndex + NumItems) % NumItems];
+		Time = Times[(Index - 1 - PastIndex + NumItems) % NumItems];
+		return true;
 	}
 
-	bool GetOldestPosition(FVector& Position, float& Time)
+	bool GetOldestPosition(FVector& Position, double& Time) const
 	{
-		for (int i = (NumItems - 1); i >= 0; i--)
-		{
-			if (GetPastPosition(i, Position, Time))
-			{
-				return true;
-			}
-		}
+		return GetPastPosition(Count - 1, Position, Time);
+	}
 
-		GetPastPosition(0, Position, Time);
-		return false;
+	int GetNumPositions() const
+	{
+		return Count;
 	}
 
 protected:
-	IHandTrackingDevice* Provider;
-	TArray<FVector> Positions;
-	TArray<float> Times;
-	int Index;
-
 	static const int NumItems = 10;
+
+	FVector Positions[NumItems];
+	double Times[NumItems];
+	int Index;
+	int Count;
 };
 
 // small helper class to save previous joint confidences and average over them
@@ -76,65 +75,57 @@ class FJointConfidenceHistory
 {
 
 public:
-	FJointConfidenceHistory(const int NumJointPositions, const int LengthIn = 60)
+	FJointConfidenceHistory(const int NumJointPositionsIn = 0, const int LengthIn = 60)
 	{
+		NumJointPositions = NumJointPositionsIn;
 		Length = LengthIn;
-		JointConfidences.AddZeroed(Length);
-
-		for (int i = 0; i < Length; ++i)
-		{
-			JointConfidences[i].AddZeroed(NumJointPositions);
-		}
-		Index = 0;
+		JointConfidences.AddZeroed(Length * NumJointPositions);
+		ClearAll();
 	}
 
 	void ClearAll()
 	{
-		ValidIndices.Empty();
+		Index = 0;
+		Count = 0;
 	}
 
 	void AddConfidences(const TArray<float>& Confidences)
 	{
-		for (int JointIndex = 0; JointIndex < Confidences.Num(); JointIndex++)
-		{
-			JointConfidences[Index][JointIndex] = Confidences[JointIndex];
-		}
-		if (ValidIndices.Find(Index) == -1)
-		{
-			ValidIndices.Add(Index);
-		}
+		const int NumToCopy = FMath::Min(Confidences.Num(), NumJointPositions);
+		FMemory::Memcpy(&JointConfidences[Index * NumJointPositions], Confidences.GetData(), NumToCopy * sizeof(float));
+
 		Index = (Index + 1) % Length;
+		Count = FMath::Min(Count + 1, Length);
 	}
 
-	TArray<float> GetAveragedConfidences()
+	// Leaves AverageConfidences empty if nothing has been added
+	void GetAveragedConfidences(TArray<float>& AverageConfidences) const
 	{
-		TArray<float> EmptyRet;
-
-		if (ValidIndices.Num() == 0)
+		AverageConfidences.Reset();
+		if (Count == 0)
 		{
-			return EmptyRet;
+			return;
 		}
+		AverageConfidences.AddZeroed(NumJointPositions);
 
-		AverageConfidences.Empty();
-		AverageConfidences.AddZeroed(JointConfidences[0].Num());
-
-		for (int i = 0; i < AverageConfidences.Num(); i++)
+		// only the first Count slots have been written until the ring wraps
+		for (int j = 0; j < Count; j++)
 		{
-			for(int j : ValidIndices)
+			const float* Confidences = &JointConfidences[j * NumJointPositions];
+			for (int i = 0; i < NumJointPositions; i++)
 			{
-				AverageConfidences[i] += JointConfidences[j][i] / ValidIndices.Num();
+				AverageConfidences[i] += Confidences[i] / Count;
 			}
 		}
-
-		return AverageConfidences;
 	}
 
 protected:
+	int NumJointPositions;
 	int Length;
-	TArray<TArray<float>> JointConfidences;
-	TArray<float> AverageConfidences;
+	// Length x NumJointPositions
+	TArray<float> JointConfidences;
 	int Index;
-	TArray<int> ValidIndices;
+	int Count;
 };
 
 // small helper class to save previous whole-hand confidences and average over them
@@ -145,46 +136,58 @@ public:
 	{
 		Length = LengthIn;
 		HandConfidences.AddZeroed(Length);
-		Index = 0;
+		ClearAll();
 	}
 
 	void ClearAll()
 	{
-		ValidIndices.Empty();
+		Index = 0;
+		Count = 0;
 	}
 
 	void AddConfidence(const float Confidence)
 	{
 		HandConfidences[Index] = Confidence;
 
-		if (ValidIndices.Find(Index) == -1)
-		{
-			ValidIndices.Add(Index);
-		}
 		Index = (Index + 1) % Length;
+		Count = FMath::Min(Count + 1, Length);
 	}
 
-	float GetAveragedConfidence()
+	float GetAveragedConfidence() const
 	{
-		if (ValidIndices.Num() == 0)
+		if (Count == 0)
 		{
 			return 0;
 		}
 
 		float ConfidenceSum = 0;
-		for (int j : ValidIndices)
+		for (int j = 0; j < Count; j++)
 		{
 			ConfidenceSum += HandConfidences[j];
 		}
 
-		return ConfidenceSum / ValidIndices.Num();
+		return ConfidenceSum / Count;
 	}
 
 protected:
 	int Length;
 	TArray<float> HandConfidences;
 	int Index;
-	TArray<int> ValidIndices;
+	int Count;
+};
+
+// History of one hand (chirality) as seen by one source device
+struct FSourceHandHistory
+{
+	FHandPositionHistory Positions;
+	FJointConfidenceHistory JointConfidences;
+	FHandConfidenceHistory HandConfidences;
+
+	// Tracking time (seconds) the hand was first seen in its current visible run
+	double FirstVisibleTime = 0;
+	// Tracking time of the latest source frame
+	double FrameTime = 0;
+	bool bVisible = false;
 };
  
 
@@ -199,8 +202,12 @@ public:
 	virtual void GetDebugInfo(int32& NumCombinedLeft, int32& NumCombinedRight) override;
 
 protected:
-	virtual void CombineFrame(const TArray<FLeapFrameData>& SourceFrames) override;
-	
+	virtual void CombineFrame(const TArray<FLeapFrameSnapshot>& SourceFrames, FLeapFrameData& CombinedFrame) override;
+	virtual void OnCombinedFramePickedUp() override;
+
+	// Hand and joint confidences are normalised across Hands, override to change how the confident hands are blended
+	virtual void MergeHands(const TArray<const FLeapHandData*>& Hands, const TArray<float>& HandConfidences,
+		const TArray<TArray<float>>& JointConfidences, FLeapHandData& HandRet);
 
 public:
 	 //If true, the overall hand confidence is affected by the duration a new hand has been visible for. When a new hand is seen for the first time, its confidence is 0. After a hand has been visible for a second, its confidence is determined by the below palm factors and palm confidences
@@ -227,16 +234,12 @@ public:
     float JointRotToPalmFactor = 0.2;
     //How much should joint occlusion influence the overall hand confidence?
     //   [Range(0f, 1f)]
+    // Taken from FLeapOptions::JointOcclusionFactor at the start of each combine
     float JointOcclusionFactor = 0;
 
 
     bool DebugJointOrigins = false;
-     
-    TMap<IHandTrackingDevice*, FHandPositionHistory> LastLeftHandPositions;
-	TMap<IHandTrackingDevice*, FHandPositionHistory> LastRightHandPositions;
 
-	TMap<IHandTrackingDevice*, float> LeftHandFirstVisible;
-	TMap<IHandTrackingDevice*, float> RightHandFirstVisible;
 private:
 
 	TArray<TArray<float>> JointConfidences;
@@ -244,24 +247,36 @@ private:
 	TArray<TArray<float>> ConfidencesJointPalmRot;
 	TArray<TArray<float>> ConfidencesJointOcclusion;
 
-    TMap<IHandTrackingDevice*, FJointConfidenceHistory> JointConfidenceHistoriesLeft;
-	TMap<IHandTrackingDevice*, FJointConfidenceHistory> JointConfidenceHistoriesRight;
-	
+	// Written from the joint occlusion actor tick, copied into ConfidencesJointOcclusion when a combine starts
+	TArray<TArray<float>> PendingConfidencesJointOcclusion;
+	FCriticalSection JointOcclusionSection;
+	// Used instead of the joint occlusion actor with FLeapOptions::bUseAnalyticJointOcclusion
+	FJointOcclusionEstimator JointOcclusionEstimator;
+	bool bUseAnalyticJointOcclusion = false;
 
-    TMap<IHandTrackingDevice*, FHandConfidenceHistory> HandConfidenceHistoriesLeft;
-	TMap<IHandTrackingDevice*, FHandConfidenceHistory> HandConfidenceHistoriesRight;
+	// Indexed by source device * 2 + (0 for left, 1 for right), as the confidence arrays
+	TArray<FSourceHandHistory> SourceHandHistories;
 
+	// Written by the combine, snapshotted for GetDebugInfo when the combined frame is picked up
 	int32 NumLeftHands = 0;
 	int32 NumRightHands = 0;
-
-	void MergeFrames(const TArray<FLeapFrameData>& SourceFrames, FLeapFrameData& CombinedFrame);
-	void AddFrameToTimeVisibleDicts(const TArray<FLeapFrameData>& Frames, const int FrameIdx);
-	float CalculateHandConfidence(int FrameIdx, const FLeapHandData& Hand);
+	int32 PickedUpNumLeftHands = 0;
+	int32 PickedUpNumRightHands = 0;
+
+	// Telemetry, the most heavily weighted source device per hand last combine
+	typedef TArray<FCombinedDeviceTelemetryRecord, TInlineAllocator<4>> FTelemetryRecords;
+	int32 DominantTelemetrySource[2] = {INDEX_NONE, INDEX_NONE};
+	void AddTelemetryRecord(FTelemetryRecords& Records, const int FrameIdx, const FLeapHandData& Hand, const float HandConfidence,
+		const FCombinedDeviceConfidenceTerms& Terms, const TArray<float>& HandJointConfidences);
+	void SubmitTelemetryRecords(FTelemetryRecords& Records, const TArray<float>& NormalisedHandConfidences);
+
+	void MergeFrames(const TArray<FLeapFrameSnapshot>& SourceFrames, FLeapFrameData& CombinedFrame);
+	void AddFrameToHandHistories(const TArray<FLeapFrameSnapshot>& Frames, const int FrameIdx);
+	float CalculateHandConfidence(int FrameIdx, const FLeapHandData& Hand, FCombinedDeviceConfidenceTerms* OutTerms = nullptr);
 	float ConfidenceRelativeHandPos(IHandTrackingDevice* Provider, const FTransform& DeviceOrigin, const FVector& HandPos);
 	float ConfidenceRelativeHandRot(const FTransform& DeviceOrigin, const FVector& HandPos, const FVector& PalmNormal);
-	float ConfidenceRelativeHandVelocity(
-		IHandTrackingDevice* Provider, const FTransform& DeviceOrigin, const FVector HandPos, const bool isLeft);
-	float ConfidenceTimeSinceHandFirstVisible(IHandTrackingDevice* Provider, const bool isLeft);
+	float ConfidenceRelativeHandVelocity(const FSourceHandHistory& History, const FVector HandPos);
+	float ConfidenceTimeSinceHandFirstVisible(const FSourceHandHistory& History);
 
 	void CalculateJointConfidence(
 		const int FrameIdx, const FLeapHandData& Hand, TArray<float>& RetConfidences);
@@ -273,7 +288,4 @@ private:
 	void StoreConfidenceJointOcclusion(AJointOcclusionActor*, TArray<float>& Confidences, const FTransform& DeviceOrigin,
 		const EHandType HandType, IHandTrackingWrapper* Provider);
 
-
-	void MergeHands(const TArray<const FLeapHandData*>& Hands, const TArray<float>& HandConfidences,
-		const TArray<TArray<float>>& JointConfidences, FLeapHandData& HandRet);
 };
@@ -0,0 +1,181 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "FUltraleapCombinedDeviceKalman.h"
+
+namespace
+{
+// Confidences are normalised across hands, a hand with no confidence is still a (very noisy) measurement
+const float MinMeasurementWeight = 0.01f;
+// Longest step we predict over, a stall shouldn't fling the hand
+const float MaxDeltaTime = 0.1f;
+}	 // namespace
+
+void FKalmanPointFilter::Predict(const float DeltaTime, const float ProcessNoise)
+{
+	if (!bValid || DeltaTime <= 0)
+	{
+		return;
+	}
+	const float DeltaTime2 = DeltaTime * DeltaTime;
+
+	Position += Velocity * DeltaTime;
+
+	// P = F P F' + Q, white noise acceleration
+	P00 += 2.0f * DeltaTime * P01 + DeltaTime2 * P11 + ProcessNoise * DeltaTime2 * DeltaTime2 * 0.25f;
+	P01 += DeltaTime * P11 + ProcessNoise * DeltaTime2 * DeltaTime * 0.5f;
+	P11 += ProcessNoise * DeltaTime2;
+}
+
+void FKalmanPointFilter::Update(const FVector& Measurement, const float MeasurementNoise, const float InitialVelocityNoise)
+{
+	if (!bValid)
+	{
+		Position = Measurement;
+		Velocity = FVector::ZeroVector;
+		P00 = MeasurementNoise;
+		P01 = 0;
+		P11 = InitialVelocityNoise;
+		bValid = true;
+		return;
+	}
+	const float Innovation = P00 + MeasurementNoise;
+	const float PositionGain = P00 / Innovation;
+	const float VelocityGain = P01 / Innovation;
+	const FVector Residual = Measurement - Position;
+
+	Position += Residual * PositionGain;
+	Velocity += Residual * VelocityGain;
+
+	P11 -= VelocityGain * P01;
+	P01 *= 1.0f - PositionGain;
+	P00 *= 1.0f - PositionGain;
+}
+
+void FUltraleapCombinedDeviceKalman::FHandFilter::Reset()
+{
+	Palm.bValid = false;
+	for (FKalmanPointFilter& Joint : Joints)
+	{
+		Joint.bValid = false;
+	}
+	AngularVelocity = FVector::ZeroVector;
+	bValid = false;
+}
+
+void FUltraleapCombinedDeviceKalman::CombineFrame(const TArray<FLeapFrameSnapshot>& SourceFrames, FLeapFrameData& CombinedFrame)
+{
+	const FLeapOptions& Options = GetCombineOptions();
+	ProcessNoise = Options.KalmanProcessNoise;
+	MeasurementNoise = FMath::Max(Options.KalmanMeasurementNoise, KINDA_SMALL_NUMBER);
+	PredictionTime = Options.KalmanPredictionTime;
+
+	// time aligned sources share the target timestamp, otherwise the newest frame is the latest measurement
+	int64 TimeStamp = 0;
+	for (const FLeapFrameSnapshot& Frame : SourceFrames)
+	{
+		TimeStamp = FMath::Max(TimeStamp, Frame->TimeStamp);
+	}
+	FrameTime = TimeStamp / 1000000.0;
+
+	FUltraleapCombinedDeviceConfidence::CombineFrame(SourceFrames, CombinedFrame);
+}
+
+void FUltraleapCombinedDeviceKalman::MergeHands(const TArray<const FLeapHandData*>& Hands, const TArray<float>& HandConfidences,
+	const TArray<TArray<float>>& JointConfidencesIn, FLeapHandData& HandRet)
+{
+	const bool IsLeft = (Hands[0]->HandType == EHandType::LEAP_HAND_LEFT);
+	FHandFilter& Filter = IsLeft ? LeftHandFilter : RightHandFilter;
+
+	float DeltaTime = Filter.bValid ? (float) (FrameTime - Filter.LastUpdateTime) : 0.0f;
+	if (DeltaTime > ResetAfterTime || DeltaTime < 0)
+	{
+		// a gap, or time went backwards as a device was swapped or the service restarted
+		Filter.Reset();
+		DeltaTime = 0;
+	}
+	else if (Filter.bValid && DeltaTime == 0)
+	{
+		// the same tracking frame again, measuring it twice would overstate its confidence
+		HandRet = Filter.LastMergedHand;
+		return;
+	}
+	DeltaTime = FMath::Min(DeltaTime, MaxDeltaTime);
+	Filter.LastUpdateTime = FrameTime;
+
+	// palm position, each device is a measurement weighted by its confidence. As confidences sum to one, equally
+	// confident devices fuse to a single measurement of MeasurementNoise
+	Filter.Palm.Predict(DeltaTime, ProcessNoise);
+	for (int HandsIdx = 0; HandsIdx < Hands.Num(); HandsIdx++)
+	{
+		const float Weight = FMath::Max(HandConfidences[HandsIdx], MinMeasurementWeight);
+		Filter.Palm.Update(Hands[HandsIdx]->Palm.Position, MeasurementNoise / Weight, InitialVelocityNoise);
+	}
+
+	// palm rotation isn't filtered, merged as the confidence combiner does and extrapolated with a smoothed angular velocity
+	FQuat MergedPalmRot = Hands[0]->Palm.Orientation.Quaternion();
+	float ConfidenceSum = HandConfidences[0];
+	for (int HandsIdx = 1; HandsIdx < Hands.Num(); HandsIdx++)
+	{
+		const float NextConfidenceSum = ConfidenceSum + HandConfidences[HandsIdx];
+		const float LerpValue = NextConfidenceSum > 0 ? ConfidenceSum / NextConfidenceSum : 0.5f;
+		MergedPalmRot = FQuat::FastLerp(Hands[HandsIdx]->Palm.Orientation.Quaternion(), MergedPalmRot, LerpValue);
+		ConfidenceSum = NextConfidenceSum;
+	}
+	MergedPalmRot.Normalize();
+	if (Filter.bValid && DeltaTime > 0)
+	{
+		FVector Axis;
+		float Angle;
+		(MergedPalmRot * Filter.PalmRotation.Inverse()).GetNormalized().ToAxisAndAngle(Axis, Angle);
+		if (Angle > PI)
+		{
+			Angle -= 2.0f * PI;
+		}
+		Filter.AngularVelocity = FMath::Lerp(Filter.AngularVelocity, Axis * (Angle / DeltaTime), 0.5f);
+	}
+	Filter.PalmRotation = MergedPalmRot;
+
+	// joints, in the palm relative linear layout used by the other combiners
+	LocalJointPositions.SetNumZeroed(NumJointPositions);
+	for (FKalmanPointFilter& Joint : Filter.Joints)
+	{
+		Joint.Predict(DeltaTime, ProcessNoise);
+	}
+	for (int HandsIdx = 0; HandsIdx < Hands.Num(); HandsIdx++)
+	{
+		CreateLocalLinearJointList(*Hands[HandsIdx], LocalJointPositions);
+		for (int JointIdx = 0; JointIdx < NumJointPositions; JointIdx++)
+		{
+			const float Weight = FMath::Max(JointConfidencesIn[HandsIdx][JointIdx], MinMeasurementWeight);
+			Filter.Joints[JointIdx].Update(LocalJointPositions[JointIdx], MeasurementNoise / Weight, InitialVelocityNoise);
+		}
+	}
+	Filter.bValid = true;
+
+	// predict forward to display time
+	const float Lead = PredictionTime + (bPredictAlignmentDelay ? GetCombinedFrameDelayInMS() / 1000.0f : 0.0f);
+
+	PredictedJointPositions.SetNumZeroed(NumJointPositions);
+	for (int JointIdx = 0; JointIdx < NumJointPositions; JointIdx++)
+	{
+		PredictedJointPositions[JointIdx] = Filter.Joints[JointIdx].Position + Filter.Joints[JointIdx].Velocity * Lead;
+	}
+	const FVector PalmPos = Filter.Palm.Position + Filter.Palm.Velocity * Lead;
+
+	FQuat PalmRot = MergedPalmRot;
+	const float AngularSpeed = Filter.AngularVelocity.Size();
+	if (AngularSpeed > KINDA_SMALL_NUMBER)
+	{
+		PalmRot = FQuat(Filter.AngularVelocity / AngularSpeed, AngularSpeed * Lead) * MergedPalmRot;
+	}
+
+	// combine everything to a hand
+	ConvertToWorldSpaceHand(HandRet, IsLeft, PalmPos, PalmRot, PredictedJointPositions);
+	Filter.LastMergedHand = HandRet;
+}
@@ -0,0 +1,86 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+#include "FUltraleapCombinedDeviceConfidence.h"
+
+// Constant velocity Kalman filter for one point. The axes are filtered independently but share a covariance as they
+// share the same model and noise
+struct FKalmanPointFilter
+{
+	FVector Position = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+
+	// Position/velocity covariance
+	float P00 = 0;
+	float P01 = 0;
+	float P11 = 0;
+
+	bool bValid = false;
+
+	void Predict(const float DeltaTime, const float ProcessNoise);
+	void Update(const FVector& Measurement, const float MeasurementNoise, const float InitialVelocityNoise);
+};
+
+/**
+ * Confidence combiner that, rather than blending the current frames, feeds each device's hand into a per joint
+ * constant velocity Kalman filter with measurement noise scaled by that device's confidence. The filtered hand is
+ * predicted forward to display time, which hides the time alignment delay and reduces jitter.
+ */
+class FUltraleapCombinedDeviceKalman : public FUltraleapCombinedDeviceConfidence
+{
+public:
+	FUltraleapCombinedDeviceKalman(IHandTrackingWrapper* LeapDeviceWrapperIn, ITrackingDeviceWrapper* TrackingDeviceWrapperIn,
+		TArray<IHandTrackingWrapper*> DevicesToCombineIn)
+		: FUltraleapCombinedDeviceConfidence(LeapDeviceWrapperIn, TrackingDeviceWrapperIn, DevicesToCombineIn)
+	{
+	}
+
+protected:
+	virtual void CombineFrame(const TArray<FLeapFrameSnapshot>& SourceFrames, FLeapFrameData& CombinedFrame) override;
+	virtual void MergeHands(const TArray<const FLeapHandData*>& Hands, const TArray<float>& HandConfidences,
+		const TArray<TArray<float>>& JointConfidences, FLeapHandData& HandRet) override;
+
+public:
+	// Acceleration noise (cm^2/s^3), taken from FLeapOptions::KalmanProcessNoise at the start of each combine
+	float ProcessNoise = 10000.0f;
+	// Variance (cm^2) of a fully confident measurement, taken from FLeapOptions::KalmanMeasurementNoise
+	float MeasurementNoise = 0.25f;
+	// Velocity variance (cm^2/s^2) for a newly seen hand
+	float InitialVelocityNoise = 10000.0f;
+	// Seconds to predict forward on top of the time alignment delay, taken from FLeapOptions::KalmanPredictionTime
+	float PredictionTime = 0.0f;
+	// Predict forward by the delay the sources were resampled at, so time alignment doesn't add latency
+	bool bPredictAlignmentDelay = true;
+	// A hand unseen for longer than this (seconds) starts a new filter
+	float ResetAfterTime = 0.25f;
+
+private:
+	struct FHandFilter
+	{
+		FKalmanPointFilter Palm;
+		FKalmanPointFilter Joints[NumJointPositions];
+		FQuat PalmRotation = FQuat::Identity;
+		FVector AngularVelocity = FVector::ZeroVector;
+		double LastUpdateTime = 0;
+		FLeapHandData LastMergedHand;
+		bool bValid = false;
+
+		void Reset();
+	};
+
+	FHandFilter LeftHandFilter;
+	FHandFilter RightHandFilter;
+
+	// Tracking time (seconds) of the frame being combined, from the source frame timestamps so the filter steps by
+	// the time between tracking frames rather than between combines
+	double FrameTime = 0;
+
+	TArray<FVector> LocalJointPositions;
+	TArray<FVector> PredictedJointPositions;
+};
@@ -11,8 +11,51 @@
 #include "LeapComponent.h"
 #include "FUltraleapCombinedDevice.h"
 #include "Engine/TextureRenderTarget2D.h"
+#include "JointOcclusionBinning.h"
+#include "RHIGPUReadback.h"
 
+namespace
+{
+// rendered colours within this distance of a sphere colour count as that sphere
+const float PaletteTolerance = 0.01f;
+
+bool IsPaletteMatch(const FLinearColor& Colour, const FLinearColor& PaletteColour)
+{
+	return FMath::Square(Colour.R - PaletteColour.R) + FMath::Square(Colour.G - PaletteColour.G) +
+			   FMath::Square(Colour.B - PaletteColour.B) <
+		   FMath::Square(PaletteTolerance);
+}
 
+void BinPixel(const FLinearColor& Colour, const TArray<FLinearColor>& Palette, TArray<int32>& PaletteCounts, int32& LastIndex)
+{
+	if (Colour.IsAlmostBlack())
+	{
+		return;
+	}
+	// neighbouring pixels are mostly the same sphere
+	if (Palette.IsValidIndex(LastIndex) && IsPaletteMatch(Colour, Palette[LastIndex]))
+	{
+		PaletteCounts[LastIndex]++;
+		return;
+	}
+	for (int32 i = 0; i < Palette.Num(); i++)
+	{
+		if (IsPaletteMatch(Colour, Palette[i]))
+		{
+			PaletteCounts[i]++;
+			LastIndex = i;
+			return;
+		}
+	}
+}
+}	 // namespace
+
+FJointOcclusionReadback::FJointOcclusionReadback() : bCopyPending(false), bHasResult(false)
+{
+}
+FJointOcclusionReadback::~FJointOcclusionReadback()
+{
+}
 
 FLinearColor LerpLinearColor(const FLinearColor& Left, const FLinearColor& Right, const float Alpha)
 {
@@ -27,6 +70,8 @@ AJointOcclusionActor::AJointOcclusionActor()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	bUseAsyncReadback = true;
+
 	LeapComponent = CreateDefaultSubobject<ULeapComponent>(TEXT("Leap component"));
 
 	static const bool DebugSimpleColours = true;
@@ -60,6 +105,29 @@ void AJointOcclusionActor::SetupColours(const bool DebugSimpleColours, const boo
 				FColor::Yellow, FColor::Blue, (float) i / (float) FUltraleapCombinedDevice::NumJointPositions));
 		}
 	}
+	BuildPalette();
+}
+void AJointOcclusionActor::BuildPalette()
+{
+	Palette.Reset();
+	JointPaletteIndices.Reset();
+
+	auto AddJoint = [this](const FLinearColor& Colour) {
+		int32 Index = Palette.IndexOfByPredicate([&Colour](const FLinearColor& Entry) { return IsPaletteMatch(Colour, Entry); });
+		if (Index == INDEX_NONE)
+		{
+			Index = Palette.Add(Colour);
+		}
+		JointPaletteIndices.Add(Index);
+	};
+	for (const FLinearColor& Colour : SphereColoursLeft)
+	{
+		AddJoint(Colour);
+	}
+	for (const FLinearColor& Colour : SphereColoursRight)
+	{
+		AddJoint(Colour);
+	}
 }
 // Called when the game starts or when spawned
 void AJointOcclusionActor::BeginPlay()
@@ -71,49 +139,114 @@ void AJointOcclusionActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	for (auto Map : ColourCountMaps)
 	{
+		if (Map->Readback.IsValid())
+		{
+			// a readback may still be in flight, let the render thread release it
+			ENQUEUE_RENDER_COMMAND(ReleaseJointOcclusionReadback)
+			([Readback = MoveTemp(Map->Readback)](FRHICommandListImmediate& RHICmdList) mutable { Readback.Reset(); });
+		}
 		delete Map;
 	}
+	ColourCountMaps.Empty();
 	Super::EndPlay(EndPlayReason);
 }
-void AJointOcclusionActor::CountColoursInSceneCapture(
-	const USceneCaptureComponent2D* SceneCapture, const FString& DeviceSerial, TMap<FLinearColor, int32>& ColourCountMap)
+void AJointOcclusionActor::UpdateJointPixelCounts(const TArray<int32>& PaletteCounts, FColourMap& ColourMap) const
+{
+	ColourMap.JointPixelCounts.SetNumUninitialized(JointPaletteIndices.Num());
+	for (int32 i = 0; i < JointPaletteIndices.Num(); i++)
+	{
+		const int32 PaletteIndex = JointPaletteIndices[i];
+		const int32 Count = PaletteCounts.IsValidIndex(PaletteIndex) ? PaletteCounts[PaletteIndex] : 0;
+
+		// filter out odd pixels we don't care about
+		ColourMap.JointPixelCounts[i] = Count < 2 ? 0 : Count;
+	}
+}
+// Blocking fallback, stalls the game thread until the GPU has caught up
+void AJointOcclusionActor::CountColoursInSceneCapture(const USceneCaptureComponent2D* SceneCapture, FColourMap& ColourMap)
 {
-	auto RenderTarget = SceneCapture->TextureTarget->GameThread_GetRenderTargetResource();
+	auto RenderTarget = SceneCapture->TextureTarget ? SceneCapture->TextureTarget->GameThread_GetRenderTargetResource() : nullptr;
 	if (RenderTarget)
 	{
-		TArray<FLinearColor> Output;
-		bool Success = RenderTarget->ReadLinearColorPixels(Output);
-		
+		bool Success = RenderTarget->ReadLinearColorPixels(CPUReadbackPixels);
+
 		if (Success)
 		{
-			ColourCountMap.Empty();
-			
-			for (const auto& Color : Output)
+			CPUPaletteCounts.Reset();
+			CPUPaletteCounts.AddZeroed(Palette.Num());
+
+			int32 LastIndex = INDEX_NONE;
+			for (const auto& Color : CPUReadbackPixels)
 			{
-				if (Color.IsAlmostBlack())
-				{
-					continue;
-				}
-				if (ColourCountMap.Find(Color))
-				{
-					ColourCountMap[Color] = ColourCountMap[Color]+1;
-				}
-				else
-				{
-					ColourCountMap.Add(Color, 1);
-				}
+				BinPixel(Color, Palette, CPUPaletteCounts, LastIndex);
 			}
-			// filter out odd pixels we don't care about
-			auto ColourCountMapCopy = ColourCountMap;
-			for (auto& KeyPair : ColourCountMapCopy)
+			UpdateJointPixelCounts(CPUPaletteCounts, ColourMap);
+		}
+	}
+}
+// Picks up the last finished readback and queues the next, results lag the capture by one or two frames
+void AJointOcclusionActor::ReadSceneCaptureAsync(const USceneCaptureComponent2D* SceneCapture, FColourMap& ColourMap)
+{
+	FTextureRenderTargetResource* RenderTarget =
+		SceneCapture->TextureTarget ? SceneCapture->TextureTarget->GameThread_GetRenderTargetResource() : nullptr;
+	if (!RenderTarget)
+	{
+		return;
+	}
+	if (!ColourMap.Readback.IsValid())
+	{
+		ColourMap.Readback = MakeShared<FJointOcclusionReadback, ESPMode::ThreadSafe>();
+	}
+	TSharedPtr<FJointOcclusionReadback, ESPMode::ThreadSafe> Readback = ColourMap.Readback;
+	{
+		FScopeLock Lock(&Readback->ResultLock);
+		if (Readback->bHasResult)
+		{
+			UpdateJointPixelCounts(Readback->PaletteCounts, ColourMap);
+			Readback->bHasResult = false;
+		}
+	}
+
+	ENQUEUE_RENDER_COMMAND(JointOcclusionReadback)
+	([Readback, RenderTarget, Palette = Palette](FRHICommandListImmediate& RHICmdList) {
+		FRHITexture* Texture = RenderTarget->GetRenderTargetTexture();
+		if (!Texture)
+		{
+			return;
+		}
+		if (!Readback->GPUReadback.IsValid())
+		{
+			Readback->GPUReadback = MakeUnique<FRHIGPUBufferReadback>(TEXT("JointOcclusionBinCounts"));
+		}
+		if (Readback->bCopyPending)
+		{
+			if (!Readback->GPUReadback->IsReady())
+			{
+				return;
+			}
+			Readback->bCopyPending = false;
+
+			// one count per palette entry, binned on the GPU
+			const int32 NumBins = FMath::Min(Palette.Num(), JointOcclusionBinning::MaxPaletteColours);
+			const uint32* Counts = static_cast<const uint32*>(Readback->GPUReadback->Lock(NumBins * sizeof(uint32)));
+			TArray<int32> PaletteCounts;
+			PaletteCounts.AddZeroed(Palette.Num());
+			if (Counts)
 			{
-				if (KeyPair.Value < 2)
+				for (int32 i = 0; i < NumBins; i++)
 				{
-					ColourCountMap.Remove(KeyPair.Key);
+					PaletteCounts[i] = Counts[i];
 				}
 			}
+			Readback->GPUReadback->Unlock();
+
+			FScopeLock Lock(&Readback->ResultLock);
+			Readback->PaletteCounts = MoveTemp(PaletteCounts);
+			Readback->bHasResult = true;
 		}
-	}
+		JointOcclusionBinning::AddBinningPass(RHICmdList, Texture, Palette, PaletteTolerance, *Readback->GPUReadback);
+		Readback->bCopyPending = true;
+	});
 }
 // for debugging only
 bool AJointOcclusionActor::GetJointOcclusionConfidences(const FString& DeviceSerial, TArray<float>& Left, TArray<float>& Right)
@@ -134,16 +267,16 @@ bool AJointOcclusionActor::GetJointOcclusionConfidences(const FString& DeviceSer
 	}
 	return DeviceInterface->GetJointOcclusionConfidences(DeviceSerial,  Left, Right);
 }
-void DebugPrintColourMap(const TMap<FLinearColor, int32>& ColourCountMap)
+void DebugPrintColourMap(const FColourMap& ColourMap)
 {
 #if WITH_EDITOR
 	if (GEngine)
 	{
-			for (auto& KeyPair : ColourCountMap)
+			for (int32 i = 0; i < ColourMap.JointPixelCounts.Num(); i++)
 			{
 				FString Message;
-				Message = FString::Printf(TEXT("ColourMap 1 %f %f %f %d"), KeyPair.Key.R, KeyPair.Key.G, KeyPair.Key.B,
-	KeyPair.Value); GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Yellow, Message);
+				Message = FString::Printf(TEXT("ColourMap %s %d %d"), *ColourMap.DeviceSerial, i, ColourMap.JointPixelCounts[i]);
+				GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Yellow, Message);
 			}
 	}
 #endif //WITH_EDITOR
@@ -165,7 +298,11 @@ void AJointOcclusionActor::Tick(float DeltaTime)
 	{
 		return;
 	}
-
+	UpdateColourCountMaps();
+	DeviceInterface->UpdateJointOcclusions(this);
+}
+void AJointOcclusionActor::UpdateColourCountMaps()
+{
 	int Index = 0;
 	for (const auto& KeyValuePair : DeviceToSceneCaptures)
 	{
@@ -173,9 +310,19 @@ void AJointOcclusionActor::Tick(float DeltaTime)
 		{
 			ColourCountMaps.Add(new FColourMap(KeyValuePair.Key));
 		}
+		FColourMap& ColourMap = *ColourCountMaps[Index++];
+		if (!KeyValuePair.Value)
+		{
+			continue;
+		}
 		// update device confidence values
-		CountColoursInSceneCapture(KeyValuePair.Value,KeyValuePair.Key, ColourCountMaps[Index++]->ColourCountMap);
+		if (bUseAsyncReadback && JointOcclusionBinning::IsSupported(Palette.Num()))
+		{
+			ReadSceneCaptureAsync(KeyValuePair.Value, ColourMap);
+		}
+		else
+		{
+			CountColoursInSceneCapture(KeyValuePair.Value, ColourMap);
+		}
 	}
-	DeviceInterface->UpdateJointOcclusions(this);
 }
-
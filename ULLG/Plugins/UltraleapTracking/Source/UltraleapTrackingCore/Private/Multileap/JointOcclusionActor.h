@@ -12,8 +12,28 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Components/SceneCaptureComponent2D.h"
+#include "UltraleapTrackingData.h"
 #include "JointOcclusionActor.generated.h"
 
+class FRHIGPUBufferReadback;
+
+// Non blocking readback of one scene capture, binned into a histogram by a compute shader so only the counts come back
+class FJointOcclusionReadback
+{
+public:
+	FJointOcclusionReadback();
+	~FJointOcclusionReadback();
+
+	// Render thread only
+	TUniquePtr<FRHIGPUBufferReadback> GPUReadback;
+	bool bCopyPending;
+
+	// Render thread -> game thread, pixel counts per palette entry
+	FCriticalSection ResultLock;
+	TArray<int32> PaletteCounts;
+	bool bHasResult;
+};
+
 class FColourMap
 {
 public:
@@ -22,8 +42,17 @@ public:
 		DeviceSerial = DeviceSerialIn;
 	}
 
-	TMap<FLinearColor, int32> ColourCountMap;
+	// Pixels seen per sphere, left hand joints followed by right hand joints
+	TArray<int32> JointPixelCounts;
 	FString DeviceSerial;
+
+	int32 GetJointPixelCount(const EHandType HandType, const int32 JointIndex) const
+	{
+		const int32 Index = (HandType == LEAP_HAND_LEFT ? 0 : JointPixelCounts.Num() / 2) + JointIndex;
+		return JointPixelCounts.IsValidIndex(Index) ? JointPixelCounts[Index] : 0;
+	}
+
+	TSharedPtr<FJointOcclusionReadback, ESPMode::ThreadSafe> Readback;
 };
 UCLASS()
 class AJointOcclusionActor : public AActor
@@ -47,6 +76,11 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Leap Devices - Joint Occlusion")
 	TMap<FString, USceneCaptureComponent2D*> DeviceToSceneCaptures;
 
+	/** Read the scene captures back without stalling the game thread, occlusion lags the capture by a frame or two.
+	 * When off (or compute shaders aren't supported) the capture is read back synchronously */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Leap Devices - Joint Occlusion")
+	bool bUseAsyncReadback;
+
 	
 	UFUNCTION(BlueprintCallable, Category = "Leap Devices - Joint Occlusion")
 	bool GetJointOcclusionConfidences(const FString& DeviceSerial, TArray<float>& Left, TArray<float>& Right);
@@ -58,6 +92,9 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Leap Devices - Joint Occlusion")
 	void SetupColours(const bool DebugSimpleColours, const bool UseLinearLerp);
 
+	// Counts the sphere pixels in each device's scene capture into the colour count maps, called on tick
+	void UpdateColourCountMaps();
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -68,7 +105,19 @@ public:
 	virtual void Tick(float DeltaTime) override;
 
 private:
-	void CountColoursInSceneCapture(
-		const USceneCaptureComponent2D* SceneCapture, const FString& DeviceSerial, TMap<FLinearColor, int32>& ColourCountMap);
+	void CountColoursInSceneCapture(const USceneCaptureComponent2D* SceneCapture, FColourMap& ColourMap);
+	void ReadSceneCaptureAsync(const USceneCaptureComponent2D* SceneCapture, FColourMap& ColourMap);
+	void UpdateJointPixelCounts(const TArray<int32>& PaletteCounts, FColourMap& ColourMap) const;
+	void BuildPalette();
+
 	TArray<FColourMap*> ColourCountMaps;
+
+	// Distinct sphere colours, the debug colours share one colour per hand
+	TArray<FLinearColor> Palette;
+	// Palette entry per sphere, left hand joints followed by right hand joints
+	TArray<int32> JointPaletteIndices;
+
+	// Synchronous readback scratch
+	TArray<FLinearColor> CPUReadbackPixels;
+	TArray<int32> CPUPaletteCounts;
 };
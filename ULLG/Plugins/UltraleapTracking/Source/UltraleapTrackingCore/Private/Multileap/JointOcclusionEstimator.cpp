@@ -0,0 +1,233 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+
+#include "JointOcclusionEstimator.h"
+
+namespace
+{
+// Ring rays sample this fraction of the way out to the joint silhouette
+const float RingRadiusScale = 0.6f;
+// Bones are very thin from the side, the metacarpals also have to cover the palm between them
+const float MinBoneRadius = 0.4f;
+const float PalmCoverageScale = 1.0f / 8.0f;
+}	 // namespace
+
+void FJointOcclusionEstimator::Estimate(const FLeapHandData& Hand, const FVector& DevicePosition, TArray<float>& OutConfidences)
+{
+	OutConfidences.SetNumZeroed(NumJoints);
+	if (Hand.Digits.Num() < NumFingers)
+	{
+		return;
+	}
+	BuildCapsules(Hand);
+
+	const FVector3f Device(DevicePosition);
+	BuildRays(Device);
+	TraceRays(Device);
+
+	for (int32 Joint = 0; Joint < NumJoints; Joint++)
+	{
+		if (bDeviceInsideJoint[Joint])
+		{
+			OutConfidences[Joint] = 1.0f;
+			continue;
+		}
+		int32 NumVisible = 0;
+		for (int32 Ray = Joint * NumRaysPerJoint; Ray < (Joint + 1) * NumRaysPerJoint; Ray++)
+		{
+			NumVisible += (Blocked[Ray / 4] >> (Ray % 4)) & 1 ? 0 : 1;
+		}
+		OutConfidences[Joint] = (float) NumVisible / NumRaysPerJoint;
+	}
+}
+void FJointOcclusionEstimator::BuildCapsules(const FLeapHandData& Hand)
+{
+	const float PalmRadius = Hand.Palm.Width * PalmCoverageScale;
+
+	for (int32 Finger = 0; Finger < NumFingers; Finger++)
+	{
+		const FLeapDigitData& Digit = Hand.Digits[Finger];
+		for (int32 Bone = 0; Bone < NumBones; Bone++)
+		{
+			const FLeapBoneData& BoneData = Digit.Bones[Bone];
+			const int32 Capsule = Finger * NumBones + Bone;
+
+			float Radius = FMath::Max(BoneData.Width * 0.5f, MinBoneRadius);
+			if (Bone == 0)
+			{
+				Radius = FMath::Max(Radius, PalmRadius);
+			}
+			const FVector3f Start(BoneData.PrevJoint);
+			const FVector3f Axis = FVector3f(BoneData.NextJoint) - Start;
+
+			Capsules[Capsule].Start = Start;
+			Capsules[Capsule].Axis = Axis;
+			// zero length bones (the thumb metacarpal) degrade to spheres
+			Capsules[Capsule].AxisLengthSquared = FMath::Max(Axis.SizeSquared(), KINDA_SMALL_NUMBER);
+			Capsules[Capsule].RadiusSquared = FMath::Square(Radius);
+
+			// joint spheres use the real bone width, the metacarpal base is the start of the first bone
+			const int32 Joint = Finger * (NumBones + 1) + Bone;
+			JointPositions[Joint] = BoneData.PrevJoint;
+			JointRadii[Joint] = FMath::Max(BoneData.Width * 0.5f, MinBoneRadius);
+			if (Bone == NumBones - 1)
+			{
+				JointPositions[Joint + 1] = BoneData.NextJoint;
+				JointRadii[Joint + 1] = JointRadii[Joint];
+			}
+		}
+	}
+}
+void FJointOcclusionEstimator::BuildRays(const FVector3f& Device)
+{
+	FMemory::Memzero(Rays);
+	for (int32 Joint = 0; Joint < NumJoints; Joint++)
+	{
+		const FVector3f Centre(JointPositions[Joint]);
+		const FVector3f ToDevice = Device - Centre;
+		const float Distance = ToDevice.Size();
+		bDeviceInsideJoint[Joint] = Distance <= JointRadii[Joint];
+		if (bDeviceInsideJoint[Joint])
+		{
+			// left as zero length rays, the result is ignored
+			continue;
+		}
+		const FVector3f ViewDirection = ToDevice / Distance;
+
+		// silhouette basis, rays end on the device facing side of the joint sphere so the bones the joint sits in
+		// don't count as occluders at the far end
+		FVector3f Right, Up;
+		ViewDirection.FindBestAxisVectors(Right, Up);
+		const FVector3f Front = Centre + ViewDirection * JointRadii[Joint];
+		const float RingRadius = JointRadii[Joint] * RingRadiusScale;
+
+		for (int32 RayInJoint = 0; RayInJoint < NumRaysPerJoint; RayInJoint++)
+		{
+			FVector3f Target = Front;
+			if (RayInJoint > 0)
+			{
+				float Sin, Cos;
+				FMath::SinCos(&Sin, &Cos, (2.0f * PI * (RayInJoint - 1)) / NumRingRays);
+				Target += (Right * Cos + Up * Sin) * RingRadius;
+			}
+			const FVector3f Direction = Target - Device;
+			const int32 Ray = Joint * NumRaysPerJoint + RayInJoint;
+			Rays.DirectionX[Ray] = Direction.X;
+			Rays.DirectionY[Ray] = Direction.Y;
+			Rays.DirectionZ[Ray] = Direction.Z;
+			Rays.LengthSquared[Ray] = Direction.SizeSquared();
+		}
+	}
+	// padding and skipped rays still divide by their length
+	for (int32 Ray = 0; Ray < NumPaddedRays; Ray++)
+	{
+		Rays.LengthSquared[Ray] = FMath::Max(Rays.LengthSquared[Ray], KINDA_SMALL_NUMBER);
+	}
+}
+void FJointOcclusionEstimator::TraceRays(const FVector3f& Device)
+{
+	// rays never count the bones their own joint sits in, four bits per capsule and ray group. Padding rays are
+	// always ignored
+	struct FIgnoreMasks
+	{
+		uint8 Masks[NumCapsules][NumRayGroups];
+
+		FIgnoreMasks()
+		{
+			FMemory::Memset(Masks, 0xF);
+			for (int32 Capsule = 0; Capsule < NumCapsules; Capsule++)
+			{
+				for (int32 Ray = 0; Ray < NumJoints * NumRaysPerJoint; Ray++)
+				{
+					if (!(GetJointCapsuleMask(Ray / NumRaysPerJoint) & (1u << Capsule)))
+					{
+						Masks[Capsule][Ray / 4] &= ~(1u << (Ray % 4));
+					}
+				}
+			}
+		}
+	};
+	static const FIgnoreMasks IgnoreMasks;
+
+	// closest points between one capsule axis and four rays at once (Ericson, Real-Time Collision Detection 5.1.9),
+	// parallel cases fall back to the ray start
+	const VectorRegister4Float Zero = GlobalVectorConstants::FloatZero;
+	const VectorRegister4Float One = GlobalVectorConstants::FloatOne;
+	const VectorRegister4Float Epsilon = VectorSetFloat1(KINDA_SMALL_NUMBER);
+
+	FMemory::Memzero(Blocked);
+	for (int32 Capsule = 0; Capsule < NumCapsules; Capsule++)
+	{
+		const FCapsule& CapsuleData = Capsules[Capsule];
+		const FVector3f Offset = Device - CapsuleData.Start;
+
+		const VectorRegister4Float D2X = VectorSetFloat1(CapsuleData.Axis.X);
+		const VectorRegister4Float D2Y = VectorSetFloat1(CapsuleData.Axis.Y);
+		const VectorRegister4Float D2Z = VectorSetFloat1(CapsuleData.Axis.Z);
+		const VectorRegister4Float E = VectorSetFloat1(CapsuleData.AxisLengthSquared);
+		const VectorRegister4Float RadiusSquared = VectorSetFloat1(CapsuleData.RadiusSquared);
+		const VectorRegister4Float RX = VectorSetFloat1(Offset.X);
+		const VectorRegister4Float RY = VectorSetFloat1(Offset.Y);
+		const VectorRegister4Float RZ = VectorSetFloat1(Offset.Z);
+		// every ray starts at the device
+		const VectorRegister4Float F = VectorSetFloat1(FVector3f::DotProduct(CapsuleData.Axis, Offset));
+
+		for (int32 Group = 0; Group < NumRayGroups; Group++)
+		{
+			const int32 First = Group * 4;
+			const VectorRegister4Float D1X = VectorLoadAligned(&Rays.DirectionX[First]);
+			const VectorRegister4Float D1Y = VectorLoadAligned(&Rays.DirectionY[First]);
+			const VectorRegister4Float D1Z = VectorLoadAligned(&Rays.DirectionZ[First]);
+			const VectorRegister4Float A = VectorLoadAligned(&Rays.LengthSquared[First]);
+
+			const VectorRegister4Float B = VectorMultiplyAdd(D1X, D2X, VectorMultiplyAdd(D1Y, D2Y, VectorMultiply(D1Z, D2Z)));
+			const VectorRegister4Float C = VectorMultiplyAdd(D1X, RX, VectorMultiplyAdd(D1Y, RY, VectorMultiply(D1Z, RZ)));
+
+			const VectorRegister4Float Denominator = VectorSubtract(VectorMultiply(A, E), VectorMultiply(B, B));
+			const VectorRegister4Float NotParallel = VectorCompareGT(Denominator, Epsilon);
+
+			// ray parameter, then the capsule parameter for it, then the ray parameter for the clamped capsule point
+			VectorRegister4Float S =
+				VectorDivide(VectorSubtract(VectorMultiply(B, F), VectorMultiply(C, E)), VectorMax(Denominator, Epsilon));
+			S = VectorSelect(NotParallel, VectorMin(VectorMax(S, Zero), One), Zero);
+			VectorRegister4Float T = VectorDivide(VectorMultiplyAdd(B, S, F), E);
+			T = VectorMin(VectorMax(T, Zero), One);
+			S = VectorDivide(VectorSubtract(VectorMultiply(B, T), C), A);
+			S = VectorMin(VectorMax(S, Zero), One);
+
+			// R + S * D1 - T * D2
+			const VectorRegister4Float DX = VectorSubtract(VectorMultiplyAdd(S, D1X, RX), VectorMultiply(T, D2X));
+			const VectorRegister4Float DY = VectorSubtract(VectorMultiplyAdd(S, D1Y, RY), VectorMultiply(T, D2Y));
+			const VectorRegister4Float DZ = VectorSubtract(VectorMultiplyAdd(S, D1Z, RZ), VectorMultiply(T, D2Z));
+			const VectorRegister4Float DistanceSquared =
+				VectorMultiplyAdd(DX, DX, VectorMultiplyAdd(DY, DY, VectorMultiply(DZ, DZ)));
+
+			const VectorRegister4Float Hit = VectorCompareLT(DistanceSquared, RadiusSquared);
+			Blocked[Group] |= VectorMaskBits(Hit) & ~IgnoreMasks.Masks[Capsule][Group];
+		}
+	}
+}
+uint32 FJointOcclusionEstimator::GetJointCapsuleMask(const int32 Joint)
+{
+	const int32 Finger = Joint / (NumBones + 1);
+	const int32 JointInFinger = Joint % (NumBones + 1);
+
+	uint32 Mask = 0;
+	// bone starting at the joint
+	if (JointInFinger < NumBones)
+	{
+		Mask |= 1u << (Finger * NumBones + JointInFinger);
+	}
+	// bone ending at the joint
+	if (JointInFinger > 0)
+	{
+		Mask |= 1u << (Finger * NumBones + JointInFinger - 1);
+	}
+	return Mask;
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UltraleapTrackingData.h"
+
+/**
+ * Estimates how much of each joint a device can see by tracing rays from the device towards the joint against the hand's
+ * own bone capsules. A CPU alternative to AJointOcclusionActor, which renders coloured joint spheres per device.
+ * The rays of every joint are kept structure of arrays so each capsule is tested against four rays at a time.
+ */
+class FJointOcclusionEstimator
+{
+public:
+	static constexpr int32 NumFingers = 5;
+	static constexpr int32 NumBones = 4;
+	// Keyed as the combiner's linear joint lists, finger * 5 + joint with joint 0 the base of the metacarpal
+	static constexpr int32 NumJoints = NumFingers * (NumBones + 1);
+
+	/** Hand and device in the same space. Fills NumJoints confidences, 0 fully occluded .. 1 fully visible */
+	void Estimate(const FLeapHandData& Hand, const FVector& DevicePosition, TArray<float>& OutConfidences);
+
+private:
+	static constexpr int32 NumCapsules = NumFingers * NumBones;
+
+	// Rays per joint, the centre and a ring across the joint's silhouette
+	static constexpr int32 NumRingRays = 6;
+	static constexpr int32 NumRaysPerJoint = NumRingRays + 1;
+	static constexpr int32 NumRayGroups = (NumJoints * NumRaysPerJoint + 3) / 4;
+	static constexpr int32 NumPaddedRays = NumRayGroups * 4;
+
+	// Capsule c is the segment Start + t * Axis, t in [0, 1]
+	struct FCapsule
+	{
+		FVector3f Start;
+		FVector3f Axis;
+		float AxisLengthSquared;
+		float RadiusSquared;
+	};
+	FCapsule Capsules[NumCapsules];
+
+	// Ray r is the segment Device + s * Direction, s in [0, 1], rays of joint j from j * NumRaysPerJoint
+	struct alignas(16) FRays
+	{
+		float DirectionX[NumPaddedRays];
+		float DirectionY[NumPaddedRays];
+		float DirectionZ[NumPaddedRays];
+		float LengthSquared[NumPaddedRays];
+	};
+	FRays Rays;
+
+	// Bit per ray that passes within the radius of a capsule, four rays per group
+	uint8 Blocked[NumRayGroups];
+
+	// Joint positions and radii, filled with the capsules
+	FVector JointPositions[NumJoints];
+	float JointRadii[NumJoints];
+	// The device is inside the joint sphere, which counts as fully visible
+	bool bDeviceInsideJoint[NumJoints];
+
+	void BuildCapsules(const FLeapHandData& Hand);
+	void BuildRays(const FVector3f& Device);
+	void TraceRays(const FVector3f& Device);
+	// The bones a joint belongs to, which always touch its sphere
+	static uint32 GetJointCapsuleMask(const int32 Joint);
+};
@@ -15,6 +15,14 @@
 UMultiDeviceAlignment::UMultiDeviceAlignment()
 {
 	AlignmentVariance = 2;
+	bUseRobustSolver = true;
+	OutlierThreshold = 2;
+	bContinuousAlignment = false;
+	SolveInterval = 0.1;
+	AlignmentSmoothing = 0.5;
+	DriftThreshold = 4;
+	SpatialCellSize = 5;
+	MinSpatialCells = 4;
 	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
 	// off to improve performance if you don't need them.
 	PrimaryComponentTick.bCanEverTick = true;
@@ -28,6 +36,8 @@ void UMultiDeviceAlignment::BeginPlay()
 {
 	Super::BeginPlay();
 
+	AlignmentService = MakeShared<FMultiDeviceAlignmentService, ESPMode::ThreadSafe>();
+
 	UpdateTrackingDevices();
 	
 }
@@ -38,7 +48,7 @@ void UMultiDeviceAlignment::TickComponent(float DeltaTime, ELevelTick TickType,
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-	Update();
+	Update(DeltaTime);
 }
 void UMultiDeviceAlignment::UpdateTrackingDevices()
 {
@@ -71,6 +81,32 @@ void UMultiDeviceAlignment::ReAlignProvider()
 		TargetDevice->SetActorTransform(FTransform(FRotator::ZeroRotator, FVector::ZeroVector));
 	}
 	PositioningComplete = false;
+	CorrectionSettleFrames = 0;
+	if (AlignmentService.IsValid())
+	{
+		AlignmentService->Reset();
+	}
+}
+FMultiDeviceAlignmentSettings UMultiDeviceAlignment::GetAlignmentSettings() const
+{
+	FMultiDeviceAlignmentSettings Settings;
+	if (bUseRobustSolver)
+	{
+		Settings.SolverOptions.OutlierRejection = EKabschOutlierRejection::RANSAC;
+		Settings.SolverOptions.InlierThreshold = OutlierThreshold;
+	}
+	else
+	{
+		Settings.SolverOptions.bUseClosedForm = false;
+		Settings.SolverOptions.OptimalRotationIterations = 200;
+	}
+	Settings.SolveInterval = SolveInterval;
+	Settings.Smoothing = AlignmentSmoothing;
+	Settings.ConvergedError = AlignmentVariance;
+	Settings.DriftError = FMath::Max(DriftThreshold, AlignmentVariance);
+	Settings.CellSize = SpatialCellSize;
+	Settings.MinCells = MinSpatialCells;
+	return Settings;
 }
 const FLeapHandData* GetHandFromFrame(const FLeapFrameData& Frame, const EHandType HandType)
 {
@@ -95,9 +131,9 @@ FTransform ConvertBSToUETransform(const FTransform& TransformLeap)
 	FTransform Ret = FUltraleapDevice::ConvertUEDeviceOriginToBSTransform(TransformLeap, false);
 	return Ret;
 }
-void UMultiDeviceAlignment::Update()
+void UMultiDeviceAlignment::Update(const float DeltaTime)
 {
-	if (!TargetDevice || !SourceDevice)
+	if (!TargetDevice || !SourceDevice || !AlignmentService.IsValid())
 	{
 		return;
 	}
@@ -105,106 +141,105 @@ void UMultiDeviceAlignment::Update()
 	{
 		return;
 	}
-	if (!PositioningComplete)
+	if (PositioningComplete)
 	{
-		FLeapFrameData SourceFrame;
-		FLeapFrameData TargetFrame;
+		return;
+	}
 
-		FLeapFrameData SourceFrameRaw;
-		FLeapFrameData TargetFrameRaw;
+	// the solve happens in the background, apply whatever it has published since last tick
+	FTransform Correction;
+	if (AlignmentService->ConsumeCorrection(Correction))
+	{
+		// to move the target device, we need to be in UE space. This layer is in BSSpace so convert
+		const FTransform CorrectionUE = ConvertBSToUETransform(Correction);
+		FTransform ActorTransform = TargetDevice->GetActorTransform();
 
+		ActorTransform *= CorrectionUE;
+
+		TargetDevice->TeleportTo(ActorTransform.GetLocation(), ActorTransform.GetRotation().Rotator(), false, true);
+		CorrectionSettleFrames = 2;
+	}
+
+	const FMultiDeviceAlignmentSettings Settings = GetAlignmentSettings();
+	if (!bContinuousAlignment && AlignmentService->GetState() == EMultiDeviceAlignmentState::Converged)
+	{
+		// we are already as aligned as we need to be, we can exit the alignment stage
+		PositioningComplete = true;
+		return;
+	}
+
+	if (CorrectionSettleFrames > 0)
+	{
+		CorrectionSettleFrames--;
+	}
+	else
+	{
+		// read in place, only a VR source frame is copied to be transformed
+		static const FLeapFrameData NoFrame;
 		const bool SourceIsVR = SourceDevice->LeapComponent->TrackingMode == LEAP_MODE_VR;
 
 		// avoid applying DeviceOrigin twice if VR
-		SourceDevice->LeapComponent->GetLatestFrameData(SourceFrame, !SourceIsVR);
-		
-
-		TargetDevice->LeapComponent->GetLatestFrameData(TargetFrame, true);
+		TSharedPtr<const FLeapFrameData, ESPMode::ThreadSafe> SourceSnapshot =
+			SourceDevice->LeapComponent->GetLatestFrameSnapshot(!SourceIsVR);
+		TSharedPtr<const FLeapFrameData, ESPMode::ThreadSafe> TargetSnapshot =
+			TargetDevice->LeapComponent->GetLatestFrameSnapshot(true);
+		const FLeapFrameData& TargetFrame = TargetSnapshot.IsValid() ? *TargetSnapshot : NoFrame;
+
+		const FLeapFrameData* SourceFramePtr = SourceSnapshot.IsValid() ? SourceSnapshot.Get() : &NoFrame;
+		FLeapFrameData TransformedSourceFrame;
 		if (SourceIsVR)
 		{
 			FTransform VRDeviceOrigin;
 			const bool Success = SourceDevice->LeapComponent->GetDeviceOrigin(VRDeviceOrigin);
 			// Transform HMD into Desktop rotation
 			FRotator Rotation(90, 0, 180);
-			FUltraleapCombinedDevice::TransformFrame(
-				SourceFrame, VRDeviceOrigin.GetLocation(), Rotation.GetInverse());
+			TransformedSourceFrame = *SourceFramePtr;
+			FUltraleapCombinedDevice::TransformFrame(TransformedSourceFrame, VRDeviceOrigin.GetLocation(), Rotation.GetInverse());
+			SourceFramePtr = &TransformedSourceFrame;
 		}
-		
-		TArray<FVector> SourceHandPoints;
-		TArray<FVector> TargetHandPoints;
-		
+		const FLeapFrameData& SourceFrame = *SourceFramePtr;
+
 #ifdef DEBUG_ALIGNMENT
 		if (GEngine)
 		{
-			FString ToPrint = FString::Printf(TEXT("Num Hands %d %d"), SourceFrame.Hands.Num(), TargetFrame.Hands.Num());
+			FString ToPrint = FString::Printf(TEXT("Num Hands %d %d Error %f"), SourceFrame.Hands.Num(), TargetFrame.Hands.Num(),
+				AlignmentService->GetAlignmentError());
 
 			GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Yellow, ToPrint);
-		}	
+		}
 #endif
-		int SourceIndex = 0;
-		for (auto& SourceHand : SourceFrame.Hands )
+		static const int NumFingers = 5;
+		static const int NumJoints = 4;
+		static_assert(NumFingers * NumJoints == FMultiDeviceAlignmentSample::NumPoints, "Alignment sample size mismatch");
+
+		for (auto& SourceHand : SourceFrame.Hands)
 		{
 			auto TargetHand = GetHandFromFrame(TargetFrame, SourceHand.HandType);
-			
-			static const int NumFingers = 5;
-			static const int NumJoints = 4;
-
-			if (TargetHand != nullptr)
+			if (TargetHand == nullptr)
 			{
-				for (int j = 0; j < NumFingers; j++)
-				{
-					for (int k = 0; k < NumJoints; k++)
-					{
-						SourceHandPoints.Add(CalcCentre(SourceHand.Digits[j].Bones[k].PrevJoint,SourceHand.Digits[j].Bones[k].NextJoint));
-						
-						TargetHandPoints.Add(
-							CalcCentre(TargetHand->Digits[j].Bones[k].PrevJoint, TargetHand->Digits[j].Bones[k].NextJoint));
-
-					}
-				}
-
-				// This is temporary while we check if any of the hands points are not close enough to each other
-				PositioningComplete = true;
-
-				for (int i = 0; i < SourceHandPoints.Num(); i++)
-				{
-					const auto Distance = FVector::Distance(SourceHandPoints[i], TargetHandPoints[i]);
-					
-					if (Distance > AlignmentVariance)
-					{
-#ifdef DEBUG_ALIGNMENT
-						if (GEngine)
-						{
-							FString ToPrint = FString::Printf(TEXT("Distance %f %f"), Distance, DistanceRaw);
-
-							GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Yellow, ToPrint);
-						}
-#endif
-						// we are already as aligned as we need to be, we can exit the alignment stage
-						PositioningComplete = false;
-						break;
-					}
-				}
+				continue;
+			}
 
-				if (PositioningComplete)
+			FMultiDeviceAlignmentSample Sample;
+			for (int j = 0; j < NumFingers; j++)
+			{
+				for (int k = 0; k < NumJoints; k++)
 				{
-					return;
+					Sample.SourcePoints[j * NumJoints + k] =
+						CalcCentre(SourceHand.Digits[j].Bones[k].PrevJoint, SourceHand.Digits[j].Bones[k].NextJoint);
+					Sample.TargetPoints[j * NumJoints + k] =
+						CalcCentre(TargetHand->Digits[j].Bones[k].PrevJoint, TargetHand->Digits[j].Bones[k].NextJoint);
 				}
-
-				FMatrix DeviceToOriginDeviceMatrix = Solver.SolveKabsch(TargetHandPoints, SourceHandPoints, 200);
-				FTransform ActorTransformFromSolver = FTransform(DeviceToOriginDeviceMatrix);
-				
-				// to move the target device, we need to be in UE space. This layer is in BSSpace so convert
-				ActorTransformFromSolver = ConvertBSToUETransform(ActorTransformFromSolver);
-				FTransform ActorTransform = TargetDevice->GetActorTransform();
-
-				ActorTransform *= ActorTransformFromSolver;
-				
-				TargetDevice->TeleportTo(ActorTransform.GetLocation(),
-					 ActorTransform.GetRotation().Rotator(), false, true);
-		
-				return;
 			}
+			// a joint is only as reliable as the less confident of the two hands, sources that don't report
+			// confidence fall back to equal weights. The legacy solver weights all joints equally
+			Sample.Weight = bUseRobustSolver
+								? FMath::Max(FMath::Min(SourceHand.Confidence, TargetHand->Confidence), KINDA_SMALL_NUMBER)
+								: 1.0f;
+
+			AlignmentService->AddSample(Sample);
 		}
 	}
-}
\ No newline at end of file
+
+	AlignmentService->Tick(DeltaTime, Settings);
+}
@@ -11,6 +11,7 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "FKabschSolver.h"
+#include "MultiDeviceAlignmentService.h"
 #include "TrackingDeviceBaseActor.h"
 #include "MultiDeviceAlignment.generated.h"
 
@@ -33,7 +34,41 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Devices")
 	float AlignmentVariance;
 
-	
+	/** Solve with the closed form solver, weighting joints by hand confidence and rejecting outlying joints (RANSAC).
+	 * When off the legacy iterative solver is used on all joints equally */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Devices")
+	bool bUseRobustSolver;
+
+	/** Joints further apart than this (cm) after alignment are treated as outliers by the robust solver */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Devices", meta = (EditCondition = "bUseRobustSolver"))
+	float OutlierThreshold;
+
+	/** Keep sampling after the devices are aligned and correct for drift, e.g. if a device is knocked.
+	 * When off alignment stops once converged, call ReAlignProvider to start again */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Devices")
+	bool bContinuousAlignment;
+
+	/** Seconds between background alignment solves */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Devices", meta = (ClampMin = "0.0"))
+	float SolveInterval;
+
+	/** Fraction of each solve applied to the target device, lower moves the device more smoothly but converges slower */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Devices", meta = (ClampMin = "0.01", ClampMax = "1.0"))
+	float AlignmentSmoothing;
+
+	/** Once aligned, the alignment error (cm) at which the devices are realigned in continuous mode.
+	 * Should be above AlignmentVariance so noise doesn't cause realignment */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Devices", meta = (EditCondition = "bContinuousAlignment"))
+	float DriftThreshold;
+
+	/** Hand positions are binned into cells of this size (cm), so one held pose doesn't dominate the solve */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Devices", meta = (ClampMin = "1.0"))
+	float SpatialCellSize;
+
+	/** Number of distinct cells hands must have been seen in before solving */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Devices", meta = (ClampMin = "1"))
+	int32 MinSpatialCells;
+
 
 #if WITH_EDITOR
 	// property change handlers
@@ -51,13 +86,17 @@ public:
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
-	FKabschSolver Solver;
-
 private:
 
 	bool PositioningComplete = false;
 
+	// Ticks to wait after moving the target device before sampling again, the device origin follows a frame behind
+	int32 CorrectionSettleFrames = 0;
+
+	TSharedPtr<FMultiDeviceAlignmentService, ESPMode::ThreadSafe> AlignmentService;
+
 	void ReAlignProvider();
-	void Update();
+	void Update(const float DeltaTime);
+	FMultiDeviceAlignmentSettings GetAlignmentSettings() const;
 
 };
@@ -0,0 +1,446 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "MultiDeviceAlignmentService.h"
+
+#include "LeapAsync.h"
+#include "LeapUtility.h"
+
+namespace
+{
+// Eigenvalues of a symmetric 3x3 matrix, largest first (Smith, "Eigenvalues of a symmetric 3 x 3 matrix", 1961)
+void SymmetricEigenvalues(const double A[3][3], double OutEigenvalues[3])
+{
+	const double OffDiagonal = FMath::Square(A[0][1]) + FMath::Square(A[0][2]) + FMath::Square(A[1][2]);
+	if (OffDiagonal <= 0)
+	{
+		OutEigenvalues[0] = A[0][0];
+		OutEigenvalues[1] = A[1][1];
+		OutEigenvalues[2] = A[2][2];
+		for (int32 Pass = 0; Pass < 2; Pass++)
+		{
+			for (int32 i = 0; i < 2 - Pass; i++)
+			{
+				if (OutEigenvalues[i] < OutEigenvalues[i + 1])
+				{
+					Swap(OutEigenvalues[i], OutEigenvalues[i + 1]);
+				}
+			}
+		}
+		return;
+	}
+	const double Mean = (A[0][0] + A[1][1] + A[2][2]) / 3.0;
+	const double Deviation = FMath::Sqrt(
+		(FMath::Square(A[0][0] - Mean) + FMath::Square(A[1][1] - Mean) + FMath::Square(A[2][2] - Mean) + 2.0 * OffDiagonal) /
+		6.0);
+	double B[3][3];
+	for (int32 Row = 0; Row < 3; Row++)
+	{
+		for (int32 Column = 0; Column < 3; Column++)
+		{
+			B[Row][Column] = (A[Row][Column] - (Row == Column ? Mean : 0.0)) / Deviation;
+		}
+	}
+	const double HalfDeterminant = (B[0][0] * (B[1][1] * B[2][2] - B[1][2] * B[2][1]) -
+									   B[0][1] * (B[1][0] * B[2][2] - B[1][2] * B[2][0]) +
+									   B[0][2] * (B[1][0] * B[2][1] - B[1][1] * B[2][0])) /
+								   2.0;
+	const double Angle = FMath::Acos(FMath::Clamp(HalfDeterminant, -1.0, 1.0)) / 3.0;
+	OutEigenvalues[0] = Mean + 2.0 * Deviation * FMath::Cos(Angle);
+	OutEigenvalues[2] = Mean + 2.0 * Deviation * FMath::Cos(Angle + 2.0 * PI / 3.0);
+	OutEigenvalues[1] = 3.0 * Mean - OutEigenvalues[0] - OutEigenvalues[2];
+}
+
+// Middle finger metacarpal to distal
+FVector GetPointingDirection(const FMultiDeviceAlignmentSample& Sample)
+{
+	const int32 MiddleFinger = 2 * FMultiDeviceAlignmentSample::NumBones;
+	return (Sample.SourcePoints[MiddleFinger + FMultiDeviceAlignmentSample::NumBones - 1] - Sample.SourcePoints[MiddleFinger])
+		.GetSafeNormal();
+}
+}	 // namespace
+
+// queue capacities must be powers of two
+FMultiDeviceAlignmentService::FMultiDeviceAlignmentService()
+	: SampleQueue(128)
+	, AppliedQueue(16)
+	, TimeSinceSolve(0)
+	, bHasPendingCorrection(false)
+	, State(EMultiDeviceAlignmentState::Collecting)
+	, AlignmentError(0)
+	, NumBumps(0)
+	, NextSequence(0)
+	, KnownEpoch(0)
+	, BumpEpoch(0)
+{
+}
+
+bool FMultiDeviceAlignmentService::AddSample(const FMultiDeviceAlignmentSample& Sample)
+{
+	FMultiDeviceAlignmentSample Stamped = Sample;
+	Stamped.Epoch = Epoch.GetValue();
+	return SampleQueue.Enqueue(Stamped);
+}
+
+void FMultiDeviceAlignmentService::Tick(const float DeltaTime, const FMultiDeviceAlignmentSettings& Settings)
+{
+	TimeSinceSolve += DeltaTime;
+	if (bSolveInFlight || TimeSinceSolve < Settings.SolveInterval)
+	{
+		return;
+	}
+	TimeSinceSolve = 0;
+	bSolveInFlight = true;
+
+	// the task holds a reference so the owner can go away mid solve
+	TSharedRef<FMultiDeviceAlignmentService, ESPMode::ThreadSafe> Self = AsShared();
+	SolveTask = FLeapAsync::RunLambdaOnBackGroundThreadPool([Self, Settings]() {
+		Self->Process(Settings);
+		Self->bSolveInFlight = false;
+	});
+}
+
+bool FMultiDeviceAlignmentService::ConsumeCorrection(FTransform& OutCorrection)
+{
+	{
+		FScopeLock Lock(&ResultLock);
+		if (!bHasPendingCorrection)
+		{
+			return false;
+		}
+		OutCorrection = PendingCorrection;
+		bHasPendingCorrection = false;
+	}
+	// samples captured from here on already include the correction, the background thread moves older ones to match
+	FAppliedCorrection Applied;
+	Applied.Epoch = Epoch.Increment();
+	Applied.Correction = OutCorrection;
+	AppliedQueue.Enqueue(Applied);
+	return true;
+}
+
+void FMultiDeviceAlignmentService::Reset()
+{
+	bResetRequested = true;
+
+	FScopeLock Lock(&ResultLock);
+	bHasPendingCorrection = false;
+	State = EMultiDeviceAlignmentState::Collecting;
+	AlignmentError = 0;
+	NumBumps = 0;
+}
+
+void FMultiDeviceAlignmentService::WaitForSolve()
+{
+	if (SolveTask.IsValid())
+	{
+		SolveTask.Wait();
+	}
+}
+
+EMultiDeviceAlignmentState FMultiDeviceAlignmentService::GetState() const
+{
+	FScopeLock Lock(&ResultLock);
+	return State;
+}
+
+float FMultiDeviceAlignmentService::GetAlignmentError() const
+{
+	FScopeLock Lock(&ResultLock);
+	return AlignmentError;
+}
+
+int32 FMultiDeviceAlignmentService::GetNumBumps() const
+{
+	FScopeLock Lock(&ResultLock);
+	return NumBumps;
+}
+
+void FMultiDeviceAlignmentService::Process(const FMultiDeviceAlignmentSettings& Settings)
+{
+	if (bResetRequested)
+	{
+		bResetRequested = false;
+
+		Reservoir.Reset();
+		CellCounts.Reset();
+
+		FMultiDeviceAlignmentSample Dropped;
+		while (SampleQueue.Dequeue(Dropped))
+		{
+		}
+		FAppliedCorrection DroppedCorrection;
+		while (AppliedQueue.Dequeue(DroppedCorrection))
+		{
+		}
+		KnownEpoch = Epoch.GetValue();
+	}
+
+	// bring stored target points up to date with corrections applied since they were captured
+	FAppliedCorrection Applied;
+	while (AppliedQueue.Dequeue(Applied))
+	{
+		for (FMultiDeviceAlignmentSample& Sample : Reservoir)
+		{
+			if (Sample.Epoch < Applied.Epoch)
+			{
+				for (int32 i = 0; i < FMultiDeviceAlignmentSample::NumPoints; i++)
+				{
+					Sample.TargetPoints[i] = Applied.Correction.TransformPosition(Sample.TargetPoints[i]);
+				}
+				Sample.Epoch = Applied.Epoch;
+			}
+		}
+		KnownEpoch = FMath::Max(KnownEpoch, Applied.Epoch);
+	}
+
+	FreshSamples.Reset();
+	FMultiDeviceAlignmentSample Sample;
+	while (SampleQueue.Dequeue(Sample))
+	{
+		// captured before a correction we don't know how to undo yet, or already folded into the reservoir
+		if (Sample.Epoch != KnownEpoch)
+		{
+			continue;
+		}
+		FreshSamples.Add(Sample);
+	}
+
+	// the samples from before a bump pull the solve back towards where the device was, start over from the new ones
+	float BumpError = 0;
+	if (DetectBump(Settings, BumpError))
+	{
+		BumpEpoch++;
+		Reservoir.RemoveAll([this](const FMultiDeviceAlignmentSample& Stored) { return Stored.BumpEpoch < BumpEpoch; });
+		CellCounts.Reset();
+		for (const FMultiDeviceAlignmentSample& Stored : Reservoir)
+		{
+			CellCounts.FindOrAdd(Stored.Cell)++;
+		}
+		UE_LOG(UltraleapTrackingLog, Log, TEXT("Multi device alignment error jumped to %f cm, the device was bumped, realigning"),
+			BumpError);
+
+		FScopeLock Lock(&ResultLock);
+		State = EMultiDeviceAlignmentState::Collecting;
+		AlignmentError = BumpError;
+		NumBumps++;
+	}
+	for (FMultiDeviceAlignmentSample& Fresh : FreshSamples)
+	{
+		AddToReservoir(Fresh, Settings);
+	}
+
+	if (CellCounts.Num() < FMath::Max(Settings.MinCells, 1) || !HasDiverseSamples(Settings))
+	{
+		FScopeLock Lock(&ResultLock);
+		if (State != EMultiDeviceAlignmentState::Converged)
+		{
+			State = EMultiDeviceAlignmentState::Collecting;
+		}
+		return;
+	}
+
+	InPoints.Reset();
+	RefPoints.Reset();
+	Weights.Reset();
+	for (const FMultiDeviceAlignmentSample& Stored : Reservoir)
+	{
+		for (int32 i = 0; i < FMultiDeviceAlignmentSample::NumPoints; i++)
+		{
+			InPoints.Add(Stored.TargetPoints[i]);
+			RefPoints.Add(Stored.SourcePoints[i]);
+			Weights.Add(Stored.Weight);
+		}
+	}
+
+	const FTransform Correction = Solver.Solve(InPoints, RefPoints, Weights, Settings.SolverOptions);
+
+	// current error over the joints the solve agrees on, outliers would otherwise keep the pair from ever converging
+	const bool bRejectOutliers = Settings.SolverOptions.OutlierRejection != EKabschOutlierRejection::None;
+	const float InlierThresholdSquared = FMath::Square(Settings.SolverOptions.InlierThreshold);
+	float ErrorSquared = 0;
+	float TotalWeight = 0;
+	for (int32 i = 0; i < InPoints.Num(); i++)
+	{
+		if (bRejectOutliers &&
+			FVector::DistSquared(Correction.TransformPosition(InPoints[i]), RefPoints[i]) > InlierThresholdSquared)
+		{
+			continue;
+		}
+		ErrorSquared += Weights[i] * FVector::DistSquared(InPoints[i], RefPoints[i]);
+		TotalWeight += Weights[i];
+	}
+	if (TotalWeight <= 0)
+	{
+		return;
+	}
+	const float Error = FMath::Sqrt(ErrorSquared / TotalWeight);
+
+	FScopeLock Lock(&ResultLock);
+	// a reset while solving invalidates this solution
+	if (bResetRequested)
+	{
+		return;
+	}
+	const bool bWasConverged = State == EMultiDeviceAlignmentState::Converged;
+	AlignmentError = Error;
+	if (Error <= Settings.ConvergedError || (bWasConverged && Error < Settings.DriftError))
+	{
+		State = EMultiDeviceAlignmentState::Converged;
+		return;
+	}
+	if (bWasConverged)
+	{
+		UE_LOG(UltraleapTrackingLog, Log, TEXT("Multi device alignment drifted to %f cm, realigning"), Error);
+	}
+	State = EMultiDeviceAlignmentState::Aligning;
+
+	// the previous correction hasn't been picked up yet, the next solve will include it
+	if (!bHasPendingCorrection)
+	{
+		PendingCorrection.Blend(FTransform::Identity, Correction, FMath::Clamp(Settings.Smoothing, 0.01f, 1.0f));
+		bHasPendingCorrection = true;
+	}
+}
+
+bool FMultiDeviceAlignmentService::DetectBump(const FMultiDeviceAlignmentSettings& Settings, float& OutError)
+{
+	if (FreshSamples.Num() < FMath::Max(Settings.MinBumpSamples, 1))
+	{
+		return false;
+	}
+	{
+		FScopeLock Lock(&ResultLock);
+		if (State != EMultiDeviceAlignmentState::Converged)
+		{
+			return false;
+		}
+	}
+
+	// corrections are applied as they're published, so a converged pair's new samples should already line up. The median
+	// over samples ignores a few badly tracked hands
+	FreshErrors.Reset();
+	for (const FMultiDeviceAlignmentSample& Fresh : FreshSamples)
+	{
+		float ErrorSquared = 0;
+		for (int32 i = 0; i < FMultiDeviceAlignmentSample::NumPoints; i++)
+		{
+			ErrorSquared += FVector::DistSquared(Fresh.TargetPoints[i], Fresh.SourcePoints[i]);
+		}
+		FreshErrors.Add(FMath::Sqrt(ErrorSquared / FMultiDeviceAlignmentSample::NumPoints));
+	}
+	FreshErrors.Sort();
+	OutError = FreshErrors[FreshErrors.Num() / 2];
+	return OutError >= Settings.DriftError;
+}
+
+bool FMultiDeviceAlignmentService::HasDiverseSamples(const FMultiDeviceAlignmentSettings& Settings) const
+{
+	if (Reservoir.Num() == 0)
+	{
+		return false;
+	}
+
+	// hands that only moved along a line leave a near singular position covariance, its middle eigenvalue is the spread
+	// off that line
+	FVector MeanPosition = FVector::ZeroVector;
+	FVector MeanDirection = FVector::ZeroVector;
+	for (const FMultiDeviceAlignmentSample& Stored : Reservoir)
+	{
+		MeanPosition += Stored.Centroid;
+		MeanDirection += GetPointingDirection(Stored);
+	}
+	MeanPosition /= Reservoir.Num();
+	MeanDirection /= Reservoir.Num();
+
+	double Covariance[3][3] = {};
+	for (const FMultiDeviceAlignmentSample& Stored : Reservoir)
+	{
+		const FVector Offset = Stored.Centroid - MeanPosition;
+		for (int32 Row = 0; Row < 3; Row++)
+		{
+			for (int32 Column = 0; Column < 3; Column++)
+			{
+				Covariance[Row][Column] += Offset[Row] * Offset[Column] / Reservoir.Num();
+			}
+		}
+	}
+	double Eigenvalues[3];
+	SymmetricEigenvalues(Covariance, Eigenvalues);
+	if (Eigenvalues[1] < FMath::Square(Settings.MinPositionSpread))
+	{
+		return false;
+	}
+
+	// the mean of unit directions shortens as they spread, a single held orientation gives one
+	const float RotationSpread = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp((double) MeanDirection.Size(), 0.0, 1.0)));
+	return RotationSpread >= Settings.MinRotationSpread;
+}
+
+void FMultiDeviceAlignmentService::AddToReservoir(
+	FMultiDeviceAlignmentSample& Sample, const FMultiDeviceAlignmentSettings& Settings)
+{
+	FVector Centroid = FVector::ZeroVector;
+	for (int32 i = 0; i < FMultiDeviceAlignmentSample::NumPoints; i++)
+	{
+		Centroid += Sample.SourcePoints[i];
+	}
+	Centroid /= FMultiDeviceAlignmentSample::NumPoints;
+
+	const float CellSize = FMath::Max(Settings.CellSize, 1.0f);
+	Sample.Cell = FIntVector(
+		FMath::FloorToInt(Centroid.X / CellSize), FMath::FloorToInt(Centroid.Y / CellSize), FMath::FloorToInt(Centroid.Z / CellSize));
+	Sample.Centroid = Centroid;
+	Sample.Sequence = NextSequence++;
+	Sample.BumpEpoch = BumpEpoch;
+
+	const int32 CellCount = CellCounts.FindRef(Sample.Cell);
+	const bool bCellFull = CellCount >= FMath::Max(Settings.MaxSamplesPerCell, 1);
+	const bool bReservoirFull = Reservoir.Num() >= FMath::Max(Settings.MaxSamples, 1);
+
+	if (!bCellFull && !bReservoirFull)
+	{
+		Reservoir.Add(Sample);
+		CellCounts.Add(Sample.Cell, CellCount + 1);
+		return;
+	}
+
+	// replace the oldest sample in the same cell, or the oldest overall so new poses can still get in
+	int32 ReplaceIndex = INDEX_NONE;
+	for (int32 i = 0; i < Reservoir.Num(); i++)
+	{
+		if (bCellFull && Reservoir[i].Cell != Sample.Cell)
+		{
+			continue;
+		}
+		if (ReplaceIndex == INDEX_NONE || Reservoir[i].Sequence < Reservoir[ReplaceIndex].Sequence)
+		{
+			ReplaceIndex = i;
+		}
+	}
+	if (ReplaceIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	const FIntVector OldCell = Reservoir[ReplaceIndex].Cell;
+	if (OldCell != Sample.Cell)
+	{
+		const int32 OldCount = CellCounts.FindRef(OldCell) - 1;
+		if (OldCount > 0)
+		{
+			CellCounts.Add(OldCell, OldCount);
+		}
+		else
+		{
+			CellCounts.Remove(OldCell);
+		}
+		CellCounts.Add(Sample.Cell, CellCount + 1);
+	}
+	Reservoir[ReplaceIndex] = Sample;
+}
@@ -0,0 +1,156 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+
+#pragma once
+
+#include "Async/Future.h"
+#include "Containers/CircularQueue.h"
+#include "CoreMinimal.h"
+#include "FKabschSolver.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+
+// One hand's joint correspondences between the source and target devices, in bodystate space. Points are bone centres,
+// digit by digit from the thumb, each from the metacarpal to the distal
+struct FMultiDeviceAlignmentSample
+{
+	static const int32 NumBones = 4;
+	static const int32 NumPoints = 5 * NumBones;
+
+	FVector SourcePoints[NumPoints];
+	FVector TargetPoints[NumPoints];
+	float Weight = 1.0f;
+
+	// Number of corrections applied to the target device when the sample was captured
+	int32 Epoch = 0;
+
+	// Set by the service
+	FIntVector Cell = FIntVector::ZeroValue;
+	FVector Centroid = FVector::ZeroVector;
+	uint64 Sequence = 0;
+	// Number of bumps detected when the sample was stored, samples from before the last bump are evicted
+	int32 BumpEpoch = 0;
+};
+
+enum class EMultiDeviceAlignmentState : uint8
+{
+	// Waiting for enough spatially diverse samples to solve
+	Collecting,
+	// Publishing corrections towards the solution
+	Aligning,
+	// Within the converged error, in continuous mode the error is still monitored for drift
+	Converged
+};
+
+struct FMultiDeviceAlignmentSettings
+{
+	FKabschSolverOptions SolverOptions;
+
+	// Seconds between background solves
+	float SolveInterval = 0.1f;
+	// Fraction of each solution published, lower is smoother but slower to converge
+	float Smoothing = 0.5f;
+	// Alignment error (cm) at which the devices are considered aligned
+	float ConvergedError = 2.0f;
+	// Alignment error (cm) at which an aligned pair is considered to have drifted, must be above ConvergedError. New
+	// samples this far out as a whole mean the target device was bumped, the samples from before it are evicted
+	float DriftError = 4.0f;
+	// New samples needed to detect a bump, so one badly tracked hand doesn't clear the reservoir
+	int32 MinBumpSamples = 4;
+
+	// Spatial diversity, samples are binned by hand position so the solve isn't dominated by one pose
+	float CellSize = 5.0f;
+	int32 MinCells = 4;
+	int32 MaxSamples = 64;
+	int32 MaxSamplesPerCell = 4;
+	// Hand positions must spread this far (cm) off their main axis, hands only moved along a line leave the rotation
+	// about it near singular
+	float MinPositionSpread = 2.0f;
+	// Pointing directions must spread this far (degrees) around their mean
+	float MinRotationSpread = 5.0f;
+};
+
+/**
+ * Accumulates hand correspondences from the game thread and solves the target to source device correction on a
+ * background thread. Corrections are published smoothed, the owner applies them to the target device and the combiners
+ * pick them up through the device origin.
+ */
+class FMultiDeviceAlignmentService : public TSharedFromThis<FMultiDeviceAlignmentService, ESPMode::ThreadSafe>
+{
+public:
+	FMultiDeviceAlignmentService();
+
+	// All game thread
+	// Lock free, returns false if the background solve has fallen behind and the sample was dropped
+	bool AddSample(const FMultiDeviceAlignmentSample& Sample);
+
+	// Starts a background solve when one is due
+	void Tick(const float DeltaTime, const FMultiDeviceAlignmentSettings& Settings);
+
+	// Returns a correction to apply to the target device, the caller must apply it
+	bool ConsumeCorrection(FTransform& OutCorrection);
+
+	// Drop all samples and start over, e.g. after the target device was moved by hand
+	void Reset();
+
+	// Blocks until any in flight solve has finished
+	void WaitForSolve();
+
+	int32 GetEpoch() const
+	{
+		return Epoch.GetValue();
+	}
+	EMultiDeviceAlignmentState GetState() const;
+	float GetAlignmentError() const;
+	// Bumps detected since the service was created or reset
+	int32 GetNumBumps() const;
+
+private:
+	struct FAppliedCorrection
+	{
+		int32 Epoch = 0;
+		FTransform Correction;
+	};
+
+	// Background thread
+	void Process(const FMultiDeviceAlignmentSettings& Settings);
+	void AddToReservoir(FMultiDeviceAlignmentSample& Sample, const FMultiDeviceAlignmentSettings& Settings);
+	bool DetectBump(const FMultiDeviceAlignmentSettings& Settings, float& OutError);
+	bool HasDiverseSamples(const FMultiDeviceAlignmentSettings& Settings) const;
+
+	// Game thread -> background
+	TCircularQueue<FMultiDeviceAlignmentSample> SampleQueue;
+	TCircularQueue<FAppliedCorrection> AppliedQueue;
+	FThreadSafeCounter Epoch;
+	FThreadSafeBool bResetRequested;
+	FThreadSafeBool bSolveInFlight;
+	TFuture<void> SolveTask;
+	float TimeSinceSolve;
+
+	// Background -> game thread
+	mutable FCriticalSection ResultLock;
+	FTransform PendingCorrection;
+	bool bHasPendingCorrection;
+	EMultiDeviceAlignmentState State;
+	float AlignmentError;
+	int32 NumBumps;
+
+	// Background only
+	TArray<FMultiDeviceAlignmentSample> Reservoir;
+	TArray<FMultiDeviceAlignmentSample> FreshSamples;
+	TArray<float> FreshErrors;
+	TMap<FIntVector, int32> CellCounts;
+	uint64 NextSequence;
+	int32 KnownEpoch;
+	int32 BumpEpoch;
+	FKabschSolver Solver;
+	TArray<FVector> InPoints;
+	TArray<FVector> RefPoints;
+	TArray<float> Weights;
+};
@@ -0,0 +1,56 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "SourceDeviceTimeAlignment.h"
+
+namespace
+{
+// Smoothing for the per device lag, frame timing jitters by a few hundred microseconds
+const double LagSmoothing = 0.1;
+}	 // namespace
+
+int64 FSourceDeviceTimeAlignment::Update(const int64 Now, const TArray<int64>& LatestFrameTimeStamps, const float LatencyBudgetMS)
+{
+	Clocks.SetNum(LatestFrameTimeStamps.Num());
+
+	double MaxLag = 0;
+	for (int32 DeviceIndex = 0; DeviceIndex < LatestFrameTimeStamps.Num(); DeviceIndex++)
+	{
+		FDeviceClock& Clock = Clocks[DeviceIndex];
+		if (LatestFrameTimeStamps[DeviceIndex] == 0)
+		{
+			Clock.bValid = false;
+			continue;
+		}
+		const double Lag = Now - LatestFrameTimeStamps[DeviceIndex];
+		if (Clock.bValid)
+		{
+			Clock.Lag = FMath::Lerp(Clock.Lag, Lag, LagSmoothing);
+		}
+		else
+		{
+			Clock.Lag = Lag;
+			Clock.bValid = true;
+		}
+		MaxLag = FMath::Max(MaxLag, Clock.Lag);
+	}
+
+	// wait for the slowest device so every device has a sample either side of the target, within the budget
+	const double Delay = FMath::Clamp(MaxLag, 0.0, (double) LatencyBudgetMS * 1000.0);
+	DelayInMS = (float) (Delay / 1000.0);
+	return Now - (int64) Delay;
+}
+
+void FSourceDeviceTimeAlignment::GetLagsInMS(TArray<float>& OutLags) const
+{
+	OutLags.Reset(Clocks.Num());
+	for (const FDeviceClock& Clock : Clocks)
+	{
+		OutLags.Add((float) (Clock.Lag / 1000.0));
+	}
+}
@@ -0,0 +1,50 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Picks the timestamp a combined device resamples its source devices to. LeapC devices share the service clock, so
+ * only how far each device's newest frame trails it is tracked, and the target waits for the slowest device within a
+ * latency budget
+ */
+class FSourceDeviceTimeAlignment
+{
+public:
+	/** LatestFrameTimeStamps holds each device's newest frame timestamp, 0 if it has none. Returns the target timestamp */
+	int64 Update(const int64 Now, const TArray<int64>& LatestFrameTimeStamps, const float LatencyBudgetMS);
+	/** Not time aligning, no delay */
+	void Reset()
+	{
+		DelayInMS = 0;
+	}
+
+	bool IsValid(const int32 DeviceIndex) const
+	{
+		return Clocks.IsValidIndex(DeviceIndex) && Clocks[DeviceIndex].bValid;
+	}
+	/** How far in the past the target is */
+	float GetDelayInMS() const
+	{
+		return DelayInMS;
+	}
+	void GetLagsInMS(TArray<float>& OutLags) const;
+
+private:
+	// Microseconds
+	struct FDeviceClock
+	{
+		// How far the newest frame is behind now, smoothed
+		double Lag = 0;
+		bool bValid = false;
+	};
+	TArray<FDeviceClock> Clocks;
+	float DelayInMS = 0;
+};
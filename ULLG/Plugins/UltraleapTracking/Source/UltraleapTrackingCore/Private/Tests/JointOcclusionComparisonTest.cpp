@@ -0,0 +1,262 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "Components/SceneCaptureComponent2D.h"
+#include "Components/StaticMeshComponent.h"
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Engine/World.h"
+#include "LeapTestDevice.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Misc/App.h"
+#include "Misc/AutomationTest.h"
+#include "Multileap/JointOcclusionActor.h"
+#include "Multileap/JointOcclusionEstimator.h"
+#include "RenderingThread.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+constexpr int32 CaptureResolution = 512;
+constexpr int32 NumDevices = 3;
+// The render path draws the first four joints of each finger
+constexpr int32 NumRenderedJointsPerFinger = 4;
+constexpr int32 NumRenderedJoints = FJointOcclusionEstimator::NumFingers * NumRenderedJointsPerFinger;
+// Joints covering fewer pixels than this with nothing in front are too small to compare
+constexpr int32 MinUnoccludedPixels = 50;
+// Mean absolute difference allowed per device, the estimator samples seven rays per joint
+const float MeanTolerance = 0.2f;
+
+// Mirrors the estimator's hand model, bones are at least this thick and the metacarpals cover the palm
+const float MinBoneRadius = 0.4f;
+const float PalmCoverageScale = 1.0f / 8.0f;
+
+// The engine's basic shapes are 100cm across
+const float BasicShapeSize = 100.0f;
+
+UStaticMeshComponent* AddShape(AActor* Owner, UStaticMesh* Mesh, UMaterialInterface* Material, const FLinearColor& Colour,
+	const FTransform& Transform)
+{
+	UStaticMeshComponent* Component = NewObject<UStaticMeshComponent>(Owner);
+	Component->SetStaticMesh(Mesh);
+	UMaterialInstanceDynamic* Instance = UMaterialInstanceDynamic::Create(Material, Owner);
+	Instance->SetVectorParameterValue(TEXT("Color"), Colour);
+	Component->SetMaterial(0, Instance);
+	Component->SetWorldTransform(Transform);
+	Component->RegisterComponent();
+	return Component;
+}
+
+// The capsule hand the render path captures, coloured joint spheres joined by black bones. Bones stop at the joint
+// spheres as the estimator never counts a joint's own bones as occluders
+void AddHand(AActor* Owner, const FLeapHandData& Hand, const TArray<FLinearColor>& Colours, UStaticMesh* Sphere,
+	UStaticMesh* Cylinder, UMaterialInterface* Material, TArray<UStaticMeshComponent*>& OutJointSpheres)
+{
+	const float PalmRadius = Hand.Palm.Width * PalmCoverageScale;
+	for (int32 Finger = 0; Finger < FJointOcclusionEstimator::NumFingers; Finger++)
+	{
+		const FLeapDigitData& Digit = Hand.Digits[Finger];
+		for (int32 Bone = 0; Bone < FJointOcclusionEstimator::NumBones; Bone++)
+		{
+			const FLeapBoneData& BoneData = Digit.Bones[Bone];
+			const float JointRadius = FMath::Max(BoneData.Width * 0.5f, MinBoneRadius);
+			const float BoneRadius = Bone == 0 ? FMath::Max(JointRadius, PalmRadius) : JointRadius;
+
+			const FVector JointScale(2.0f * JointRadius / BasicShapeSize);
+			OutJointSpheres.Add(AddShape(Owner, Sphere, Material, Colours[Finger * NumRenderedJointsPerFinger + Bone],
+				FTransform(FQuat::Identity, BoneData.PrevJoint, JointScale)));
+			if (Bone == FJointOcclusionEstimator::NumBones - 1)
+			{
+				AddShape(Owner, Sphere, Material, FLinearColor::Black, FTransform(FQuat::Identity, BoneData.NextJoint, JointScale));
+			}
+
+			const FVector Axis = BoneData.NextJoint - BoneData.PrevJoint;
+			const float Length = Axis.Size() - 2.0f * JointRadius;
+			if (Length > KINDA_SMALL_NUMBER)
+			{
+				const FVector Direction = Axis.GetSafeNormal();
+				AddShape(Owner, Cylinder, Material, FLinearColor::Black,
+					FTransform(FRotationMatrix::MakeFromZ(Direction).ToQuat(), (BoneData.PrevJoint + BoneData.NextJoint) * 0.5f,
+						FVector(2.0f * BoneRadius / BasicShapeSize, 2.0f * BoneRadius / BasicShapeSize, Length / BasicShapeSize)));
+			}
+		}
+	}
+}
+
+USceneCaptureComponent2D* AddCapture(AActor* Owner, const FVector& Position, const FVector& Target)
+{
+	UTextureRenderTarget2D* RenderTarget = NewObject<UTextureRenderTarget2D>(Owner);
+	RenderTarget->RenderTargetFormat = RTF_RGBA16f;
+	RenderTarget->ClearColor = FLinearColor::Black;
+	RenderTarget->InitAutoFormat(CaptureResolution, CaptureResolution);
+	RenderTarget->UpdateResourceImmediate(true);
+
+	USceneCaptureComponent2D* Capture = NewObject<USceneCaptureComponent2D>(Owner);
+	Capture->TextureTarget = RenderTarget;
+	// unlit sphere colours, as the palette expects
+	Capture->CaptureSource = ESceneCaptureSource::SCS_BaseColor;
+	Capture->FOVAngle = 70.0f;
+	Capture->bCaptureEveryFrame = false;
+	Capture->bCaptureOnMovement = false;
+	Capture->ShowFlags.SetAntiAliasing(false);
+	Capture->SetWorldLocationAndRotation(Position, FRotationMatrix::MakeFromX(Target - Position).Rotator());
+	Capture->RegisterComponent();
+	return Capture;
+}
+
+void CaptureAndCount(AJointOcclusionActor* Actor, const TArray<USceneCaptureComponent2D*>& Captures)
+{
+	for (USceneCaptureComponent2D* Capture : Captures)
+	{
+		Capture->CaptureScene();
+	}
+	FlushRenderingCommands();
+	Actor->UpdateColourCountMaps();
+}
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJointOcclusionComparisonTest, "Ultraleap.Multileap.JointOcclusionRenderComparison",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJointOcclusionComparisonTest::RunTest(const FString& Parameters)
+{
+	if (!FApp::CanEverRender() || !GEngine)
+	{
+		AddWarning(TEXT("Rendering isn't available, joint occlusion not compared."));
+		return true;
+	}
+	UStaticMesh* Sphere = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Sphere.Sphere"));
+	UStaticMesh* Cylinder = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cylinder.Cylinder"));
+	UMaterialInterface* Material =
+		LoadObject<UMaterialInterface>(nullptr, TEXT("/Engine/BasicShapes/BasicShapeMaterial.BasicShapeMaterial"));
+	if (!Sphere || !Cylinder || !Material)
+	{
+		AddWarning(TEXT("Engine basic shapes aren't available, joint occlusion not compared."));
+		return true;
+	}
+
+	FLeapTestDeviceWrapper Source(TEXT("OCCLUSION1"), 1);
+	Source.SetFrame(1, 1000000, {MakeTestLeapHand(eLeapHandType_Left, 1, FVector(0.f, 200.f, 0.f))});
+	const FLeapFrameData Frame = Source.GetFrameData();
+	if (!TestEqual(TEXT("The synthetic frame has a hand"), Frame.Hands.Num(), 1))
+	{
+		return false;
+	}
+	const FLeapHandData& Hand = Frame.Hands[0];
+
+	// under the palm as a device normally sees it, along the knuckles from the thumb side and back along the fingers,
+	// the last two with heavy self occlusion
+	const FVector Palm = Hand.Palm.Position;
+	const FVector ThumbSide = (Hand.Digits[1].Bones[0].PrevJoint - Hand.Digits[4].Bones[0].PrevJoint).GetSafeNormal();
+	const FVector Fingers = (Hand.Digits[2].Bones[3].NextJoint - Hand.Digits[2].Bones[0].PrevJoint).GetSafeNormal();
+	const FVector DevicePositions[NumDevices] = {FVector::ZeroVector, Palm + ThumbSide * 25.0f, Palm + Fingers * 30.0f};
+	const TCHAR* DeviceNames[NumDevices] = {TEXT("OCCLUSIONBELOW"), TEXT("OCCLUSIONSIDE"), TEXT("OCCLUSIONFRONT")};
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	AJointOcclusionActor* Actor = World->SpawnActor<AJointOcclusionActor>();
+	Actor->bUseAsyncReadback = false;
+	Actor->SetupColours(false, false);
+
+	AActor* Scene = World->SpawnActor<AActor>();
+	TArray<UStaticMeshComponent*> JointSpheres;
+	AddHand(Scene, Hand, Actor->SphereColoursLeft, Sphere, Cylinder, Material, JointSpheres);
+
+	TArray<USceneCaptureComponent2D*> Captures;
+	for (int32 Device = 0; Device < NumDevices; Device++)
+	{
+		Captures.Add(AddCapture(Scene, DevicePositions[Device], Palm));
+		Actor->DeviceToSceneCaptures.Add(DeviceNames[Device], Captures.Last());
+	}
+	auto GetPixelCount = [Actor](const int32 Device, const int32 RenderedJoint)
+	{
+		const TArray<FColourMap*>& Maps = Actor->GetColourCountMaps();
+		return Maps.IsValidIndex(Device) ? Maps[Device]->GetJointPixelCount(LEAP_HAND_LEFT, RenderedJoint) : 0;
+	};
+
+	// the render path's own normalisation (a fixed pixel count) depends on the capture size, so each joint is
+	// compared against the pixels it covers with nothing in front of it
+	TArray<int32> Seen[NumDevices];
+	TArray<int32> Unoccluded[NumDevices];
+	CaptureAndCount(Actor, Captures);
+	for (int32 Device = 0; Device < NumDevices; Device++)
+	{
+		Unoccluded[Device].SetNumZeroed(NumRenderedJoints);
+		for (int32 RenderedJoint = 0; RenderedJoint < NumRenderedJoints; RenderedJoint++)
+		{
+			Seen[Device].Add(GetPixelCount(Device, RenderedJoint));
+		}
+	}
+	for (USceneCaptureComponent2D* Capture : Captures)
+	{
+		Capture->PrimitiveRenderMode = ESceneCapturePrimitiveRenderMode::PRM_UseShowOnlyList;
+	}
+	for (int32 RenderedJoint = 0; RenderedJoint < NumRenderedJoints; RenderedJoint++)
+	{
+		for (USceneCaptureComponent2D* Capture : Captures)
+		{
+			Capture->ShowOnlyComponents.Reset();
+			Capture->ShowOnlyComponent(JointSpheres[RenderedJoint]);
+		}
+		CaptureAndCount(Actor, Captures);
+		for (int32 Device = 0; Device < NumDevices; Device++)
+		{
+			Unoccluded[Device][RenderedJoint] = GetPixelCount(Device, RenderedJoint);
+		}
+	}
+
+	FJointOcclusionEstimator Estimator;
+	TArray<float> Estimated;
+	for (int32 Device = 0; Device < NumDevices; Device++)
+	{
+		Estimator.Estimate(Hand, DevicePositions[Device], Estimated);
+
+		float TotalDifference = 0.0f;
+		float MaxDifference = 0.0f;
+		int32 NumCompared = 0;
+		FString Details;
+		for (int32 RenderedJoint = 0; RenderedJoint < NumRenderedJoints; RenderedJoint++)
+		{
+			if (Unoccluded[Device][RenderedJoint] < MinUnoccludedPixels)
+			{
+				continue;
+			}
+			const int32 Finger = RenderedJoint / NumRenderedJointsPerFinger;
+			const int32 Joint = Finger * (FJointOcclusionEstimator::NumBones + 1) + RenderedJoint % NumRenderedJointsPerFinger;
+			const float Rendered = FMath::Min((float) Seen[Device][RenderedJoint] / Unoccluded[Device][RenderedJoint], 1.0f);
+			const float Difference = FMath::Abs(Rendered - Estimated[Joint]);
+
+			TotalDifference += Difference;
+			MaxDifference = FMath::Max(MaxDifference, Difference);
+			NumCompared++;
+			Details += FString::Printf(TEXT(" %d:%.2f/%.2f"), Joint, Rendered, Estimated[Joint]);
+		}
+		const float MeanDifference = NumCompared > 0 ? TotalDifference / NumCompared : 0.0f;
+		AddInfo(FString::Printf(TEXT("%s: %d joints, mean difference %.3f, max %.3f (joint:rendered/estimated%s)"),
+			DeviceNames[Device], NumCompared, MeanDifference, MaxDifference, *Details));
+
+		TestTrue(FString::Printf(TEXT("%s sees most joints"), DeviceNames[Device]), NumCompared >= NumRenderedJoints / 2);
+		TestTrue(FString::Printf(TEXT("%s estimate matches the render path"), DeviceNames[Device]),
+			MeanDifference <= MeanTolerance);
+	}
+
+	Actor->Destroy();
+	Scene->Destroy();
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif
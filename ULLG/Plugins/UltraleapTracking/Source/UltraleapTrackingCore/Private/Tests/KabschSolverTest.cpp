@@ -0,0 +1,191 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Multileap/FKabschSolver.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+// Joint positions of both hands as the alignment service collects them
+constexpr int32 NumJoints = 42;
+
+struct FKabschCase
+{
+	TArray<FVector> InPoints;
+	TArray<FVector> RefPoints;
+	FTransform Expected;
+};
+
+// Points on a hand sized volume, mapped by a known transform with tracking noise, OutlierFraction of them are moved
+// as a badly tracked joint would be
+FKabschCase MakeCase(FRandomStream& Stream, const float Noise, const float OutlierFraction)
+{
+	FKabschCase Case;
+	const FRotator Rotation(Stream.FRandRange(-60.f, 60.f), Stream.FRandRange(-180.f, 180.f), Stream.FRandRange(-30.f, 30.f));
+	Case.Expected = FTransform(Rotation, Stream.GetUnitVector() * Stream.FRandRange(5.f, 40.f));
+	const int32 NumOutliers = FMath::RoundToInt(NumJoints * OutlierFraction);
+	for (int32 i = 0; i < NumJoints; i++)
+	{
+		const FVector Point(Stream.FRandRange(-10.f, 10.f), Stream.FRandRange(-10.f, 10.f), Stream.FRandRange(-4.f, 4.f));
+		FVector Mapped = Case.Expected.TransformPosition(Point) + Stream.GetUnitVector() * Stream.FRandRange(0.f, Noise);
+		if (i < NumOutliers)
+		{
+			Mapped += Stream.GetUnitVector() * Stream.FRandRange(5.f, 10.f);
+		}
+		Case.InPoints.Add(Point);
+		Case.RefPoints.Add(Mapped);
+	}
+	return Case;
+}
+
+void MeasureError(const FTransform& Solved, const FTransform& Expected, float& OutTranslation, float& OutRotationDegrees)
+{
+	OutTranslation = FVector::Distance(Solved.GetTranslation(), Expected.GetTranslation());
+	OutRotationDegrees = FMath::RadiansToDegrees(Solved.GetRotation().AngularDistance(Expected.GetRotation()));
+}
+
+FKabschSolverOptions MakeOptions(const EKabschOutlierRejection Rejection, const bool bUseClosedForm)
+{
+	FKabschSolverOptions Options;
+	Options.OutlierRejection = Rejection;
+	Options.bUseClosedForm = bUseClosedForm;
+	// a couple of times the tracking noise
+	Options.InlierThreshold = .5f;
+	return Options;
+}
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKabschSolverAccuracyTest, "Ultraleap.Multileap.KabschAccuracy",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FKabschSolverAccuracyTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumCases = 50;
+	const TArray<float> NoWeights;
+	FRandomStream Stream(1234);
+	FKabschSolver Solver;
+
+	// Clean points, the closed form and the iterative solve both find the transform
+	float MaxClosedFormError = 0.f;
+	float MaxIterativeRotation = 0.f;
+	for (int32 CaseIndex = 0; CaseIndex < NumCases; CaseIndex++)
+	{
+		const FKabschCase Case = MakeCase(Stream, 0.f, 0.f);
+		float Translation, Rotation;
+		MeasureError(Solver.Solve(Case.InPoints, Case.RefPoints, NoWeights, MakeOptions(EKabschOutlierRejection::None, true)),
+			Case.Expected, Translation, Rotation);
+		MaxClosedFormError = FMath::Max3(MaxClosedFormError, Translation, Rotation);
+
+		FKabschSolverOptions Iterative = MakeOptions(EKabschOutlierRejection::None, false);
+		Iterative.OptimalRotationIterations = 50;
+		MeasureError(Solver.Solve(Case.InPoints, Case.RefPoints, NoWeights, Iterative), Case.Expected, Translation, Rotation);
+		MaxIterativeRotation = FMath::Max(MaxIterativeRotation, Rotation);
+	}
+	AddInfo(FString::Printf(TEXT("Clean points: closed form max error %.5f, iterative max rotation error %.3fdeg"),
+		MaxClosedFormError, MaxIterativeRotation));
+	TestTrue(TEXT("Closed form solve is exact on clean points"), MaxClosedFormError < .01f);
+	TestTrue(TEXT("Iterative solve converges on clean points"), MaxIterativeRotation < .5f);
+
+	// Noise and 20% outliers, rejection recovers the transform the plain solve is dragged away from
+	const TCHAR* Names[] = {TEXT("None"), TEXT("IRLS"), TEXT("RANSAC")};
+	const EKabschOutlierRejection Rejections[] = {
+		EKabschOutlierRejection::None, EKabschOutlierRejection::IRLS, EKabschOutlierRejection::RANSAC};
+	float MeanTranslation[3] = {0.f, 0.f, 0.f};
+	float MeanRotation[3] = {0.f, 0.f, 0.f};
+	int32 MinInliers[3] = {NumJoints, NumJoints, NumJoints};
+	for (int32 CaseIndex = 0; CaseIndex < NumCases; CaseIndex++)
+	{
+		const FKabschCase Case = MakeCase(Stream, .1f, .2f);
+		for (int32 Method = 0; Method < 3; Method++)
+		{
+			float Translation, Rotation;
+			MeasureError(Solver.Solve(Case.InPoints, Case.RefPoints, NoWeights, MakeOptions(Rejections[Method], true)), Case.Expected,
+				Translation, Rotation);
+			MeanTranslation[Method] += Translation / NumCases;
+			MeanRotation[Method] += Rotation / NumCases;
+			MinInliers[Method] = FMath::Min(MinInliers[Method], Solver.GetInlierCount());
+		}
+	}
+	for (int32 Method = 0; Method < 3; Method++)
+	{
+		AddInfo(FString::Printf(TEXT("20%% outliers, %s: mean error %.3fcm %.3fdeg, min inliers %d of %d"), Names[Method],
+			MeanTranslation[Method], MeanRotation[Method], MinInliers[Method], NumJoints));
+	}
+	TestTrue(TEXT("IRLS beats the plain solve with outliers"), MeanRotation[1] < MeanRotation[0]);
+	TestTrue(TEXT("RANSAC beats the plain solve with outliers"), MeanRotation[2] < MeanRotation[0]);
+	TestTrue(TEXT("IRLS recovers the transform"), MeanTranslation[1] < .5f && MeanRotation[1] < 1.f);
+	TestTrue(TEXT("RANSAC recovers the transform"), MeanTranslation[2] < .25f && MeanRotation[2] < .5f);
+	TestTrue(TEXT("RANSAC keeps the non outliers as inliers"), MinInliers[2] >= NumJoints * 3 / 4);
+
+	// Zero weighted outliers are ignored by the plain solve
+	const FKabschCase Case = MakeCase(Stream, 0.f, .2f);
+	TArray<float> Weights;
+	for (int32 i = 0; i < NumJoints; i++)
+	{
+		Weights.Add(i < FMath::RoundToInt(NumJoints * .2f) ? 0.f : 1.f);
+	}
+	float Translation, Rotation;
+	const FTransform Weighted =
+		Solver.Solve(Case.InPoints, Case.RefPoints, Weights, MakeOptions(EKabschOutlierRejection::None, true));
+	MeasureError(Weighted, Case.Expected, Translation, Rotation);
+	TestTrue(TEXT("Zero weights exclude points"), Translation < .01f && Rotation < .01f);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKabschSolverBenchmark, "Ultraleap.Multileap.KabschBenchmark",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FKabschSolverBenchmark::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumCases = 64;
+	constexpr int32 NumSolves = 2000;
+	const TArray<float> NoWeights;
+	FRandomStream Stream(5678);
+	TArray<FKabschCase> Cases;
+	for (int32 CaseIndex = 0; CaseIndex < NumCases; CaseIndex++)
+	{
+		Cases.Add(MakeCase(Stream, .1f, .2f));
+	}
+
+	FKabschSolver Solver;
+	double Checksum = 0.0;
+
+	// the original matrix solve, as the alignment used before the weighted one
+	uint64 Start = FPlatformTime::Cycles64();
+	for (int32 SolveIndex = 0; SolveIndex < NumSolves; SolveIndex++)
+	{
+		const FKabschCase& Case = Cases[SolveIndex % NumCases];
+		Checksum += Solver.SolveKabsch(Case.InPoints, Case.RefPoints).M[3][0];
+	}
+	AddInfo(FString::Printf(TEXT("SolveKabsch (iterative, unweighted): %.2fus/solve"),
+		FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start) * 1000.0 / NumSolves));
+
+	const TCHAR* Names[] = {TEXT("Iterative"), TEXT("Closed form"), TEXT("Closed form + IRLS"), TEXT("Closed form + RANSAC")};
+	const FKabschSolverOptions Options[] = {MakeOptions(EKabschOutlierRejection::None, false),
+		MakeOptions(EKabschOutlierRejection::None, true), MakeOptions(EKabschOutlierRejection::IRLS, true),
+		MakeOptions(EKabschOutlierRejection::RANSAC, true)};
+	for (int32 Method = 0; Method < 4; Method++)
+	{
+		Start = FPlatformTime::Cycles64();
+		for (int32 SolveIndex = 0; SolveIndex < NumSolves; SolveIndex++)
+		{
+			const FKabschCase& Case = Cases[SolveIndex % NumCases];
+			Checksum += Solver.Solve(Case.InPoints, Case.RefPoints, NoWeights, Options[Method]).GetTranslation().X;
+		}
+		AddInfo(FString::Printf(TEXT("%s: %.2fus/solve of %d points"), Names[Method],
+			FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start) * 1000.0 / NumSolves, NumJoints));
+	}
+	// keeps the solves from being optimised out
+	TestTrue(TEXT("Solves produce finite results"), FMath::IsFinite(Checksum));
+	return true;
+}
+
+#endif
@@ -0,0 +1,158 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/MemoryBase.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Sits in front of GMalloc, forwarding everything to it, and counts the allocations of threads that have a counter in
+ * scope. It is installed the first time a counter is created and stays installed for the rest of the process, so other
+ * threads never see GMalloc swapped back or the wrapper destroyed while they allocate or free through it.
+ */
+class FLeapAllocationCountingMalloc : public FMalloc
+{
+public:
+	struct FCounts
+	{
+		int32 Count = 0;
+		int64 Bytes = 0;
+	};
+
+	// Game thread, installs the wrapper the first time
+	static FLeapAllocationCountingMalloc& Get()
+	{
+		check(IsInGameThread());
+		// never deleted, another thread may be inside it at shutdown
+		static FLeapAllocationCountingMalloc* Instance = new FLeapAllocationCountingMalloc(GMalloc);
+		return *Instance;
+	}
+
+	// The counts the calling thread records into, nullptr when it isn't counting
+	static FCounts*& ThreadCounts()
+	{
+		static thread_local FCounts* Counts = nullptr;
+		return Counts;
+	}
+
+	// FMalloc
+	virtual void* Malloc(SIZE_T Size, uint32 Alignment) override
+	{
+		Record(Size);
+		return Inner->Malloc(Size, Alignment);
+	}
+	virtual void* Realloc(void* Original, SIZE_T Size, uint32 Alignment) override
+	{
+		if (Size > 0)
+		{
+			Record(Size);
+		}
+		return Inner->Realloc(Original, Size, Alignment);
+	}
+	virtual void Free(void* Original) override
+	{
+		Inner->Free(Original);
+	}
+	virtual SIZE_T QuantizeSize(SIZE_T Size, uint32 Alignment) override
+	{
+		return Inner->QuantizeSize(Size, Alignment);
+	}
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+	{
+		return Inner->GetAllocationSize(Original, SizeOut);
+	}
+	virtual void Trim(bool bTrimThreadCaches) override
+	{
+		Inner->Trim(bTrimThreadCaches);
+	}
+	virtual void SetupTLSCachesOnCurrentThread() override
+	{
+		Inner->SetupTLSCachesOnCurrentThread();
+	}
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+	{
+		Inner->ClearAndDisableTLSCachesOnCurrentThread();
+	}
+	virtual bool IsInternallyThreadSafe() const override
+	{
+		return Inner->IsInternallyThreadSafe();
+	}
+	virtual const TCHAR* GetDescriptiveName() override
+	{
+		return Inner->GetDescriptiveName();
+	}
+
+private:
+	FMalloc* Inner;
+
+	explicit FLeapAllocationCountingMalloc(FMalloc* InInner) : Inner(InInner)
+	{
+		// the wrapper forwards to the same allocator, so threads reading the old GMalloc meanwhile are fine
+		GMalloc = this;
+	}
+
+	static void Record(const SIZE_T Size)
+	{
+		if (FCounts* Counts = ThreadCounts())
+		{
+			Counts->Count++;
+			Counts->Bytes += Size;
+		}
+	}
+};
+
+/**
+ * Counts heap allocations made by the constructing thread while in scope, for allocation tests. Allocations from other
+ * threads pass through uncounted. Platforms that bypass GMalloc with an inlined allocator count nothing, check
+ * IsCounting() before asserting on the counts.
+ */
+class FLeapScopedAllocationCounter
+{
+public:
+	FLeapScopedAllocationCounter()
+	{
+		FLeapAllocationCountingMalloc::Get();
+		check(FLeapAllocationCountingMalloc::ThreadCounts() == nullptr);
+		FLeapAllocationCountingMalloc::ThreadCounts() = &Counts;
+		// an allocation to check allocations reach GMalloc at all
+		void* Probe = FMemory::Malloc(16);
+		FMemory::Free(Probe);
+		bCounting = Counts.Count > 0;
+		ResetCount();
+	}
+	~FLeapScopedAllocationCounter()
+	{
+		FLeapAllocationCountingMalloc::ThreadCounts() = nullptr;
+	}
+
+	bool IsCounting() const
+	{
+		return bCounting;
+	}
+	int32 GetCount() const
+	{
+		return Counts.Count;
+	}
+	int64 GetBytes() const
+	{
+		return Counts.Bytes;
+	}
+	void ResetCount()
+	{
+		Counts = FLeapAllocationCountingMalloc::FCounts();
+	}
+
+private:
+	FLeapAllocationCountingMalloc::FCounts Counts;
+	bool bCounting = false;
+};
+
+#endif
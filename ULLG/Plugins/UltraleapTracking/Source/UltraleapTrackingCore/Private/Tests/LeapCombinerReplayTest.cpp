@@ -0,0 +1,142 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "LeapTestDevice.h"
+#include "Misc/AutomationTest.h"
+#include "Multileap/FUltraleapCombinedDeviceConfidence.h"
+#include "Multileap/FUltraleapCombinedDeviceKalman.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+constexpr int32 NumRecordedFrames = 400;
+constexpr int64 FramePeriod = 11111;
+
+typedef TArray<TArray<FLeapFrameData>> FCombinerRecording;
+
+// Two devices watching the same hands with their own tracking noise. The left hand leaves the second device's view
+// part way through and the right hand is lost by both for a few frames, so the histories are cleared and refilled
+FCombinerRecording Record(FLeapTestDeviceWrapper& First, FLeapTestDeviceWrapper& Second)
+{
+	FRandomStream Stream(99);
+	FCombinerRecording Recording;
+	FLeapTestDeviceWrapper* Sources[2] = {&First, &Second};
+	for (int32 FrameIndex = 0; FrameIndex < NumRecordedFrames; FrameIndex++)
+	{
+		const int64 TimeStamp = 1000000 + FrameIndex * FramePeriod;
+		const float Angle = 2.f * PI * FrameIndex / 90.f;
+		const FVector Right(100.f + 60.f * FMath::Cos(Angle), 200.f + 30.f * FMath::Sin(Angle), -40.f);
+		const FVector Left(-120.f, 220.f + 20.f * FMath::Sin(Angle * .5f), -20.f);
+
+		TArray<FLeapFrameData>& SourceFrames = Recording.AddDefaulted_GetRef();
+		for (int32 SourceIndex = 0; SourceIndex < 2; SourceIndex++)
+		{
+			TArray<LEAP_HAND> Hands;
+			if (SourceIndex == 0 || FrameIndex < 150 || FrameIndex >= 250)
+			{
+				Hands.Add(MakeTestLeapHand(eLeapHandType_Left, 1, Left + Stream.GetUnitVector() * Stream.FRandRange(0.f, 2.f)));
+			}
+			if (FrameIndex < 200 || FrameIndex >= 210)
+			{
+				Hands.Add(MakeTestLeapHand(eLeapHandType_Right, 2, Right + Stream.GetUnitVector() * Stream.FRandRange(0.f, 2.f)));
+			}
+			// the sources aren't in lockstep, the second device's frames are a little later
+			Sources[SourceIndex]->SetFrame(FrameIndex, TimeStamp + SourceIndex * 3000, Hands);
+			SourceFrames.Add(Sources[SourceIndex]->GetFrameData());
+		}
+	}
+	return Recording;
+}
+
+struct FReplayResult
+{
+	uint32 Checksum = 0;
+	int32 NumCombinedHands = 0;
+};
+
+// Replays the recording through a new combiner. With bStall the wall clock jumps every so often, which mustn't
+// change anything as the combiners only use tracking timestamps
+FReplayResult Replay(const ELeapDeviceCombinerClass CombinerClass, FLeapTestDeviceWrapper& First, FLeapTestDeviceWrapper& Second,
+	const FCombinerRecording& Recording, const bool bStall)
+{
+	FLeapTestDeviceWrapper CombinedWrapper(TEXT("Combined - Replay"));
+	const TArray<IHandTrackingWrapper*> DevicesToCombine = {&First, &Second};
+	if (CombinerClass == ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_KALMAN)
+	{
+		CombinedWrapper.Device =
+			MakeShared<FUltraleapCombinedDeviceKalman>(&CombinedWrapper, &CombinedWrapper, DevicesToCombine);
+	}
+	else
+	{
+		CombinedWrapper.Device =
+			MakeShared<FUltraleapCombinedDeviceConfidence>(&CombinedWrapper, &CombinedWrapper, DevicesToCombine);
+	}
+	FUltraleapCombinedDevice* Combiner = static_cast<FUltraleapCombinedDevice*>(CombinedWrapper.Device.Get());
+
+	const FLeapOptions Options;
+	FLeapFrameData CombinedFrame;
+	FReplayResult Result;
+	for (int32 FrameIndex = 0; FrameIndex < Recording.Num(); FrameIndex++)
+	{
+		if (bStall && FrameIndex % 50 == 25)
+		{
+			FPlatformProcess::Sleep(.02f);
+		}
+		Combiner->CombineRecordedFrames(Recording[FrameIndex], Options, CombinedFrame);
+		for (const FLeapHandData& Hand : CombinedFrame.Hands)
+		{
+			Result.Checksum = FCrc::MemCrc32(&Hand.Palm.Position, sizeof(FVector), Result.Checksum);
+			for (const FLeapDigitData& Digit : Hand.Digits)
+			{
+				for (const FLeapBoneData& Bone : Digit.Bones)
+				{
+					Result.Checksum = FCrc::MemCrc32(&Bone.NextJoint, sizeof(FVector), Result.Checksum);
+				}
+			}
+			Result.NumCombinedHands++;
+		}
+	}
+	return Result;
+}
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapCombinerReplayTest, "Ultraleap.Multileap.CombinerReplay",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapCombinerReplayTest::RunTest(const FString& Parameters)
+{
+	FLeapTestDeviceWrapper First(TEXT("REPLAY0001"), 1);
+	FLeapTestDeviceWrapper Second(TEXT("REPLAY0002"), 2);
+	First.CreateDevice();
+	Second.CreateDevice();
+	const FCombinerRecording Recording = Record(First, Second);
+
+	const TCHAR* Names[] = {TEXT("Confidence"), TEXT("Kalman")};
+	const ELeapDeviceCombinerClass Classes[] = {
+		ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_CONFIDENCE, ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_KALMAN};
+	for (int32 ClassIndex = 0; ClassIndex < 2; ClassIndex++)
+	{
+		const FReplayResult Reference = Replay(Classes[ClassIndex], First, Second, Recording, false);
+		const FReplayResult Stalled = Replay(Classes[ClassIndex], First, Second, Recording, true);
+		AddInfo(FString::Printf(TEXT("%s combiner: %d combined hands over %d frames, checksum %08x"), Names[ClassIndex],
+			Reference.NumCombinedHands, Recording.Num(), Reference.Checksum));
+
+		// every frame has at least one hand and most have both
+		TestTrue(FString::Printf(TEXT("%s combiner combines the recorded hands"), Names[ClassIndex]),
+			Reference.NumCombinedHands > Recording.Num() * 3 / 2);
+		TestEqual(FString::Printf(TEXT("%s combiner replays to identical frames"), Names[ClassIndex]), Stalled.Checksum,
+			Reference.Checksum);
+		TestEqual(FString::Printf(TEXT("%s combiner replays the same hands"), Names[ClassIndex]), Stalled.NumCombinedHands,
+			Reference.NumCombinedHands);
+	}
+	return true;
+}
+
+#endif
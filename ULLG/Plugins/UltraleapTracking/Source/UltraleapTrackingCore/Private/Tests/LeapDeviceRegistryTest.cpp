@@ -0,0 +1,84 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "LeapAllocationCounter.h"
+#include "LeapDeviceRegistry.h"
+#include "LeapTestDevice.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapDeviceRegistryCombinedTest, "Ultraleap.Devices.RegistryCombinedDevices",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapDeviceRegistryCombinedTest::RunTest(const FString& Parameters)
+{
+	const ELeapDeviceCombinerClass Confidence = ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_CONFIDENCE;
+	const ELeapDeviceCombinerClass Angular = ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_ANGULAR;
+	FLeapTestDeviceWrapper First(TEXT("LP00000001"), 1);
+	FLeapTestDeviceWrapper Second(TEXT("LP00000002"), 2);
+	FLeapTestDeviceWrapper Combined(TEXT("Combined - 0001 0002"));
+	FLeapTestDeviceWrapper Incomplete(TEXT("Combined - 0001"));
+
+	FLeapDeviceRegistry Registry;
+	Registry.AddDevice(&First);
+	Registry.AddDevice(&Second);
+	Registry.AddCombinedDevice(&Combined, {TEXT("LP00000001"), TEXT("LP00000002")}, Confidence, {});
+	// requested before the third device connected
+	Registry.AddCombinedDevice(&Incomplete, {TEXT("LP00000001"), TEXT("LP00000003")}, Confidence, {TEXT("LP00000003")});
+
+	const TArray<FString> Requested = {TEXT("LP00000002"), TEXT("LP00000001")};
+	TestTrue(TEXT("Combined devices are found with the serials in any order"),
+		Registry.FindCombinedDevice(Requested, Confidence) == &Combined);
+	TestNull(TEXT("The combiner class is part of the key"), Registry.FindCombinedDevice(Requested, Angular));
+	TestNull(TEXT("A subset of the serials doesn't match"), Registry.FindCombinedDevice({TEXT("LP00000001")}, Confidence));
+	TestNull(TEXT("A superset of the serials doesn't match"),
+		Registry.FindCombinedDevice({TEXT("LP00000001"), TEXT("LP00000002"), TEXT("LP00000003")}, Confidence));
+	TestTrue(TEXT("Incomplete combined devices are found by their requested serials"),
+		Registry.FindCombinedDevice({TEXT("LP00000003"), TEXT("LP00000001")}, Confidence) == &Incomplete);
+
+	TArray<IHandTrackingWrapper*> Missing;
+	Registry.FindCombinedDevicesMissing(TEXT("LP00000003"), Missing);
+	TestTrue(TEXT("Combined devices waiting for a serial are found"), Missing.Num() == 1 && Missing[0] == &Incomplete);
+	Missing.Reset();
+	Registry.FindCombinedDevicesMissing(TEXT("LP00000001"), Missing);
+	TestEqual(TEXT("Connected serials aren't missing"), Missing.Num(), 0);
+
+	// looked up every time a component asks for its device
+	int32 LookupAllocations = 0;
+	bool bCounting = false;
+	{
+		FLeapScopedAllocationCounter Counter;
+		bCounting = Counter.IsCounting();
+		for (int32 Lookup = 0; Lookup < 100; Lookup++)
+		{
+			Registry.FindCombinedDevice(Requested, Confidence);
+		}
+		LookupAllocations = Counter.GetCount();
+	}
+	if (bCounting)
+	{
+		TestEqual(TEXT("Combined lookups don't allocate"), LookupAllocations, 0);
+	}
+	else
+	{
+		AddWarning(TEXT("Allocations bypass GMalloc on this platform, allocation counts not checked."));
+	}
+
+	const int32 TickListLength = Registry.GetTickList().Num();
+	TestTrue(TEXT("Removing a combined device succeeds"), Registry.RemoveDevice(&Incomplete));
+	TestNull(TEXT("A removed combined device isn't found"),
+		Registry.FindCombinedDevice({TEXT("LP00000001"), TEXT("LP00000003")}, Confidence));
+	TestTrue(TEXT("Other combined devices are still found"), Registry.FindCombinedDevice(Requested, Confidence) == &Combined);
+	TestEqual(TEXT("The tick list drops the removed device"), Registry.GetTickList().Num(), TickListLength - 1);
+	TestTrue(TEXT("Real devices tick before combined devices"), Registry.GetTickList().Last() == &Combined);
+	return true;
+}
+
+#endif
@@ -0,0 +1,70 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "LeapTestDevice.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapFrameSnapshotTest, "Ultraleap.Devices.FrameSnapshots",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapFrameSnapshotTest::RunTest(const FString& Parameters)
+{
+	FLeapTestDeviceWrapper Wrapper(TEXT("SNAPSHOTS1"), 1);
+	Wrapper.CreateDevice();
+	FUltraleapDevice& Device = *Wrapper.Device;
+	FLeapOptions Options = Device.GetOptions();
+	Options.bUseInterpolation = false;
+	Device.SetOptions(Options);
+
+	int64 FrameId = 0;
+	auto Tick = [&Wrapper, &Device, &FrameId](const float PalmX)
+	{
+		Wrapper.Now += 11111;
+		Wrapper.SetFrame(++FrameId, Wrapper.Now, {MakeTestLeapHand(eLeapHandType_Left, 1, FVector(PalmX, 200.f, 0.f))});
+		Device.CaptureAndEvaluateInput();
+	};
+
+	{
+		Tick(0.f);
+		const FLeapFrameSnapshot First = Device.GetLatestFrameSnapshot();
+		const FVector FirstPalm = First->Hands[0].Palm.Position;
+		TestTrue(TEXT("Readers share the published frame"), &Device.GetLatestFrameSnapshot().Get() == &First.Get());
+		TestTrue(TEXT("Without an origin the origin transformed frame is the published one"),
+			&Device.GetLatestFrameSnapshot(true).Get() == &First.Get());
+
+		Tick(50.f);
+		const FLeapFrameSnapshot Second = Device.GetLatestFrameSnapshot();
+		TestTrue(TEXT("The next frame is parsed into another frame"), &Second.Get() != &First.Get());
+		TestEqual(TEXT("A held snapshot keeps its frame id"), First->FrameId, 1);
+		TestEqual(TEXT("A held snapshot isn't written by later parses"), First->Hands[0].Palm.Position, FirstPalm);
+		TestFalse(TEXT("The new frame has the new hand"), Second->Hands[0].Palm.Position.Equals(FirstPalm));
+	}
+
+	// nobody holds the frames between ticks, parsing takes turns between the same two
+	TSet<const FLeapFrameData*> ParsedFrames;
+	for (int32 TickIndex = 0; TickIndex < 20; TickIndex++)
+	{
+		Tick(TickIndex * 5.f);
+		ParsedFrames.Add(&Device.GetLatestFrameSnapshot().Get());
+	}
+	TestEqual(TEXT("Frames no reader holds are parsed into again"), ParsedFrames.Num(), 2);
+
+	Device.SetDeviceOrigin(FTransform(FVector(10.f, 0.f, 0.f)));
+	Tick(0.f);
+	const FLeapFrameSnapshot OriginFrame = Device.GetLatestFrameSnapshot(true);
+	TestTrue(TEXT("A moved origin transforms a copy"), &OriginFrame.Get() != &Device.GetLatestFrameSnapshot().Get());
+	TestTrue(TEXT("The copy is made once per published frame"), &Device.GetLatestFrameSnapshot(true).Get() == &OriginFrame.Get());
+	TestFalse(TEXT("The copy is moved by the origin"),
+		OriginFrame->Hands[0].Palm.Position.Equals(Device.GetLatestFrameSnapshot()->Hands[0].Palm.Position));
+	return true;
+}
+
+#endif
@@ -0,0 +1,270 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "LeapHandStateMachine.h"
+#include "LeapTestDevice.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+constexpr int64 FramePeriod = 11111;
+
+LEAP_HAND Left(const uint32 Id, const float PinchStrength = 0.f, const float GrabStrength = 0.f)
+{
+	return MakeTestLeapHand(eLeapHandType_Left, Id, FVector(-120.f, 220.f, -20.f), PinchStrength, GrabStrength);
+}
+
+LEAP_HAND Right(const uint32 Id, const float PinchStrength = 0.f, const float GrabStrength = 0.f)
+{
+	return MakeTestLeapHand(eLeapHandType_Right, Id, FVector(100.f, 200.f, -40.f), PinchStrength, GrabStrength);
+}
+
+// Feeds a state machine frames converted as a device converts them, on a clock the test controls
+class FHandStateDriver
+{
+public:
+	explicit FHandStateDriver(const FLeapHandStateSettings& Settings) : Wrapper(TEXT("HANDSTATES"))
+	{
+		Machine.SetSettings(Settings);
+	}
+
+	// Advances the clock by DeltaTime (microseconds) and updates with a frame holding Hands. Returns the transitions
+	// as text, e.g. "L.Visible L.BeginTracking", they are also kept in Transitions
+	FString Step(const TArray<LEAP_HAND>& Hands, const int64 DeltaTime = FramePeriod)
+	{
+		Now += DeltaTime;
+		Wrapper.SetFrame(++FrameId, Now, Hands);
+		const FLeapFrameData Frame = Wrapper.GetFrameData();
+		Transitions.Reset();
+		Machine.Update(Frame, Now, Transitions);
+
+		static const TCHAR* Names[] = {TEXT("Visible"), TEXT("Hidden"), TEXT("BeginTracking"), TEXT("EndTracking"),
+			TEXT("Pinch"), TEXT("Unpinch"), TEXT("Grab"), TEXT("Release")};
+		FString Ret;
+		for (const FLeapHandStateMachine::FTransition& Transition : Transitions)
+		{
+			Ret += FString::Printf(TEXT("%s%s.%s"), Ret.IsEmpty() ? TEXT("") : TEXT(" "),
+				Transition.HandType == EHandType::LEAP_HAND_LEFT ? TEXT("L") : TEXT("R"), Names[(int32) Transition.Type]);
+		}
+		return Ret;
+	}
+
+	bool AllHandsLeft() const
+	{
+		for (const FLeapHandStateMachine::FTransition& Transition : Transitions)
+		{
+			if (Transition.HandIndex != INDEX_NONE)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	FLeapHandStateMachine Machine;
+	FLeapHandStateMachine::FTransitions Transitions;
+
+private:
+	FLeapTestDeviceWrapper Wrapper;
+	int64 Now = 1000000;
+	int64 FrameId = 0;
+};
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapHandStateHysteresisTest, "Ultraleap.HandStates.Hysteresis",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapHandStateHysteresisTest::RunTest(const FString& Parameters)
+{
+	const TCHAR* Names[] = {TEXT("Pinch"), TEXT("Grab")};
+	for (int32 GestureIndex = 0; GestureIndex < 2; GestureIndex++)
+	{
+		const bool bPinch = GestureIndex == 0;
+		auto Hand = [bPinch](const float Strength)
+		{
+			return Left(1, bPinch ? Strength : 0.f, bPinch ? 0.f : Strength);
+		};
+		const FString Start = bPinch ? TEXT("L.Pinch") : TEXT("L.Grab");
+		const FString End = bPinch ? TEXT("L.Unpinch") : TEXT("L.Release");
+
+		// frame based, every change is sent on the frame the threshold is crossed
+		FHandStateDriver Driver{FLeapHandStateSettings()};
+		TestEqual(TEXT("A hand entering starts tracking"), Driver.Step({Hand(.1f)}), TEXT("L.Visible L.BeginTracking"));
+		TestEqual(FString::Printf(TEXT("%s starts above the start threshold"), Names[GestureIndex]), Driver.Step({Hand(.81f)}),
+			Start);
+
+		FString Oscillation;
+		for (const float Strength : {.79f, .81f, .7f, .85f, .51f, .9f})
+		{
+			Oscillation += Driver.Step({Hand(Strength)});
+		}
+		TestEqual(FString::Printf(TEXT("%s doesn't retrigger around the start threshold"), Names[GestureIndex]), Oscillation,
+			FString());
+		TestEqual(FString::Printf(TEXT("%s ends at the end threshold"), Names[GestureIndex]), Driver.Step({Hand(.5f)}), End);
+
+		Oscillation.Reset();
+		for (const float Strength : {.49f, .51f, .45f, .79f, .6f, .8f})
+		{
+			Oscillation += Driver.Step({Hand(Strength)});
+		}
+		TestEqual(FString::Printf(TEXT("%s doesn't restart below the start threshold"), Names[GestureIndex]), Oscillation,
+			FString());
+		TestEqual(FString::Printf(TEXT("%s restarts above the start threshold"), Names[GestureIndex]), Driver.Step({Hand(.81f)}),
+			Start);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapHandStateDebounceTest, "Ultraleap.HandStates.Debounce",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapHandStateDebounceTest::RunTest(const FString& Parameters)
+{
+	FLeapHandStateSettings Settings;
+	Settings.PinchDebounce = 30000;
+	Settings.GrabDebounce = 30000;
+	FHandStateDriver Driver(Settings);
+	Driver.Step({Left(1)});
+
+	FString Spike = Driver.Step({Left(1, .9f, .9f)});
+	Spike += Driver.Step({Left(1)});
+	TestEqual(TEXT("A single frame spike doesn't start a gesture"), Spike, FString());
+	TestFalse(TEXT("A single frame spike doesn't pinch"), Driver.Machine.IsPinching(EHandType::LEAP_HAND_LEFT));
+
+	// dropping between the thresholds restarts the debounce
+	FString Interrupted = Driver.Step({Left(1, .9f, .9f)});
+	Interrupted += Driver.Step({Left(1, .9f, .9f)}, 20000);
+	Interrupted += Driver.Step({Left(1, .79f, .79f)});
+	Interrupted += Driver.Step({Left(1, .9f, .9f)});
+	Interrupted += Driver.Step({Left(1, .9f, .9f)}, 29999);
+	TestEqual(TEXT("Gestures wait for the whole debounce"), Interrupted, FString());
+	TestEqual(TEXT("Gestures start once the strength has held for the debounce"), Driver.Step({Left(1, .9f, .9f)}, 1),
+		TEXT("L.Grab L.Pinch"));
+
+	TestEqual(TEXT("The debounce doesn't delay ending a gesture"), Driver.Step({Left(1)}), TEXT("L.Release L.Unpinch"));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapHandStateTimeoutTest, "Ultraleap.HandStates.Timeout",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapHandStateTimeoutTest::RunTest(const FString& Parameters)
+{
+	// the time based gesture defaults
+	FLeapHandStateSettings Settings;
+	Settings.PinchTimeout = 100000;
+	Settings.GrabTimeout = 100000;
+	FHandStateDriver Driver(Settings);
+	TestEqual(TEXT("The timeout doesn't delay starting a gesture"), Driver.Step({Left(1, .9f, .9f)}),
+		TEXT("L.Visible L.BeginTracking L.Grab L.Pinch"));
+
+	FString Dropout = Driver.Step({Left(1)});
+	Dropout += Driver.Step({Left(1)}, 50000);
+	Dropout += Driver.Step({Left(1)}, 49999);
+	Dropout += Driver.Step({Left(1, .9f, .9f)});
+	TestEqual(TEXT("Dropping out for less than the timeout doesn't end a gesture"), Dropout, FString());
+	TestTrue(TEXT("The hand is still pinching and grabbing"), Driver.Machine.IsPinching(EHandType::LEAP_HAND_LEFT) &&
+		Driver.Machine.IsGrabbing(EHandType::LEAP_HAND_LEFT));
+
+	FString Held = Driver.Step({Left(1)});
+	Held += Driver.Step({Left(1)}, 99999);
+	TestEqual(TEXT("Gestures hold until the timeout"), Held, FString());
+	TestEqual(TEXT("Gestures end at the timeout, the grab first"), Driver.Step({Left(1)}, 1), TEXT("L.Release L.Unpinch"));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapHandStateVisibilityTimeoutTest, "Ultraleap.HandStates.VisibilityTimeout",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapHandStateVisibilityTimeoutTest::RunTest(const FString& Parameters)
+{
+	FLeapHandStateSettings Settings;
+	Settings.VisibilityTimeout = 50000;
+	FHandStateDriver Driver(Settings);
+	Driver.Step({Left(1, .9f)});
+
+	FString Gone = Driver.Step({}, 20000);
+	Gone += Driver.Step({}, 29999);
+	TestEqual(TEXT("A hand gone for less than the timeout sends nothing"), Gone, FString());
+	TestTrue(TEXT("A hand gone for less than the timeout stays visible and pinching"),
+		Driver.Machine.IsVisible(EHandType::LEAP_HAND_LEFT) && Driver.Machine.IsPinching(EHandType::LEAP_HAND_LEFT));
+	TestEqual(TEXT("The same hand returning carries on"), Driver.Step({Left(1, .9f)}), FString());
+
+	Gone = Driver.Step({}, 20000);
+	TestEqual(TEXT("A hand gone for the timeout is released and hidden"), Gone + Driver.Step({}, 30000),
+		TEXT("L.Unpinch L.EndTracking L.Hidden"));
+	TestEqual(TEXT("A hidden hand returning is visible again"), Driver.Step({Left(1)}), TEXT("L.Visible L.BeginTracking"));
+
+	Gone = Driver.Step({}, 10000);
+	TestEqual(TEXT("A new hand within the timeout replaces the old one"), Gone + Driver.Step({Left(2)}),
+		TEXT("L.EndTracking L.BeginTracking"));
+
+	FHandStateDriver Immediate{FLeapHandStateSettings()};
+	Immediate.Step({Left(1)});
+	TestEqual(TEXT("Without a timeout a hand is hidden on the first frame without it"), Immediate.Step({}),
+		TEXT("L.EndTracking L.Hidden"));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapHandStateIdSwapTest, "Ultraleap.HandStates.IdSwap",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapHandStateIdSwapTest::RunTest(const FString& Parameters)
+{
+	FHandStateDriver Driver{FLeapHandStateSettings()};
+	TestEqual(TEXT("Both hands enter"), Driver.Step({Right(2), Left(1, .9f, .9f)}),
+		TEXT("L.Visible L.BeginTracking L.Grab L.Pinch R.Visible R.BeginTracking"));
+
+	TestEqual(TEXT("A new Id releases the old hand before tracking the new one"), Driver.Step({Right(2), Left(5)}),
+		TEXT("L.Unpinch L.Release L.EndTracking L.BeginTracking"));
+	TestTrue(TEXT("The old hand's transitions have no hand index"), Driver.Transitions[0].HandIndex == INDEX_NONE &&
+		Driver.Transitions[1].HandIndex == INDEX_NONE && Driver.Transitions[2].HandIndex == INDEX_NONE);
+	TestEqual(TEXT("The new hand's transitions index the updated frame"), Driver.Transitions[3].HandIndex, 1);
+	TestFalse(TEXT("The new hand doesn't inherit the old hand's gestures"), Driver.Machine.IsPinching(EHandType::LEAP_HAND_LEFT));
+
+	TestEqual(TEXT("A new hand already pinching pinches"), Driver.Step({Right(2), Left(6, .9f)}),
+		TEXT("L.EndTracking L.BeginTracking L.Pinch"));
+
+	// the service reporting the right hand's Id as a left hand
+	TestEqual(TEXT("A chirality flip ends both hands"), Driver.Step({Left(2)}),
+		TEXT("L.Unpinch L.EndTracking L.BeginTracking R.EndTracking R.Hidden"));
+
+	Driver.Machine.Reset();
+	TestEqual(TEXT("After a reset the hand is new"), Driver.Step({Left(2)}), TEXT("L.Visible L.BeginTracking"));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapHandStateLeaveOrderTest, "Ultraleap.HandStates.ReleaseOnLeave",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapHandStateLeaveOrderTest::RunTest(const FString& Parameters)
+{
+	FHandStateDriver Driver{FLeapHandStateSettings()};
+	Driver.Step({Left(1, .9f, .9f), Right(2, .9f, .9f)});
+
+	TestEqual(TEXT("Leaving hands are released before they end tracking and hide"), Driver.Step({}),
+		TEXT("L.Unpinch L.Release L.EndTracking L.Hidden R.Unpinch R.Release R.EndTracking R.Hidden"));
+	TestTrue(TEXT("Leaving hands have no hand index"), Driver.AllHandsLeft());
+	TestFalse(TEXT("Left hand is hidden"), Driver.Machine.IsVisible(EHandType::LEAP_HAND_LEFT));
+	TestFalse(TEXT("Right hand isn't grabbing"), Driver.Machine.IsGrabbing(EHandType::LEAP_HAND_RIGHT));
+
+	// the most a single update can send
+	Driver.Step({Left(1, .9f, .9f), Right(2, .9f, .9f)});
+	TestEqual(TEXT("Both hands swapping for gesturing hands fits the transition array"),
+		Driver.Step({Left(3, .9f, .9f), Right(4, .9f, .9f)}),
+		TEXT("L.Unpinch L.Release L.EndTracking L.BeginTracking L.Grab L.Pinch "
+			 "R.Unpinch R.Release R.EndTracking R.BeginTracking R.Grab R.Pinch"));
+	TestEqual(TEXT("The transition array is full"), Driver.Transitions.Num(),
+		FLeapHandStateMachine::NumSlots * FLeapHandStateMachine::MaxTransitionsPerSlot);
+	return true;
+}
+
+#endif
@@ -0,0 +1,158 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "LeapAsync.h"
+#include "LeapHotPlugQueue.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+constexpr uint32 NumDevices = 4;
+constexpr int32 NumProducedEvents = 4000;
+
+FLeapHotPlugQueue::FEvent MakeEvent(const bool bFound, const uint32 DeviceID)
+{
+	FLeapHotPlugQueue::FEvent Event;
+	Event.bFound = bFound;
+	Event.DeviceID = DeviceID;
+	if (bFound)
+	{
+		FCStringAnsi::Sprintf(Event.Serial, "LP%08u", DeviceID);
+	}
+	return Event;
+}
+
+// Gathers and pops one tick's events as FLeapWrapper::ProcessHotPlugEvents does, as text, e.g. "+1 -2"
+FString Tick(FLeapHotPlugQueue& Queue, const int32 FoundBudget = 1)
+{
+	Queue.Gather();
+	int32 Budget = FoundBudget;
+	FLeapHotPlugQueue::FEvent Event;
+	FString Ret;
+	while (Queue.Pop(Event, Budget))
+	{
+		Ret += FString::Printf(TEXT("%s%c%u"), Ret.IsEmpty() ? TEXT("") : TEXT(" "), Event.bFound ? TEXT('+') : TEXT('-'),
+			Event.DeviceID);
+	}
+	return Ret;
+}
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapHotPlugQueueTest, "Ultraleap.Devices.HotPlugQueue",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapHotPlugQueueTest::RunTest(const FString& Parameters)
+{
+	FLeapHotPlugQueue Queue;
+
+	Queue.Push(MakeEvent(true, 1));
+	Queue.Push(MakeEvent(false, 1));
+	TestEqual(TEXT("A device lost before it was added is never added"), Tick(Queue), FString());
+	TestEqual(TEXT("The cancelled events aren't pending"), Queue.NumPending(), 0);
+
+	Queue.Push(MakeEvent(true, 1));
+	Queue.Push(MakeEvent(false, 1));
+	Queue.Push(MakeEvent(true, 1));
+	TestEqual(TEXT("A device plugged back in before it was added is added once"), Tick(Queue), TEXT("+1"));
+
+	Queue.Push(MakeEvent(false, 1));
+	Queue.Push(MakeEvent(true, 1));
+	TestEqual(TEXT("An added device replugged is removed then added"), Tick(Queue), TEXT("-1 +1"));
+
+	// only the budgeted adds go through, later events wait behind the next add so each device's events stay in order
+	Queue.Push(MakeEvent(true, 2));
+	Queue.Push(MakeEvent(false, 1));
+	Queue.Push(MakeEvent(true, 3));
+	Queue.Push(MakeEvent(false, 2));
+	Queue.Push(MakeEvent(true, 4));
+	TestEqual(TEXT("Found events cancel with their own device's lost event only, one device is added"), Tick(Queue),
+		TEXT("-1 +3"));
+	TestEqual(TEXT("The next add waits for the next tick"), Queue.NumPending(), 1);
+	Queue.Push(MakeEvent(false, 3));
+	TestEqual(TEXT("Events queued meanwhile come after the waiting add"), Tick(Queue), TEXT("+4 -3"));
+	Queue.Push(MakeEvent(true, 1));
+	Queue.Push(MakeEvent(true, 2));
+	Queue.Push(MakeEvent(true, 3));
+	TestEqual(TEXT("A larger budget adds more devices a tick"), Tick(Queue, 2), TEXT("+1 +2"));
+	TestEqual(TEXT("The rest are added later"), Tick(Queue, 2), TEXT("+3"));
+
+	FLeapHotPlugQueue::FEvent Found = MakeEvent(true, 7);
+	Queue.Push(Found);
+	Queue.Gather();
+	int32 Budget = 1;
+	TestTrue(TEXT("A found event pops"), Queue.Pop(Found, Budget));
+	TestEqual(TEXT("The found event carries its serial"), FString(ANSI_TO_TCHAR(Found.GetDeviceInfo().serial)),
+		FString(TEXT("LP00000007")));
+	TestEqual(TEXT("The found event takes the budget"), Budget, 0);
+
+	// devices plugged in and out as fast as the poll thread can report them, while the game thread ticks
+	FLeapHotPlugQueue RapidQueue;
+	TAtomic<int32> NumFullPushes(0);
+	bool ProducerConnected[NumDevices + 1] = {};
+	TFuture<void> Producer = FLeapAsync::RunLambdaOnBackGroundThread(
+		[&RapidQueue, &NumFullPushes, &ProducerConnected]()
+		{
+			FRandomStream Stream(7);
+			for (int32 EventIndex = 0; EventIndex < NumProducedEvents; EventIndex++)
+			{
+				const uint32 DeviceID = (uint32) Stream.RandRange(1, NumDevices);
+				ProducerConnected[DeviceID] = !ProducerConnected[DeviceID];
+				const FLeapHotPlugQueue::FEvent Event = MakeEvent(ProducerConnected[DeviceID], DeviceID);
+				while (!RapidQueue.Push(Event))
+				{
+					NumFullPushes++;
+					FPlatformProcess::Yield();
+				}
+			}
+		});
+
+	bool InOrder = true;
+	int32 MostAddsInATick = 0;
+	int32 NumTicks = 0;
+	int32 NumPopped = 0;
+	bool Connected[NumDevices + 1] = {};
+	for (;;)
+	{
+		const bool bProducerDone = Producer.IsReady();
+		RapidQueue.Gather();
+		if (bProducerDone && RapidQueue.NumPending() == 0)
+		{
+			break;
+		}
+		NumTicks++;
+
+		int32 TickBudget = 1;
+		int32 NumAdds = 0;
+		FLeapHotPlugQueue::FEvent Event;
+		while (RapidQueue.Pop(Event, TickBudget))
+		{
+			// every found needs the device lost and every lost found, or devices are created twice or never removed
+			InOrder &= Event.DeviceID >= 1 && Event.DeviceID <= NumDevices && Connected[Event.DeviceID] != Event.bFound;
+			Connected[FMath::Clamp(Event.DeviceID, 1u, NumDevices)] = Event.bFound;
+			NumAdds += Event.bFound ? 1 : 0;
+			NumPopped++;
+		}
+		MostAddsInATick = FMath::Max(MostAddsInATick, NumAdds);
+	}
+
+	AddInfo(FString::Printf(TEXT("%d hot plug events handled as %d over %d ticks, the queue was full %d times"),
+		NumProducedEvents, NumPopped, NumTicks, (int32) NumFullPushes));
+	TestTrue(TEXT("Each device's events are handled in order"), InOrder);
+	TestTrue(TEXT("No tick adds more devices than its budget"), MostAddsInATick <= 1);
+	for (uint32 DeviceID = 1; DeviceID <= NumDevices; DeviceID++)
+	{
+		TestEqual(FString::Printf(TEXT("Device %u ends up as the poll thread last reported it"), DeviceID),
+			Connected[DeviceID], ProducerConnected[DeviceID]);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,279 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "LeapTestDevice.h"
+#include "Misc/AutomationTest.h"
+#include "Multileap/FUltraleapCombinedDeviceAngular.h"
+#include "Multileap/FUltraleapCombinedDeviceConfidence.h"
+#include "Multileap/FUltraleapCombinedDeviceKalman.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+// Microseconds, as LeapC timestamps
+constexpr int64 FramePeriod = 11111;
+constexpr int64 EvaluationLength = 10000000;
+constexpr int64 WarmUp = 1000000;
+constexpr int64 StartTimeStamp = 1000000;
+// Sources resampled this far behind display time, as time alignment within its latency budget
+constexpr int64 AlignmentDelay = 10000;
+// Per device tracking noise (mm, LeapC space)
+constexpr double MeasurementSigma = 2.0;
+const FVector PalmCentre(0.f, 200.f, 0.f);
+
+struct FEvaluation
+{
+	// RMS distance from a still hand
+	double JitterCM = 0;
+	// Shift of the true path that best matches the output of a moving hand
+	double LatencyMS = 0;
+	// Mean distance from the moving hand at display time
+	double ErrorCM = 0;
+	// Display frames without a combined hand
+	int32 NumMissingHands = 0;
+	uint32 Checksum = 0;
+};
+
+// Both source devices' frames for one display time
+struct FEvaluationFrame
+{
+	int64 DisplayTime = 0;
+	TArray<FLeapFrameData> SourceFrames;
+};
+typedef TArray<FEvaluationFrame> FEvaluationRecording;
+
+// Along LeapC x (mm)
+double StillHand(const int64 Time)
+{
+	return 0.0;
+}
+
+// A hand swinging 10cm at 1Hz
+double MovingHand(const int64 Time)
+{
+	return 100.0 * FMath::Sin(2.0 * PI * Time / 1000000.0);
+}
+
+double Gaussian(FRandomStream& Stream)
+{
+	const double U1 = FMath::Max(Stream.GetFraction(), 1e-6f);
+	const double U2 = Stream.GetFraction();
+	return FMath::Sqrt(-2.0 * FMath::Loge(U1)) * FMath::Cos(2.0 * PI * U2);
+}
+
+// Two devices tracking the same right hand, each with its own noise, converted as the devices convert their frames
+FEvaluationRecording Record(FLeapTestDeviceWrapper& First, FLeapTestDeviceWrapper& Second, double (*HandPosition)(int64))
+{
+	FRandomStream Stream(7);
+	FLeapTestDeviceWrapper* Sources[2] = {&First, &Second};
+	FEvaluationRecording Recording;
+	int64 FrameId = 0;
+	for (int64 Display = 0; Display < EvaluationLength; Display += FramePeriod + Stream.RandRange(-300, 300))
+	{
+		FEvaluationFrame& Frame = Recording.AddDefaulted_GetRef();
+		Frame.DisplayTime = Display;
+		const int64 Captured = Display - AlignmentDelay;
+		FrameId++;
+		for (FLeapTestDeviceWrapper* Source : Sources)
+		{
+			const FVector Noise = FVector(Gaussian(Stream), Gaussian(Stream), Gaussian(Stream)) * MeasurementSigma;
+			const FVector Palm = PalmCentre + FVector(HandPosition(Captured), 0.f, 0.f) + Noise;
+			Source->SetFrame(FrameId, StartTimeStamp + Captured, {MakeTestLeapHand(eLeapHandType_Right, 2, Palm)});
+			Frame.SourceFrames.Add(Source->GetFrameData());
+		}
+	}
+	return Recording;
+}
+
+// The noise free path in the combined frames' space, Centre plus Axis per mm along LeapC x
+struct FTruePath
+{
+	FVector Centre = FVector::ZeroVector;
+	FVector Axis = FVector::ZeroVector;
+
+	FVector At(double (*HandPosition)(int64), const int64 Time) const
+	{
+		return Centre + Axis * HandPosition(Time);
+	}
+};
+
+FTruePath MakeTruePath()
+{
+	FLeapTestDeviceWrapper Converter(TEXT("KALMAN0000"));
+	FTruePath Path;
+	Converter.SetFrame(1, StartTimeStamp, {MakeTestLeapHand(eLeapHandType_Right, 2, PalmCentre)});
+	Path.Centre = Converter.GetFrameData().Hands[0].Palm.Position;
+	Converter.SetFrame(2, StartTimeStamp, {MakeTestLeapHand(eLeapHandType_Right, 2, PalmCentre + FVector(1.f, 0.f, 0.f))});
+	Path.Axis = Converter.GetFrameData().Hands[0].Palm.Position - Path.Centre;
+	return Path;
+}
+
+// Replays a recording through a new combiner, the combined right palm at each display time
+void Replay(const ELeapDeviceCombinerClass CombinerClass, const FLeapOptions& Options, FLeapTestDeviceWrapper& First,
+	FLeapTestDeviceWrapper& Second, const FEvaluationRecording& Recording, TArray<FVector>& OutPalms, FEvaluation& Evaluation)
+{
+	FLeapTestDeviceWrapper CombinedWrapper(TEXT("Combined - Evaluation"));
+	const TArray<IHandTrackingWrapper*> DevicesToCombine = {&First, &Second};
+	switch (CombinerClass)
+	{
+		case ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_ANGULAR:
+			CombinedWrapper.Device =
+				MakeShared<FUltraleapCombinedDeviceAngular>(&CombinedWrapper, &CombinedWrapper, DevicesToCombine);
+			break;
+		case ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_KALMAN:
+			CombinedWrapper.Device =
+				MakeShared<FUltraleapCombinedDeviceKalman>(&CombinedWrapper, &CombinedWrapper, DevicesToCombine);
+			break;
+		default:
+			CombinedWrapper.Device =
+				MakeShared<FUltraleapCombinedDeviceConfidence>(&CombinedWrapper, &CombinedWrapper, DevicesToCombine);
+			break;
+	}
+	FUltraleapCombinedDevice* Combiner = static_cast<FUltraleapCombinedDevice*>(CombinedWrapper.Device.Get());
+
+	FLeapFrameData CombinedFrame;
+	for (const FEvaluationFrame& Frame : Recording)
+	{
+		Combiner->CombineRecordedFrames(Frame.SourceFrames, Options, CombinedFrame);
+		const FLeapHandData* Hand = CombinedFrame.Hands.FindByPredicate(
+			[](const FLeapHandData& Candidate) { return Candidate.HandType == LEAP_HAND_RIGHT; });
+		if (!Hand)
+		{
+			Evaluation.NumMissingHands++;
+		}
+		const FVector Palm = Hand ? Hand->Palm.Position : FVector::ZeroVector;
+		OutPalms.Add(Palm);
+		Evaluation.Checksum = FCrc::MemCrc32(&Palm, sizeof(Palm), Evaluation.Checksum);
+	}
+}
+
+struct FEvaluationRecordings
+{
+	FEvaluationRecording Still;
+	FEvaluationRecording Moving;
+	FTruePath Path;
+};
+
+FEvaluation Evaluate(const ELeapDeviceCombinerClass CombinerClass, const FLeapOptions& Options, FLeapTestDeviceWrapper& First,
+	FLeapTestDeviceWrapper& Second, const FEvaluationRecordings& Recordings)
+{
+	FEvaluation Evaluation;
+	TArray<FVector> Palms;
+
+	Replay(CombinerClass, Options, First, Second, Recordings.Still, Palms, Evaluation);
+	int32 NumSamples = 0;
+	for (int32 i = 0; i < Palms.Num(); i++)
+	{
+		if (Recordings.Still[i].DisplayTime >= WarmUp)
+		{
+			Evaluation.JitterCM += FVector::DistSquared(Palms[i], Recordings.Path.Centre);
+			NumSamples++;
+		}
+	}
+	Evaluation.JitterCM = FMath::Sqrt(Evaluation.JitterCM / NumSamples);
+
+	Palms.Reset();
+	Replay(CombinerClass, Options, First, Second, Recordings.Moving, Palms, Evaluation);
+	double BestError = TNumericLimits<double>::Max();
+	for (int64 Shift = -20000; Shift <= 250000; Shift += 500)
+	{
+		double Error = 0;
+		NumSamples = 0;
+		for (int32 i = 0; i < Palms.Num(); i++)
+		{
+			const int64 Display = Recordings.Moving[i].DisplayTime;
+			if (Display >= WarmUp)
+			{
+				Error += FVector::Distance(Palms[i], Recordings.Path.At(MovingHand, Display - Shift));
+				NumSamples++;
+			}
+		}
+		Error /= NumSamples;
+		if (Shift == 0)
+		{
+			Evaluation.ErrorCM = Error;
+		}
+		if (Error < BestError)
+		{
+			BestError = Error;
+			Evaluation.LatencyMS = Shift / 1000.0;
+		}
+	}
+	return Evaluation;
+}
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapKalmanEvaluationTest, "Ultraleap.Multileap.KalmanLatencyJitter",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapKalmanEvaluationTest::RunTest(const FString& Parameters)
+{
+	FLeapTestDeviceWrapper First(TEXT("KALMAN0001"), 1);
+	FLeapTestDeviceWrapper Second(TEXT("KALMAN0002"), 2);
+	First.CreateDevice();
+	Second.CreateDevice();
+	FEvaluationRecordings Recordings;
+	Recordings.Still = Record(First, Second, StillHand);
+	Recordings.Moving = Record(First, Second, MovingHand);
+	Recordings.Path = MakeTruePath();
+
+	auto Report = [this](const FString& Name, const FEvaluation& Evaluation)
+	{
+		AddInfo(FString::Printf(TEXT("%s: jitter %.3fcm, latency %.1fms, error %.3fcm"), *Name, Evaluation.JitterCM,
+			Evaluation.LatencyMS, Evaluation.ErrorCM));
+		TestEqual(FString::Printf(TEXT("%s combines a hand every frame"), *Name), Evaluation.NumMissingHands, 0);
+	};
+
+	const FLeapOptions Defaults;
+	const FEvaluation Confidence =
+		Evaluate(ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_CONFIDENCE, Defaults, First, Second, Recordings);
+	Report(TEXT("Confidence combiner"), Confidence);
+	const FEvaluation Angular =
+		Evaluate(ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_ANGULAR, Defaults, First, Second, Recordings);
+	Report(TEXT("Angular combiner"), Angular);
+
+	// latency against jitter across process noise, around the default, and predicting the alignment delay
+	const float ProcessNoises[] = {100.f, 1000.f, Defaults.KalmanProcessNoise, 100000.f};
+	TArray<FEvaluation> Filtered;
+	TArray<FEvaluation> Predicted;
+	for (const float ProcessNoise : ProcessNoises)
+	{
+		FLeapOptions Options = Defaults;
+		Options.KalmanProcessNoise = ProcessNoise;
+		Filtered.Add(Evaluate(ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_KALMAN, Options, First, Second, Recordings));
+		Report(FString::Printf(TEXT("Kalman combiner, process noise %.0f"), ProcessNoise), Filtered.Last());
+
+		Options.KalmanPredictionTime = AlignmentDelay / 1000000.f;
+		Predicted.Add(Evaluate(ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_KALMAN, Options, First, Second, Recordings));
+		Report(FString::Printf(TEXT("Kalman combiner, process noise %.0f, predicting the alignment delay"), ProcessNoise),
+			Predicted.Last());
+	}
+
+	// neither blend filters over time, both lag by exactly the alignment delay
+	TestTrue(TEXT("The confidence combiner lags by the alignment delay"),
+		FMath::Abs(Confidence.LatencyMS - AlignmentDelay / 1000.0) <= 2.0);
+	TestTrue(TEXT("The angular combiner lags by the alignment delay"),
+		FMath::Abs(Angular.LatencyMS - AlignmentDelay / 1000.0) <= 2.0);
+	TestTrue(TEXT("The default Kalman filter jitters less than the confidence combiner"),
+		Filtered[2].JitterCM < Confidence.JitterCM);
+	TestTrue(TEXT("The default Kalman filter jitters less than the angular combiner"), Filtered[2].JitterCM < Angular.JitterCM);
+	TestTrue(TEXT("Predicting the alignment delay lowers latency"), Predicted[2].LatencyMS < Filtered[2].LatencyMS);
+	TestTrue(TEXT("More process noise trades jitter for latency"),
+		Filtered[0].JitterCM < Filtered[3].JitterCM && Filtered[0].LatencyMS > Filtered[3].LatencyMS);
+
+	FLeapOptions PredictedDefaults = Defaults;
+	PredictedDefaults.KalmanPredictionTime = AlignmentDelay / 1000000.f;
+	TestEqual(TEXT("Evaluation is deterministic"),
+		Evaluate(ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_KALMAN, PredictedDefaults, First, Second, Recordings).Checksum,
+		Predicted[2].Checksum);
+	return true;
+}
+
+#endif
@@ -0,0 +1,203 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "Features/IModularFeatures.h"
+#include "LeapAllocationCounter.h"
+#include "LeapLiveLink.h"
+#include "Misc/AutomationTest.h"
+#include "Roles/LiveLinkAnimationRole.h"
+#include "Tests/AutomationCommon.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+const FName LiveLinkTestSubject = TEXT("Ultraleap Tracking");
+
+ILiveLinkClient* GetLiveLinkClient()
+{
+	IModularFeatures& ModularFeatures = IModularFeatures::Get();
+	if (!ModularFeatures.IsModularFeatureAvailable(ILiveLinkClient::ModularFeatureName))
+	{
+		return nullptr;
+	}
+	return &ModularFeatures.GetModularFeature<ILiveLinkClient>(ILiveLinkClient::ModularFeatureName);
+}
+
+// Tracks the left hand bones, or both hands with bBothHands
+UBodyStateSkeleton* MakeTrackedSkeleton(const bool bBothHands)
+{
+	UBodyStateSkeleton* Skeleton = NewObject<UBodyStateSkeleton>();
+	const int32 First = (int32) EBodyStateBasicBoneType::BONE_HAND_WRIST_L;
+	const int32 Last =
+		(int32) (bBothHands ? EBodyStateBasicBoneType::BONE_THUMB_2_DISTAL_R : EBodyStateBasicBoneType::BONE_THUMB_2_DISTAL_L);
+	for (int32 BoneIndex = First; BoneIndex <= Last; BoneIndex++)
+	{
+		Skeleton->Bones[BoneIndex]->Meta.Confidence = 1.f;
+		Skeleton->Bones[BoneIndex]->BoneData.SetFromTransform(FTransform(FVector(BoneIndex, 0.f, 0.f)));
+	}
+	return Skeleton;
+}
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapLiveLinkRateControlTest, "Ultraleap.LiveLink.RateControl",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapLiveLinkRateControlTest::RunTest(const FString& Parameters)
+{
+	FLeapLiveLinkProducer Producer;
+	Producer.SetPublishRate(0.f, 3);
+
+	int32 Published = 0;
+	for (int32 Update = 0; Update < 30; Update++)
+	{
+		Published += Producer.ShouldPublish() ? 1 : 0;
+	}
+	TestEqual(TEXT("Decimation 3 publishes every third update"), Published, 10);
+	TestEqual(TEXT("The rest are counted as skipped"), (int32) Producer.GetSkippedFrameCount(), 20);
+
+	// a rate far below the update rate publishes once in a tight loop
+	Producer.SetPublishRate(.001f, 1);
+	Published = 0;
+	for (int32 Update = 0; Update < 30; Update++)
+	{
+		Published += Producer.ShouldPublish() ? 1 : 0;
+	}
+	TestTrue(TEXT("Publish rate limits updates"), Published <= 1);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapLiveLinkAllocationTest, "Ultraleap.LiveLink.Allocations",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapLiveLinkAllocationTest::RunTest(const FString& Parameters)
+{
+	if (!GetLiveLinkClient())
+	{
+		AddWarning(TEXT("No Live Link client loaded, enable the Live Link plugin to run this test."));
+		return true;
+	}
+	constexpr int32 NumFrames = 100;
+
+	UBodyStateSkeleton* Skeleton = MakeTrackedSkeleton(false);
+	FLeapLiveLinkProducer Producer;
+	Producer.Startup(TEXT("AllocationTest"), true);
+	Producer.SyncSubjectToSkeleton(Skeleton);
+	Producer.UpdateFromBodyState(Skeleton);
+
+	int32 SyncAllocations = 0;
+	int32 UpdateAllocations = 0;
+	int64 UpdateBytes = 0;
+	bool bCounting = false;
+	{
+		FLeapScopedAllocationCounter Counter;
+		bCounting = Counter.IsCounting();
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			Counter.ResetCount();
+			Producer.SyncSubjectToSkeleton(Skeleton);
+			SyncAllocations += Counter.GetCount();
+
+			Counter.ResetCount();
+			Producer.UpdateFromBodyState(Skeleton);
+			UpdateAllocations += Counter.GetCount();
+			UpdateBytes += Counter.GetBytes();
+		}
+	}
+
+	AddInfo(FString::Printf(TEXT("Steady state: sync %.2f allocations/frame, update %.2f allocations/frame (%.0f bytes), ")
+							TEXT("including the Live Link client's own queueing"),
+		(float) SyncAllocations / NumFrames, (float) UpdateAllocations / NumFrames, (double) UpdateBytes / NumFrames));
+	TestEqual(TEXT("Static data is sent once while the tracked bones don't change"), (int32) Producer.GetStaticDataUpdateCount(), 1);
+	if (bCounting)
+	{
+		TestEqual(TEXT("Syncing unchanged tracked bones doesn't allocate"), SyncAllocations, 0);
+	}
+	else
+	{
+		AddWarning(TEXT("Allocations bypass GMalloc on this platform, allocation counts not checked."));
+	}
+
+	// a hand starting to track rebuilds the static data once
+	UBodyStateSkeleton* BothHands = MakeTrackedSkeleton(true);
+	Producer.SyncSubjectToSkeleton(BothHands);
+	Producer.SyncSubjectToSkeleton(BothHands);
+	TestEqual(TEXT("Static data is rebuilt when the tracked bones change"), (int32) Producer.GetStaticDataUpdateCount(), 2);
+
+	Producer.ShutDown();
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapLiveLinkLoopbackLatencyTest, "Ultraleap.LiveLink.LoopbackLatency",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapLiveLinkLoopbackLatencyTest::RunTest(const FString& Parameters)
+{
+	ILiveLinkClient* Client = GetLiveLinkClient();
+	if (!Client)
+	{
+		AddWarning(TEXT("No Live Link client loaded, enable the Live Link plugin to run this test."));
+		return true;
+	}
+
+	// publish a frame every tick and evaluate it as a consumer would on the next, the client picks pushed frames up
+	// in its own tick
+	struct FLatencyRun
+	{
+		TSharedRef<FLeapLiveLinkProducer> Producer = MakeShared<FLeapLiveLinkProducer>();
+		UBodyStateSkeleton* Skeleton = nullptr;
+		int32 Ticks = 0;
+		int32 Evaluated = 0;
+		double SumLatency = 0.0;
+		double MaxLatency = 0.0;
+	};
+	constexpr int32 NumTicks = 120;
+
+	TSharedRef<FLatencyRun> Run = MakeShared<FLatencyRun>();
+	Run->Skeleton = MakeTrackedSkeleton(false);
+	Run->Skeleton->AddToRoot();
+	Run->Producer->Startup(TEXT("LatencyTest"), true);
+	Run->Producer->SetPublishRate(0.f, 1);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand(
+		[this, Run, Client]()
+		{
+			if (Run->Ticks > 0)
+			{
+				FLiveLinkSubjectFrameData Frame;
+				if (Client->EvaluateFrame_AnyThread(LiveLinkTestSubject, ULiveLinkAnimationRole::StaticClass(), Frame) &&
+					Frame.FrameData.GetBaseData())
+				{
+					const double Latency = FPlatformTime::Seconds() - Frame.FrameData.GetBaseData()->WorldTime.GetOffsettedTime();
+					Run->SumLatency += Latency;
+					Run->MaxLatency = FMath::Max(Run->MaxLatency, Latency);
+					Run->Evaluated++;
+				}
+			}
+			if (Run->Ticks++ < NumTicks)
+			{
+				Run->Producer->SyncSubjectToSkeleton(Run->Skeleton);
+				Run->Producer->UpdateFromBodyState(Run->Skeleton);
+				return false;
+			}
+
+			AddInfo(FString::Printf(TEXT("Loopback publish to evaluate latency over %d frames: mean %.2fms, max %.2fms"),
+				Run->Evaluated, Run->Evaluated > 0 ? Run->SumLatency * 1000.0 / Run->Evaluated : 0.0, Run->MaxLatency * 1000.0));
+			TestTrue(TEXT("Published frames are evaluated by the local client"), Run->Evaluated > NumTicks / 2);
+			// picked up by the next tick, a backlog would grow past a few frames
+			TestTrue(TEXT("Loopback frames don't queue up"), Run->MaxLatency < .25);
+
+			Run->Producer->ShutDown();
+			Run->Skeleton->RemoveFromRoot();
+			return true;
+		}));
+	return true;
+}
+
+#endif
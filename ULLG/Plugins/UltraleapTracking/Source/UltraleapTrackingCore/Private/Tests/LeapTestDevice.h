@@ -0,0 +1,166 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FUltraleapDevice.h"
+#include "LeapWrapper.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * A flat hand as LeapC reports it, fingers pointing away from the user with the palm at Position (mm, LeapC space).
+ * The thumb is on the side matching Type so combiners and gestures see a plausible hand
+ */
+inline LEAP_HAND MakeTestLeapHand(const eLeapHandType Type, const uint32 Id, const FVector& Position,
+	const float PinchStrength = 0.f, const float GrabStrength = 0.f)
+{
+	auto ToLeap = [](const FVector& Vector)
+	{
+		LEAP_VECTOR Ret;
+		Ret.x = Vector.X;
+		Ret.y = Vector.Y;
+		Ret.z = Vector.Z;
+		return Ret;
+	};
+	LEAP_QUATERNION Identity;
+	Identity.x = 0.f;
+	Identity.y = 0.f;
+	Identity.z = 0.f;
+	Identity.w = 1.f;
+
+	LEAP_HAND Hand;
+	FMemory::Memzero(Hand);
+	Hand.id = Id;
+	Hand.type = Type;
+	Hand.confidence = 1.f;
+	Hand.visible_time = 1000000;
+	Hand.pinch_strength = PinchStrength;
+	Hand.grab_strength = GrabStrength;
+	Hand.pinch_distance = FMath::Lerp(80.f, 0.f, PinchStrength);
+	Hand.grab_angle = GrabStrength * PI;
+
+	Hand.palm.position = ToLeap(Position);
+	Hand.palm.stabilized_position = Hand.palm.position;
+	Hand.palm.normal = ToLeap(FVector(0.f, -1.f, 0.f));
+	Hand.palm.direction = ToLeap(FVector(0.f, 0.f, -1.f));
+	Hand.palm.orientation = Identity;
+	Hand.palm.width = 85.f;
+
+	// thumb to pinky across the palm, each bone continuing from the last towards -z
+	const float Side = Type == eLeapHandType_Left ? 1.f : -1.f;
+	const float BoneLengths[4] = {40.f, 35.f, 25.f, 20.f};
+	for (int32 DigitIndex = 0; DigitIndex < 5; DigitIndex++)
+	{
+		LEAP_DIGIT& Digit = Hand.digits[DigitIndex];
+		Digit.finger_id = Id * 10 + DigitIndex;
+		Digit.is_extended = GrabStrength < .5f;
+		FVector Joint = Position + FVector(Side * (DigitIndex - 2) * -20.f, 0.f, 30.f);
+		for (int32 BoneIndex = 0; BoneIndex < 4; BoneIndex++)
+		{
+			LEAP_BONE& Bone = Digit.bones[BoneIndex];
+			Bone.prev_joint = ToLeap(Joint);
+			Joint.Z -= BoneLengths[BoneIndex];
+			Bone.next_joint = ToLeap(Joint);
+			Bone.width = 15.f;
+			Bone.rotation = Identity;
+		}
+	}
+	Hand.arm.prev_joint = ToLeap(Position + FVector(0.f, 0.f, 280.f));
+	Hand.arm.next_joint = ToLeap(Position + FVector(0.f, 0.f, 50.f));
+	Hand.arm.width = 60.f;
+	Hand.arm.rotation = Identity;
+	return Hand;
+}
+
+/**
+ * Stands in for a LeapC device wrapper in tests, without a connection to the tracking service. Serves a scripted
+ * tracking frame from GetFrame and, once CreateDevice is called, owns a real FUltraleapDevice reading from it
+ */
+class FLeapTestDeviceWrapper : public FLeapWrapperBase
+{
+public:
+	explicit FLeapTestDeviceWrapper(const FString& SerialIn, const uint32 DeviceIDIn = 0) : Serial(SerialIn), DeviceID(DeviceIDIn)
+	{
+		FMemory::Memzero(Frame);
+		FMemory::Memzero(DeviceInfo);
+		// connected as soon as it exists, so the device parses its frames
+		CurrentDeviceInfo = &DeviceInfo;
+		bIsConnected = true;
+	}
+	virtual ~FLeapTestDeviceWrapper()
+	{
+		Device.Reset();
+	}
+
+	void CreateDevice()
+	{
+		Device = MakeShared<FUltraleapDevice>(this, this);
+	}
+	// Publishes a new tracking frame, GetFrame returns it until the next one
+	void SetFrame(const int64 FrameId, const int64 TimeStamp, const TArray<LEAP_HAND>& HandsIn)
+	{
+		Hands = HandsIn;
+		Frame.info.frame_id = FrameId;
+		Frame.info.timestamp = TimeStamp;
+		Frame.tracking_frame_id = FrameId;
+		Frame.nHands = Hands.Num();
+		Frame.pHands = Hands.GetData();
+		Frame.framerate = 90.f;
+		bHasFrame = true;
+	}
+	// Converted as the device converts its latest frame, for feeding combiners directly
+	FLeapFrameData GetFrameData()
+	{
+		FLeapFrameData FrameData = FLeapFrameData();
+		FrameData.FrameId = Frame.info.frame_id;
+		FrameData.SetFromLeapFrame(&Frame, FVector::ZeroVector, FQuat::Identity);
+		return FrameData;
+	}
+
+	virtual LEAP_TRACKING_EVENT* GetFrame() override
+	{
+		return bHasFrame ? &Frame : nullptr;
+	}
+	virtual int64_t GetNow() override
+	{
+		return Now;
+	}
+	virtual FString GetDeviceSerial() override
+	{
+		return Serial;
+	}
+	virtual uint32_t GetDeviceID() override
+	{
+		return DeviceID;
+	}
+	virtual IHandTrackingDevice* GetDevice() override
+	{
+		return Device.Get();
+	}
+	virtual LEAP_DEVICE_INFO* GetDeviceProperties() override
+	{
+		return CurrentDeviceInfo;
+	}
+
+	// LeapC time (microseconds) GetNow reports
+	int64 Now = 0;
+	// A plain device from CreateDevice, or a combined device a test creates with this as its wrapper
+	TSharedPtr<FUltraleapDevice> Device;
+
+private:
+	FString Serial;
+	uint32 DeviceID;
+	LEAP_DEVICE_INFO DeviceInfo;
+	LEAP_TRACKING_EVENT Frame;
+	TArray<LEAP_HAND> Hands;
+	bool bHasFrame = false;
+};
+
+#endif
@@ -0,0 +1,46 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "UltraleapTrackingData.h"
+
+#include "LeapTestEventReceiver.generated.h"
+
+/**
+ * Counts what a ULeapComponent broadcasts, for binding its dynamic delegates in tests. Components only receive the
+ * events they have handlers bound for
+ */
+UCLASS(Transient)
+class ULeapTestEventReceiver : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION()
+	void OnHand(const FLeapHandData& Hand)
+	{
+		NumHandEvents++;
+	}
+	UFUNCTION()
+	void OnVisibility(bool bIsVisible)
+	{
+		NumVisibilityEvents++;
+	}
+	UFUNCTION()
+	void OnFrame(const FLeapFrameData& Frame)
+	{
+		NumFrames++;
+	}
+
+	int32 NumHandEvents = 0;
+	int32 NumVisibilityEvents = 0;
+	int32 NumFrames = 0;
+};
@@ -0,0 +1,187 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "Framework/Application/SlateApplication.h"
+#include "LeapAllocationCounter.h"
+#include "LeapComponent.h"
+#include "LeapTestDevice.h"
+#include "LeapTestEventReceiver.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+constexpr int64 FramePeriod = 11111;
+constexpr int32 NumWarmUpTicks = 75;
+constexpr int32 NumMeasuredTicks = 120;
+// Long enough for the default gesture timeouts to let every pinch and grab through
+constexpr int32 PinchPeriod = 15;
+constexpr int32 GrabPeriod = 25;
+
+// Over NumMeasuredTicks ticks
+struct FTickPhase
+{
+	int32 Allocations = 0;
+	int32 NumHandEvents = 0;
+	int32 NumFrames = 0;
+};
+
+struct FTickAllocations
+{
+	// Steady tracking, then ticks with pinches and grabs starting and ending
+	FTickPhase Steady;
+	FTickPhase Events;
+	// What one broadcast to the subscribed component allocates, the dynamic delegates copy their parameters
+	int32 FrameBroadcastAllocations = 0;
+	int32 HandBroadcastAllocations = 0;
+};
+
+// Ticks a device through the same scripted two hand session, only counting allocations made inside the tick. With
+// bSubscribe a component is bound to every hand event and the tracking data
+FTickAllocations Run(FLeapScopedAllocationCounter& Counter, const bool bSubscribe)
+{
+	FLeapTestDeviceWrapper Wrapper(TEXT("ALLOCATIONS1"), 1);
+	Wrapper.CreateDevice();
+	FUltraleapDevice& Device = *Wrapper.Device;
+	FLeapOptions Options = Device.GetOptions();
+	Options.bUseInterpolation = false;
+	Device.SetOptions(Options);
+
+	ULeapComponent* Component = nullptr;
+	ULeapTestEventReceiver* Receiver = nullptr;
+	if (bSubscribe)
+	{
+		Component = NewObject<ULeapComponent>();
+		Receiver = NewObject<ULeapTestEventReceiver>();
+		Component->OnHandBeginTracking.AddDynamic(Receiver, &ULeapTestEventReceiver::OnHand);
+		Component->OnHandEndTracking.AddDynamic(Receiver, &ULeapTestEventReceiver::OnHand);
+		Component->OnHandPinched.AddDynamic(Receiver, &ULeapTestEventReceiver::OnHand);
+		Component->OnHandUnpinched.AddDynamic(Receiver, &ULeapTestEventReceiver::OnHand);
+		Component->OnHandGrabbed.AddDynamic(Receiver, &ULeapTestEventReceiver::OnHand);
+		Component->OnHandReleased.AddDynamic(Receiver, &ULeapTestEventReceiver::OnHand);
+		Component->OnLeftHandVisibilityChanged.AddDynamic(Receiver, &ULeapTestEventReceiver::OnVisibility);
+		Component->OnRightHandVisibilityChanged.AddDynamic(Receiver, &ULeapTestEventReceiver::OnVisibility);
+		Component->OnLeapTrackingData.AddDynamic(Receiver, &ULeapTestEventReceiver::OnFrame);
+		Device.AddEventDelegate(Component);
+	}
+
+	int64 FrameId = 0;
+	auto Tick = [&Counter, &Wrapper, &Device, &FrameId](const int32 TickIndex, const bool bGesture)
+	{
+		const float Angle = 2.f * PI * TickIndex / 90.f;
+		const float Pinch = bGesture && (TickIndex / PinchPeriod) % 2 ? .9f : .1f;
+		const float Grab = bGesture && (TickIndex / GrabPeriod) % 2 ? .9f : .1f;
+		Wrapper.Now += FramePeriod;
+		Wrapper.SetFrame(++FrameId, Wrapper.Now,
+			{MakeTestLeapHand(eLeapHandType_Left, 1, FVector(-120.f, 220.f, -20.f), 0.f, Grab),
+				MakeTestLeapHand(eLeapHandType_Right, 2, FVector(100.f + 60.f * FMath::Cos(Angle), 200.f, -40.f), Pinch, 0.f)});
+
+		const int32 Before = Counter.GetCount();
+		Device.CaptureAndEvaluateInput();
+		return Counter.GetCount() - Before;
+	};
+
+	// hands start tracking and go through a few gestures so first use allocations are behind us, then open again
+	int32 TickIndex = 0;
+	for (int32 i = 0; i < NumWarmUpTicks; i++)
+	{
+		Tick(TickIndex++, i < NumWarmUpTicks - PinchPeriod);
+	}
+	FTickAllocations Result;
+	auto RunPhase = [&Tick, &TickIndex, Receiver](FTickPhase& Phase, const bool bGesture)
+	{
+		const int32 HandEventsBefore = Receiver ? Receiver->NumHandEvents : 0;
+		const int32 FramesBefore = Receiver ? Receiver->NumFrames : 0;
+		for (int32 i = 0; i < NumMeasuredTicks; i++)
+		{
+			Phase.Allocations += Tick(TickIndex++, bGesture);
+		}
+		Phase.NumHandEvents = Receiver ? Receiver->NumHandEvents - HandEventsBefore : 0;
+		Phase.NumFrames = Receiver ? Receiver->NumFrames - FramesBefore : 0;
+	};
+	RunPhase(Result.Steady, false);
+	RunPhase(Result.Events, true);
+
+	if (bSubscribe)
+	{
+		// the same two hand frame the ticks broadcast, through the same bindings
+		const FLeapFrameData Frame = Wrapper.GetFrameData();
+		int32 Before = Counter.GetCount();
+		Component->OnLeapTrackingData.Broadcast(Frame);
+		Result.FrameBroadcastAllocations = Counter.GetCount() - Before;
+		Before = Counter.GetCount();
+		Component->OnHandPinched.Broadcast(Frame.Hands[0]);
+		Result.HandBroadcastAllocations = Counter.GetCount() - Before;
+
+		Device.RemoveEventDelegate(Component);
+	}
+	return Result;
+}
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapTickAllocationTest, "Ultraleap.Devices.TickAllocations",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapTickAllocationTest::RunTest(const FString& Parameters)
+{
+	// pinches and grabs also send key events
+	if (!FSlateApplication::IsInitialized())
+	{
+		AddWarning(TEXT("Slate isn't initialized, tick allocations not counted."));
+		return true;
+	}
+
+	FLeapScopedAllocationCounter Counter;
+	if (!Counter.IsCounting())
+	{
+		AddWarning(TEXT("Allocations bypass GMalloc on this platform, tick allocations not counted."));
+		return true;
+	}
+	const FTickAllocations Unsubscribed = Run(Counter, false);
+	const FTickAllocations Subscribed = Run(Counter, true);
+
+	// for scale, what each copy of a hand costs
+	FLeapTestDeviceWrapper Wrapper(TEXT("ALLOCATIONS2"), 2);
+	Wrapper.SetFrame(1, 1000000, {MakeTestLeapHand(eLeapHandType_Left, 1, FVector(0.f, 200.f, 0.f))});
+	const FLeapFrameData Frame = Wrapper.GetFrameData();
+	const int32 BeforeCopy = Counter.GetCount();
+	{
+		const FLeapHandData Copy = Frame.Hands[0];
+	}
+	const int32 HandCopyAllocations = Counter.GetCount() - BeforeCopy;
+
+	AddInfo(FString::Printf(TEXT("Allocations per tick with two hands, no components: %.2f steady, %.2f with gestures"),
+		(float) Unsubscribed.Steady.Allocations / NumMeasuredTicks, (float) Unsubscribed.Events.Allocations / NumMeasuredTicks));
+	AddInfo(FString::Printf(
+		TEXT("Allocations per tick with a subscribed component: %.2f steady, %.2f with gestures (%d hand events, %d frames)"),
+		(float) Subscribed.Steady.Allocations / NumMeasuredTicks, (float) Subscribed.Events.Allocations / NumMeasuredTicks,
+		Subscribed.Steady.NumHandEvents + Subscribed.Events.NumHandEvents,
+		Subscribed.Steady.NumFrames + Subscribed.Events.NumFrames));
+	AddInfo(FString::Printf(TEXT("Copying one hand allocates %d times, broadcasting a two hand frame %d times, a hand %d times"),
+		HandCopyAllocations, Subscribed.FrameBroadcastAllocations, Subscribed.HandBroadcastAllocations));
+
+	TestTrue(TEXT("The component receives the gestures"), Subscribed.Events.NumHandEvents >= NumMeasuredTicks / PinchPeriod);
+	TestTrue(TEXT("The component receives the tracking data"), Subscribed.Steady.NumFrames >= NumMeasuredTicks);
+	TestTrue(TEXT("Broadcasting the tracking data copies the frame"), Subscribed.FrameBroadcastAllocations > 0);
+	// the queue and everything else in the tick allocate nothing more for a subscribed component
+	const FTickPhase* SubscribedPhases[] = {&Subscribed.Steady, &Subscribed.Events};
+	const FTickPhase* UnsubscribedPhases[] = {&Unsubscribed.Steady, &Unsubscribed.Events};
+	const TCHAR* PhaseNames[] = {TEXT("steady"), TEXT("gesture")};
+	for (int32 PhaseIndex = 0; PhaseIndex < 2; PhaseIndex++)
+	{
+		const FTickPhase& Phase = *SubscribedPhases[PhaseIndex];
+		TestEqual(FString::Printf(TEXT("Subscribing only adds the delegate copies over the %s ticks"), PhaseNames[PhaseIndex]),
+			Phase.Allocations - UnsubscribedPhases[PhaseIndex]->Allocations,
+			Phase.NumFrames * Subscribed.FrameBroadcastAllocations + Phase.NumHandEvents * Subscribed.HandBroadcastAllocations);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,135 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Multileap/SourceDeviceTimeAlignment.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+// Microseconds, as LeapC timestamps
+constexpr int64 DeviceFramePeriod = 11111;
+constexpr int64 TickPeriod = 16667;
+// Capture to the frame being available to the game thread
+constexpr int64 PublishDelay = 2000;
+constexpr int64 ReplayLength = 5000000;
+
+// A hand swinging 10cm at 1.5Hz, fast enough that a frame's difference in time shows
+double HandPosition(const int64 TimeStamp)
+{
+	return 10.0 * FMath::Sin(2.0 * PI * 1.5 * TimeStamp / 1000000.0);
+}
+
+// One unsynchronised sensor, frames are captured at its own phase with some timing jitter
+struct FReplayDevice
+{
+	TArray<int64> TimeStamps;
+	TArray<double> Positions;
+
+	FReplayDevice(const int64 Phase, FRandomStream& Stream)
+	{
+		for (int64 Capture = Phase; Capture < ReplayLength; Capture += DeviceFramePeriod)
+		{
+			const int64 TimeStamp = Capture + Stream.RandRange(-300, 300);
+			TimeStamps.Add(TimeStamp);
+			Positions.Add(HandPosition(TimeStamp));
+		}
+	}
+	// Newest frame the game thread can see at Now, INDEX_NONE for none
+	int32 GetLatestFrame(const int64 Now) const
+	{
+		int32 Latest = INDEX_NONE;
+		while (TimeStamps.IsValidIndex(Latest + 1) && TimeStamps[Latest + 1] + PublishDelay <= Now)
+		{
+			Latest++;
+		}
+		return Latest;
+	}
+	// Linear between the frames either side of TimeStamp, extrapolated past the newest, as LeapInterpolateFrameEx
+	double Interpolate(const int64 TimeStamp, const int32 Latest) const
+	{
+		int32 After = 1;
+		while (After < Latest && TimeStamps[After] < TimeStamp)
+		{
+			After++;
+		}
+		const int32 Before = After - 1;
+		const double Alpha = double(TimeStamp - TimeStamps[Before]) / double(TimeStamps[After] - TimeStamps[Before]);
+		return FMath::Lerp(Positions[Before], Positions[After], Alpha);
+	}
+};
+
+struct FReplayResult
+{
+	int32 NumTicks = 0;
+	double LatestDisagreement = 0;
+	double AlignedDisagreement = 0;
+	double AlignedError = 0;
+	float MaxDelayInMS = 0;
+	uint32 Checksum = 0;
+};
+
+FReplayResult Replay(const float LatencyBudgetMS)
+{
+	FRandomStream Stream(42);
+	// half a frame out of phase, the worst case for fusing latest frames
+	const FReplayDevice Devices[2] = {FReplayDevice(0, Stream), FReplayDevice(DeviceFramePeriod / 2, Stream)};
+	FSourceDeviceTimeAlignment TimeAlignment;
+	TArray<int64> LatestTimeStamps;
+	FReplayResult Result;
+
+	for (int64 Now = 100000; Now < ReplayLength; Now += TickPeriod + Stream.RandRange(-1000, 1000))
+	{
+		const int32 Latest[2] = {Devices[0].GetLatestFrame(Now), Devices[1].GetLatestFrame(Now)};
+		LatestTimeStamps.Reset();
+		LatestTimeStamps.Add(Devices[0].TimeStamps[Latest[0]]);
+		LatestTimeStamps.Add(Devices[1].TimeStamps[Latest[1]]);
+
+		const int64 Target = TimeAlignment.Update(Now, LatestTimeStamps, LatencyBudgetMS);
+		const double Resampled[2] = {Devices[0].Interpolate(Target, Latest[0]), Devices[1].Interpolate(Target, Latest[1])};
+
+		Result.LatestDisagreement += FMath::Abs(Devices[0].Positions[Latest[0]] - Devices[1].Positions[Latest[1]]);
+		Result.AlignedDisagreement += FMath::Abs(Resampled[0] - Resampled[1]);
+		Result.AlignedError += FMath::Abs(0.5 * (Resampled[0] + Resampled[1]) - HandPosition(Target));
+		Result.MaxDelayInMS = FMath::Max(Result.MaxDelayInMS, TimeAlignment.GetDelayInMS());
+		Result.Checksum = FCrc::MemCrc32(&Target, sizeof(Target), Result.Checksum);
+		Result.Checksum = FCrc::MemCrc32(Resampled, sizeof(Resampled), Result.Checksum);
+		Result.NumTicks++;
+	}
+	Result.LatestDisagreement /= Result.NumTicks;
+	Result.AlignedDisagreement /= Result.NumTicks;
+	Result.AlignedError /= Result.NumTicks;
+	return Result;
+}
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLeapTimeAlignmentReplayTest, "Ultraleap.Multileap.TimeAlignmentReplay",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLeapTimeAlignmentReplayTest::RunTest(const FString& Parameters)
+{
+	const FReplayResult Aligned = Replay(20.f);
+	AddInfo(FString::Printf(TEXT("%d ticks of two 90Hz devices half a frame apart: latest frames disagree by %.3fcm, ")
+							TEXT("resampled by %.3fcm (%.3fcm from the true position), max delay %.2fms"),
+		Aligned.NumTicks, Aligned.LatestDisagreement, Aligned.AlignedDisagreement, Aligned.AlignedError, Aligned.MaxDelayInMS));
+
+	TestTrue(TEXT("Resampled devices agree far better than their latest frames"),
+		Aligned.AlignedDisagreement < Aligned.LatestDisagreement * .25);
+	TestTrue(TEXT("Resampled position tracks the target time"), Aligned.AlignedError < .1);
+	TestTrue(TEXT("Delay stays within the budget"), Aligned.MaxDelayInMS <= 20.f);
+	TestEqual(TEXT("Replay is deterministic"), Replay(20.f).Checksum, Aligned.Checksum);
+
+	// a tight budget caps the delay, the slower device is extrapolated instead
+	const FReplayResult Capped = Replay(2.f);
+	TestTrue(TEXT("Delay is capped at the budget"), Capped.MaxDelayInMS <= 2.f);
+	return true;
+}
+
+#endif
@@ -0,0 +1,168 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "Multileap/MultiDeviceAlignmentService.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+constexpr float TickTime = 1.f / 90.f;
+constexpr int32 MaxTicks = 90 * 60;
+// Per joint tracking noise (cm)
+constexpr float Noise = .2f;
+
+// Two tracked hands seen by both devices, the target device off by TargetError. Published corrections are applied to
+// the target device as UMultiDeviceAlignment applies them
+struct FAlignmentRig
+{
+	TSharedRef<FMultiDeviceAlignmentService, ESPMode::ThreadSafe> Service =
+		MakeShared<FMultiDeviceAlignmentService, ESPMode::ThreadSafe>();
+	FMultiDeviceAlignmentSettings Settings;
+	FTransform TargetError = FTransform(FRotator(5.f, -15.f, 4.f), FVector(8.f, 5.f, -3.f));
+	FRandomStream Stream = FRandomStream(3);
+	int32 NumCorrections = 0;
+
+	FAlignmentRig()
+	{
+		// tight enough that the aligned transform can be checked against the true one
+		Settings.ConvergedError = .5f;
+	}
+
+	// Bone centres of a flat open hand pointing along its X and centred on its pose, as both devices report them
+	FMultiDeviceAlignmentSample MakeSample(const FTransform& HandPose)
+	{
+		FMultiDeviceAlignmentSample Sample;
+		for (int32 Digit = 0; Digit < 5; Digit++)
+		{
+			for (int32 Bone = 0; Bone < FMultiDeviceAlignmentSample::NumBones; Bone++)
+			{
+				const FVector Local(Bone * 2.5f + (Digit == 0 ? -7.f : -3.f), (Digit - 2) * 2.f, Digit == 0 ? -1.f : 0.f);
+				const FVector Joint = HandPose.TransformPosition(Local);
+				const int32 Point = Digit * FMultiDeviceAlignmentSample::NumBones + Bone;
+				Sample.SourcePoints[Point] = Joint + Stream.GetUnitVector() * Stream.FRandRange(0.f, Noise);
+				Sample.TargetPoints[Point] =
+					TargetError.TransformPosition(Joint) + Stream.GetUnitVector() * Stream.FRandRange(0.f, Noise);
+			}
+		}
+		return Sample;
+	}
+
+	FTransform RandomPose(const bool bRandomRotation = true)
+	{
+		const FRotator Rotation = bRandomRotation ? FRotator(Stream.FRandRange(-30.f, 30.f), Stream.FRandRange(-30.f, 30.f),
+														Stream.FRandRange(-30.f, 30.f))
+												  : FRotator::ZeroRotator;
+		return FTransform(Rotation, FVector(Stream.FRandRange(-20.f, 20.f), Stream.FRandRange(-20.f, 20.f),
+										Stream.FRandRange(10.f, 40.f)));
+	}
+
+	void Tick(const FTransform& Left, const FTransform& Right)
+	{
+		FTransform Correction;
+		if (Service->ConsumeCorrection(Correction))
+		{
+			TargetError = TargetError * Correction;
+			NumCorrections++;
+		}
+		Service->AddSample(MakeSample(Left));
+		Service->AddSample(MakeSample(Right));
+		Service->Tick(TickTime, Settings);
+		Service->WaitForSolve();
+	}
+
+	// Ticks taken with hands at random poses, INDEX_NONE if the devices never align
+	int32 TickUntilConverged()
+	{
+		for (int32 TickIndex = 0; TickIndex < MaxTicks; TickIndex++)
+		{
+			Tick(RandomPose(), RandomPose());
+			if (Service->GetState() == EMultiDeviceAlignmentState::Converged)
+			{
+				return TickIndex + 1;
+			}
+		}
+		return INDEX_NONE;
+	}
+
+	bool IsAligned(const float MaxTranslation, const float MaxRotationDegrees) const
+	{
+		return TargetError.GetTranslation().Size() <= MaxTranslation &&
+			   FMath::RadiansToDegrees(TargetError.GetRotation().AngularDistance(FQuat::Identity)) <= MaxRotationDegrees;
+	}
+};
+}	 // namespace
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMultiDeviceAlignmentServiceTest, "Ultraleap.Multileap.AlignmentService",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMultiDeviceAlignmentServiceTest::RunTest(const FString& Parameters)
+{
+	{
+		FAlignmentRig Rig;
+		const int32 AlignTicks = Rig.TickUntilConverged();
+		TestTrue(TEXT("The devices align"), AlignTicks != INDEX_NONE);
+		TestTrue(TEXT("The aligned target device is within 1.5cm and 2 degrees of the source"), Rig.IsAligned(1.5f, 2.f));
+
+		// knocked while converged, as continuous alignment keeps sampling. The state stays converged until the next solve
+		Rig.TargetError = Rig.TargetError * FTransform(FRotator(3.f, 10.f, -2.f), FVector(4.f, -6.f, 3.f));
+		const int32 NumCorrectionsBeforeBump = Rig.NumCorrections;
+		int32 DetectTicks = 0;
+		while (Rig.Service->GetNumBumps() == 0 && DetectTicks < 90)
+		{
+			Rig.Tick(Rig.RandomPose(), Rig.RandomPose());
+			DetectTicks++;
+		}
+		TestTrue(TEXT("The bump is detected by the next solve"),
+			DetectTicks <= FMath::CeilToInt(Rig.Settings.SolveInterval / TickTime) + 1);
+		TestTrue(TEXT("The samples from before the bump are dropped"),
+			Rig.Service->GetState() != EMultiDeviceAlignmentState::Converged);
+
+		const int32 RealignTicks = Rig.TickUntilConverged();
+		AddInfo(FString::Printf(
+			TEXT("Aligned in %d ticks, bump detected in %d ticks and realigned in %d ticks with %d corrections"), AlignTicks,
+			DetectTicks, RealignTicks, Rig.NumCorrections - NumCorrectionsBeforeBump));
+		TestEqual(TEXT("The bump is detected once"), Rig.Service->GetNumBumps(), 1);
+		TestTrue(TEXT("The devices realign"), RealignTicks != INDEX_NONE);
+		TestTrue(TEXT("The bump is corrected"), Rig.NumCorrections > NumCorrectionsBeforeBump);
+		TestTrue(TEXT("The realigned target device is within 1.5cm and 2 degrees of the source"), Rig.IsAligned(1.5f, 2.f));
+	}
+
+	{
+		// hands swept along a line in many cells, the rotation about the line is near singular
+		FAlignmentRig Rig;
+		for (int32 TickIndex = 0; TickIndex < 900; TickIndex++)
+		{
+			const FVector Along(FMath::Lerp(-20.f, 20.f, (TickIndex % 90) / 89.f), 0.f, 20.f);
+			FTransform Left = Rig.RandomPose();
+			FTransform Right = Rig.RandomPose();
+			Left.SetTranslation(Along);
+			Right.SetTranslation(Along + FVector(0.f, 0.f, .5f));
+			Rig.Tick(Left, Right);
+		}
+		TestEqual(TEXT("Hands moved along a line aren't solved"), Rig.NumCorrections, 0);
+		TestTrue(TEXT("Hands moved along a line keep collecting"),
+			Rig.Service->GetState() == EMultiDeviceAlignmentState::Collecting);
+		TestTrue(TEXT("Hands moved off the line then align"), Rig.TickUntilConverged() != INDEX_NONE);
+	}
+
+	{
+		FAlignmentRig Rig;
+		for (int32 TickIndex = 0; TickIndex < 900; TickIndex++)
+		{
+			Rig.Tick(Rig.RandomPose(false), Rig.RandomPose(false));
+		}
+		TestEqual(TEXT("Hands held in one orientation aren't solved"), Rig.NumCorrections, 0);
+		TestTrue(TEXT("Hands turned then align"), Rig.TickUntilConverged() != INDEX_NONE);
+	}
+	return true;
+}
+
+#endif
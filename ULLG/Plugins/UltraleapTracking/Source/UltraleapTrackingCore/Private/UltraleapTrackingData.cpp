@@ -439,14 +439,35 @@ FLeapOptions::FLeapOptions()
 	EndPinchThreshold = .5f;
 	GrabTimeout = 100000;
 	PinchTimeout = 100000;
+	GrabDebounce = 0;
+	PinchDebounce = 0;
+	VisibilityTimeout = 0;
 	bUseOpenXRAsSource = false;
+	bTimeAlignCombinedDevices = false;
+	CombinedDeviceLatencyBudgetMS = 20.f;
+	bCombineDevicesAsync = false;
+	bWaitForCombinedFrame = false;
+	JointOcclusionFactor = 0.f;
+	bUseAnalyticJointOcclusion = false;
+	KalmanProcessNoise = 10000.f;
+	KalmanMeasurementNoise = .25f;
+	KalmanPredictionTime = 0.f;
+	bSkipUnchangedFrames = true;
+	bBroadcastUnchangedFrames = true;
+	bEnableIdleMode = false;
+	IdleTimeout = 5.f;
+	bIdleLowPowerPolicies = true;
+	bEnableLiveLinkInPackagedBuilds = false;
+	bUseLiveLinkLoopback = false;
+	LiveLinkPublishRate = 0.f;
+	LiveLinkDecimation = 1;
 
 	HMDPositionOffset = FVector(80.f, 0, 0);
 	HMDRotationOffset = FRotator(0, 0, 0);
 	// bEnableImageStreaming = false;		//default image streaming to off
 }
 
-FLeapStats::FLeapStats() : FrameExtrapolationInMS(0)
+FLeapStats::FLeapStats() : FrameExtrapolationInMS(0), CombinedFrameDelayInMS(0), bIsIdle(false), IdleTimeSavedInMS(0)
 {
 }
 
@@ -13,7 +13,25 @@
 
 class ULeapComponent;
 
+/** A hand as sampled by the game thread, used to late update it on the render thread */
+struct FLeapLateUpdateSample
+{
+	// Leap time (microseconds) the hand was sampled at
+	int64 TimeStamp = 0;
+	// Sample time relative to LeapGetNow() when it was taken, render thread samples are taken the same distance from their now
+	int64 TimeOffset = 0;
+	// Palm as converted from LeapC, before any tracking mode and HMD transforms
+	FTransform RawPalm;
+	// Palm as in the device's frame data
+	FTransform FramePalm;
+	// Mount offsets the raw palm was converted with
+	FVector HMDPositionOffset = FVector::ZeroVector;
+	FQuat HMDRotationOffset = FQuat::Identity;
+	bool bValid = false;
+};
 
+/** A parsed frame shared by every reader of a device, never changed once published. Copy it to make changes */
+typedef TSharedRef<const FLeapFrameData, ESPMode::ThreadSafe> FLeapFrameSnapshot;
 
 class IHandTrackingDevice
 {
@@ -25,6 +43,8 @@ public:
 	virtual void SendControllerEvents() = 0;
 
 	virtual void GetLatestFrameData(FLeapFrameData& OutData, const bool ApplyDeviceOrigin  = false) = 0;
+	/** Latest frame without copying it, prefer this to GetLatestFrameData outside Blueprint */
+	virtual FLeapFrameSnapshot GetLatestFrameSnapshot(const bool ApplyDeviceOrigin = false) = 0;
 	virtual void AreHandsVisible(bool& LeftHandIsVisible, bool& RightHandIsVisible) = 0;
 	virtual void SetOptions(const FLeapOptions& InOptions) = 0;
 	virtual FLeapOptions GetOptions() = 0;
@@ -36,6 +56,8 @@ public:
 	virtual bool GetJointOcclusionConfidences(const FString& DeviceSerial, TArray<float>& Left, TArray<float>& Right) = 0;
 	virtual void GetDebugInfo(int32& NumCombinedLeft, int32& NumCombinedRight) = 0;
 	virtual int32 GetBodyStateDeviceID() = 0;
+	/** The sample the latest frame's hand was taken from, false if the hand isn't tracked or can't be late updated */
+	virtual bool GetLateUpdateSample(const EHandType HandType, FLeapLateUpdateSample& OutSample) = 0;
 };
 class ITrackingDeviceWrapper
 {
@@ -98,6 +120,12 @@ public:
 	/** Uses leap method to get an interpolated frame at a given leap timestamp in microseconds given by e.g. LeapGetNow()*/
 	virtual LEAP_TRACKING_EVENT* GetInterpolatedFrameAtTime(int64 TimeStamp) = 0;
 	virtual LEAP_TRACKING_EVENT* GetInterpolatedFrameAtTimeEx(int64 TimeStamp, const uint32_t DeviceID = 0) = 0;
+	/** As GetInterpolatedFrameAtTime but into the caller's buffer so it can be called from any thread, e.g. the render thread
+	 * for late updates. Returns nullptr if not supported */
+	virtual LEAP_TRACKING_EVENT* InterpolateFrameAtTime(int64 TimeStamp, TArray<uint8>& FrameBuffer)
+	{
+		return nullptr;
+	}
 	virtual LEAP_DEVICE_INFO* GetDeviceProperties() = 0;
 
 	virtual const char* ResultString(eLeapRS Result) = 0;
@@ -145,6 +173,8 @@ public:
 	// if in singular mode pass one tracking device serial
 	virtual class IHandTrackingWrapper* GetDevice(const TArray<FString>& DeviceSerial,
 		const ELeapDeviceCombinerClass DeviceCombinerClass, const bool AllowOpenXRAsFallback) = 0;
+	// singular device lookup without building a serial list, an empty serial gets the default device
+	virtual class IHandTrackingWrapper* GetDeviceBySerial(const FString& DeviceSerial, const bool AllowOpenXRAsFallback) = 0;
 
 	virtual void TickDevices(const float DeltaTime) = 0;
 	virtual void TickSendControllerEventsOnDevices() = 0;
@@ -27,6 +27,27 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FLeapPolicySignature, TArray<TEnumAs
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FLeapImageEventSignature, UTexture2D*, Texture, ELeapImageType, ImageType);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FLeapTrackingModeSignature, ELeapMode, Flag);
 
+/** Events a component has handlers bound for, devices skip components and events nobody listens to */
+enum class ELeapEventSubscription : uint32
+{
+	None = 0,
+	TrackingData = 1 << 0,
+	LeftHandTrackingData = 1 << 1,
+	RightHandTrackingData = 1 << 2,
+	HandBeginTracking = 1 << 3,
+	HandEndTracking = 1 << 4,
+	LeftHandVisibilityChanged = 1 << 5,
+	RightHandVisibilityChanged = 1 << 6,
+	HandPinched = 1 << 7,
+	HandUnpinched = 1 << 8,
+	HandGrabbed = 1 << 9,
+	HandReleased = 1 << 10,
+	// Which hands the hand events (tracking, pinch, grab) are wanted for
+	LeftHand = 1 << 16,
+	RightHand = 1 << 17
+};
+ENUM_CLASS_FLAGS(ELeapEventSubscription);
+
 UCLASS(ClassGroup = "Input Controller", meta = (BlueprintSpawnableComponent))
 
 class ULTRALEAPTRACKING_API ULeapComponent : public UActorComponent, public ILeapConnectorCallbacks
@@ -47,6 +68,15 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "Leap Events")
 	FLeapFrameSignature OnLeapTrackingData;
 
+	/** Event called when new tracking data is available with just the left hand, only while it is tracked. Cheaper than
+	 * OnLeapTrackingData when only one hand is needed */
+	UPROPERTY(BlueprintAssignable, Category = "Leap Events")
+	FLeapHandSignature OnLeftHandTrackingData;
+
+	/** Event called when new tracking data is available with just the right hand, only while it is tracked */
+	UPROPERTY(BlueprintAssignable, Category = "Leap Events")
+	FLeapHandSignature OnRightHandTrackingData;
+
 	/** Event called when a leap hand grab gesture is detected */
 	UPROPERTY(BlueprintAssignable, Category = "Leap Events")
 	FLeapHandSignature OnHandGrabbed;
@@ -96,6 +126,17 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "Leap Events")
 	FLeapEventSignature OnLeapServiceDisconnected;
 
+	/** Receive the grab, pinch and begin/end tracking events of the left hand */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Events")
+	bool bReceiveLeftHandEvents;
+
+	/** Receive the grab, pinch and begin/end tracking events of the right hand */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Events")
+	bool bReceiveRightHandEvents;
+
+	/** Events this component has handlers bound for, the devices check this every frame */
+	ELeapEventSubscription GetEventSubscriptions() const;
+
 	/** Tracking mode optimization */
 	UPROPERTY(BlueprintReadOnly, Category = "Leap Properties")
 	TEnumAsByte<ELeapMode> TrackingMode;
@@ -119,6 +160,9 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Leap Functions")
 	void GetLatestFrameData(FLeapFrameData& OutData, const bool ApplyDeviceOrigin = false);
 
+	/** Latest frame shared with the device's other readers, null without a device. Use from C++ to avoid the copy */
+	TSharedPtr<const FLeapFrameData, ESPMode::ThreadSafe> GetLatestFrameSnapshot(const bool ApplyDeviceOrigin = false);
+
 	UFUNCTION(BlueprintCallable, Category = "Leap Functions")
 	void SetSwizzles(ELeapQuatSwizzleAxisB ToX, ELeapQuatSwizzleAxisB ToY, ELeapQuatSwizzleAxisB ToZ, ELeapQuatSwizzleAxisB ToW);
 	
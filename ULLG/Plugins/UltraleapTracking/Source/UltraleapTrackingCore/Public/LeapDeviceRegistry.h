@@ -0,0 +1,117 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+
+#pragma once
+#include "CoreMinimal.h"
+#include "LeapC.h"
+#include "UltraleapTrackingData.h"
+
+class IHandTrackingWrapper;
+class LeapWrapperCallbackInterface;
+
+/**
+ * Every device known to the connector. Devices get a stable slot index for their lifetime and are looked up by serial,
+ * LeapC device id or (for combined devices) combiner class and serial set through hashes, combined lookups don't
+ * allocate. The tick lists are only rebuilt when a device is added or removed. Devices and lists are game thread only,
+ * the per device id LeapC state is also read from the service thread and is locked.
+ */
+class FLeapDeviceRegistry
+{
+public:
+	/** Adds a real device, returns its slot index */
+	int32 AddDevice(IHandTrackingWrapper* Device);
+	/** Adds a combined device, keyed by the combiner class and the serials it was requested with in any order.
+	 * MissingSerials are the requested serials that weren't connected when it was created */
+	int32 AddCombinedDevice(IHandTrackingWrapper* Device, const TArray<FString>& DeviceSerials,
+		const ELeapDeviceCombinerClass DeviceCombinerClass, const TArray<FString>& MissingSerials);
+	/** Removes a real or combined device, the caller still owns it */
+	bool RemoveDevice(IHandTrackingWrapper* Device);
+	/** Removes every device, the caller still owns them */
+	void Reset();
+
+	IHandTrackingWrapper* FindDeviceBySerial(const FString& DeviceSerial) const;
+	IHandTrackingWrapper* FindDeviceByID(const uint32 DeviceID) const;
+	IHandTrackingWrapper* FindCombinedDevice(
+		const TArray<FString>& DeviceSerials, const ELeapDeviceCombinerClass DeviceCombinerClass) const;
+	/** Combined devices created without DeviceSerial connected, they should be rebuilt now it is */
+	void FindCombinedDevicesMissing(const FString& DeviceSerial, TArray<IHandTrackingWrapper*>& OutDevices) const;
+
+	/** INDEX_NONE if the device isn't registered */
+	int32 GetSlotIndex(IHandTrackingWrapper* Device) const;
+	IHandTrackingWrapper* GetDeviceInSlot(const int32 SlotIndex) const;
+
+	/** Real devices in the order they were added */
+	const TArray<IHandTrackingWrapper*>& GetDevices() const
+	{
+		return Devices;
+	}
+	const TArray<IHandTrackingWrapper*>& GetCombinedDevices() const
+	{
+		return CombinedDevices;
+	}
+	/** Real devices followed by combined devices, as combined devices read the real devices when they tick */
+	const TArray<IHandTrackingWrapper*>& GetTickList() const
+	{
+		return TickList;
+	}
+	/** Changes whenever a device is added or removed */
+	uint32 GetVersion() const
+	{
+		return Version;
+	}
+
+	// Per LeapC device id state, safe to call from any thread
+	void SetDeviceHandle(const uint32 DeviceID, const LEAP_DEVICE DeviceHandle);
+	LEAP_DEVICE GetDeviceHandle(const uint32 DeviceID) const;
+	void SetCallbackDelegate(const uint32 DeviceID, LeapWrapperCallbackInterface* CallbackDelegate);
+	LeapWrapperCallbackInterface* GetCallbackDelegate(const uint32 DeviceID) const;
+	void RemoveDeviceID(const uint32 DeviceID);
+	void ClearCallbackDelegates();
+
+private:
+	struct FDeviceSlot
+	{
+		IHandTrackingWrapper* Device = nullptr;
+		// Real devices only
+		FString Serial;
+		uint32 DeviceID = 0;
+		bool bCombined = false;
+		// Combined devices only
+		uint32 CombinedHash = 0;
+		ELeapDeviceCombinerClass CombinerClass = ELeapDeviceCombinerClass::LEAP_DEVICE_COMBINER_UNKNOWN;
+		TArray<FString> CombinedSerials;
+		TArray<FString> MissingSerials;
+	};
+	TSparseArray<FDeviceSlot> Slots;
+
+	TMap<IHandTrackingWrapper*, int32> DeviceToSlot;
+	TMap<FString, int32> SerialToSlot;
+	TMap<uint32, int32> DeviceIDToSlot;
+	// Combined hashes can collide, matches are confirmed against the slot's serials
+	TMultiMap<uint32, int32> CombinedHashToSlot;
+
+	TArray<IHandTrackingWrapper*> Devices;
+	TArray<IHandTrackingWrapper*> CombinedDevices;
+	TArray<IHandTrackingWrapper*> TickList;
+	uint32 Version = 0;
+
+	struct FDeviceConnection
+	{
+		LEAP_DEVICE DeviceHandle = nullptr;
+		LeapWrapperCallbackInterface* CallbackDelegate = nullptr;
+	};
+	TMap<uint32, FDeviceConnection> DeviceConnections;
+	mutable FRWLock DeviceConnectionsLock;
+
+	void RebuildLists();
+	// Independent of serial order, so lookups don't have to sort
+	static uint32 HashCombinedKey(const TArray<FString>& DeviceSerials, const ELeapDeviceCombinerClass DeviceCombinerClass);
+	static bool MatchesCombinedKey(
+		const FDeviceSlot& Slot, const TArray<FString>& DeviceSerials, const ELeapDeviceCombinerClass DeviceCombinerClass);
+};
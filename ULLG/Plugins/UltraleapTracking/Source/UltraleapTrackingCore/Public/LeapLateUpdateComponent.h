@@ -0,0 +1,112 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+
+#pragma once
+
+#include "Components/SceneComponent.h"
+#include "CoreMinimal.h"
+#include "LeapC.h"
+#include "IUltraleapTrackingPlugin.h"
+#include "LateUpdateManager.h"
+#include "SceneViewExtension.h"
+#include "UltraleapTrackingData.h"
+
+#include "LeapLateUpdateComponent.generated.h"
+
+/**
+ * Late updates the primitives attached below it with the latest movement of one hand, like a motion controller's late
+ * update. Just before rendering, the render thread samples the hand again and moves the attached primitives (hand mesh
+ * roots, BodyState bone followers) by how far the palm moved since the game thread sampled it.
+ * Place it where the hand meshes' tracking space is, i.e. as the parent the hand meshes would otherwise be attached to.
+ * Leap devices only, combined and OpenXR devices are not late updated.
+ */
+UCLASS(ClassGroup = "Input Controller", meta = (BlueprintSpawnableComponent))
+class ULTRALEAPTRACKING_API ULeapLateUpdateComponent : public USceneComponent, public ILeapConnectorCallbacks
+{
+	GENERATED_UCLASS_BODY()
+public:
+	/** Hand the attached primitives follow */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Late Update")
+	TEnumAsByte<EHandType> Hand;
+
+	/** Late update the attached primitives, off leaves them where the game thread put them */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Late Update")
+	bool bLateUpdate;
+
+	/** Device to sample, empty for the default device */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Late Update")
+	FString DeviceSerial;
+
+	/** Extra time (ms) to predict the hand ahead by on top of the device's own interpolation, e.g. the scan out time of the
+	 * display */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Leap Late Update", meta = (ClampMin = "0.0", ClampMax = "50.0"))
+	float AdditionalPredictionMS;
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// ILeapConnectorCallbacks implementation
+	virtual void OnDeviceAdded(IHandTrackingWrapper* DeviceWrapper) override;
+	virtual void OnDeviceRemoved(IHandTrackingWrapper* DeviceWrapper) override;
+
+protected:
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+
+private:
+	class FViewExtension : public FSceneViewExtensionBase
+	{
+	public:
+		FViewExtension(const FAutoRegister& AutoRegister, ULeapLateUpdateComponent* InComponent);
+
+		virtual void SetupViewFamily(FSceneViewFamily& InViewFamily) override
+		{
+		}
+		virtual void SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView) override
+		{
+		}
+		virtual void BeginRenderViewFamily(FSceneViewFamily& InViewFamily) override;
+		virtual void PreRenderView_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneView& InView) override
+		{
+		}
+		virtual void PreRenderViewFamily_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily) override;
+		virtual void PostRenderViewFamily_RenderThread(FRHICommandListImmediate& RHICmdList, FSceneViewFamily& InViewFamily) override;
+		virtual int32 GetPriority() const override
+		{
+			// after the motion controllers, so a hand attached to a late updated camera sees its final transform
+			return -20;
+		}
+
+	protected:
+		virtual bool IsActiveThisFrame_Internal(const FSceneViewExtensionContext& Context) const override;
+
+	private:
+		friend class ULeapLateUpdateComponent;
+
+		// Guarded by CritSect, the component and device are cleared on the game thread before they go
+		ULeapLateUpdateComponent* Component;
+		IHandTrackingWrapper* Device = nullptr;
+		FLeapLateUpdateSample Sample;
+		EHandType HandType = EHandType::LEAP_HAND_LEFT;
+		int64 AdditionalPrediction = 0;
+		FTransform RelativeTransform;
+		FTransform ComponentToWorld;
+		FTransform ParentToWorld;
+		mutable FCriticalSection CritSect;
+		// Held by the render thread while it samples Device, taken by the game thread before it clears Device for good
+		FCriticalSection DeviceInUseSect;
+
+		FLateUpdateManager LateUpdate;
+		// Render thread only
+		TArray<uint8> FrameBuffer;
+	};
+	TSharedPtr<FViewExtension, ESPMode::ThreadSafe> ViewExtension;
+
+	IHandTrackingWrapper* CurrentDevice = nullptr;
+	void UpdateDevice();
+};
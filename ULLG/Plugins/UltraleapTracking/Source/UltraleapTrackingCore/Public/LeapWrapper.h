@@ -13,6 +13,10 @@
 #include "LeapC.h"
 #include "UltraleapTrackingData.h"
 #include "IUltraleapTrackingPlugin.h"
+#include "LeapDeviceRegistry.h"
+
+class FLeapHotPlugQueue;
+class FLeapPollThread;
 
 
 class FLeapWrapperBase : public IHandTrackingWrapper, public ITrackingDeviceWrapper
@@ -201,6 +205,7 @@ public:
 	/** Uses leap method to get an interpolated frame at a given leap timestamp in microseconds given by e.g. LeapGetNow()*/
 	virtual LEAP_TRACKING_EVENT* GetInterpolatedFrameAtTime(int64 TimeStamp) override;
 	virtual LEAP_TRACKING_EVENT* GetInterpolatedFrameAtTimeEx(int64 TimeStamp, const uint32_t DeviceID = 0) override;
+	virtual LEAP_TRACKING_EVENT* InterpolateFrameAtTime(int64 TimeStamp, TArray<uint8>& FrameBuffer) override;
 
 	virtual LEAP_DEVICE_INFO* GetDeviceProperties() override
 	{
@@ -258,6 +263,7 @@ public:
 	virtual void GetDeviceSerials(TArray<FString>& DeviceSerials) override;
 	virtual IHandTrackingWrapper* GetDevice(
 		const TArray<FString>& DeviceSerial, const ELeapDeviceCombinerClass DeviceCombinerClass, const bool AllowOpenXRAsFallback) override;
+	virtual IHandTrackingWrapper* GetDeviceBySerial(const FString& DeviceSerial, const bool AllowOpenXRAsFallback) override;
 	virtual void TickDevices(const float DeltaTime);
 	virtual void TickSendControllerEventsOnDevices();
 	virtual ELeapDeviceType GetDeviceTypeFromSerial(const FString& DeviceSerial) override;
@@ -271,17 +277,15 @@ private:
 	void Millisleep(int Milliseconds);
 
 	LeapWrapperCallbackInterface* ConnectorCallbackDelegate = nullptr;
-	TMap<uint32_t, LeapWrapperCallbackInterface*> MapDeviceToCallback;
-	TMap<uint32_t, LEAP_DEVICE> MapDeviceIDToDevice;
 
 	LeapWrapperCallbackInterface* GetCallbackDelegateFromDeviceID(const uint32_t DeviceID);
 	
 	// Frame and handle data
-	// Actual connected devices
-	TArray <IHandTrackingWrapper*> Devices;
+	// Actual connected and aggregated/combined devices, device handles and callbacks
+	FLeapDeviceRegistry DeviceRegistry;
 	TArray<IHandTrackingWrapper*> DevicesToCleanup;
-	// Aggregated/combined devices
-	TArray<IHandTrackingWrapper*> CombinedDevices;
+	// Device found/lost events from the poll thread, applied in TickDevices
+	TUniquePtr<FLeapHotPlugQueue> HotPlugQueue;
 
 	TArray<ILeapConnectorCallbacks*> LeapConnectorCallbacks;
 
@@ -289,7 +293,7 @@ private:
 
 	// Threading variables
 	FCriticalSection* DataLock;
-	TFuture<void> ProducerLambdaFuture;
+	TUniquePtr<FLeapPollThread> PollThread;
 
 	LEAP_TRACKING_EVENT* InterpolatedFrame;
 	uint64 InterpolatedFrameSize;
@@ -313,7 +317,8 @@ private:
 	//void SetDevice(const LEAP_DEVICE_INFO* DeviceProps);
 	
 
-	void ServiceMessageLoop(void* unused = nullptr);
+	/** Dispatches one message returned by LeapPollConnection() on the poll thread */
+	void ServiceMessage(const LEAP_CONNECTION_MESSAGE& Msg);
 
 	// Received LeapC callbacks converted into game thread events
 	void HandleConnectionEvent(const LEAP_CONNECTION_EVENT* ConnectionEvent);
@@ -334,10 +339,13 @@ private:
 
 	void AddDevice(const uint32_t DeviceID, const LEAP_DEVICE_INFO& DeviceInfo, const LEAP_DEVICE DeviceHandle);
 	void RemoveDevice(const uint32_t DeviceID);
+	void ProcessHotPlugEvents();
 
 	void AddOpenXRDevice(LeapWrapperCallbackInterface* InCallbackDelegate);
 
 	IHandTrackingWrapper* GetSingularDeviceBySerial(const FString& DeviceSerial);
+	IHandTrackingWrapper* GetFallbackDevice(const bool AllowOpenXR);
+	void ForEachTickDevice(TFunctionRef<void(IHandTrackingDevice*)> Function);
 	LEAP_DEVICE GetDeviceHandleFromDeviceID(const uint32_t DeviceID);
 	
 	IHandTrackingWrapper* FindAggregator(const TArray<FString>& DeviceSerials, const ELeapDeviceCombinerClass DeviceCombinerClass);
@@ -347,6 +355,9 @@ private:
 	void NotifyDeviceAdded(IHandTrackingWrapper* Device);
 	void NotifyDeviceRemoved(IHandTrackingWrapper* Device);
 	void CleanupCombinedDevicesReferencingDevice(IHandTrackingWrapper* Device);
+	// Combined devices created before Device connected are missing it, removed so the next lookup rebuilds them whole
+	void CleanupCombinedDevicesMissingDevice(IHandTrackingWrapper* Device);
+	void DestroyCombinedDevices(const TArray<IHandTrackingWrapper*>& CombinedDevices);
 	void RemoveDeviceDirect(const uint32_t DeviceID);
 
 };
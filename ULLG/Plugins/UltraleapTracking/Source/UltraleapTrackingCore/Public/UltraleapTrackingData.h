@@ -109,7 +109,8 @@ enum ELeapDeviceCombinerClass
 {
 	LEAP_DEVICE_COMBINER_UNKNOWN,
 	LEAP_DEVICE_COMBINER_CONFIDENCE,
-	LEAP_DEVICE_COMBINER_ANGULAR
+	LEAP_DEVICE_COMBINER_ANGULAR,
+	LEAP_DEVICE_COMBINER_KALMAN
 	// add your custom classes here and add them to the class factory in LeapWrapper
 };
 	USTRUCT(BlueprintType)
@@ -172,6 +173,22 @@ struct ULTRALEAPTRACKING_API FLeapStats
 
 	UPROPERTY(BlueprintReadOnly, Category = "Leap Stats")
 	float FrameExtrapolationInMS;
+
+	/** Combined devices only, how far behind the combined frame time each source device's newest frame is */
+	UPROPERTY(BlueprintReadOnly, Category = "Leap Stats")
+	TArray<float> SourceDeviceLagInMS;
+
+	/** Combined devices only, how far in the past source devices are resampled to so they line up */
+	UPROPERTY(BlueprintReadOnly, Category = "Leap Stats")
+	float CombinedFrameDelayInMS;
+
+	/** True while idle mode has cut the device down to a presence check */
+	UPROPERTY(BlueprintReadOnly, Category = "Leap Stats")
+	bool bIsIdle;
+
+	/** Estimated game thread and BodyState time saved by idle mode since the device started */
+	UPROPERTY(BlueprintReadOnly, Category = "Leap Stats")
+	float IdleTimeSavedInMS;
 };
 
 USTRUCT(BlueprintType)
@@ -252,10 +269,105 @@ struct ULTRALEAPTRACKING_API FLeapOptions
 	UPROPERTY(BlueprintReadWrite, Category = "Gesture Options")
 	float PinchTimeout;
 
+	/** How long (microseconds) grab strength has to stay above StartGrabThreshold before a grab starts. Filters out
+	 * single frame spikes at the cost of grab latency */
+	UPROPERTY(BlueprintReadWrite, Category = "Gesture Options")
+	float GrabDebounce;
+
+	/** How long (microseconds) pinch strength has to stay above StartPinchThreshold before a pinch starts */
+	UPROPERTY(BlueprintReadWrite, Category = "Gesture Options")
+	float PinchDebounce;
+
+	/** How long (microseconds) a hand stays visible after leaving the frame, 0 ends tracking on the first frame without it */
+	UPROPERTY(BlueprintReadWrite, Category = "Gesture Options")
+	float VisibilityTimeout;
+
 	/** Experimental: Pull tracking data from OpenXR instead of LeapC.dll. Note that Pinch and Grasp events and strength are not yet
 	 * implemented  */
 	UPROPERTY(BlueprintReadWrite, Category = "Leap Options")
 	bool bUseOpenXRAsSource;
+
+	/** Combined devices only, resample every source device to a common timestamp before combining rather than
+	 * combining whatever frame each device last produced */
+	UPROPERTY(BlueprintReadWrite, Category = "Multi Device Options")
+	bool bTimeAlignCombinedDevices;
+
+	/** Combined devices only, the furthest back in time (ms) source devices are resampled to when waiting for the
+	 * slowest device. Lower favours latency, higher keeps fast hands aligned across devices */
+	UPROPERTY(BlueprintReadWrite, Category = "Multi Device Options")
+	float CombinedDeviceLatencyBudgetMS;
+
+	/** Combined devices only, combine source frames on a worker task so the game thread only picks up the result. The
+	 * combined frame is then up to one tick behind the source devices */
+	UPROPERTY(BlueprintReadWrite, Category = "Multi Device Options")
+	bool bCombineDevicesAsync;
+
+	/** Combined devices only, with async combining wait for the combine kicked this tick to finish so the combined
+	 * frame is always from the same tick as the source device frames */
+	UPROPERTY(BlueprintReadWrite, Category = "Multi Device Options")
+	bool bWaitForCombinedFrame;
+
+	/** Confidence combiner only, how much joint occlusion lowers the confidence of a source device's joints. 0 turns
+	 * occlusion off */
+	UPROPERTY(BlueprintReadWrite, Category = "Multi Device Options", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float JointOcclusionFactor;
+
+	/** Confidence combiner only, estimate joint occlusion by tracing rays from each device against the hand's bones on
+	 * the CPU instead of rendering the hands with a Joint Occlusion Actor */
+	UPROPERTY(BlueprintReadWrite, Category = "Multi Device Options")
+	bool bUseAnalyticJointOcclusion;
+
+	/** Kalman combiner only, acceleration noise (cm^2/s^3). Higher follows fast movement more closely but passes
+	 * through more jitter */
+	UPROPERTY(BlueprintReadWrite, Category = "Multi Device Options", meta = (ClampMin = "0.0"))
+	float KalmanProcessNoise;
+
+	/** Kalman combiner only, variance (cm^2) of a fully confident measurement. Higher smooths more at the cost of
+	 * latency */
+	UPROPERTY(BlueprintReadWrite, Category = "Multi Device Options", meta = (ClampMin = "0.001"))
+	float KalmanMeasurementNoise;
+
+	/** Kalman combiner only, seconds to predict the combined hand forward on top of the time alignment delay */
+	UPROPERTY(BlueprintReadWrite, Category = "Multi Device Options", meta = (ClampMin = "0.0", ClampMax = "0.1"))
+	float KalmanPredictionTime;
+
+	/** Skip frame conversion, gesture checks and BodyState updates on ticks where the device has no new tracking
+	 * frame. Has no effect while interpolating as every tick then produces a new frame */
+	UPROPERTY(BlueprintReadWrite, Category = "Leap Options")
+	bool bSkipUnchangedFrames;
+
+	/** With bSkipUnchangedFrames, still broadcast the tracking data delegates every tick */
+	UPROPERTY(BlueprintReadWrite, Category = "Leap Options")
+	bool bBroadcastUnchangedFrames;
+
+	/** After IdleTimeout seconds without hands, only check for hands each tick until one appears. Events, tracking
+	 * data and BodyState updates pause while idle and resume on the tick a hand is seen */
+	UPROPERTY(BlueprintReadWrite, Category = "Idle Options")
+	bool bEnableIdleMode;
+
+	/** Seconds without hands before the device goes idle */
+	UPROPERTY(BlueprintReadWrite, Category = "Idle Options", meta = (ClampMin = "0.0"))
+	float IdleTimeout;
+
+	/** While idle, turn off the image and map point policies so the service does less work, restored on waking */
+	UPROPERTY(BlueprintReadWrite, Category = "Idle Options")
+	bool bIdleLowPowerPolicies;
+
+	/** Publish tracking over LiveLink in packaged builds as well as in the editor */
+	UPROPERTY(BlueprintReadWrite, Category = "LiveLink Options")
+	bool bEnableLiveLinkInPackagedBuilds;
+
+	/** Publish to the LiveLink client in this process instead of over the message bus */
+	UPROPERTY(BlueprintReadWrite, Category = "LiveLink Options")
+	bool bUseLiveLinkLoopback;
+
+	/** Maximum LiveLink frames published per second, 0 publishes every tracking update */
+	UPROPERTY(BlueprintReadWrite, Category = "LiveLink Options")
+	float LiveLinkPublishRate;
+
+	/** Publish only every Nth tracking update over LiveLink */
+	UPROPERTY(BlueprintReadWrite, Category = "LiveLink Options")
+	int32 LiveLinkDecimation;
 };
 
 USTRUCT(BlueprintType)
@@ -126,6 +126,7 @@ namespace UnrealBuildTool.Rules
 				new string[]
 				{
 					// ... add private dependencies that you statically link with here ...
+					"UltraleapTrackingShaders",
 				}
 				);
 
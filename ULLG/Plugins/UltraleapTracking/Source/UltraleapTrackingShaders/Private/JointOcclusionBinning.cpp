@@ -0,0 +1,101 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "JointOcclusionBinning.h"
+
+#include "GlobalShader.h"
+#include "RHIGPUReadback.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "RenderTargetPool.h"
+#include "ShaderParameterStruct.h"
+
+namespace
+{
+constexpr int32 ThreadGroupSize = 8;
+static_assert(ThreadGroupSize * ThreadGroupSize == JointOcclusionBinning::MaxPaletteColours,
+	"Each thread of a group clears and flushes one palette entry");
+
+class FJointOcclusionBinningCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FJointOcclusionBinningCS);
+	SHADER_USE_PARAMETER_STRUCT(FJointOcclusionBinningCS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE(Texture2D, InputTexture)
+		SHADER_PARAMETER(FIntPoint, TextureSize)
+		SHADER_PARAMETER(uint32, PaletteCount)
+		SHADER_PARAMETER(uint32, bDecodeSRGB)
+		SHADER_PARAMETER(float, ToleranceSquared)
+		SHADER_PARAMETER_ARRAY(FVector4f, PaletteColours, [JointOcclusionBinning::MaxPaletteColours])
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWStructuredBuffer<uint>, BinCounts)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+	static void ModifyCompilationEnvironment(
+		const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), ThreadGroupSize);
+		OutEnvironment.SetDefine(TEXT("MAX_PALETTE_COLOURS"), JointOcclusionBinning::MaxPaletteColours);
+	}
+};
+IMPLEMENT_GLOBAL_SHADER(
+	FJointOcclusionBinningCS, "/Plugin/UltraleapTracking/Private/JointOcclusionBinning.usf", "MainCS", SF_Compute);
+
+// The CPU read converts 8 bit colours from sRGB, unless the hardware does it on load
+bool NeedsSRGBDecode(const FRHITexture* Texture)
+{
+	const EPixelFormat Format = Texture->GetFormat();
+	return (Format == PF_B8G8R8A8 || Format == PF_R8G8B8A8) && !EnumHasAnyFlags(Texture->GetFlags(), TexCreate_SRGB);
+}
+}	 // namespace
+
+bool JointOcclusionBinning::IsSupported(const int32 NumPaletteColours)
+{
+	return NumPaletteColours <= MaxPaletteColours && IsFeatureLevelSupported(GMaxRHIShaderPlatform, ERHIFeatureLevel::SM5);
+}
+
+void JointOcclusionBinning::AddBinningPass(FRHICommandListImmediate& RHICmdList, FRHITexture* Texture,
+	const TArray<FLinearColor>& Palette, const float Tolerance, FRHIGPUBufferReadback& Readback)
+{
+	check(IsInRenderingThread());
+	const int32 NumBins = FMath::Clamp(Palette.Num(), 1, MaxPaletteColours);
+	const FIntPoint Size(Texture->GetSizeXYZ().X, Texture->GetSizeXYZ().Y);
+
+	FRDGBuilder GraphBuilder(RHICmdList);
+	FRDGTextureRef InputTexture = GraphBuilder.RegisterExternalTexture(CreateRenderTarget(Texture, TEXT("JointOcclusionCapture")));
+	FRDGBufferRef BinCounts =
+		GraphBuilder.CreateBuffer(FRDGBufferDesc::CreateStructuredDesc(sizeof(uint32), NumBins), TEXT("JointOcclusionBinCounts"));
+	FRDGBufferUAVRef BinCountsUAV = GraphBuilder.CreateUAV(BinCounts);
+	AddClearUAVPass(GraphBuilder, BinCountsUAV, 0u);
+
+	FJointOcclusionBinningCS::FParameters* Parameters = GraphBuilder.AllocParameters<FJointOcclusionBinningCS::FParameters>();
+	Parameters->InputTexture = InputTexture;
+	Parameters->TextureSize = Size;
+	Parameters->PaletteCount = FMath::Min(Palette.Num(), MaxPaletteColours);
+	Parameters->bDecodeSRGB = NeedsSRGBDecode(Texture) ? 1 : 0;
+	Parameters->ToleranceSquared = FMath::Square(Tolerance);
+	for (int32 i = 0; i < (int32) Parameters->PaletteCount; i++)
+	{
+		Parameters->PaletteColours[i] = FVector4f(Palette[i].R, Palette[i].G, Palette[i].B, 0.f);
+	}
+	Parameters->BinCounts = BinCountsUAV;
+
+	TShaderMapRef<FJointOcclusionBinningCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	FComputeShaderUtils::AddPass(GraphBuilder, RDG_EVENT_NAME("JointOcclusionBinning %dx%d", Size.X, Size.Y), ComputeShader,
+		Parameters, FComputeShaderUtils::GetGroupCount(Size, ThreadGroupSize));
+
+	// only the counts come back, not the capture
+	AddEnqueueCopyPass(GraphBuilder, &Readback, BinCounts, NumBins * sizeof(uint32));
+	GraphBuilder.Execute();
+}
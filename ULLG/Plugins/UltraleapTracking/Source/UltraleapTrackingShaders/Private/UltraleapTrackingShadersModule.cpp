@@ -0,0 +1,26 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#include "UltraleapTrackingShadersModule.h"
+
+#include "Interfaces/IPluginManager.h"
+#include "Misc/Paths.h"
+#include "Modules/ModuleManager.h"
+#include "ShaderCore.h"
+
+IMPLEMENT_MODULE(FUltraleapTrackingShadersModule, UltraleapTrackingShaders);
+
+void FUltraleapTrackingShadersModule::StartupModule()
+{
+	// the plugin's Shaders directory as /Plugin/UltraleapTracking for the shader compiler
+	TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("UltraleapTracking"));
+	if (Plugin.IsValid())
+	{
+		AddShaderSourceDirectoryMapping(TEXT("/Plugin/UltraleapTracking"), FPaths::Combine(Plugin->GetBaseDir(), TEXT("Shaders")));
+	}
+}
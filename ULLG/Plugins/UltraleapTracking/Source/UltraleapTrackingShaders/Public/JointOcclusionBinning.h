@@ -0,0 +1,31 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+
+class FRHIGPUBufferReadback;
+
+namespace JointOcclusionBinning
+{
+// Palette entries binned per dispatch, one per thread of a group
+constexpr int32 MaxPaletteColours = 64;
+
+// Game thread, false where compute shaders aren't available and the capture has to be binned on the CPU
+ULTRALEAPTRACKINGSHADERS_API bool IsSupported(const int32 NumPaletteColours);
+
+/**
+ * Render thread. Counts the pixels of Texture matching each palette colour (within Tolerance, as AJointOcclusionActor
+ * matches on the CPU) into a structured buffer and queues a copy of just the counts, one uint32 per palette entry,
+ * into Readback
+ */
+ULTRALEAPTRACKINGSHADERS_API void AddBinningPass(FRHICommandListImmediate& RHICmdList, FRHITexture* Texture,
+	const TArray<FLinearColor>& Palette, const float Tolerance, FRHIGPUBufferReadback& Readback);
+}	 // namespace JointOcclusionBinning
@@ -0,0 +1,17 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "Modules/ModuleInterface.h"
+
+class FUltraleapTrackingShadersModule : public IModuleInterface
+{
+public:
+	virtual void StartupModule() override;
+};
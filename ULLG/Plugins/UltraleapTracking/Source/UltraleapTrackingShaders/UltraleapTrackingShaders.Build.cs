@@ -0,0 +1,36 @@
+/******************************************************************************
+ * Copyright (C) Ultraleap, Inc. 2011-2021.                                   *
+ *                                                                            *
+ * Use subject to the terms of the Apache License 2.0 available at            *
+ * http://www.apache.org/licenses/LICENSE-2.0, or another agreement           *
+ * between Ultraleap and you, your company or other organization.             *
+ ******************************************************************************/
+
+namespace UnrealBuildTool.Rules
+{
+	// Global shaders have to be registered before the engine compiles the global shader map, so they live in their own
+	// module loaded at PostConfigInit rather than in UltraleapTracking
+	public class UltraleapTrackingShaders : ModuleRules
+	{
+		public UltraleapTrackingShaders(ReadOnlyTargetRules Target) : base(Target)
+		{
+			PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+			PublicDependencyModuleNames.AddRange(
+				new string[]
+				{
+					"Core",
+					"RHI",
+					"RenderCore",
+				}
+				);
+
+			PrivateDependencyModuleNames.AddRange(
+				new string[]
+				{
+					"Projects",
+				}
+				);
+		}
+	}
+}